@@ -1,5 +1,7 @@
 #include "Controller.hpp"
 
+#include "imgui_impl_sdl2.h"
+
 Controller::Controller(Game &_game) : m_game(&_game) {
 }
 
@@ -16,7 +18,7 @@ void Controller::update() {
 	}
 
 	while (SDL_PollEvent(&event)) {
-		//ImGui_ImplSDL2_ProcessEvent(&event);
+		ImGui_ImplSDL2_ProcessEvent(&event);
 
 		switch (event.type) {
 		case SDL_KEYDOWN:
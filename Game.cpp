@@ -1,6 +1,6 @@
 #include "Game.hpp"
 
-Game::Game() {
+Game::Game() : m_level(MAP_WIDTH, MAP_HEIGHT, MAP_CELL_SIZE, m_map) {
 	m_px = 400.0f;
 	m_py = 300.0f;
 	m_pa = 0.0f;
@@ -8,6 +8,13 @@ Game::Game() {
 	m_mousey = 0.0f;
 
 	m_triangles = std::vector<Triangle>();
+	m_level.setTransparent(GLASS_WALL, true);
+	// a waist high wall in the open room and a low ceiling along the south
+	// wall, the raycaster sees past the first and under the second
+	m_level.setHeights(5, 5, { 0.0f, 1.0f, 0.4f });
+	for (int x = 1; x < MAP_WIDTH - 1; x++) {
+		m_level.setHeights(x, 6, { 0.0f, 0.8f, 1.0f });
+	}
 }
 
 Game::~Game() {
@@ -5,13 +5,16 @@
 #include <glm/glm.hpp>
 
 #include "Triangle.hpp"
+#include "VreMap.hpp"
 
 constexpr int MAP_WIDTH = 8;
 constexpr int MAP_HEIGHT = 8;
+constexpr int MAP_CELL_SIZE = 64;
+constexpr int GLASS_WALL = 6; // see through, tinted
 constexpr int m_map[] = {
 		1,1,1,1,1,1,1,1,
 		1,0,1,0,0,0,0,1,
-		1,0,1,0,0,0,0,1,
+		1,0,6,0,0,0,0,1,
 		1,0,1,0,0,0,0,1,
 		1,0,0,0,0,0,0,1,
 		1,0,0,0,0,1,0,1,
@@ -32,6 +35,9 @@ public:
 
 	std::vector<Triangle> m_triangles;
 
+	// runtime copy of m_map, this is what the raycaster reads
+	vre::VreMap m_level;
+
 	int m_mousex;
 	int m_mousey;
 	float m_px;
@@ -8,6 +8,9 @@ constexpr unsigned int FRAME_OVERLAP = 2;
 constexpr bool VYSNC = false;
 constexpr int WINDOW_WIDTH = 800;
 constexpr int WINDOW_HEIGHT = 600;
+// the path tracer renders at this size and is scaled to the window
+constexpr int PATH_TRACE_WIDTH = 1280;
+constexpr int PATH_TRACE_HEIGHT = 720;
 
 
 #define VK_CHECK(x)                                                 \
@@ -1,9 +1,19 @@
 #include "View.hpp"
 
+#include <algorithm>
+#include <chrono>
+
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE // forces depth to [0,1] instead of [-1,1]
 #include <glm/glm.hpp>
 
+#include "imgui.h"
+#include "imgui_impl_sdl2.h"
+#include "imgui_impl_vulkan.h"
+
+#include "VreRayStats.hpp"
+#include "VreStatsPanel.hpp"
+
 namespace vre {
 	struct SimplePushConstantData {
 		glm::vec2 offset;
@@ -17,17 +27,263 @@ View::View(Game &_game) : m_game(&_game) {
 	createPipelineLayout();
 	recreateSwapchain();
 	createCommandBuffers();
+	initImgui();
+
+	m_raycaster.bindMap(m_game->m_level);
+
+	m_segmentMap = vre::VreSegmentMap::fromGrid(m_game->m_level);
+	m_bsp.loadOrBuild(m_segmentMap.segments(), "./level.bsp");
+	m_bspRenderer = std::make_unique<vre::VreBspRenderer>(m_bsp, m_segmentMap.cellSize());
+	m_bvh.build(m_segmentMap.segments());
+	m_bvhRenderer = std::make_unique<vre::VreBvhRenderer>(m_bvh, m_segmentMap.segments(),
+		m_segmentMap.cellSize());
+
+	m_terrain = vre::VreTerrain::generate(10, 1);
+	m_gridMesh = std::make_unique<vre::VreGridMesh>(m_vreDevice, m_game->m_level, m_cpuRenderer.palette());
+	m_gridMesh->createPipeline(m_vreSwapchain->getRenderPass());
+	m_voxelTracer.bindMap(m_voxelScene);
+	m_voxelChunks = std::make_unique<vre::VreVoxelChunks>(m_vreDevice, m_voxelScene, m_cpuRenderer.palette());
+	m_voxelChunks->createPipeline(m_vreSwapchain->getRenderPass());
+
+	m_pathTracer.bindMap(m_game->m_level);
+	m_pathTracer.resize(PATH_TRACE_WIDTH, PATH_TRACE_HEIGHT);
+	m_colorFramebuffer = std::make_unique<vre::VreColorFramebuffer>(m_vreDevice,
+		PATH_TRACE_WIDTH, PATH_TRACE_HEIGHT);
+	m_lastUpdate = std::chrono::steady_clock::now();
 }
 
 View::~View() {
+	vkDeviceWaitIdle(m_vreDevice.m_device);
+	destroyImgui();
+	m_gridMesh.reset();
+	m_voxelChunks.reset();
+	m_voxelCompute.reset();
+	m_indexedFramebuffer.reset();
+	m_colorFramebuffer.reset();
 	vkDestroyPipelineLayout(m_vreDevice.device(), m_pipelineLayout, nullptr);
 }
 
 void View::update() {
+	// no wait for the gpu here, the next frame is cast and recorded while
+	// the last ones still run. acquireNextImage waits for the fence of the
+	// frame slot before anything of that slot is rewritten
+	auto now = std::chrono::steady_clock::now();
+	m_frameMs = std::chrono::duration<double, std::milli>(now - m_lastUpdate).count();
+	m_lastUpdate = now;
+
+	// before casting, recreateSwapchain rebuilds the indexed framebuffer and
+	// restarts the frame slots that castRays writes into
+	if (m_swapchainDirty) {
+		m_swapchainDirty = false;
+		recreateSwapchain();
+	}
+
+	castRays();
 	drawFrame();
+}
 
-	// wait for all cpu/gpu operations to cease
-	vkDeviceWaitIdle(m_vreDevice.m_device);
+void View::castRays() {
+	vre::RayCamera camera{ m_game->m_px, m_game->m_py, m_game->m_pa };
+	int width = static_cast<int>(m_rayHits.size());
+	vre::VreWorldRenderer *world = &m_gridRenderer;
+	if (m_useBvh) {
+		world = m_bvhRenderer.get();
+	} else if (m_useBsp) {
+		world = m_bspRenderer.get();
+	}
+
+	// the tiled and stacked renderers cast their own rays band by band
+	bool tiled = usesTiledCpu();
+	bool stacked = usesStackedCpu();
+	bool terrain = usesTerrainCpu();
+	bool voxels = usesVoxels();
+	bool layered = world == &m_gridRenderer && m_game->m_level.hasTransparentCells();
+	// m_rayHits only feed the cpu column renderers, the path tracer and
+	// the gpu mesh and voxel paths never read them
+	bool columnHits = m_cpuBackend && !m_pathTrace && !tiled && !stacked && !terrain && !voxels;
+	if (voxels) {
+		// traced when the staging buffer of the frame is free, or on the gpu
+		m_voxelFrame = vre::VoxelFrame::make(m_voxelScene, voxelCamera(),
+			static_cast<int>(m_indexedFramebuffer->width()),
+			static_cast<int>(m_indexedFramebuffer->height()),
+			static_cast<int>(m_indexedFramebuffer->stride()));
+		if (m_voxelGpu && m_voxelHybrid) {
+			m_voxelFrame.endWord = m_hybridSplit.split() / 4;
+		}
+	} else if (terrain) {
+		// the player walks the terrain in texels, eye a fixed height above it
+		vre::TerrainSettings settings;
+		vre::TerrainCamera terrainCamera{ m_game->m_px, m_game->m_py, m_game->m_pa, 0.0f };
+		terrainCamera.height = m_terrain.heightAt(m_game->m_px, m_game->m_py)
+			* settings.verticalScale + 30.0f;
+		auto start = std::chrono::steady_clock::now();
+		m_cpuRenderer.renderTerrain(m_terrain, terrainCamera, vre::VreThreadPool::shared(), settings);
+		m_cpuDrawMs = std::chrono::duration<double, std::milli>(
+			std::chrono::steady_clock::now() - start).count();
+	} else if (stacked) {
+		auto start = std::chrono::steady_clock::now();
+		m_cpuRenderer.renderStacked(m_game->m_level, camera, vre::VreThreadPool::shared());
+		m_cpuDrawMs = std::chrono::duration<double, std::milli>(
+			std::chrono::steady_clock::now() - start).count();
+	} else if (tiled) {
+		vre::CpuTileOptions tileOptions;
+		tileOptions.edgeSamples = m_edgeSupersample ? 4 : 0;
+		tileOptions.texturedFlats = m_texturedFlats;
+		if (m_interlacedCpu) {
+			m_cpuRenderer.renderInterlaced(m_raycaster, camera, vre::VreThreadPool::shared(), tileOptions);
+		} else {
+			m_cpuRenderer.renderTiled(m_raycaster, camera, vre::VreThreadPool::shared(), tileOptions);
+		}
+	} else if (columnHits && layered) {
+		m_raycaster.castColumnsLayered(camera, 0, width, width, m_rayHits.data(), m_rayLayers.data());
+	} else if (columnHits) {
+		world->castColumns(camera, 0, width, width, m_rayHits.data());
+	}
+
+	// every ray of this frame has been cast, merge the thread counters
+	vre::VreRayStats::endFrame();
+
+	if (m_pathTrace) {
+		auto start = std::chrono::steady_clock::now();
+		m_pathTracer.renderSample(camera, vre::VreThreadPool::shared());
+		m_pathTraceMs = std::chrono::duration<double, std::milli>(
+			std::chrono::steady_clock::now() - start).count();
+	} else if (columnHits) {
+		auto start = std::chrono::steady_clock::now();
+		float cellSize = static_cast<float>(m_game->m_level.cellSize());
+		const vre::RayLayers *layers = layered ? m_rayLayers.data() : nullptr;
+		if (m_columnMajorCpu) {
+			m_cpuRenderer.renderColumnMajor(camera, cellSize, m_rayHits.data(), layers);
+		} else {
+			m_cpuRenderer.render(camera, cellSize, m_rayHits.data(), layers);
+		}
+		m_cpuDrawMs = std::chrono::duration<double, std::milli>(
+			std::chrono::steady_clock::now() - start).count();
+	}
+}
+
+bool View::usesTiledCpu() const {
+	return m_cpuBackend && !m_pathTrace && m_tiledCpu && !m_useBsp && !m_useBvh
+		&& !usesStackedCpu() && !m_terrainMode && !m_voxelMode;
+}
+
+bool View::usesStackedCpu() const {
+	// flat levels keep the faster single hit renderers
+	return m_cpuBackend && !m_pathTrace && !m_useBsp && !m_useBvh
+		&& m_game->m_level.hasHeights() && !m_terrainMode && !m_voxelMode;
+}
+
+bool View::usesTerrainCpu() const {
+	return m_cpuBackend && !m_pathTrace && m_terrainMode && !m_voxelMode;
+}
+
+bool View::usesVoxels() const {
+	return m_cpuBackend && !m_pathTrace && m_voxelMode;
+}
+
+bool View::usesGridMesh() const {
+	return !m_cpuBackend && !m_pathTrace && m_meshMode && !m_voxelMode;
+}
+
+bool View::usesVoxelMesh() const {
+	return !m_cpuBackend && !m_pathTrace && m_voxelMode;
+}
+
+vre::VoxelCamera View::voxelCamera() const {
+	// the level's floor plan at a quarter scale, eye over the hills
+	return { m_game->m_px * 0.25f, m_game->m_py * 0.25f, 24.0f, m_game->m_pa, 0.0f };
+}
+
+void View::createIndexedFramebuffer() {
+	// renders at swapchain resolution, one ray per column
+	VkExtent2D extent = m_vreSwapchain->getSwapchainExtent();
+	m_voxelCompute.reset();
+	m_indexedFramebuffer.reset();
+	m_indexedFramebuffer = std::make_unique<vre::VreIndexedFramebuffer>(m_vreDevice,
+		extent.width, extent.height, m_cpuRenderer.palette());
+	m_voxelCompute = std::make_unique<vre::VreVoxelCompute>(m_vreDevice, m_voxelScene,
+		*m_indexedFramebuffer);
+	// whole 16 word workgroups on the gpu side
+	m_hybridSplit.reset(static_cast<int>(extent.width), 64, 64);
+	m_cpuRenderer.resize(static_cast<int>(extent.width), static_cast<int>(extent.height));
+	m_rayHits.resize(extent.width);
+	m_rayLayers.resize(extent.width);
+}
+
+void View::clearSwapchainImage(VkCommandBuffer _cmd, int _imageIndex) {
+	VkImageMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.srcAccessMask = 0;
+	barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = m_vreSwapchain->getImage(_imageIndex);
+	barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+	// color attachment output is where the acquire semaphore is waited on
+	vkCmdPipelineBarrier(_cmd, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+		VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+	VkClearColorValue clearColor = { { 0.1f, 0.1f, 0.1f, 1.0f } };
+	vkCmdClearColorImage(_cmd, barrier.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		&clearColor, 1, &barrier.subresourceRange);
+}
+
+void View::initImgui() {
+	// oversized pool, straight from the imgui example
+	VkDescriptorPoolSize poolSizes[] = {
+		{ VK_DESCRIPTOR_TYPE_SAMPLER, 1000 },
+		{ VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1000 },
+		{ VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 1000 },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1000 },
+		{ VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER, 1000 },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER, 1000 },
+		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1000 },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1000 },
+		{ VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1000 },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 1000 },
+		{ VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, 1000 }
+	};
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+	poolInfo.maxSets = 1000;
+	poolInfo.poolSizeCount = static_cast<uint32_t>(std::size(poolSizes));
+	poolInfo.pPoolSizes = poolSizes;
+
+	if (vkCreateDescriptorPool(m_vreDevice.m_device, &poolInfo, nullptr, &m_imguiPool) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create imgui descriptor pool");
+	}
+
+	ImGui::CreateContext();
+	ImGui_ImplSDL2_InitForVulkan(m_vreWindow.m_window);
+
+	ImGui_ImplVulkan_InitInfo initInfo{};
+	initInfo.Instance = m_vreDevice.instance();
+	initInfo.PhysicalDevice = m_vreDevice.physicalDevice();
+	initInfo.Device = m_vreDevice.m_device;
+	initInfo.QueueFamily = m_vreDevice.findPhysicalQueueFamilies().graphicsFamily;
+	initInfo.Queue = m_vreDevice.graphicsQueue();
+	initInfo.DescriptorPool = m_imguiPool;
+	initInfo.MinImageCount = 2;
+	// the backend rotates its vertex buffers over ImageCount frames, each
+	// frame in flight needs its own whatever the frames in flight setting
+	initInfo.ImageCount = static_cast<uint32_t>(std::max(m_vreSwapchain->imageCount(),
+		static_cast<size_t>(vre::VreSwapchain::MAX_FRAMES_IN_FLIGHT)));
+	initInfo.MSAASamples = VK_SAMPLE_COUNT_1_BIT;
+
+	// the ui is drawn last inside the swapchain render pass
+	ImGui_ImplVulkan_Init(&initInfo, m_vreSwapchain->getRenderPass());
+}
+
+void View::destroyImgui() {
+	ImGui_ImplVulkan_Shutdown();
+	ImGui_ImplSDL2_Shutdown();
+	ImGui::DestroyContext();
+	vkDestroyDescriptorPool(m_vreDevice.m_device, m_imguiPool, nullptr);
 }
 
 void View::createPipelineLayout() {
@@ -64,6 +320,12 @@ void View::createPipeline() {
 	
 	m_vrePipeline = std::make_unique<vre::VrePipeline>(
 		m_vreDevice.m_device, pipelineConfig, "./triangle.vert.spv", "./triangle.frag.spv");
+	if (m_gridMesh) {
+		m_gridMesh->createPipeline(m_vreSwapchain->getRenderPass());
+	}
+	if (m_voxelChunks) {
+		m_voxelChunks->createPipeline(m_vreSwapchain->getRenderPass());
+	}
 }
 
 void View::loadModel() {
@@ -76,7 +338,8 @@ void View::loadModel() {
 }
 
 void View::createCommandBuffers() {
-	m_commandBuffers.resize(m_vreSwapchain->imageCount());
+	// one per frame slot, re-recorded once the slot's fence has signalled
+	m_commandBuffers.resize(vre::VreSwapchain::MAX_FRAMES_IN_FLIGHT);
 	VkCommandBufferAllocateInfo allocInfo{};
 	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
 	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY; // there are primary and secondary command buffers
@@ -93,7 +356,10 @@ void View::drawFrame() {
 	uint32_t imageIndex;
 	// fetches the index of the frame we should render to next
 	// also handles cpu/gpu sync for double/triple buff
+	auto acquireStart = std::chrono::steady_clock::now();
 	auto result = m_vreSwapchain->acquireNextImage(&imageIndex);
+	m_fenceWaitMs = std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now() - acquireStart).count();
 
 	if (result == VK_ERROR_OUT_OF_DATE_KHR) {
 		recreateSwapchain();
@@ -104,9 +370,161 @@ void View::drawFrame() {
 		throw std::runtime_error("failed to acquire swapchain image");
 	}
 
+	ImGui_ImplVulkan_NewFrame();
+	ImGui_ImplSDL2_NewFrame();
+	ImGui::NewFrame();
+	vre::ui::rayStatsPanel(vre::VreRayStats::lastFrame());
+	ImGui::Begin("Renderer");
+	ImGui::Checkbox("cpu renderer (8 bit indexed)", &m_cpuBackend);
+	ImGui::Checkbox("tiled cpu scheduler (grid only)", &m_tiledCpu);
+	if (m_tiledCpu) {
+		ImGui::SameLine();
+		ImGui::Checkbox("interlaced", &m_interlacedCpu);
+		ImGui::SameLine();
+		ImGui::Checkbox("edge supersampling", &m_edgeSupersample);
+		ImGui::SameLine();
+		ImGui::Checkbox("textured floors", &m_texturedFlats);
+		ImGui::SameLine();
+		ImGui::Checkbox("sky", &m_sky);
+	}
+	if (usesTiledCpu() && (m_interlacedCpu || m_edgeSupersample)) {
+		ImGui::Text("cast %d of %d columns, %d edge columns", m_cpuRenderer.lastCastColumns(),
+			m_cpuRenderer.width(), m_cpuRenderer.lastEdgeColumns());
+	}
+	ImGui::Checkbox("column major + transpose on upload", &m_columnMajorCpu);
+	ImGui::Checkbox("voxel terrain (outdoor)", &m_terrainMode);
+	ImGui::Checkbox("brick map voxels (3d dda)", &m_voxelMode);
+	if (m_voxelMode) {
+		ImGui::SameLine();
+		ImGui::Checkbox("on the gpu", &m_voxelGpu);
+		if (m_voxelGpu) {
+			ImGui::SameLine();
+			ImGui::Checkbox("split with the cpu", &m_voxelHybrid);
+		}
+	}
+	if (usesVoxels()) {
+		ImGui::Text("%zu bricks, %.2f MB on the gpu", m_voxelScene.brickCount(),
+			m_voxelCompute->sceneBytes() / double(1 << 20));
+		if (!m_voxelGpu) {
+			ImGui::Text("cpu trace %.2f ms", m_cpuDrawMs);
+		} else if (m_voxelHybrid) {
+			ImGui::Text("gpu %d columns %.2f ms, cpu %d columns %.2f ms", m_hybridSplit.split(),
+				m_gpuTraceMs, static_cast<int>(m_indexedFramebuffer->width()) - m_hybridSplit.split(), m_cpuDrawMs);
+			ImGui::Text("per column: gpu %.2f us, cpu %.2f us", m_hybridSplit.gpuColumnUs(),
+				m_hybridSplit.cpuColumnUs());
+		} else if (m_voxelCompute->hasTimestamps()) {
+			ImGui::Text("gpu trace %.2f ms", m_gpuTraceMs);
+		}
+	} else if (usesTerrainCpu()) {
+		ImGui::Text("terrain: draw %.2f ms, transpose %.2f ms", m_cpuDrawMs, m_cpuTransposeMs);
+	} else if (usesStackedCpu()) {
+		ImGui::Text("stacked heights: draw %.2f ms, transpose %.2f ms", m_cpuDrawMs, m_cpuTransposeMs);
+	} else if (m_columnMajorCpu) {
+		ImGui::Text("draw %.2f ms, transpose %.2f ms", m_cpuDrawMs, m_cpuTransposeMs);
+	}
+	ImGui::Checkbox("rasterized grid mesh (gpu path)", &m_meshMode);
+	if (usesGridMesh()) {
+		ImGui::Text("%zu triangles, last chunk rebuild %.2f ms", m_gridMesh->triangleCount(),
+			m_gridMesh->lastRebuildMs());
+	} else if (usesVoxelMesh()) {
+		ImGui::Text("%zu voxel quads, last remesh %.2f ms, staged %.1f KB", m_voxelChunks->quadCount(),
+			m_voxelChunks->lastRemeshMs(), m_voxelChunks->stagedBytes() / 1024.0);
+	}
+	ImGui::Checkbox("bsp segment walls", &m_useBsp);
+	ImGui::Checkbox("bvh segment walls", &m_useBvh);
+	ImGui::Checkbox("upload changed blocks only", &m_deltaUpload);
+	double frameMb = m_indexedFramebuffer->frameBytes() / double(1 << 20);
+	ImGui::Text("uploaded %.2f of %.2f MB last frame, %.2f MB as rgba16f",
+		m_indexedFramebuffer->lastUploadBytes() / double(1 << 20), frameMb, frameMb * 8.0);
+	ImGui::Text("frame %.2f ms, %.2f ms of it waiting for a frame slot", m_frameMs, m_fenceWaitMs);
+	if (ImGui::SliderInt("frames in flight", &m_swapchainSettings.framesInFlight, 1,
+		vre::VreSwapchain::MAX_FRAMES_IN_FLIGHT)) {
+		m_swapchainDirty = true;
+	}
+	for (VkPresentModeKHR mode : { VK_PRESENT_MODE_FIFO_KHR, VK_PRESENT_MODE_MAILBOX_KHR,
+		VK_PRESENT_MODE_IMMEDIATE_KHR }) {
+		if (mode != VK_PRESENT_MODE_FIFO_KHR) {
+			ImGui::SameLine();
+		}
+		if (ImGui::RadioButton(vre::VreSwapchain::presentModeName(mode), m_swapchainSettings.presentMode == mode)) {
+			m_swapchainSettings.presentMode = mode;
+			m_swapchainDirty = true;
+		}
+	}
+	ImGui::Text("presenting %s, present done %.2f ms after submit (%s)",
+		vre::VreSwapchain::presentModeName(m_vreSwapchain->presentMode()),
+		m_vreSwapchain->presentDoneMs(),
+		m_vreSwapchain->presentWaitTimed() ? "present wait" : "at reacquire");
+	ImGui::Checkbox("path tracer (720p reference)", &m_pathTrace);
+	if (m_pathTrace) {
+		ImGui::Text("%d samples, %.1f ms per sample on %u threads", m_pathTracer.sampleCount(),
+			m_pathTraceMs, vre::VreThreadPool::shared().threadCount());
+	}
+	ImGui::End();
+	ImGui::Render();
+
+	// a camera that moved changes most blocks, its frames skip the diff
+	// and go up whole
+	bool moved = m_game->m_px != m_uploadCamera.x || m_game->m_py != m_uploadCamera.y
+		|| m_game->m_pa != m_uploadCamera.angle;
+	m_uploadCamera = vre::RayCamera{ m_game->m_px, m_game->m_py, m_game->m_pa };
+
+	if (m_pathTrace) {
+		m_pathTracer.resolve(m_colorFramebuffer->mapped(m_vreSwapchain->currentFrame()),
+			vre::VreThreadPool::shared());
+	} else if (usesVoxels()) {
+		size_t frame = m_vreSwapchain->currentFrame();
+		if (!m_voxelGpu) {
+			auto start = std::chrono::steady_clock::now();
+			m_voxelTracer.render(m_voxelFrame, m_indexedFramebuffer->mapped(frame), vre::VreThreadPool::shared());
+			m_cpuDrawMs = std::chrono::duration<double, std::milli>(
+				std::chrono::steady_clock::now() - start).count();
+		} else {
+			// the fence of this frame was waited for, its last trace is timed
+			if (m_voxelCompute->readTraceMs(frame, m_gpuTraceMs) && m_hybridGpuColumns[frame] > 0) {
+				m_hybridSplit.update(m_hybridGpuColumns[frame], m_gpuTraceMs, m_hybridCpuMs[frame]);
+			}
+			int split = m_voxelFrame.endWord * 4;
+			m_hybridGpuColumns[frame] = 0;
+			if (split < m_voxelFrame.width) {
+				auto start = std::chrono::steady_clock::now();
+				m_voxelTracer.renderColumns(m_voxelFrame, split, m_voxelFrame.width,
+					m_indexedFramebuffer->mapped(frame), vre::VreThreadPool::shared());
+				m_cpuDrawMs = std::chrono::duration<double, std::milli>(
+					std::chrono::steady_clock::now() - start).count();
+				m_hybridGpuColumns[frame] = split;
+				m_hybridCpuMs[frame] = m_cpuDrawMs;
+			}
+		}
+	} else if (m_cpuBackend && (m_columnMajorCpu || usesStackedCpu() || usesTerrainCpu())
+		&& !usesTiledCpu()) {
+		auto start = std::chrono::steady_clock::now();
+		m_cpuRenderer.transposeTo(m_indexedFramebuffer->mapped(m_vreSwapchain->currentFrame()),
+			vre::VreThreadPool::shared());
+		m_cpuTransposeMs = std::chrono::duration<double, std::milli>(
+			std::chrono::steady_clock::now() - start).count();
+	} else if (m_cpuBackend && m_deltaUpload && !moved) {
+		m_indexedFramebuffer->uploadChanged(m_vreSwapchain->currentFrame(), m_cpuRenderer.pixels(),
+			vre::VreThreadPool::shared());
+	} else if (m_cpuBackend) {
+		m_indexedFramebuffer->upload(m_vreSwapchain->currentFrame(), m_cpuRenderer.pixels());
+	}
+	if (usesTiledCpu() && m_sky) {
+		vre::RayCamera camera{ m_game->m_px, m_game->m_py, m_game->m_pa };
+		m_indexedFramebuffer->drawSky(m_vreSwapchain->currentFrame(), m_cpuRenderer.columnTops(),
+			m_cpuRenderer.columnBottoms(), camera.angle, camera.fov);
+	}
+
+	if (usesGridMesh()) {
+		m_gridMesh->update(vre::VreThreadPool::shared());
+	} else if (usesVoxelMesh()) {
+		m_voxelChunks->update(m_vreSwapchain->currentFrame(), vre::VreThreadPool::shared());
+	}
+
 	// submit command buffer to device graphics queue while handling cpu/gpu sync
 	recordCommandBuffer(imageIndex);
-	result = m_vreSwapchain->submitCommandBuffers(&m_commandBuffers[imageIndex], &imageIndex);
+	result = m_vreSwapchain->submitCommandBuffers(&m_commandBuffers[m_vreSwapchain->currentFrame()],
+		&imageIndex);
 	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR
 		|| m_vreWindow.wasWindowResized()) {
 		m_vreWindow.resetWindowResizedFlag();
@@ -136,18 +554,19 @@ void View::recreateSwapchain() {
 	vkDeviceWaitIdle(m_vreDevice.m_device);
 
 	if (m_vreSwapchain == nullptr) {
-		m_vreSwapchain = std::make_unique<vre::VreSwapchain>(m_vreDevice, extent);
+		m_vreSwapchain = std::make_unique<vre::VreSwapchain>(m_vreDevice, extent, m_swapchainSettings);
 	} else {
 		m_vreSwapchain = std::make_unique<vre::VreSwapchain>
-			(m_vreDevice, extent, std::move(m_vreSwapchain));
-		if (m_vreSwapchain->imageCount() != m_commandBuffers.size()) {
-			freeCommandBuffers();
-			createCommandBuffers();
-		}
+			(m_vreDevice, extent, std::move(m_vreSwapchain), m_swapchainSettings);
+	}
+	// the frame slots start over, possibly fewer of them
+	if (m_voxelChunks) {
+		m_voxelChunks->releaseFrames();
 	}
 
 	// if renderpass compatible do nothing else
 	createPipeline();
+	createIndexedFramebuffer();
 
 }
 
@@ -155,13 +574,32 @@ void View::recordCommandBuffer(int _imageIndex) {
 	static int frame = 0;
 	frame = (frame + 1) % 1000;
 
+	VkCommandBuffer cmd = m_commandBuffers[m_vreSwapchain->currentFrame()];
+
 	VkCommandBufferBeginInfo beginInfo{};
 	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 
-	if (vkBeginCommandBuffer(m_commandBuffers[_imageIndex], &beginInfo) != VK_SUCCESS) {
+	if (vkBeginCommandBuffer(cmd, &beginInfo) != VK_SUCCESS) {
 		throw std::runtime_error("failed to begin recording command buffer");
 	}
 
+	// the render pass loads the swapchain image, fill it first
+	if (m_pathTrace) {
+		m_colorFramebuffer->record(cmd, m_vreSwapchain->currentFrame(),
+			m_vreSwapchain->getImage(_imageIndex), m_vreSwapchain->getSwapchainExtent());
+	} else if (usesVoxels() && m_voxelGpu) {
+		m_voxelCompute->record(cmd, m_vreSwapchain->currentFrame(),
+			m_voxelFrame, m_vreSwapchain->getImage(_imageIndex), m_vreSwapchain->getSwapchainExtent());
+	} else if (m_cpuBackend) {
+		m_indexedFramebuffer->record(cmd, m_vreSwapchain->currentFrame(),
+			m_vreSwapchain->getImage(_imageIndex), m_vreSwapchain->getSwapchainExtent());
+	} else {
+		clearSwapchainImage(cmd, _imageIndex);
+	}
+	if (usesVoxelMesh()) {
+		m_voxelChunks->recordUploads(cmd);
+	}
+
 	VkRenderPassBeginInfo renderPassInfo{};
 	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
 	renderPassInfo.renderPass = m_vreSwapchain->getRenderPass();
@@ -180,7 +618,7 @@ void View::recordCommandBuffer(int _imageIndex) {
 	// VK_SUBPASS_CONTENTS_INLINE signals that the subsequent render pass commands will be directly embedded in the 
 	// primary command buffer itself, and that no secondary cmd buffers will be used
 	// VK_SUBPASS_CONTENTS_SECONDARY means that render pass command will be exeucted by secondary command buffer, no render pass can use inline/secondary command buffers
-	vkCmdBeginRenderPass(m_commandBuffers[_imageIndex], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+	vkCmdBeginRenderPass(cmd, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
 
 	VkViewport viewport{};
 	viewport.x = 0.0f;
@@ -190,31 +628,42 @@ void View::recordCommandBuffer(int _imageIndex) {
 	viewport.minDepth = 0.0f;
 	viewport.maxDepth = 1.0f;
 	VkRect2D scissor{ {0, 0}, m_vreSwapchain->getSwapchainExtent() };
-	vkCmdSetViewport(m_commandBuffers[_imageIndex], 0, 1, &viewport);
-	vkCmdSetScissor(m_commandBuffers[_imageIndex], 0, 1, &scissor);
+	vkCmdSetViewport(cmd, 0, 1, &viewport);
+	vkCmdSetScissor(cmd, 0, 1, &scissor);
 
-	m_vrePipeline->bind(m_commandBuffers[_imageIndex]);
+	m_vrePipeline->bind(cmd);
 	//vkCmdDraw(m_commandBuffers[i], 3, 1, 0, 0);
-	m_model->bind(m_commandBuffers[_imageIndex]);
+	m_model->bind(cmd);
+
+	if (usesGridMesh()) {
+		vre::RayCamera camera{ m_game->m_px, m_game->m_py, m_game->m_pa };
+		m_gridMesh->record(cmd, vre::VreGridMesh::cameraMatrix(camera,
+			static_cast<float>(m_game->m_level.cellSize()), 0.5f, m_vreSwapchain->getSwapchainExtent()));
+	} else if (usesVoxelMesh()) {
+		m_voxelChunks->record(cmd, vre::VreVoxelChunks::cameraMatrix(
+			voxelCamera(), m_vreSwapchain->getSwapchainExtent()));
+	}
 
-	// Playing with push constants
-	for (int j = 0; j < 4; j++) {
+	// Playing with push constants, only over the plain clear
+	for (int j = 0; j < 4 && !m_cpuBackend && !m_pathTrace && !m_meshMode && !m_voxelMode; j++) {
 		vre::SimplePushConstantData push{};
 		push.offset = { -0.5f + frame * 0.002f, -0.4f + j * 0.25f };
 		push.color = { 0.0f, 0.0f, 0.2f + 0.2f * j };
 
-		vkCmdPushConstants(m_commandBuffers[_imageIndex], m_pipelineLayout,
+		vkCmdPushConstants(cmd, m_pipelineLayout,
 			VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
 			0, sizeof(vre::SimplePushConstantData), &push);
-		m_model->draw(m_commandBuffers[_imageIndex]);
+		m_model->draw(cmd);
 		// don't forget to update shader files to expect push constants!
 	}
 
-	//m_model->draw(m_commandBuffers[_imageIndex]);
+	//m_model->draw(cmd);
+
+	ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), cmd);
 
-	vkCmdEndRenderPass(m_commandBuffers[_imageIndex]);
+	vkCmdEndRenderPass(cmd);
 
-	if (vkEndCommandBuffer(m_commandBuffers[_imageIndex]) != VK_SUCCESS) {
+	if (vkEndCommandBuffer(cmd) != VK_SUCCESS) {
 		throw std::runtime_error("Failed to record command buffer");
 	}
 }
@@ -1,6 +1,8 @@
 #pragma once
 
 #include <iostream>
+#include <array>
+#include <chrono>
 #include <vector>
 #include <memory>
 #include <stdexcept>
@@ -14,6 +16,17 @@
 #include "VreDevice.hpp"
 #include "VrePipeline.hpp"
 #include "VreSwapchain.hpp"
+#include "VreRaycaster.hpp"
+#include "VreBspRenderer.hpp"
+#include "VreBvhRenderer.hpp"
+#include "VreCpuRenderer.hpp"
+#include "VreIndexedFramebuffer.hpp"
+#include "VreColorFramebuffer.hpp"
+#include "VrePathTracer.hpp"
+#include "VreVoxelCompute.hpp"
+#include "VreHybridSplit.hpp"
+#include "VreGridMesh.hpp"
+#include "VreVoxelChunks.hpp"
 #include "Game.hpp"
 
 class View {
@@ -40,7 +53,95 @@ private:
 	std::unique_ptr<vre::VreModel> m_model;
 	
 	VkPipelineLayout m_pipelineLayout;
+	// indexed by frame slot, not swapchain image
 	std::vector<VkCommandBuffer> m_commandBuffers;
+	// time between updates and the part of it spent waiting in
+	// acquireNextImage for the gpu to finish the frame slot
+	std::chrono::steady_clock::time_point m_lastUpdate;
+	double m_frameMs = 0.0;
+	double m_fenceWaitMs = 0.0;
+	// frames in flight and present mode, the swapchain is rebuilt before
+	// the next frame when the ui changes them
+	vre::SwapchainSettings m_swapchainSettings;
+	bool m_swapchainDirty = false;
+
+	VkDescriptorPool m_imguiPool = VK_NULL_HANDLE;
+
+	vre::VreRaycaster m_raycaster;
+	std::vector<vre::RayHit> m_rayHits;
+	// see through walls in front of m_rayHits, grid walls only
+	std::vector<vre::RayLayers> m_rayLayers;
+
+	// the level as line segments, rendered through a bsp instead of the grid
+	bool m_useBsp = false;
+	vre::VreGridRenderer m_gridRenderer{ m_raycaster };
+	vre::VreSegmentMap m_segmentMap;
+	vre::VreBsp m_bsp;
+	std::unique_ptr<vre::VreBspRenderer> m_bspRenderer;
+	// same segments through the packet bvh, wins over the bsp when both are on
+	bool m_useBvh = false;
+	vre::VreBvh m_bvh;
+	std::unique_ptr<vre::VreBvhRenderer> m_bvhRenderer;
+
+	// the level extruded into chunked greedy meshes and rasterized with the
+	// depth buffer, used on the gpu path when the cpu renderer is off
+	bool m_meshMode = true;
+	std::unique_ptr<vre::VreGridMesh> m_gridMesh;
+
+	// software path, 8 bit indices expanded on the gpu
+	bool m_cpuBackend = true;
+	vre::VreCpuRenderer m_cpuRenderer;
+	// grid walls only, casts and draws in column band x row band tiles
+	bool m_tiledCpu = true;
+	// tiled, casting every other column and reprojecting the rest from the
+	// last frame, full frames again on fast turns
+	bool m_interlacedCpu = false;
+	// tiled, 4 sub column rays on columns at wall edges, blended
+	bool m_edgeSupersample = false;
+	// tiled, textured floor and ceiling instead of one shade per row
+	bool m_texturedFlats = false;
+	// tiled, panorama sky over the ceiling above the walls
+	bool m_sky = false;
+	// draws columns into a column major buffer and transposes it straight
+	// into the mapped staging buffer, used when tiles are off
+	bool m_columnMajorCpu = false;
+	// outdoor voxel space terrain instead of the level, cpu backend only
+	bool m_terrainMode = false;
+	vre::VreTerrain m_terrain;
+	// brick map test scene through the 3d dda, traced by the cpu pool or by
+	// voxel_dda.comp straight into the indexed framebuffer on the cpu
+	// backend, drawn as chunk meshes on the gpu path
+	bool m_voxelMode = false;
+	bool m_voxelGpu = true;
+	vre::VreBrickMap m_voxelScene = vre::VreBrickMap::testScene();
+	vre::VreVoxelTracer m_voxelTracer;
+	vre::VoxelFrame m_voxelFrame{};
+	std::unique_ptr<vre::VreVoxelCompute> m_voxelCompute;
+	// gpu traces the left columns, the cpu pool the rest into the staging
+	// buffer, the split follows the timestamps and the cpu timer
+	bool m_voxelHybrid = false;
+	vre::VreHybridSplit m_hybridSplit;
+	// what each frame in flight was drawn with, until its gpu time is back
+	std::array<int, vre::VreSwapchain::MAX_FRAMES_IN_FLIGHT> m_hybridGpuColumns{};
+	std::array<double, vre::VreSwapchain::MAX_FRAMES_IN_FLIGHT> m_hybridCpuMs{};
+	double m_gpuTraceMs = 0.0;
+	// the same scene as greedy chunk meshes, used by the voxel mode on the
+	// gpu path when the cpu renderer is off
+	std::unique_ptr<vre::VreVoxelChunks> m_voxelChunks;
+	// row major cpu frames are diffed and only changed column blocks are
+	// copied to the gpu, while the camera holds still
+	bool m_deltaUpload = true;
+	vre::RayCamera m_uploadCamera{}; // the pose of the last frame drawn
+	double m_cpuDrawMs = 0.0;
+	double m_cpuTransposeMs = 0.0;
+	std::unique_ptr<vre::VreIndexedFramebuffer> m_indexedFramebuffer;
+
+	// progressive reference path tracer at a fixed 720p, wins over the
+	// cpu renderer when on. it keeps accumulating while the camera is still
+	bool m_pathTrace = false;
+	vre::VrePathTracer m_pathTracer;
+	std::unique_ptr<vre::VreColorFramebuffer> m_colorFramebuffer;
+	double m_pathTraceMs = 0.0;
 	
 	void loadModel();
 	void createPipelineLayout();
@@ -50,6 +151,18 @@ private:
 	void drawFrame();
 	void recreateSwapchain();
 	void recordCommandBuffer(int _imageIndex);
+	void initImgui();
+	void destroyImgui();
+	void castRays();
+	bool usesTiledCpu() const;
+	bool usesStackedCpu() const;
+	bool usesTerrainCpu() const;
+	bool usesVoxels() const;
+	bool usesGridMesh() const;
+	bool usesVoxelMesh() const;
+	vre::VoxelCamera voxelCamera() const;
+	void createIndexedFramebuffer();
+	void clearSwapchainImage(VkCommandBuffer _cmd, int _imageIndex);
 
 	//SDL_Window *m_window;
 	//std::shared_ptr<vre::VreDevice> m_vreDevice;
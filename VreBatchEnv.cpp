@@ -0,0 +1,181 @@
+#include "VreBatchEnv.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+	constexpr float TWO_PI = 6.2831853f;
+
+	uint32_t nextRandom(uint32_t &_state) {
+		// xorshift32, one word of state per environment
+		_state ^= _state << 13;
+		_state ^= _state >> 17;
+		_state ^= _state << 5;
+		return _state;
+	}
+}
+
+vre::VreBatchEnv::VreBatchEnv(std::vector<const VreMap *> _maps,
+	std::vector<uint16_t> _mapIndex, BatchEnvSettings _settings
+) : m_maps{ std::move(_maps) }, m_settings{ _settings },
+	m_count{ static_cast<int>(_mapIndex.size()) }, m_mapIndex{ std::move(_mapIndex) } {
+	for (const VreMap *map : m_maps) {
+		std::vector<int> empty;
+		for (int y = 0; y < map->height(); y++) {
+			for (int x = 0; x < map->width(); x++) {
+				if (map->at(x, y) == 0) {
+					empty.push_back(y * map->width() + x);
+				}
+			}
+		}
+		if (empty.empty()) {
+			throw std::runtime_error("Failed to create batch env, a map has no empty cell");
+		}
+		m_emptyCells.push_back(std::move(empty));
+	}
+	for (uint16_t index : m_mapIndex) {
+		if (index >= m_maps.size()) {
+			throw std::runtime_error("Failed to create batch env, map index out of range");
+		}
+	}
+
+	size_t count = static_cast<size_t>(m_count);
+	size_t pickups = count * m_settings.pickupsPerEnv;
+	m_x.resize(count);
+	m_y.resize(count);
+	m_angle.resize(count);
+	m_dirX.resize(count);
+	m_dirY.resize(count);
+	m_steps.resize(count);
+	m_pickupsLeft.resize(count);
+	m_rng.resize(count);
+	m_reward.resize(count);
+	m_done.resize(count);
+	m_pickupX.resize(pickups);
+	m_pickupY.resize(pickups);
+	m_pickupAlive.resize(pickups);
+
+	resetAll();
+}
+
+void vre::VreBatchEnv::resetAll() {
+	for (int i = 0; i < m_count; i++) {
+		// never zero, xorshift would stay there
+		m_rng[i] = ((m_settings.seed * 2654435761u) ^ (static_cast<uint32_t>(i) * 2246822519u)) | 1u;
+		resetEnv(i);
+		m_reward[i] = 0.0f;
+		m_done[i] = 0;
+	}
+	m_totalSteps = 0;
+}
+
+void vre::VreBatchEnv::step(const uint8_t *_actions, VreThreadPool &_pool) {
+	int blockSize = std::max(m_settings.blockSize, 1);
+	int blocks = (m_count + blockSize - 1) / blockSize;
+	_pool.parallelFor(blocks, [&](int _block) {
+		int first = _block * blockSize;
+		stepBlock(_actions, first, std::min(first + blockSize, m_count));
+	});
+	m_totalSteps += static_cast<uint64_t>(m_count);
+}
+
+void vre::VreBatchEnv::stepBlock(const uint8_t *_actions, int _first, int _last) {
+	const float speed = m_settings.moveSpeed;
+	const float radius = m_settings.playerRadius;
+	const float pickupRadiusSquared = m_settings.pickupRadius * m_settings.pickupRadius;
+	const int pickups = m_settings.pickupsPerEnv;
+	// both turn directions are fixed rotations, no trig per step
+	const float turnCos = std::cos(m_settings.turnSpeed);
+	const float turnSin = std::sin(m_settings.turnSpeed);
+
+	// pose update first, no memory but the pose arrays, so it vectorizes
+	for (int i = _first; i < _last; i++) {
+		uint8_t action = _actions[i];
+		float turn = static_cast<float>(((action >> 3) & 1) - ((action >> 2) & 1));
+		float sine = turn * turnSin;
+		float cosine = turn != 0.0f ? turnCos : 1.0f;
+		float dirX = m_dirX[i] * cosine - m_dirY[i] * sine;
+		float dirY = m_dirX[i] * sine + m_dirY[i] * cosine;
+		// one newton step keeps the direction unit length
+		float correction = 1.5f - 0.5f * (dirX * dirX + dirY * dirY);
+		m_dirX[i] = dirX * correction;
+		m_dirY[i] = dirY * correction;
+
+		float angle = m_angle[i] + turn * m_settings.turnSpeed;
+		angle += angle < 0.0f ? TWO_PI : 0.0f;
+		angle -= angle > TWO_PI ? TWO_PI : 0.0f;
+		m_angle[i] = angle;
+	}
+
+	for (int i = _first; i < _last; i++) {
+		const VreMap &map = *m_maps[m_mapIndex[i]];
+		uint8_t action = _actions[i];
+		float move = speed * static_cast<float>((action & 1) - ((action >> 1) & 1));
+		float moveX = m_dirX[i] * move;
+		float moveY = m_dirY[i] * move;
+
+		// one axis at a time so the player slides along walls, the leading
+		// edge of the player circle is what gets tested
+		float x = m_x[i];
+		float y = m_y[i];
+		if (moveX != 0.0f && !blocked(map, x + moveX + (moveX > 0.0f ? radius : -radius), y)) {
+			x += moveX;
+		}
+		if (moveY != 0.0f && !blocked(map, x, y + moveY + (moveY > 0.0f ? radius : -radius))) {
+			y += moveY;
+		}
+		m_x[i] = x;
+		m_y[i] = y;
+
+		float reward = 0.0f;
+		size_t base = static_cast<size_t>(i) * pickups;
+		for (int k = 0; k < pickups; k++) {
+			float dx = m_pickupX[base + k] - x;
+			float dy = m_pickupY[base + k] - y;
+			bool taken = m_pickupAlive[base + k] && dx * dx + dy * dy < pickupRadiusSquared;
+			m_pickupAlive[base + k] &= static_cast<uint8_t>(!taken);
+			reward += taken ? 1.0f : 0.0f;
+		}
+		m_pickupsLeft[i] -= static_cast<int32_t>(reward);
+		m_reward[i] = reward;
+
+		m_steps[i]++;
+		bool done = m_pickupsLeft[i] == 0 || m_steps[i] >= m_settings.maxSteps;
+		m_done[i] = static_cast<uint8_t>(done);
+		if (done) {
+			resetEnv(i);
+		}
+	}
+}
+
+void vre::VreBatchEnv::resetEnv(int _env) {
+	randomSpawn(_env, m_x[_env], m_y[_env]);
+	float angle = static_cast<float>(nextRandom(m_rng[_env]) >> 8) * (TWO_PI / 16777216.0f);
+	m_angle[_env] = angle;
+	m_dirX[_env] = std::cos(angle);
+	m_dirY[_env] = std::sin(angle);
+	m_steps[_env] = 0;
+	m_pickupsLeft[_env] = m_settings.pickupsPerEnv;
+
+	size_t base = static_cast<size_t>(_env) * m_settings.pickupsPerEnv;
+	for (int k = 0; k < m_settings.pickupsPerEnv; k++) {
+		randomSpawn(_env, m_pickupX[base + k], m_pickupY[base + k]);
+		m_pickupAlive[base + k] = 1;
+	}
+}
+
+void vre::VreBatchEnv::randomSpawn(int _env, float &_x, float &_y) {
+	const std::vector<int> &empty = m_emptyCells[m_mapIndex[_env]];
+	const VreMap &map = *m_maps[m_mapIndex[_env]];
+	int cell = empty[nextRandom(m_rng[_env]) % empty.size()];
+	_x = (static_cast<float>(cell % map.width()) + 0.5f) * map.cellSize();
+	_y = (static_cast<float>(cell / map.width()) + 0.5f) * map.cellSize();
+}
+
+bool vre::VreBatchEnv::blocked(const VreMap &_map, float _x, float _y) const {
+	float invCellSize = 1.0f / static_cast<float>(_map.cellSize());
+	int cellX = static_cast<int>(std::floor(_x * invCellSize));
+	int cellY = static_cast<int>(std::floor(_y * invCellSize));
+	return !_map.inBounds(cellX, cellY) || _map.at(cellX, cellY) != 0;
+}
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "VreMap.hpp"
+#include "VreThreadPool.hpp"
+
+namespace vre {
+	// one byte per environment and step, bits can be combined. turning left
+	// lowers the angle like the A key in Controller
+	enum BatchAction : uint8_t {
+		ACTION_FORWARD = 1,
+		ACTION_BACKWARD = 2,
+		ACTION_TURN_LEFT = 4,
+		ACTION_TURN_RIGHT = 8,
+	};
+
+	struct BatchEnvSettings {
+		float moveSpeed = 5.0f; // world units per step, same as the controller
+		float turnSpeed = 0.1f; // radians per step
+		float playerRadius = 8.0f;
+		float pickupRadius = 16.0f;
+		int pickupsPerEnv = 4; // episode ends when all are collected
+		int maxSteps = 1000; // or after this many steps
+		int blockSize = 1024; // environments per thread task
+		uint32_t seed = 1;
+	};
+
+	// thousands of independent copies of the game without SDL or Vulkan.
+	// all state is stored as one array per field so a step is a few linear
+	// passes over memory, split into blocks across the pool. actions come
+	// in as an array, one byte per environment. finished environments
+	// report done and start a new episode in the same step
+	class VreBatchEnv {
+	public:
+		// every environment plays on _maps[_mapIndex[i]], the maps are shared
+		// and must outlive the batch
+		VreBatchEnv(std::vector<const VreMap *> _maps, std::vector<uint16_t> _mapIndex,
+			BatchEnvSettings _settings = {});
+
+		void resetAll();
+		// _actions holds size() entries. rewards() and dones() describe this
+		// step afterwards
+		void step(const uint8_t *_actions, VreThreadPool &_pool);
+
+		int size() const { return m_count; }
+		const BatchEnvSettings &settings() const { return m_settings; }
+		const VreMap &map(int _env) const { return *m_maps[m_mapIndex[_env]]; }
+
+		const float *x() const { return m_x.data(); }
+		const float *y() const { return m_y.data(); }
+		const float *angle() const { return m_angle.data(); }
+		const float *rewards() const { return m_reward.data(); }
+		const uint8_t *dones() const { return m_done.data(); }
+		const int32_t *episodeSteps() const { return m_steps.data(); }
+		// size() * pickupsPerEnv entries, environment major
+		const float *pickupX() const { return m_pickupX.data(); }
+		const float *pickupY() const { return m_pickupY.data(); }
+		const uint8_t *pickupAlive() const { return m_pickupAlive.data(); }
+
+		uint64_t totalSteps() const { return m_totalSteps; }
+
+	private:
+		void stepBlock(const uint8_t *_actions, int _first, int _last);
+		void resetEnv(int _env);
+		// centre of a random empty cell of the environment's map
+		void randomSpawn(int _env, float &_x, float &_y);
+		bool blocked(const VreMap &_map, float _x, float _y) const;
+
+		std::vector<const VreMap *> m_maps;
+		std::vector<std::vector<int>> m_emptyCells; // per map, y * width + x
+		BatchEnvSettings m_settings;
+		int m_count;
+		uint64_t m_totalSteps = 0;
+
+		std::vector<uint16_t> m_mapIndex;
+		std::vector<float> m_x;
+		std::vector<float> m_y;
+		std::vector<float> m_angle;
+		std::vector<float> m_dirX; // unit view direction, kept with the angle
+		std::vector<float> m_dirY;
+		std::vector<int32_t> m_steps;
+		std::vector<int32_t> m_pickupsLeft;
+		std::vector<uint32_t> m_rng;
+		std::vector<float> m_reward;
+		std::vector<uint8_t> m_done;
+
+		std::vector<float> m_pickupX;
+		std::vector<float> m_pickupY;
+		std::vector<uint8_t> m_pickupAlive;
+	};
+}
@@ -0,0 +1,1923 @@
+#include "VreBenchmark.hpp"
+
+#include <cassert>
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <numeric>
+
+#include "VreRaycaster.hpp"
+#include "VreCpuRenderer.hpp"
+#include "VreBspRenderer.hpp"
+#include "VreBvhRenderer.hpp"
+#include "VrePathTracer.hpp"
+#include "VreBatchEnv.hpp"
+#include "VreMultiCamera.hpp"
+#include "VreVoxelTracer.hpp"
+#include "VreGridMesher.hpp"
+#include "VreVoxelMesher.hpp"
+#include "VreFrameDelta.hpp"
+#include "VreFloorCaster.hpp"
+#include "VreHybridSplit.hpp"
+
+namespace {
+	struct BenchEntry {
+		const char *name;
+		void (*function)();
+	};
+
+	const BenchEntry BENCHMARKS[] = {
+		{ "raycaster", &vre::bench::raycaster },
+		{ "occupancy", &vre::bench::occupancy },
+		{ "indexed", &vre::bench::indexed },
+		{ "bsp", &vre::bench::bsp },
+		{ "bvh", &vre::bench::bvh },
+		{ "pathtracer", &vre::bench::pathTracer },
+		{ "tiled", &vre::bench::tiled },
+		{ "transpose", &vre::bench::transpose },
+		{ "batchenv", &vre::bench::batchEnv },
+		{ "multicamera", &vre::bench::multiCamera },
+		{ "seethrough", &vre::bench::seeThrough },
+		{ "stacked", &vre::bench::stacked },
+		{ "terrain", &vre::bench::terrain },
+		{ "voxel", &vre::bench::voxel },
+		{ "gridmesh", &vre::bench::gridMesh },
+		{ "voxelmesh", &vre::bench::voxelMesh },
+		{ "interlaced", &vre::bench::interlaced },
+		{ "edges", &vre::bench::edges },
+		{ "delta", &vre::bench::delta },
+		{ "flats", &vre::bench::flats },
+		{ "hybrid", &vre::bench::hybrid },
+		{ "inflight", &vre::bench::inFlight },
+	};
+
+	double secondsSince(std::chrono::steady_clock::time_point _start) {
+		return std::chrono::duration<double>(std::chrono::steady_clock::now() - _start).count();
+	}
+
+	// the first wall along the float ray, every boundary crossing computed
+	// from the camera in long double, nothing accumulated. the referee when
+	// two casters disagree on a cell. false if the ray leaves the map
+	bool exactHit(const vre::VreMap &_map, const vre::RayCamera &_camera, float _dirX,
+		float _dirY, int &_mapX, int &_mapY
+	) {
+		long double cellSize = _map.cellSize();
+		int x = static_cast<int>(std::floor(_camera.x / cellSize));
+		int y = static_cast<int>(std::floor(_camera.y / cellSize));
+		int stepX = _dirX < 0.0f ? -1 : 1;
+		int stepY = _dirY < 0.0f ? -1 : 1;
+		for (int i = 0; i < _map.width() + _map.height() + 2; i++) {
+			long double nextX = _dirX == 0.0f ? HUGE_VALL
+				: ((stepX > 0 ? x + 1 : x) * cellSize - _camera.x) / _dirX;
+			long double nextY = _dirY == 0.0f ? HUGE_VALL
+				: ((stepY > 0 ? y + 1 : y) * cellSize - _camera.y) / _dirY;
+			if (nextX < nextY) {
+				x += stepX;
+			} else {
+				y += stepY;
+			}
+			if (!_map.inBounds(x, y)) {
+				return false;
+			}
+			if (_map.at(x, y) != 0) {
+				_mapX = x;
+				_mapY = y;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// stands in for the graphics queue: submitted frames complete in order,
+	// each after a fixed time the device is busy. the wait does not use the
+	// cpu, like a real gpu running beside it
+	class SimulatedQueue {
+	public:
+		explicit SimulatedQueue(double _frameMs) : m_frameMs{ _frameMs } {
+			m_worker = std::thread([this] { run(); });
+		}
+
+		~SimulatedQueue() {
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_stop = true;
+			}
+			m_changed.notify_all();
+			m_worker.join();
+		}
+
+		// the fence value of the submitted frame
+		int submit() {
+			std::lock_guard<std::mutex> lock(m_mutex);
+			int fence = ++m_submitted;
+			m_changed.notify_all();
+			return fence;
+		}
+
+		void wait(int _fence) {
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_changed.wait(lock, [&] { return m_completed >= _fence; });
+		}
+
+		double busySeconds() const { return m_busySeconds; }
+		// once _fence has been waited for
+		std::chrono::steady_clock::time_point completedAt(int _fence) {
+			std::lock_guard<std::mutex> lock(m_mutex);
+			return m_completedAt[_fence - 1];
+		}
+
+	private:
+		void run() {
+			std::unique_lock<std::mutex> lock(m_mutex);
+			while (true) {
+				m_changed.wait(lock, [&] { return m_stop || m_submitted > m_completed; });
+				if (m_stop) {
+					return;
+				}
+				lock.unlock();
+				auto start = std::chrono::steady_clock::now();
+				std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(m_frameMs));
+				double busy = secondsSince(start);
+				lock.lock();
+				m_busySeconds += busy;
+				m_completed++;
+				m_completedAt.push_back(std::chrono::steady_clock::now());
+				m_changed.notify_all();
+			}
+		}
+
+		double m_frameMs;
+		std::thread m_worker;
+		std::mutex m_mutex;
+		std::condition_variable m_changed;
+		int m_submitted = 0;
+		int m_completed = 0;
+		double m_busySeconds = 0.0;
+		std::vector<std::chrono::steady_clock::time_point> m_completedAt;
+		bool m_stop = false;
+	};
+}
+
+bool vre::bench::run(const std::string &_name) {
+	bool found = false;
+	for (const BenchEntry &entry : BENCHMARKS) {
+		if (_name == "all" || _name == entry.name) {
+			std::cout << "=== " << entry.name << " ===" << std::endl;
+			entry.function();
+			found = true;
+		}
+	}
+
+	if (!found) {
+		std::cout << "unknown benchmark '" << _name << "', available:";
+		for (const BenchEntry &entry : BENCHMARKS) {
+			std::cout << " " << entry.name;
+		}
+		std::cout << std::endl;
+	}
+	return found;
+}
+
+vre::VreMap vre::bench::makeTestMap(int _width, int _height, int _cellSize,
+	float _wallDensity, unsigned int _seed
+) {
+	std::mt19937 rng(_seed);
+	std::uniform_real_distribution<float> roll(0.0f, 1.0f);
+	std::uniform_int_distribution<int> wallId(1, 8);
+
+	std::vector<int> cells(static_cast<size_t>(_width) * _height, 0);
+	for (int y = 0; y < _height; y++) {
+		for (int x = 0; x < _width; x++) {
+			bool border = x == 0 || y == 0 || x == _width - 1 || y == _height - 1;
+			if (border || roll(rng) < _wallDensity) {
+				cells[y * _width + x] = wallId(rng);
+			}
+		}
+	}
+	cells[(_height / 2) * _width + _width / 2] = 0;
+
+	return VreMap(_width, _height, _cellSize, cells);
+}
+
+void vre::bench::raycaster() {
+	struct Case {
+		int width;
+		int height;
+		int cellSize;
+	};
+	const Case cases[] = {
+		{ 64, 64, 64 },
+		{ 256, 256, 64 },
+		{ 1024, 1024, 64 },
+		{ 1000, 1000, 64 }, // not a power of two, generic only
+	};
+
+	constexpr int screenWidth = 1920;
+	constexpr int frames = 300;
+	std::vector<RayHit> hits(screenWidth);
+	std::vector<RayHit> reference(screenWidth);
+
+	std::cout << std::left << std::setw(14) << "map" << std::setw(14) << "kernel"
+		<< std::setw(12) << "Mrays/s" << "speedup" << std::endl;
+
+	for (const Case &c : cases) {
+		VreMap map = makeTestMap(c.width, c.height, c.cellSize, 0.02f, 1234);
+		RayCamera camera{ (c.width / 2 + 0.5f) * c.cellSize,
+			(c.height / 2 + 0.5f) * c.cellSize, 0.0f };
+
+		double genericRate = 0.0;
+		for (bool specialized : { false, true }) {
+			VreRaycaster raycaster;
+			RaycasterOptions options;
+			options.specialized = specialized;
+			options.occupancy = false;
+			raycaster.bindMap(map, options);
+			if (specialized && !raycaster.isSpecialized()) {
+				continue;
+			}
+
+			auto start = std::chrono::steady_clock::now();
+			for (int frame = 0; frame < frames; frame++) {
+				camera.angle = frame * 0.021f;
+				raycaster.castColumns(camera, 0, screenWidth, screenWidth, hits.data());
+			}
+			double rate = screenWidth * static_cast<double>(frames) / secondsSince(start) / 1e6;
+
+			// both kernels have to agree on the last frame
+			if (!specialized) {
+				genericRate = rate;
+				reference = hits;
+			} else {
+				for (int i = 0; i < screenWidth; i++) {
+					if (hits[i].cell != reference[i].cell
+						|| std::abs(hits[i].distance - reference[i].distance) > 1e-3f) {
+						std::cout << "mismatch at column " << i << std::endl;
+						break;
+					}
+				}
+			}
+
+			std::cout << std::setw(14) << (std::to_string(c.width) + "x" + std::to_string(c.height))
+				<< std::setw(14) << (specialized ? "specialized" : "generic")
+				<< std::setw(12) << std::fixed << std::setprecision(1) << rate
+				<< std::setprecision(2) << rate / genericRate << "x" << std::endl;
+		}
+	}
+}
+
+void vre::bench::occupancy() {
+	struct Case {
+		int size;
+		float density;
+		bool alongAxis; // only near axis rays, the case word stepping is for
+	};
+	const Case cases[] = {
+		{ 1024, 0.02f, false },
+		{ 1024, 0.002f, false },
+		{ 4096, 0.0005f, false },
+		{ 1024, 0.02f, true },
+		{ 1024, 0.002f, true },
+		{ 4096, 0.0005f, true },
+	};
+
+	constexpr int screenWidth = 1920;
+	constexpr int frames = 100;
+	std::vector<RayHit> dda(screenWidth);
+	std::vector<RayHit> bits(screenWidth);
+
+	std::cout << std::left << std::setw(10) << "map" << std::setw(10) << "density"
+		<< std::setw(8) << "rays" << std::setw(12) << "dda Mray/s"
+		<< std::setw(13) << "bits Mray/s" << std::setw(9) << "speedup"
+		<< std::setw(12) << "mismatches" << std::setw(9) << "dda off"
+		<< std::setw(10) << "bits off" << "memory (ints -> bits)" << std::endl;
+
+	for (const Case &c : cases) {
+		VreMap map = makeTestMap(c.size, c.size, 64, c.density, 99);
+
+		VreRaycaster ddaCaster;
+		ddaCaster.bindMap(map, { true, false });
+		VreRaycaster bitCaster;
+		bitCaster.bindMap(map, { true, true });
+
+		RayCamera camera{ (c.size / 2 + 0.5f) * 64.0f, (c.size / 2 + 0.5f) * 64.0f, 0.0f };
+		if (c.alongAxis) {
+			camera.fov = 0.3f;
+		}
+
+		double seconds[2] = { 0.0, 0.0 };
+		int mismatches = 0;
+		// disagreements with exactHit, per caster
+		int ddaOff = 0;
+		int bitsOff = 0;
+		for (int frame = 0; frame < frames; frame++) {
+			camera.angle = c.alongAxis ? (frame % 4) * 1.5707963f + 0.05f * std::sin(frame * 0.7f)
+				: frame * 0.063f;
+
+			auto start = std::chrono::steady_clock::now();
+			ddaCaster.castColumns(camera, 0, screenWidth, screenWidth, dda.data());
+			seconds[0] += secondsSince(start);
+
+			start = std::chrono::steady_clock::now();
+			bitCaster.castColumns(camera, 0, screenWidth, screenWidth, bits.data());
+			seconds[1] += secondsSince(start);
+
+			// the dda sums its side distances in float, far rays grazing a
+			// corner can land on a neighbour cell. every disagreement is
+			// settled by the exact walk
+			RayFrustum frustum(camera, screenWidth);
+			for (int i = 0; i < screenWidth; i++) {
+				if (dda[i].mapX == bits[i].mapX && dda[i].mapY == bits[i].mapY) {
+					continue;
+				}
+				mismatches++;
+				float dirX;
+				float dirY;
+				frustum.direction(i, dirX, dirY);
+				int mapX = -1;
+				int mapY = -1;
+				exactHit(map, camera, dirX, dirY, mapX, mapY);
+				ddaOff += dda[i].mapX != mapX || dda[i].mapY != mapY;
+				bitsOff += bits[i].mapX != mapX || bits[i].mapY != mapY;
+			}
+		}
+		assert(bitsOff == 0 && "occupancy spans missed the exact first wall");
+
+		double rays = screenWidth * static_cast<double>(frames) / 1e6;
+		double cellBytes = static_cast<double>(c.size) * c.size * sizeof(int);
+		std::cout << std::setw(10) << (std::to_string(c.size) + "^2")
+			<< std::setw(10) << c.density
+			<< std::setw(8) << (c.alongAxis ? "axis" : "all")
+			<< std::setw(12) << std::fixed << std::setprecision(1) << rays / seconds[0]
+			<< std::setw(13) << rays / seconds[1]
+			<< std::setw(9) << std::setprecision(2) << seconds[0] / seconds[1]
+			<< std::setw(12) << mismatches << std::setw(9) << ddaOff << std::setw(10) << bitsOff
+			<< cellBytes / (1 << 20) << " MB -> "
+			<< bitCaster.occupancy().memoryBytes() / double(1 << 20) << " MB"
+			<< std::defaultfloat << std::endl;
+	}
+}
+
+void vre::bench::indexed() {
+	struct Case {
+		const char *name;
+		int width;
+		int height;
+	};
+	const Case cases[] = {
+		{ "1080p", 1920, 1080 },
+		{ "4k", 3840, 2160 },
+	};
+
+	constexpr int frames = 100;
+	VreMap map = makeTestMap(64, 64, 64, 0.05f, 7);
+	VreRaycaster raycaster;
+	raycaster.bindMap(map);
+
+	std::cout << std::left << std::setw(8) << "size" << std::setw(10) << "format"
+		<< std::setw(12) << "ms/frame" << std::setw(10) << "speedup" << "MB/frame" << std::endl;
+
+	for (const Case &c : cases) {
+		VreCpuRenderer renderer;
+		renderer.resize(c.width, c.height);
+		std::vector<RayHit> hits(c.width);
+		std::vector<uint32_t> rgba(static_cast<size_t>(renderer.stride()) * c.height);
+		RayCamera camera{ 32.5f * 64.0f, 32.5f * 64.0f, 0.0f };
+
+		double seconds[2] = { 0.0, 0.0 };
+		for (int frame = 0; frame < frames; frame++) {
+			camera.angle = frame * 0.063f;
+			raycaster.castColumns(camera, 0, c.width, c.width, hits.data());
+
+			auto start = std::chrono::steady_clock::now();
+			renderer.renderRgba(camera, 64.0f, hits.data(), rgba.data());
+			seconds[0] += secondsSince(start);
+
+			start = std::chrono::steady_clock::now();
+			renderer.render(camera, 64.0f, hits.data());
+			seconds[1] += secondsSince(start);
+		}
+
+		double indexedMb = renderer.sizeBytes() / double(1 << 20);
+		const char *formats[] = { "rgba8", "indexed" };
+		double megabytes[] = { indexedMb * 4.0, indexedMb };
+		for (int i = 0; i < 2; i++) {
+			std::cout << std::setw(8) << c.name << std::setw(10) << formats[i]
+				<< std::setw(12) << std::fixed << std::setprecision(2) << seconds[i] * 1000.0 / frames
+				<< std::setw(10) << seconds[0] / seconds[i]
+				<< megabytes[i] << std::defaultfloat << std::endl;
+		}
+	}
+}
+
+void vre::bench::bsp() {
+	const int sizes[] = { 64, 256, 1024 };
+	constexpr int screenWidth = 1920;
+	constexpr int frames = 100;
+	std::vector<RayHit> grid(screenWidth);
+	std::vector<RayHit> tree(screenWidth);
+
+	std::cout << std::left << std::setw(8) << "map" << std::setw(10) << "segments"
+		<< std::setw(8) << "depth" << std::setw(12) << "build 1t ms" << std::setw(12) << "build mt ms"
+		<< std::setw(10) << "load ms" << std::setw(12) << "grid Mray/s" << std::setw(12) << "bsp Mray/s"
+		<< "mismatches" << std::endl;
+
+	for (int size : sizes) {
+		VreMap map = makeTestMap(size, size, 64, 0.02f, 5);
+		VreSegmentMap segmentMap = VreSegmentMap::fromGrid(map);
+
+		VreBsp bsp;
+		auto start = std::chrono::steady_clock::now();
+		bsp.build(segmentMap.segments(), 1);
+		double singleSeconds = secondsSince(start);
+
+		start = std::chrono::steady_clock::now();
+		bsp.build(segmentMap.segments());
+		double parallelSeconds = secondsSince(start);
+
+		std::string cachePath = "bench_bsp_" + std::to_string(size) + ".bin";
+		bsp.save(cachePath);
+		VreBsp cached;
+		start = std::chrono::steady_clock::now();
+		bool loaded = cached.load(cachePath, VreBsp::hashSegments(segmentMap.segments()));
+		double loadSeconds = secondsSince(start);
+		std::remove(cachePath.c_str());
+
+		VreRaycaster raycaster;
+		raycaster.bindMap(map);
+		VreGridRenderer gridRenderer(raycaster);
+		VreBspRenderer bspRenderer(cached, map.cellSize());
+
+		RayCamera camera{ (size / 2 + 0.5f) * 64.0f, (size / 2 + 0.5f) * 64.0f, 0.0f };
+		double seconds[2] = { 0.0, 0.0 };
+		int mismatches = 0;
+		for (int frame = 0; frame < frames; frame++) {
+			camera.angle = frame * 0.063f;
+
+			start = std::chrono::steady_clock::now();
+			gridRenderer.castColumns(camera, 0, screenWidth, screenWidth, grid.data());
+			seconds[0] += secondsSince(start);
+
+			start = std::chrono::steady_clock::now();
+			bspRenderer.castColumns(camera, 0, screenWidth, screenWidth, tree.data());
+			seconds[1] += secondsSince(start);
+
+			// same walls, so the same wall id at nearly the same distance
+			for (int i = 0; i < screenWidth; i++) {
+				if (grid[i].cell != tree[i].cell
+					|| std::abs(grid[i].distance - tree[i].distance) > 1e-3f * grid[i].distance + 0.1f) {
+					mismatches++;
+				}
+			}
+		}
+
+		double rays = screenWidth * static_cast<double>(frames) / 1e6;
+		std::cout << std::setw(8) << (std::to_string(size) + "^2")
+			<< std::setw(10) << cached.segments().size()
+			<< std::setw(8) << cached.depth()
+			<< std::setw(12) << std::fixed << std::setprecision(1) << singleSeconds * 1000.0
+			<< std::setw(12) << parallelSeconds * 1000.0
+			<< std::setw(10) << (loaded ? std::to_string(loadSeconds * 1000.0).substr(0, 5) : "failed")
+			<< std::setw(12) << rays / seconds[0]
+			<< std::setw(12) << rays / seconds[1]
+			<< mismatches << std::defaultfloat << std::endl;
+	}
+}
+
+void vre::bench::bvh() {
+	const int sizes[] = { 64, 256, 1024 };
+	constexpr int screenWidth = 1920;
+	constexpr int frames = 100;
+	std::vector<RayHit> packet(screenWidth);
+	std::vector<RayHit> reference(screenWidth);
+
+	std::cout << std::left << std::setw(8) << "map" << std::setw(10) << "segments"
+		<< std::setw(9) << "nodes" << std::setw(12) << "build 1t ms" << std::setw(12) << "build mt ms"
+		<< std::setw(12) << "bsp Mray/s" << std::setw(13) << "single Mray/s"
+		<< std::setw(13) << "packet Mray/s" << "mismatches" << std::endl;
+
+	for (int size : sizes) {
+		VreMap map = makeTestMap(size, size, 64, 0.02f, 5);
+		VreSegmentMap segmentMap = VreSegmentMap::fromGrid(map);
+		const std::vector<Segment> &segments = segmentMap.segments();
+
+		VreBvh bvh;
+		auto start = std::chrono::steady_clock::now();
+		bvh.build(segments, 1);
+		double singleBuild = secondsSince(start);
+		start = std::chrono::steady_clock::now();
+		bvh.build(segments);
+		double parallelBuild = secondsSince(start);
+
+		VreBsp bsp;
+		bsp.build(segments);
+		VreBspRenderer bspRenderer(bsp, map.cellSize());
+		VreBvhRenderer bvhRenderer(bvh, segments, map.cellSize());
+
+		RayCamera camera{ (size / 2 + 0.5f) * 64.0f, (size / 2 + 0.5f) * 64.0f, 0.0f };
+		double seconds[3] = { 0.0, 0.0, 0.0 };
+		int mismatches = 0;
+		for (int frame = 0; frame < frames; frame++) {
+			camera.angle = frame * 0.063f;
+
+			start = std::chrono::steady_clock::now();
+			bspRenderer.castColumns(camera, 0, screenWidth, screenWidth, reference.data());
+			seconds[0] += secondsSince(start);
+
+			// one ray at a time, hits are not converted so this is traversal only
+			RayFrustum frustum(camera, screenWidth);
+			start = std::chrono::steady_clock::now();
+			for (int i = 0; i < screenWidth; i++) {
+				BvhRay ray{ camera.x, camera.y, 0.0f, 0.0f, raycast::NO_HIT_DISTANCE };
+				frustum.direction(i, ray.dirX, ray.dirY);
+				packet[i].distance = bvh.intersect(ray).t;
+			}
+			seconds[1] += secondsSince(start);
+
+			start = std::chrono::steady_clock::now();
+			bvhRenderer.castColumns(camera, 0, screenWidth, screenWidth, packet.data());
+			seconds[2] += secondsSince(start);
+
+			for (int i = 0; i < screenWidth; i++) {
+				if (packet[i].cell != reference[i].cell
+					|| std::abs(packet[i].distance - reference[i].distance) > 1e-3f * reference[i].distance + 0.1f) {
+					mismatches++;
+				}
+			}
+		}
+
+		double rays = screenWidth * static_cast<double>(frames) / 1e6;
+		std::cout << std::setw(8) << (std::to_string(size) + "^2")
+			<< std::setw(10) << segments.size()
+			<< std::setw(9) << bvh.nodes().size()
+			<< std::setw(12) << std::fixed << std::setprecision(1) << singleBuild * 1000.0
+			<< std::setw(12) << parallelBuild * 1000.0
+			<< std::setw(12) << rays / seconds[0]
+			<< std::setw(13) << rays / seconds[1]
+			<< std::setw(13) << rays / seconds[2]
+			<< mismatches << std::defaultfloat << std::endl;
+	}
+
+	// a door slides along, refit instead of rebuilding
+	VreMap map = makeTestMap(1024, 1024, 64, 0.02f, 5);
+	std::vector<Segment> segments = VreSegmentMap::fromGrid(map).segments();
+	VreBvh refitted;
+	refitted.build(segments);
+
+	std::mt19937 rng(3);
+	std::uniform_int_distribution<size_t> pick(0, segments.size() - 1);
+	std::vector<size_t> moving(segments.size() / 100);
+	for (size_t &index : moving) {
+		index = pick(rng);
+	}
+	double refitSeconds = 0.0;
+	for (int step = 1; step <= 10; step++) {
+		for (size_t index : moving) {
+			segments[index].x1 += 3.2f;
+			segments[index].x2 += 3.2f;
+		}
+		auto start = std::chrono::steady_clock::now();
+		refitted.refit(segments);
+		refitSeconds += secondsSince(start);
+	}
+	auto start = std::chrono::steady_clock::now();
+	VreBvh rebuilt;
+	rebuilt.build(segments);
+	double rebuildSeconds = secondsSince(start);
+
+	// both trees hold the same segments, they must find the same hits
+	std::uniform_real_distribution<float> coordinate(64.0f, 1023.0f * 64.0f);
+	std::uniform_real_distribution<float> angle(0.0f, 6.2831853f);
+	int differences = 0;
+	int blocked = 0;
+	constexpr int queries = 100000;
+	for (int i = 0; i < queries; i++) {
+		float a = angle(rng);
+		BvhRay ray{ coordinate(rng), coordinate(rng), std::cos(a), std::sin(a), 4096.0f };
+		BvhHit first = refitted.intersect(ray);
+		BvhHit second = rebuilt.intersect(ray);
+		if (first.segment != second.segment && std::abs(first.t - second.t) > 1e-3f) {
+			differences++;
+		}
+		if (refitted.occluded(ray) != (second.segment >= 0)) {
+			differences++;
+		}
+		blocked += second.segment >= 0;
+	}
+	std::cout << "1% of segments moving on 1024^2: refit " << std::fixed << std::setprecision(2)
+		<< refitSeconds * 100.0 << " ms, rebuild " << rebuildSeconds * 1000.0 << " ms, "
+		<< differences << "/" << queries << " queries differ (" << blocked << " blocked)"
+		<< std::defaultfloat << std::endl;
+}
+
+void vre::bench::pathTracer() {
+	constexpr int width = 1280;
+	constexpr int height = 720;
+	constexpr int samples = 8;
+	VreMap map = makeTestMap(64, 64, 64, 0.1f, 11);
+	RayCamera camera{ 32.5f * 64.0f, 32.5f * 64.0f, 0.3f };
+
+	// a fixed count so the determinism check splits the tiles across
+	// threads even where the machine has a single core
+	VreThreadPool single(1);
+	VreThreadPool four(4);
+	VreThreadPool &shared = VreThreadPool::shared();
+	VreThreadPool *pools[] = { &single, &four };
+
+	std::cout << std::left << std::setw(10) << "threads" << std::setw(14) << "ms/sample"
+		<< std::setw(14) << "Mpath/s" << "lights" << std::endl;
+
+	std::vector<float> images[2];
+	for (int i = 0; i < 2; i++) {
+		VrePathTracer tracer;
+		tracer.bindMap(map);
+		tracer.resize(width, height);
+
+		auto start = std::chrono::steady_clock::now();
+		for (int s = 0; s < samples; s++) {
+			tracer.renderSample(camera, *pools[i]);
+		}
+		double seconds = secondsSince(start);
+
+		std::cout << std::setw(10) << pools[i]->threadCount() << std::fixed << std::setprecision(2)
+			<< std::setw(14) << seconds * 1000.0 / samples
+			<< std::setw(14) << width * height * samples / seconds / 1e6
+			<< std::defaultfloat << tracer.lights().size() << std::endl;
+
+		images[i].assign(tracer.accumulation(), tracer.accumulation() + width * height * 4);
+	}
+
+	// paths are seeded per pixel and sample, the thread count must not matter
+	std::cout << "1 thread and " << four.threadCount() << " threads "
+		<< (images[0] == images[1] ? "match" : "differ") << " after " << samples << " samples" << std::endl;
+	assert(images[0] == images[1] && "path tracer image depends on the thread count");
+
+	// noise against a longer run, should halve for every 4x the samples
+	VrePathTracer tracer;
+	tracer.bindMap(map);
+	tracer.resize(width / 4, height / 4);
+	std::vector<float> reference;
+	for (int s = 0; s < 256; s++) {
+		tracer.renderSample(camera, shared);
+	}
+	reference.assign(tracer.accumulation(), tracer.accumulation() + tracer.width() * tracer.height() * 4);
+
+	tracer.reset();
+	for (int s = 1; s <= 64; s++) {
+		tracer.renderSample(camera, shared);
+		if (s != 1 && s != 4 && s != 16 && s != 64) {
+			continue;
+		}
+		double error = 0.0;
+		for (size_t p = 0; p < reference.size(); p += 4) {
+			for (int c = 0; c < 3; c++) {
+				double difference = tracer.accumulation()[p + c] / s - reference[p + c] / 256.0;
+				error += difference * difference;
+			}
+		}
+		std::cout << "rmse at " << s << " spp: " << std::sqrt(error / (reference.size() / 4 * 3)) << std::endl;
+	}
+}
+
+void vre::bench::tiled() {
+	struct Case {
+		const char *name;
+		int width;
+		int height;
+	};
+	const Case cases[] = {
+		{ "1080p", 1920, 1080 },
+		{ "4k", 3840, 2160 },
+	};
+	const CpuTileOptions tilings[] = {
+		{ 32, 32 },
+		{ 64, 64 },
+		{ 128, 64 },
+		{ 256, 32 },
+	};
+
+	constexpr int frames = 100;
+	VreMap map = makeTestMap(64, 64, 64, 0.05f, 7);
+	VreRaycaster raycaster;
+	raycaster.bindMap(map);
+	VreThreadPool &pool = VreThreadPool::shared();
+
+	std::cout << pool.threadCount() << " threads, ray casting included in every time" << std::endl;
+	std::cout << std::left << std::setw(8) << "size" << std::setw(16) << "order"
+		<< std::setw(12) << "ms/frame" << std::setw(10) << "speedup" << "same image" << std::endl;
+
+	for (const Case &c : cases) {
+		VreCpuRenderer columnOrder;
+		columnOrder.resize(c.width, c.height);
+		std::vector<RayHit> hits(c.width);
+
+		auto start = std::chrono::steady_clock::now();
+		for (int frame = 0; frame < frames; frame++) {
+			RayCamera camera{ 32.5f * 64.0f, 32.5f * 64.0f, frame * 0.063f };
+			raycaster.castColumns(camera, 0, c.width, c.width, hits.data());
+			columnOrder.render(camera, 64.0f, hits.data());
+		}
+		double baseline = secondsSince(start);
+		std::cout << std::setw(8) << c.name << std::setw(16) << "columns" << std::fixed
+			<< std::setprecision(2) << std::setw(12) << baseline * 1000.0 / frames
+			<< std::setw(10) << 1.0 << "-" << std::defaultfloat << std::endl;
+
+		for (const CpuTileOptions &tiling : tilings) {
+			VreCpuRenderer renderer;
+			renderer.resize(c.width, c.height);
+
+			start = std::chrono::steady_clock::now();
+			for (int frame = 0; frame < frames; frame++) {
+				RayCamera camera{ 32.5f * 64.0f, 32.5f * 64.0f, frame * 0.063f };
+				renderer.renderTiled(raycaster, camera, pool, tiling);
+			}
+			double seconds = secondsSince(start);
+
+			// both renderers finished on the same last camera
+			bool same = std::equal(renderer.pixels(), renderer.pixels() + renderer.sizeBytes(),
+				columnOrder.pixels());
+			std::string order = "tiles " + std::to_string(tiling.columnBand) + "x"
+				+ std::to_string(tiling.rowBand);
+			std::cout << std::setw(8) << c.name << std::setw(16) << order << std::fixed
+				<< std::setprecision(2) << std::setw(12) << seconds * 1000.0 / frames
+				<< std::setw(10) << baseline / seconds << (same ? "yes" : "no")
+				<< std::defaultfloat << std::endl;
+		}
+	}
+}
+
+void vre::bench::transpose() {
+	struct Case {
+		const char *name;
+		int width;
+		int height;
+	};
+	const Case cases[] = {
+		{ "1080p", 1920, 1080 },
+		{ "4k", 3840, 2160 },
+		{ "odd", 1366, 771 },
+	};
+
+	constexpr int frames = 100;
+	VreMap map = makeTestMap(64, 64, 64, 0.05f, 7);
+	VreRaycaster raycaster;
+	raycaster.bindMap(map);
+	VreThreadPool &pool = VreThreadPool::shared();
+
+	std::cout << std::left << std::setw(8) << "size" << std::setw(14) << "row draw ms"
+		<< std::setw(10) << "+ copy" << std::setw(14) << "col draw ms" << std::setw(14) << "transpose ms"
+		<< std::setw(10) << "speedup" << "same image" << std::endl;
+
+	for (const Case &c : cases) {
+		VreCpuRenderer renderer;
+		renderer.resize(c.width, c.height);
+		std::vector<RayHit> hits(c.width);
+		// stands in for the mapped staging buffer, 64 byte aligned like a
+		// vulkan mapping
+		std::vector<uint8_t> stagingStorage(renderer.sizeBytes() + 64);
+		uint8_t *staging = stagingStorage.data() + (64 - reinterpret_cast<uintptr_t>(stagingStorage.data()) % 64) % 64;
+
+		double seconds[4] = {};
+		bool same = true;
+		for (int frame = 0; frame < frames; frame++) {
+			RayCamera camera{ 32.5f * 64.0f, 32.5f * 64.0f, frame * 0.063f };
+			raycaster.castColumns(camera, 0, c.width, c.width, hits.data());
+
+			// the row major path pays for a memcpy into staging on upload
+			auto start = std::chrono::steady_clock::now();
+			renderer.render(camera, 64.0f, hits.data());
+			seconds[0] += secondsSince(start);
+			start = std::chrono::steady_clock::now();
+			memcpy(staging, renderer.pixels(), renderer.sizeBytes());
+			seconds[1] += secondsSince(start);
+
+			start = std::chrono::steady_clock::now();
+			renderer.renderColumnMajor(camera, 64.0f, hits.data());
+			seconds[2] += secondsSince(start);
+			start = std::chrono::steady_clock::now();
+			renderer.transposeTo(staging, pool);
+			seconds[3] += secondsSince(start);
+
+			for (int y = 0; y < c.height && same; y++) {
+				same = std::equal(staging + static_cast<size_t>(y) * renderer.stride(),
+					staging + static_cast<size_t>(y) * renderer.stride() + c.width,
+					renderer.pixels() + static_cast<size_t>(y) * renderer.stride());
+			}
+		}
+
+		double rowTotal = seconds[0] + seconds[1];
+		double columnTotal = seconds[2] + seconds[3];
+		std::cout << std::setw(8) << c.name << std::fixed << std::setprecision(2)
+			<< std::setw(14) << seconds[0] * 1000.0 / frames << std::setw(10) << seconds[1] * 1000.0 / frames
+			<< std::setw(14) << seconds[2] * 1000.0 / frames << std::setw(14) << seconds[3] * 1000.0 / frames
+			<< std::setw(10) << rowTotal / columnTotal << (same ? "yes" : "no")
+			<< std::defaultfloat << std::endl;
+	}
+}
+
+void vre::bench::batchEnv() {
+	const int counts[] = { 1024, 4096, 16384 };
+	constexpr int steps = 2000;
+	constexpr int actionFrames = 64;
+
+	// a few maps shared by every environment
+	std::vector<VreMap> maps;
+	for (unsigned int seed = 0; seed < 4; seed++) {
+		maps.push_back(makeTestMap(64, 64, 64, 0.1f, seed));
+	}
+	std::vector<const VreMap *> mapPointers;
+	for (const VreMap &map : maps) {
+		mapPointers.push_back(&map);
+	}
+
+	VreThreadPool single(1);
+	VreThreadPool &shared = VreThreadPool::shared();
+
+	std::cout << std::left << std::setw(8) << "envs" << std::setw(10) << "threads"
+		<< std::setw(14) << "Msteps/s" << std::setw(12) << "episodes" << "rewards" << std::endl;
+
+	for (int count : counts) {
+		std::vector<uint16_t> mapIndex(count);
+		for (int i = 0; i < count; i++) {
+			mapIndex[i] = static_cast<uint16_t>(i % maps.size());
+		}
+
+		// random actions, generated up front so only stepping is timed
+		std::mt19937 rng(3);
+		std::uniform_int_distribution<int> action(0, 15);
+		std::vector<uint8_t> actions(static_cast<size_t>(count) * actionFrames);
+		for (uint8_t &a : actions) {
+			a = static_cast<uint8_t>(action(rng));
+		}
+
+		VreThreadPool *pools[] = { &single, &shared };
+		std::vector<float> finalX[2];
+		for (int p = 0; p < 2; p++) {
+			if (p == 1 && shared.threadCount() == 1) {
+				finalX[1] = finalX[0];
+				break;
+			}
+			VreBatchEnv env(mapPointers, mapIndex);
+			uint64_t episodes = 0;
+			double rewards = 0.0;
+
+			auto start = std::chrono::steady_clock::now();
+			for (int s = 0; s < steps; s++) {
+				env.step(&actions[static_cast<size_t>(s % actionFrames) * count], *pools[p]);
+				// reading the results is part of what an agent loop pays for
+				for (int i = 0; i < count; i++) {
+					episodes += env.dones()[i];
+					rewards += env.rewards()[i];
+				}
+			}
+			double seconds = secondsSince(start);
+			finalX[p].assign(env.x(), env.x() + count);
+
+			std::cout << std::setw(8) << count << std::setw(10) << pools[p]->threadCount()
+				<< std::fixed << std::setprecision(2) << std::setw(14) << env.totalSteps() / seconds / 1e6
+				<< std::defaultfloat << std::setw(12) << episodes << rewards << std::endl;
+		}
+		if (finalX[0] != finalX[1]) {
+			std::cout << "thread count changed the simulation" << std::endl;
+		}
+	}
+}
+
+void vre::bench::multiCamera() {
+	const int cameraCounts[] = { 256, 4096 };
+	const int columnCounts[] = { 32, 64, 128 };
+	constexpr int ticks = 20;
+
+	std::vector<VreMap> maps;
+	for (unsigned int seed = 0; seed < 4; seed++) {
+		maps.push_back(makeTestMap(64, 64, 64, 0.1f, seed));
+	}
+	std::vector<const VreMap *> mapPointers;
+	for (const VreMap &map : maps) {
+		mapPointers.push_back(&map);
+	}
+	VreThreadPool &pool = VreThreadPool::shared();
+
+	std::cout << std::left << std::setw(10) << "cameras" << std::setw(10) << "columns"
+		<< std::setw(14) << "single Mray/s" << std::setw(14) << "batch Mray/s"
+		<< std::setw(10) << "speedup" << "mismatches" << std::endl;
+
+	for (int cameras : cameraCounts) {
+		// agent poses straight from the batch env, moved by random actions
+		std::vector<uint16_t> mapIndex(cameras);
+		for (int i = 0; i < cameras; i++) {
+			mapIndex[i] = static_cast<uint16_t>(i % maps.size());
+		}
+		VreBatchEnv env(mapPointers, mapIndex);
+		std::mt19937 rng(9);
+		std::vector<uint8_t> actions(cameras);
+
+		for (int columns : columnCounts) {
+			MultiCameraSettings settings;
+			settings.columns = columns;
+			VreMultiCamera multiCamera(mapPointers, settings);
+			std::vector<float> observations(multiCamera.outputSize(cameras));
+			std::vector<RayHit> hits(columns);
+			std::vector<VreRaycaster> raycasters(maps.size());
+			for (size_t m = 0; m < maps.size(); m++) {
+				raycasters[m].bindMap(maps[m]);
+			}
+
+			double seconds[2] = {};
+			int mismatches = 0;
+			for (int tick = 0; tick < ticks; tick++) {
+				for (uint8_t &a : actions) {
+					a = static_cast<uint8_t>(rng() & 15);
+				}
+				env.step(actions.data(), pool);
+
+				auto start = std::chrono::steady_clock::now();
+				MultiCameraPoses poses{ env.x(), env.y(), env.angle(), mapIndex.data(), cameras };
+				multiCamera.cast(poses, observations.data(), pool);
+				seconds[1] += secondsSince(start);
+
+				// one raycaster call per camera is what this replaces
+				for (int c = 0; c < cameras; c++) {
+					RayCamera camera{ env.x()[c], env.y()[c], env.angle()[c], settings.fov };
+					start = std::chrono::steady_clock::now();
+					raycasters[mapIndex[c]].castColumns(camera, 0, columns, columns, hits.data());
+					seconds[0] += secondsSince(start);
+
+					const float *depth = &observations[multiCamera.outputSize(c) + OBSERVATION_DEPTH * columns];
+					const float *wall = &observations[multiCamera.outputSize(c) + OBSERVATION_WALL * columns];
+					for (int i = 0; i < columns; i++) {
+						if (static_cast<int>(wall[i]) != hits[i].cell
+							|| std::abs(depth[i] - hits[i].distance / 64.0f) > 1e-3f) {
+							mismatches++;
+						}
+					}
+				}
+			}
+
+			double rays = static_cast<double>(cameras) * columns * ticks;
+			std::cout << std::setw(10) << cameras << std::setw(10) << columns << std::fixed
+				<< std::setprecision(2) << std::setw(14) << rays / seconds[0] / 1e6
+				<< std::setw(14) << rays / seconds[1] / 1e6 << std::setw(10) << seconds[0] / seconds[1]
+				<< std::defaultfloat << mismatches << std::endl;
+		}
+	}
+}
+
+void vre::bench::seeThrough() {
+	constexpr int width = 1920;
+	constexpr int height = 1080;
+	constexpr int frames = 100;
+	VreMap map = makeTestMap(64, 64, 64, 0.05f, 7);
+	VreRaycaster raycaster;
+	raycaster.bindMap(map);
+	VreThreadPool &pool = VreThreadPool::shared();
+
+	std::vector<RayHit> hits(width);
+	std::vector<RayLayers> layers(width);
+	VreCpuRenderer renderer;
+	renderer.resize(width, height);
+	std::vector<uint8_t> reference;
+
+	std::cout << "1080p, casting and drawing on one thread, tiled on " << pool.threadCount()
+		<< " threads" << std::endl;
+	std::cout << std::left << std::setw(14) << "map" << std::setw(22) << "path"
+		<< std::setw(12) << "ms/frame" << std::setw(16) << "layers/column" << "same image" << std::endl;
+
+	auto report = [&](const char *_map, const char *_path, double _seconds, double _layers, bool _same) {
+		std::cout << std::setw(14) << _map << std::setw(22) << _path << std::fixed
+			<< std::setprecision(2) << std::setw(12) << _seconds * 1000.0 / frames
+			<< std::setw(16) << _layers << std::defaultfloat << (_same ? "yes" : "no") << std::endl;
+	};
+
+	for (int glass = 0; glass < 2; glass++) {
+		// two of the eight wall ids turn into glass on the second pass
+		if (glass == 1) {
+			map.setTransparent(3, true);
+			map.setTransparent(6, true);
+		}
+		const char *name = glass == 0 ? "opaque" : "25% glass";
+
+		auto start = std::chrono::steady_clock::now();
+		for (int frame = 0; frame < frames; frame++) {
+			RayCamera camera{ 32.5f * 64.0f, 32.5f * 64.0f, frame * 0.063f };
+			raycaster.castColumns(camera, 0, width, width, hits.data());
+			renderer.render(camera, 64.0f, hits.data());
+		}
+		report(name, "single hit", secondsSince(start), 0.0, true);
+		reference.assign(renderer.pixels(), renderer.pixels() + renderer.sizeBytes());
+
+		size_t layerCount = 0;
+		start = std::chrono::steady_clock::now();
+		for (int frame = 0; frame < frames; frame++) {
+			RayCamera camera{ 32.5f * 64.0f, 32.5f * 64.0f, frame * 0.063f };
+			raycaster.castColumnsLayered(camera, 0, width, width, hits.data(), layers.data());
+			renderer.render(camera, 64.0f, hits.data(), layers.data());
+			for (const RayLayers &l : layers) {
+				layerCount += l.count;
+			}
+		}
+		double seconds = secondsSince(start);
+		bool same = std::equal(reference.begin(), reference.end(), renderer.pixels());
+		report(name, "layered", seconds, layerCount / double(width) / frames, same);
+		reference.assign(renderer.pixels(), renderer.pixels() + renderer.sizeBytes());
+
+		start = std::chrono::steady_clock::now();
+		for (int frame = 0; frame < frames; frame++) {
+			RayCamera camera{ 32.5f * 64.0f, 32.5f * 64.0f, frame * 0.063f };
+			renderer.renderTiled(raycaster, camera, pool);
+		}
+		seconds = secondsSince(start);
+		same = std::equal(reference.begin(), reference.end(), renderer.pixels());
+		report(name, "tiled", seconds, layerCount / double(width) / frames, same);
+	}
+}
+
+void vre::bench::stacked() {
+	constexpr int width = 1920;
+	constexpr int height = 1080;
+	constexpr int frames = 100;
+	VreMap map = makeTestMap(64, 64, 64, 0.05f, 7);
+	VreRaycaster raycaster;
+	raycaster.bindMap(map);
+	VreThreadPool &pool = VreThreadPool::shared();
+
+	VreCpuRenderer flat;
+	flat.resize(width, height);
+	VreCpuRenderer renderer;
+	renderer.resize(width, height);
+	std::vector<RayHit> hits(width);
+
+	std::cout << "1080p column major, casting included, stacked on " << pool.threadCount()
+		<< " threads" << std::endl;
+	std::cout << std::left << std::setw(16) << "map" << std::setw(18) << "renderer"
+		<< std::setw(12) << "ms/frame" << "same image" << std::endl;
+
+	auto start = std::chrono::steady_clock::now();
+	for (int frame = 0; frame < frames; frame++) {
+		RayCamera camera{ 32.5f * 64.0f, 32.5f * 64.0f, frame * 0.063f };
+		raycaster.castColumns(camera, 0, width, width, hits.data());
+		flat.renderColumnMajor(camera, 64.0f, hits.data());
+	}
+	double seconds = secondsSince(start);
+	std::cout << std::setw(16) << "flat" << std::setw(18) << "column major" << std::fixed
+		<< std::setprecision(2) << std::setw(12) << seconds * 1000.0 / frames << std::defaultfloat
+		<< "-" << std::endl;
+
+	for (int pass = 0; pass < 2; pass++) {
+		// second pass: half height walls, raised floors and low ceilings
+		if (pass == 1) {
+			std::mt19937 rng(3);
+			std::uniform_real_distribution<float> roll(0.0f, 1.0f);
+			for (int y = 1; y < map.height() - 1; y++) {
+				for (int x = 1; x < map.width() - 1; x++) {
+					CellHeights heights;
+					float r = roll(rng);
+					if (map.at(x, y) != 0) {
+						heights.wallTop = r < 0.5f ? 0.3f + r : 1.0f;
+					} else if (r < 0.1f) {
+						heights.floor = 0.2f;
+					} else if (r < 0.2f) {
+						heights.ceiling = 0.8f;
+					}
+					map.setHeights(x, y, heights);
+				}
+			}
+		}
+
+		start = std::chrono::steady_clock::now();
+		for (int frame = 0; frame < frames; frame++) {
+			RayCamera camera{ 32.5f * 64.0f, 32.5f * 64.0f, frame * 0.063f };
+			renderer.renderStacked(map, camera, pool);
+		}
+		seconds = secondsSince(start);
+		bool same = std::equal(renderer.columnPixels(), renderer.columnPixels()
+			+ static_cast<size_t>(renderer.columnStride()) * width, flat.columnPixels());
+		std::cout << std::setw(16) << (pass == 0 ? "flat" : "varied heights") << std::setw(18)
+			<< "stacked" << std::fixed << std::setprecision(2) << std::setw(12)
+			<< seconds * 1000.0 / frames << std::defaultfloat << (same ? "yes" : "no") << std::endl;
+	}
+}
+
+void vre::bench::terrain() {
+	struct Case {
+		const char *name;
+		float lodGrowth;
+	};
+	const Case cases[] = {
+		{ "fixed step", 0.0f },
+		{ "lod 0.003", 0.003f },
+		{ "lod 0.006", 0.006f },
+		{ "lod 0.012", 0.012f },
+	};
+
+	constexpr int width = 1920;
+	constexpr int height = 1080;
+	constexpr int frames = 60;
+	auto start = std::chrono::steady_clock::now();
+	VreTerrain terrain = VreTerrain::generate(10, 5);
+	std::cout << "1024x1024 terrain generated in " << secondsSince(start) * 1000.0 << " ms" << std::endl;
+
+	VreThreadPool &pool = VreThreadPool::shared();
+	VreCpuRenderer renderer;
+	renderer.resize(width, height);
+	std::vector<uint8_t> frame(static_cast<size_t>(renderer.stride()) * height);
+
+	std::cout << "1080p on " << pool.threadCount() << " threads, upload transpose included" << std::endl;
+	std::cout << std::left << std::setw(14) << "march" << std::setw(12) << "ms/frame"
+		<< std::setw(10) << "fps" << std::endl;
+
+	for (const Case &c : cases) {
+		TerrainSettings settings;
+		settings.lodGrowth = c.lodGrowth;
+		start = std::chrono::steady_clock::now();
+		for (int i = 0; i < frames; i++) {
+			// flying a circle low over the hills
+			float angle = i * 0.05f;
+			TerrainCamera camera{ 512.0f + 300.0f * std::cos(angle), 512.0f + 300.0f * std::sin(angle),
+				angle + 1.5707963f, 0.0f };
+			camera.height = terrain.heightAt(camera.x, camera.y) * settings.verticalScale + 40.0f;
+			renderer.renderTerrain(terrain, camera, pool, settings);
+			renderer.transposeTo(frame.data(), pool);
+		}
+		double ms = secondsSince(start) * 1000.0 / frames;
+		std::cout << std::setw(14) << c.name << std::fixed << std::setprecision(2) << std::setw(12)
+			<< ms << std::setw(10) << 1000.0 / ms << std::defaultfloat << std::endl;
+	}
+}
+
+void vre::bench::voxel() {
+	constexpr int width = 960;
+	constexpr int height = 540;
+	constexpr int frames = 10;
+	auto start = std::chrono::steady_clock::now();
+	VreBrickMap map = VreBrickMap::testScene();
+	std::cout << "test scene built in " << secondsSince(start) * 1000.0 << " ms" << std::endl;
+
+	size_t sparseBytes = map.coarseCount() * sizeof(uint32_t) + map.brickCount() * VreBrickMap::BRICK_VOXELS;
+	size_t denseBytes = static_cast<size_t>(map.voxelsX()) * map.voxelsY() * map.voxelsZ();
+	std::cout << map.brickCount() << " of " << map.coarseCount() << " bricks allocated, "
+		<< sparseBytes / 1024 << " KiB against " << denseBytes / 1024 << " KiB dense" << std::endl;
+
+	VreThreadPool &pool = VreThreadPool::shared();
+	VreVoxelTracer tracer;
+	tracer.bindMap(map);
+	int stride = (width + 3) & ~3;
+	std::vector<uint8_t> image(static_cast<size_t>(stride) * height);
+
+	std::cout << "960x540 on " << pool.threadCount() << " threads" << std::endl;
+	std::cout << std::left << std::setw(12) << "walk" << std::setw(12) << "ms/frame"
+		<< std::setw(12) << "Mrays/s" << "mismatches" << std::endl;
+
+	for (int pass = 0; pass < 2; pass++) {
+		size_t mismatches = 0;
+		start = std::chrono::steady_clock::now();
+		for (int i = 0; i < frames; i++) {
+			// circling the ball between the pillars, looking a little down
+			float angle = i * 0.6f;
+			VoxelCamera camera{ 128.0f + 90.0f * std::cos(angle), 128.0f + 90.0f * std::sin(angle),
+				24.0f, angle + 2.0f, -0.15f };
+			VoxelFrame frame = VoxelFrame::make(map, camera, width, height, stride);
+			if (pass == 0) {
+				tracer.render(frame, image.data(), pool);
+				continue;
+			}
+			pool.parallelFor(height, [&](int _y) {
+				for (int x = 0; x < width; x++) {
+					image[static_cast<size_t>(_y) * stride + x] = tracer.traceDense(frame, x, _y);
+				}
+			});
+		}
+		double seconds = secondsSince(start);
+
+		// the last frame again through the other walk
+		if (pass == 1) {
+			float angle = (frames - 1) * 0.6f;
+			VoxelCamera camera{ 128.0f + 90.0f * std::cos(angle), 128.0f + 90.0f * std::sin(angle),
+				24.0f, angle + 2.0f, -0.15f };
+			VoxelFrame frame = VoxelFrame::make(map, camera, width, height, stride);
+			for (int y = 0; y < height; y++) {
+				for (int x = 0; x < width; x++) {
+					mismatches += image[static_cast<size_t>(y) * stride + x] != tracer.tracePixel(frame, x, y);
+				}
+			}
+		}
+		std::cout << std::setw(12) << (pass == 0 ? "brickmap" : "dense") << std::fixed
+			<< std::setprecision(2) << std::setw(12) << seconds * 1000.0 / frames << std::setw(12)
+			<< width * height * frames / seconds / 1e6 << std::defaultfloat;
+		if (pass == 1) {
+			std::cout << mismatches;
+		} else {
+			std::cout << "-";
+		}
+		std::cout << std::endl;
+	}
+}
+
+void vre::bench::gridMesh() {
+	constexpr int edits = 200;
+	VrePalette palette;
+	VreThreadPool &pool = VreThreadPool::shared();
+
+	std::cout << "chunks of " << VreGridMesher::CHUNK_SIZE << " cells on " << pool.threadCount()
+		<< " threads" << std::endl;
+	std::cout << std::left << std::setw(12) << "map" << std::setw(12) << "build ms" << std::setw(14)
+		<< "naive tris" << std::setw(14) << "greedy tris" << "edit ms" << std::endl;
+
+	for (int size : { 64, 256, 1024 }) {
+		VreMap map = makeTestMap(size, size, 64, 0.1f, 11);
+
+		// one quad per exposed wall side and per floor and ceiling cell
+		size_t naiveQuads = 0;
+		for (int y = 0; y < size; y++) {
+			for (int x = 0; x < size; x++) {
+				if (map.at(x, y) == 0) {
+					naiveQuads += 2;
+					continue;
+				}
+				const int sides[4][2] = { { 1, 0 }, { -1, 0 }, { 0, 1 }, { 0, -1 } };
+				for (const auto &side : sides) {
+					int nx = x + side[0];
+					int ny = y + side[1];
+					naiveQuads += map.inBounds(nx, ny) && map.at(nx, ny) == 0 ? 1 : 0;
+				}
+			}
+		}
+
+		auto start = std::chrono::steady_clock::now();
+		VreGridMesher mesher(map, palette);
+		mesher.rebuildDirty(pool);
+		double buildMs = secondsSince(start) * 1000.0;
+		size_t triangles = 0;
+		for (int i = 0; i < mesher.chunkCount(); i++) {
+			triangles += mesher.chunk(i).indices.size() / 3;
+		}
+
+		// toggling single interior cells, each one rebuilds up to 3 chunks
+		std::mt19937 rng(5);
+		std::uniform_int_distribution<int> cell(1, size - 2);
+		start = std::chrono::steady_clock::now();
+		for (int i = 0; i < edits; i++) {
+			int x = cell(rng);
+			int y = cell(rng);
+			map.setCell(x, y, map.at(x, y) == 0 ? 3 : 0);
+			mesher.markCell(x, y);
+			mesher.rebuildDirty(pool);
+		}
+		double editMs = secondsSince(start) * 1000.0 / edits;
+
+		std::cout << std::setw(12) << (std::to_string(size) + "x" + std::to_string(size)) << std::fixed
+			<< std::setprecision(2) << std::setw(12) << buildMs << std::setw(14) << naiveQuads * 2
+			<< std::setw(14) << triangles << std::setprecision(3) << editMs << std::defaultfloat << std::endl;
+	}
+}
+
+void vre::bench::voxelMesh() {
+	constexpr int edits = 300;
+	VrePalette palette;
+	VreThreadPool &pool = VreThreadPool::shared();
+	VreBrickMap map = VreBrickMap::testScene();
+
+	// one quad per open voxel face, what the greedy quads have to cover
+	size_t naiveQuads = 0;
+	const int sides[6][3] = { { 1, 0, 0 }, { -1, 0, 0 }, { 0, 1, 0 }, { 0, -1, 0 }, { 0, 0, 1 }, { 0, 0, -1 } };
+	for (int z = 0; z < map.voxelsZ(); z++) {
+		for (int y = 0; y < map.voxelsY(); y++) {
+			for (int x = 0; x < map.voxelsX(); x++) {
+				if (map.voxel(x, y, z) == 0) {
+					continue;
+				}
+				for (const auto &side : sides) {
+					int nx = x + side[0];
+					int ny = y + side[1];
+					int nz = z + side[2];
+					naiveQuads += !map.inBounds(nx, ny, nz) || map.voxel(nx, ny, nz) == 0 ? 1 : 0;
+				}
+			}
+		}
+	}
+
+	auto start = std::chrono::steady_clock::now();
+	VreVoxelMesher mesher(map, palette);
+	mesher.rebuildDirty(pool);
+	double buildMs = secondsSince(start) * 1000.0;
+
+	size_t quads = 0;
+	size_t covered = 0;
+	for (int i = 0; i < mesher.chunkCount(); i++) {
+		const VoxelChunkMesh &mesh = mesher.chunk(i);
+		quads += mesh.quadCount();
+		for (size_t q = 0; q < mesh.vertices.size(); q += 4) {
+			uint32_t a = mesh.vertices[q].position;
+			uint32_t b = mesh.vertices[q + 2].position;
+			int area = 1;
+			for (int shift = 0; shift < 18; shift += 6) {
+				int extent = std::abs(static_cast<int>((a >> shift) & 63) - static_cast<int>((b >> shift) & 63));
+				area *= extent > 0 ? extent : 1;
+			}
+			covered += area;
+		}
+	}
+
+	std::cout << mesher.chunkCount() << " chunks of " << VreVoxelMesher::CHUNK_SIZE << "^3 on "
+		<< pool.threadCount() << " threads, full mesh in " << std::fixed << std::setprecision(2)
+		<< buildMs << " ms" << std::defaultfloat << std::endl;
+	std::cout << naiveQuads << " open faces, " << quads << " greedy quads covering " << covered
+		<< (covered == naiveQuads ? " (all of them)" : " (MISMATCH)") << ", "
+		<< quads * 4 * sizeof(PackedVoxelVertex) / 1024 << " KiB of vertices" << std::endl;
+
+	// single voxel edits, each remeshes its chunk and any chunk across a
+	// face it opened or closed. random voxels first, then voxels in chunk
+	// corners, the worst case with up to 4 chunks. the chunks around every
+	// edit are rebuilt from scratch to check nothing needed was skipped
+	std::mt19937 rng(9);
+	std::uniform_int_distribution<int> px(0, map.voxelsX() - 1);
+	std::uniform_int_distribution<int> py(0, map.voxelsY() - 1);
+	std::uniform_int_distribution<int> pz(0, 15);
+	std::uniform_int_distribution<int> chunkX(0, mesher.chunksX() - 1);
+	std::uniform_int_distribution<int> chunkY(0, mesher.chunksY() - 1);
+	std::uniform_int_distribution<int> chunkZ(0, mesher.chunksZ() - 1);
+	std::uniform_int_distribution<int> corner(0, 1);
+	constexpr int last = VreVoxelMesher::CHUNK_SIZE - 1;
+	size_t stale = 0;
+	for (bool corners : { false, true }) {
+		std::vector<double> times;
+		size_t chunks = 0;
+		size_t mostChunks = 0;
+		for (int i = 0; i < edits; i++) {
+			int x = px(rng);
+			int y = py(rng);
+			int z = pz(rng);
+			if (corners) {
+				x = (chunkX(rng) << VreVoxelMesher::CHUNK_SHIFT) + corner(rng) * last;
+				y = (chunkY(rng) << VreVoxelMesher::CHUNK_SHIFT) + corner(rng) * last;
+				z = (chunkZ(rng) << VreVoxelMesher::CHUNK_SHIFT) + corner(rng) * last;
+			}
+			uint8_t before = map.voxel(x, y, z);
+			map.setVoxel(x, y, z, before == 0 ? 3 : 0);
+			start = std::chrono::steady_clock::now();
+			mesher.markVoxel(x, y, z, before);
+			size_t remeshed = mesher.rebuildDirty(pool).size();
+			times.push_back(secondsSince(start) * 1000.0);
+			chunks += remeshed;
+			mostChunks = std::max(mostChunks, remeshed);
+
+			int cx = x >> VreVoxelMesher::CHUNK_SHIFT;
+			int cy = y >> VreVoxelMesher::CHUNK_SHIFT;
+			int cz = z >> VreVoxelMesher::CHUNK_SHIFT;
+			for (int nz = std::max(cz - 1, 0); nz <= std::min(cz + 1, mesher.chunksZ() - 1); nz++) {
+				for (int ny = std::max(cy - 1, 0); ny <= std::min(cy + 1, mesher.chunksY() - 1); ny++) {
+					for (int nx = std::max(cx - 1, 0); nx <= std::min(cx + 1, mesher.chunksX() - 1); nx++) {
+						VoxelChunkMesh fresh;
+						VreVoxelMesher::buildChunk(map, palette, nx, ny, nz, fresh);
+						const VoxelChunkMesh &kept = mesher.chunk((nz * mesher.chunksY() + ny) * mesher.chunksX() + nx);
+						stale += fresh.vertices.size() != kept.vertices.size()
+							|| memcmp(fresh.vertices.data(), kept.vertices.data(),
+								fresh.vertices.size() * sizeof(PackedVoxelVertex)) != 0;
+					}
+				}
+			}
+		}
+		// the worst single edit on a shared machine is mostly how long the
+		// thread was preempted, the 99th percentile is what the remesh costs
+		double totalMs = std::accumulate(times.begin(), times.end(), 0.0);
+		std::sort(times.begin(), times.end());
+		std::cout << (corners ? "corner" : "random") << " edit remesh " << std::fixed << std::setprecision(3)
+			<< totalMs / edits << " ms mean, " << times[edits * 99 / 100] << " ms p99, " << times.back()
+			<< " ms worst, " << std::setprecision(2)
+			<< static_cast<double>(chunks) / edits << " chunks mean, " << mostChunks << " most, "
+			<< totalMs / chunks << " ms per chunk" << std::defaultfloat << std::endl;
+	}
+	std::cout << stale << " chunks differ from a fresh mesh" << std::endl;
+	assert(stale == 0 && "an edit skipped a chunk whose faces changed");
+}
+
+void vre::bench::interlaced() {
+	constexpr int frames = 200;
+	VreMap small = makeTestMap(64, 64, 64, 0.05f, 7);
+	// long open rays, where casting is most of the frame
+	VreMap open = makeTestMap(1024, 1024, 64, 0.002f, 7);
+	VreThreadPool &pool = VreThreadPool::shared();
+
+	struct Case {
+		const char *name;
+		const VreMap *map;
+		int width;
+		int height;
+		float turn; // radians per frame
+	};
+	const Case cases[] = {
+		{ "64^2 1080p", &small, 1920, 1080, 0.01f },
+		{ "64^2 4k", &small, 3840, 2160, 0.01f },
+		{ "1024^2 1080p", &open, 1920, 1080, 0.01f },
+		{ "1024^2 4k", &open, 3840, 2160, 0.01f },
+		{ "1024^2 4k", &open, 3840, 2160, 0.063f },
+		// under maxTurn, but too fast for most reprojected columns to hold
+		{ "1024^2 1080p", &open, 1920, 1080, 0.045f },
+	};
+
+	std::cout << pool.threadCount() << " threads, " << frames << " frames walking a circle, both"
+		<< " renderers on every pose" << std::endl;
+	std::cout << std::left << std::setw(16) << "case" << std::setw(8) << "turn" << std::setw(10)
+		<< "full ms" << std::setw(16) << "interlaced ms" << std::setw(14) << "cast columns"
+		<< "pixels off" << std::endl;
+
+	for (const Case &c : cases) {
+		VreRaycaster raycaster;
+		raycaster.bindMap(*c.map);
+		float center = (c.map->width() / 2 + 0.5f) * 64.0f;
+		auto cameraAt = [&](int _frame) {
+			float t = _frame * 0.01f;
+			return RayCamera{ center + 96.0f * std::cos(t), center + 96.0f * std::sin(t), _frame * c.turn };
+		};
+
+		// each renderer is timed on its own pass. run frame by frame
+		// together, whichever went second paid for the cache the other and
+		// the pixel comparison had taken, up to a millisecond at 4k
+		auto timed = [&](auto _render) {
+			auto start = std::chrono::steady_clock::now();
+			for (int frame = 0; frame < frames; frame++) {
+				_render(cameraAt(frame));
+			}
+			return secondsSince(start);
+		};
+		VreCpuRenderer full;
+		full.resize(c.width, c.height);
+		double fullSeconds = timed([&](const RayCamera &_camera) {
+			full.renderTiled(raycaster, _camera, pool);
+		});
+		VreCpuRenderer renderer;
+		renderer.resize(c.width, c.height);
+		size_t cast = 0;
+		double seconds = timed([&](const RayCamera &_camera) {
+			renderer.renderInterlaced(raycaster, _camera, pool);
+			cast += renderer.lastCastColumns();
+		});
+
+		// the same poses again untimed, a fresh interlaced renderer repeats
+		// the timed one frame for frame
+		VreCpuRenderer compared;
+		compared.resize(c.width, c.height);
+		size_t off = 0;
+		for (int frame = 0; frame < frames; frame++) {
+			full.renderTiled(raycaster, cameraAt(frame), pool);
+			compared.renderInterlaced(raycaster, cameraAt(frame), pool);
+			for (size_t i = 0; i < compared.sizeBytes(); i++) {
+				off += compared.pixels()[i] != full.pixels()[i] ? 1 : 0;
+			}
+		}
+
+		std::cout << std::setw(16) << c.name << std::fixed << std::setprecision(3) << std::setw(8)
+			<< c.turn << std::setprecision(2) << std::setw(10) << fullSeconds * 1000.0 / frames
+			<< std::setw(16) << seconds * 1000.0 / frames << std::setprecision(1) << std::setw(14)
+			<< 100.0 * cast / (static_cast<double>(c.width) * frames) << std::setprecision(3)
+			<< 100.0 * off / (static_cast<double>(renderer.sizeBytes()) * frames) << "%"
+			<< std::defaultfloat << std::endl;
+	}
+}
+
+void vre::bench::edges() {
+	constexpr int frames = 100;
+	VreThreadPool &pool = VreThreadPool::shared();
+
+	// the edge count follows what is in view, not the resolution
+	struct Case {
+		const char *name;
+		int size;
+		float density;
+		int width;
+		int height;
+	};
+	const Case cases[] = {
+		{ "64^2 1080p", 64, 0.05f, 1920, 1080 },
+		{ "64^2 4k", 64, 0.05f, 3840, 2160 },
+		{ "256^2 1080p", 256, 0.05f, 1920, 1080 },
+		{ "256^2 4k", 256, 0.05f, 3840, 2160 },
+	};
+
+	std::cout << pool.threadCount() << " threads, 4 sub column rays per edge column" << std::endl;
+	std::cout << std::left << std::setw(14) << "case" << std::setw(14) << "edge columns"
+		<< std::setw(10) << "plain ms" << std::setw(10) << "edges ms" << "us per edge column" << std::endl;
+
+	for (const Case &c : cases) {
+		VreMap map = makeTestMap(c.size, c.size, 64, c.density, 7);
+		VreRaycaster raycaster;
+		raycaster.bindMap(map);
+		CpuTileOptions plain;
+		CpuTileOptions supersampled;
+		supersampled.edgeSamples = 4;
+
+		VreCpuRenderer renderer;
+		renderer.resize(c.width, c.height);
+		double plainSeconds = 0.0;
+		double edgeSeconds = 0.0;
+		size_t edgeColumns = 0;
+		for (int frame = 0; frame < frames; frame++) {
+			float center = (c.size / 2 + 0.5f) * 64.0f;
+			RayCamera camera{ center, center, frame * 0.063f };
+			auto start = std::chrono::steady_clock::now();
+			renderer.renderTiled(raycaster, camera, pool, plain);
+			plainSeconds += secondsSince(start);
+
+			start = std::chrono::steady_clock::now();
+			renderer.renderTiled(raycaster, camera, pool, supersampled);
+			edgeSeconds += secondsSince(start);
+			edgeColumns += renderer.lastEdgeColumns();
+		}
+
+		double perFrame = static_cast<double>(edgeColumns) / frames;
+		std::cout << std::setw(14) << c.name << std::fixed << std::setprecision(0) << std::setw(6)
+			<< perFrame << std::setprecision(1) << std::setw(8)
+			<< "(" + std::to_string(static_cast<int>(100.0 * perFrame / c.width + 0.5)) + "%)"
+			<< std::setprecision(2) << std::setw(10) << plainSeconds * 1000.0 / frames << std::setw(10)
+			<< edgeSeconds * 1000.0 / frames << std::setprecision(3)
+			<< (edgeSeconds - plainSeconds) * 1e6 / std::max(static_cast<double>(edgeColumns), 1.0)
+			<< std::defaultfloat << std::endl;
+	}
+}
+
+void vre::bench::delta() {
+	constexpr int frames = 100;
+	constexpr int slots = 2;
+	VreThreadPool &pool = VreThreadPool::shared();
+	VreMap map = makeTestMap(64, 64, 64, 0.05f, 7);
+	VreRaycaster raycaster;
+	raycaster.bindMap(map);
+	float center = 32.5f * 64.0f;
+
+	// a still view with a small sprite moving across it, a still view, and
+	// a turning camera that changes nearly every block. View sends turning
+	// frames whole without a diff, here they show what the early bail out
+	// of the diff costs when the caller can't tell
+	struct Case {
+		const char *name;
+		int width;
+		int height;
+		float turn;
+		bool sprite;
+	};
+	const Case cases[] = {
+		{ "still 1080p", 1920, 1080, 0.0f, false },
+		{ "sprite 1080p", 1920, 1080, 0.0f, true },
+		{ "turning 1080p", 1920, 1080, 0.02f, false },
+		{ "still 4k", 3840, 2160, 0.0f, false },
+		{ "sprite 4k", 3840, 2160, 0.0f, true },
+		{ "turning 4k", 3840, 2160, 0.02f, false },
+	};
+
+	// the copies stand in for the vkCmdCopyBuffer into the device buffer,
+	// here a memcpy between host buffers, so the totals weigh the bytes
+	// either path moves rather than the time over the bus. every slot's
+	// device buffer has to match the frame after its copies
+	std::cout << pool.threadCount() << " threads, " << slots << " frames in flight, "
+		<< VreFrameDelta::BLOCK << " byte blocks" << std::endl;
+	std::cout << std::left << std::setw(16) << "case" << std::setw(14) << "KB per frame"
+		<< std::setw(10) << "full KB" << std::setw(7) << "whole" << std::setw(10) << "delta ms"
+		<< std::setw(11) << "memcpy ms" << std::setw(17) << "delta+copies ms" << "memcpy+copy ms"
+		<< std::endl;
+
+	for (const Case &c : cases) {
+		VreCpuRenderer renderer;
+		renderer.resize(c.width, c.height);
+		std::vector<uint8_t> frame(static_cast<size_t>(renderer.stride()) * c.height);
+		std::vector<uint8_t> staging(frame.size());
+		std::vector<std::vector<uint8_t>> device(slots, std::vector<uint8_t>(frame.size()));
+		VreFrameDelta delta;
+		delta.resize(renderer.stride(), c.height, slots);
+
+		double deltaSeconds = 0.0;
+		double copySeconds = 0.0;
+		double appliedSeconds = 0.0;
+		double fullSeconds = 0.0;
+		int wrong = 0;
+		size_t bytes = 0;
+		int whole = 0;
+		// the first frame of every slot sends everything and is left out
+		for (int i = -slots; i < frames; i++) {
+			RayCamera camera{ center, center, std::max(i, 0) * c.turn };
+			renderer.renderTiled(raycaster, camera, pool, CpuTileOptions{});
+			memcpy(frame.data(), renderer.pixels(), frame.size());
+			if (c.sprite) {
+				int x0 = c.width / 4 + i * 8;
+				int y0 = c.height / 2;
+				for (int y = y0; y < y0 + 64; y++) {
+					memset(frame.data() + static_cast<size_t>(y) * renderer.stride() + x0, 200 + (i & 7), 64);
+				}
+			}
+
+			int slot = (i + slots) % slots;
+			auto start = std::chrono::steady_clock::now();
+			const std::vector<VreFrameDelta::Copy> &copies = delta.update(slot, frame.data(), staging.data(), pool);
+			double updated = secondsSince(start);
+			for (const VreFrameDelta::Copy &copy : copies) {
+				memcpy(device[slot].data() + copy.frameOffset, staging.data() + copy.stagingOffset, copy.size);
+			}
+			double applied = secondsSince(start);
+			wrong += memcmp(device[slot].data(), frame.data(), frame.size()) != 0 ? 1 : 0;
+			if (i >= 0) {
+				deltaSeconds += updated;
+				appliedSeconds += applied;
+				bytes += delta.lastBytes();
+				whole += delta.lastFull() ? 1 : 0;
+			}
+
+			start = std::chrono::steady_clock::now();
+			memcpy(staging.data(), frame.data(), frame.size());
+			double copied = secondsSince(start);
+			memcpy(device[slot].data(), staging.data(), frame.size());
+			if (i >= 0) {
+				copySeconds += copied;
+				fullSeconds += secondsSince(start);
+			}
+		}
+
+		std::cout << std::setw(16) << c.name << std::fixed << std::setprecision(1) << std::setw(14)
+			<< bytes / 1024.0 / frames << std::setw(10) << frame.size() / 1024.0 << std::setw(7) << whole
+			<< std::setprecision(3) << std::setw(10) << deltaSeconds * 1000.0 / frames
+			<< std::setw(11) << copySeconds * 1000.0 / frames << std::setw(17) << appliedSeconds * 1000.0 / frames
+			<< fullSeconds * 1000.0 / frames << std::defaultfloat << std::endl;
+		assert(wrong == 0 && "a device copy missed a changed block");
+	}
+}
+
+void vre::bench::flats() {
+	constexpr int frames = 50;
+	constexpr int width = 1920;
+	constexpr int height = 1080;
+	constexpr int stride = (width + 3) & ~3;
+	VreThreadPool &pool = VreThreadPool::shared();
+	VreThreadPool single(1);
+	VreMap map = makeTestMap(64, 64, 64, 0.05f, 7);
+	VreRaycaster raycaster;
+	raycaster.bindMap(map);
+	float cellSize = static_cast<float>(map.cellSize());
+	float center = 32.5f * 64.0f;
+
+	VreFloorCaster caster;
+	VrePalette palette;
+	std::vector<uint8_t> naive(static_cast<size_t>(stride) * height);
+	std::vector<uint8_t> rows(naive.size());
+
+	// turning, so rows cross the textures at every angle
+	auto camera = [&](int _frame) {
+		return RayCamera{ center + _frame * 3.0f, center, _frame * 0.13f };
+	};
+	auto time = [&](const std::function<void(const RayCamera &)> &_cast) {
+		auto start = std::chrono::steady_clock::now();
+		for (int frame = 0; frame < frames; frame++) {
+			_cast(camera(frame));
+		}
+		return secondsSince(start) * 1000.0 / frames;
+	};
+
+	double naiveMs = time([&](const RayCamera &_camera) {
+		caster.castNaive(_camera, cellSize, palette, width, height, naive.data(), stride);
+	});
+	double singleMs = time([&](const RayCamera &_camera) {
+		caster.cast(_camera, cellSize, palette, width, height, rows.data(), stride, single);
+	});
+	double pooledMs = time([&](const RayCamera &_camera) {
+		caster.cast(_camera, cellSize, palette, width, height, rows.data(), stride, pool);
+	});
+
+	// both casts of the last frame, texel edges may round either way
+	size_t differing = 0;
+	for (size_t i = 0; i < naive.size(); i++) {
+		differing += naive[i] != rows[i];
+	}
+
+	VreCpuRenderer renderer;
+	renderer.resize(width, height);
+	CpuTileOptions plain;
+	CpuTileOptions textured;
+	textured.texturedFlats = true;
+	double plainMs = time([&](const RayCamera &_camera) {
+		renderer.renderTiled(raycaster, _camera, pool, plain);
+	});
+	double texturedMs = time([&](const RayCamera &_camera) {
+		renderer.renderTiled(raycaster, _camera, pool, textured);
+	});
+
+	std::cout << "1080p, " << VreFloorCaster::SIZE << "^2 textures, " << pool.threadCount()
+		<< " threads" << std::endl;
+	std::cout << std::left << std::fixed << std::setprecision(2);
+	std::cout << std::setw(34) << "naive, columns, row major" << naiveMs << " ms" << std::endl;
+	std::cout << std::setw(34) << "rows x8, morton, 1 thread" << singleMs << " ms" << std::endl;
+	std::cout << std::setw(34) << "rows x8, morton, row bands" << pooledMs << " ms" << std::endl;
+	std::cout << std::setw(34) << "pixels differing from naive" << std::setprecision(3)
+		<< 100.0 * differing / naive.size() << " %" << std::setprecision(2) << std::endl;
+	std::cout << std::setw(34) << "renderTiled, flat shades" << plainMs << " ms" << std::endl;
+	std::cout << std::setw(34) << "renderTiled, textured flats" << texturedMs << " ms" << std::endl;
+	std::cout << std::defaultfloat;
+}
+
+void vre::bench::hybrid() {
+	constexpr int width = 960;
+	constexpr int height = 540;
+	constexpr int stride = (width + 3) & ~3;
+	constexpr int frames = 40;
+	constexpr int latency = 2; // frames in flight before a timestamp is back
+	VreThreadPool &pool = VreThreadPool::shared();
+	VreBrickMap map = VreBrickMap::testScene();
+	VreVoxelTracer tracer;
+	tracer.bindMap(map);
+	std::vector<uint8_t> image(static_cast<size_t>(stride) * height);
+
+	std::cout << "960x540 on " << pool.threadCount() << " threads, last " << frames / 2
+		<< " frames averaged" << std::endl;
+	std::cout << std::left << std::setw(12) << "gpu speed" << std::setw(12) << "split"
+		<< std::setw(12) << "gpu ms" << std::setw(12) << "cpu ms" << std::setw(12) << "frame ms"
+		<< std::setw(12) << "cpu only" << "gpu only" << std::endl;
+
+	for (double gpuSpeed : { 0.25, 1.0, 4.0 }) {
+		VreHybridSplit split;
+		split.reset(width, 64, 64);
+		int pendingColumns[latency] = {};
+		double pendingGpuMs[latency] = {};
+		double pendingCpuMs[latency] = {};
+		double gpuSum = 0.0;
+		double cpuSum = 0.0;
+		double frameSum = 0.0;
+		double fullSum = 0.0;
+		for (int i = 0; i < frames; i++) {
+			float angle = i * 0.15f;
+			VoxelCamera camera{ 128.0f + 90.0f * std::cos(angle), 128.0f + 90.0f * std::sin(angle),
+				24.0f, angle + 2.0f, -0.15f };
+			VoxelFrame frame = VoxelFrame::make(map, camera, width, height, stride);
+
+			int slot = i % latency;
+			if (i >= latency) {
+				split.update(pendingColumns[slot], pendingGpuMs[slot], pendingCpuMs[slot]);
+			}
+			int columns = split.split();
+
+			auto start = std::chrono::steady_clock::now();
+			tracer.renderColumns(frame, 0, columns, image.data(), pool);
+			double gpuMs = secondsSince(start) * 1000.0 / gpuSpeed;
+			start = std::chrono::steady_clock::now();
+			tracer.renderColumns(frame, columns, width, image.data(), pool);
+			double cpuMs = secondsSince(start) * 1000.0;
+			pendingColumns[slot] = columns;
+			pendingGpuMs[slot] = gpuMs;
+			pendingCpuMs[slot] = cpuMs;
+
+			if (i >= frames / 2) {
+				gpuSum += gpuMs;
+				cpuSum += cpuMs;
+				frameSum += std::max(gpuMs, cpuMs);
+				fullSum += gpuMs * gpuSpeed + cpuMs;
+			}
+		}
+
+		int counted = frames - frames / 2;
+		double full = fullSum / counted;
+		std::cout << std::setw(12) << std::to_string(gpuSpeed).substr(0, 4) + "x" << std::setw(12)
+			<< std::to_string(split.split()) + "/" + std::to_string(width) << std::fixed
+			<< std::setprecision(2) << std::setw(12) << gpuSum / counted << std::setw(12) << cpuSum / counted
+			<< std::setw(12) << frameSum / counted << std::setw(12) << full << full / gpuSpeed
+			<< std::defaultfloat << std::endl;
+	}
+}
+
+void vre::bench::inFlight() {
+	constexpr int width = 1920;
+	constexpr int height = 1080;
+	constexpr int frames = 120;
+	VreMap map = makeTestMap(64, 64, 64, 0.05f, 7);
+	VreRaycaster raycaster;
+	raycaster.bindMap(map);
+	VreThreadPool &pool = VreThreadPool::shared();
+	constexpr int maxFramesInFlight = 3; // as VreSwapchain::MAX_FRAMES_IN_FLIGHT
+	VreCpuRenderer renderer;
+	renderer.resize(width, height);
+
+	// one slot of staging per frame in flight, written after its fence
+	std::vector<std::vector<uint8_t>> staging(maxFramesInFlight,
+		std::vector<uint8_t>(renderer.sizeBytes()));
+	auto drawFrame = [&](int _frame, int _slot) {
+		RayCamera camera{ 32.5f * 64.0f, 32.5f * 64.0f, _frame * 0.063f };
+		renderer.renderTiled(raycaster, camera, pool);
+		std::memcpy(staging[_slot].data(), renderer.pixels(), renderer.sizeBytes());
+	};
+
+	auto start = std::chrono::steady_clock::now();
+	for (int i = 0; i < frames / 4; i++) {
+		drawFrame(i, 0);
+	}
+	double cpuMs = secondsSince(start) * 1000.0 / (frames / 4);
+
+	std::cout << "1080p tiled on " << pool.threadCount() << " threads, " << std::fixed
+		<< std::setprecision(2) << cpuMs << " ms cpu per frame, the gpu modelled as a fixed time"
+		<< std::defaultfloat << std::endl;
+	std::cout << std::left << std::setw(10) << "gpu ms" << std::setw(18) << "mode" << std::setw(12)
+		<< "ms/frame" << std::setw(12) << "cpu busy" << std::setw(12) << "gpu busy" << "queue done ms"
+		<< std::endl;
+
+	for (double gpuFactor : { 0.5, 1.0, 1.5 }) {
+		double gpuMs = cpuMs * gpuFactor;
+		for (int slots = 1; slots <= maxFramesInFlight; slots++) {
+			SimulatedQueue queue(gpuMs);
+			std::vector<int> fences(slots, 0);
+			std::vector<std::chrono::steady_clock::time_point> submitted(frames);
+			double waitSeconds = 0.0;
+			start = std::chrono::steady_clock::now();
+			for (int i = 0; i < frames; i++) {
+				// the slot's last frame has to be done before it is rewritten,
+				// with one slot that is the device idle wait after every frame
+				int slot = i % slots;
+				auto waitStart = std::chrono::steady_clock::now();
+				queue.wait(fences[slot]);
+				waitSeconds += secondsSince(waitStart);
+				drawFrame(i, slot);
+				submitted[i] = std::chrono::steady_clock::now();
+				fences[slot] = queue.submit();
+			}
+			for (int fence : fences) {
+				queue.wait(fence);
+			}
+			double total = secondsSince(start);
+			// submit until the queue finished the frame, no present involved
+			double completion = 0.0;
+			for (int i = 0; i < frames; i++) {
+				completion += std::chrono::duration<double, std::milli>(
+					queue.completedAt(i + 1) - submitted[i]).count();
+			}
+
+			std::cout << std::setw(10) << std::fixed << std::setprecision(2) << gpuMs << std::setw(18)
+				<< (slots == 1 ? "1, wait idle" : std::to_string(slots) + " in flight") << std::setw(12)
+				<< total * 1000.0 / frames << std::setw(12)
+				<< std::to_string(static_cast<int>(100.0 * (1.0 - waitSeconds / total))) + "%"
+				<< std::setw(12) << std::to_string(static_cast<int>(100.0 * queue.busySeconds() / total)) + "%"
+				<< completion / frames << std::defaultfloat << std::endl;
+		}
+	}
+
+	// the same loop behind a modelled 60 Hz fifo swapchain of slots + 1
+	// images. a frame is shown at the first refresh after its queue work
+	// and one after the previous frame, an image is acquired again once
+	// the frame after it is shown. present done is what
+	// VreSwapchain::presentDoneMs measures with present wait
+	constexpr double refreshMs = 1000.0 / 60.0;
+	constexpr int fifoFrames = 60;
+	std::cout << "fifo at 60 Hz, gpu " << std::fixed << std::setprecision(2) << cpuMs << " ms"
+		<< std::defaultfloat << std::endl;
+	std::cout << std::left << std::setw(18) << "mode" << std::setw(12) << "ms/frame" << std::setw(16)
+		<< "queue done ms" << "present done ms" << std::endl;
+	for (int slots = 1; slots <= maxFramesInFlight; slots++) {
+		SimulatedQueue queue(cpuMs);
+		std::vector<int> fences(slots, 0);
+		std::vector<double> submitted(fifoFrames);
+		std::vector<double> shown(fifoFrames);
+		int shownCount = 0;
+		start = std::chrono::steady_clock::now();
+		auto msSinceStart = [&](std::chrono::steady_clock::time_point _time) {
+			return std::chrono::duration<double, std::milli>(_time - start).count();
+		};
+		// display times of the frames up to _frame, whose queue work is done
+		auto showUpTo = [&](int _frame) {
+			for (; shownCount <= _frame; shownCount++) {
+				double previous = shownCount > 0 ? shown[shownCount - 1] : -refreshMs;
+				double done = msSinceStart(queue.completedAt(shownCount + 1));
+				shown[shownCount] = std::ceil(std::max(done, previous + refreshMs) / refreshMs) * refreshMs;
+			}
+		};
+		for (int i = 0; i < fifoFrames; i++) {
+			int slot = i % slots;
+			queue.wait(fences[slot]);
+			// acquire, frame i - slots - 1 held the image until frame i - slots was shown
+			if (i >= slots) {
+				showUpTo(i - slots);
+				std::this_thread::sleep_until(start
+					+ std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+						std::chrono::duration<double, std::milli>(shown[i - slots])));
+			}
+			drawFrame(i, slot);
+			submitted[i] = msSinceStart(std::chrono::steady_clock::now());
+			fences[slot] = queue.submit();
+		}
+		for (int fence : fences) {
+			queue.wait(fence);
+		}
+		showUpTo(fifoFrames - 1);
+
+		double completion = 0.0;
+		double presentDone = 0.0;
+		for (int i = 0; i < fifoFrames; i++) {
+			completion += msSinceStart(queue.completedAt(i + 1)) - submitted[i];
+			presentDone += shown[i] - submitted[i];
+		}
+		double total = shown[fifoFrames - 1] - shown[0];
+		std::cout << std::setw(18) << (slots == 1 ? "1, wait idle" : std::to_string(slots) + " in flight")
+			<< std::fixed << std::setprecision(2) << std::setw(12) << total / (fifoFrames - 1)
+			<< std::setw(16) << completion / fifoFrames << presentDone / fifoFrames
+			<< std::defaultfloat << std::endl;
+	}
+}
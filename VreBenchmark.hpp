@@ -0,0 +1,76 @@
+#pragma once
+
+#include <string>
+
+#include "VreMap.hpp"
+
+// headless cpu benchmarks, run with "VulkanRayEngine --bench <name>".
+// none of these touch SDL or Vulkan
+namespace vre {
+	namespace bench {
+		// runs one benchmark by name, or every one of them for "all".
+		// returns false if the name is unknown
+		bool run(const std::string &_name);
+
+		// random level with a solid border and an empty center cell
+		VreMap makeTestMap(int _width, int _height, int _cellSize,
+			float _wallDensity, unsigned int _seed);
+
+		void raycaster();
+		void occupancy();
+		// cpu renderer writing 8 bit indices against rgba8
+		void indexed();
+		// segment bsp build, cache and render against the grid raycaster
+		void bsp();
+		// 4 wide bvh, single rays and packets against the bsp, refit vs rebuild
+		void bvh();
+		// 720p path tracer samples, thread scaling and noise per sample count
+		void pathTracer();
+		// column order cpu rendering against column band x row band tiles
+		void tiled();
+		// row major draw + copy against column major draw + blocked transpose
+		void transpose();
+		// soa batch stepping of many headless game instances
+		void batchEnv();
+		// many small cameras into one observation buffer against the raycaster
+		void multiCamera();
+		// multi hit casting and blending of see through walls, and what it
+		// costs on a map that has none
+		void seeThrough();
+		// per column occlusion ranges over cell heights against the flat
+		// column major renderer
+		void stacked();
+		// voxel space terrain at 1080p for a few lod step growths
+		void terrain();
+		// brick map dda against a dense voxel walk, speed, memory and
+		// whether every pixel agrees
+		void voxel();
+		// greedy chunked extrusion of the grid, triangles against one quad
+		// per face and the cost of rebuilding after a single cell edit
+		void gridMesh();
+		// greedy mesher for 32^3 voxel chunks, full scene and single voxel
+		// edits, no gpu involved
+		void voxelMesh();
+		// every other column cast per frame with the rest reprojected,
+		// against full tiled frames along a walk, slow and fast turning
+		void interlaced();
+		// sub column rays on edge columns only, cost against the number of
+		// edges on sparse and dense maps
+		void edges();
+		// bytes staged per frame by the delta upload and the cost of finding
+		// them, against copying whole frames
+		void delta();
+		// textured floor and ceiling at 1080p, rows 8 pixels at a time
+		// from morton textures against a pixel per step down the columns
+		void flats();
+		// the hybrid voxel split settling along a walk. the gpu side is
+		// modelled as the cpu's own time for its columns times a factor,
+		// reported a frame in flight late like the timestamps
+		void hybrid();
+		// frames drawn into per slot staging against a simulated queue with
+		// 1 to 3 frames in flight, a slot rewritten once its fence is done.
+		// utilization and the time from submit until the queue finished and
+		// until a modelled 60 Hz fifo present showed the frame
+		void inFlight();
+	}
+}
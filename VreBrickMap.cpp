@@ -0,0 +1,79 @@
+#include "VreBrickMap.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+vre::VreBrickMap::VreBrickMap(int _bricksX, int _bricksY, int _bricksZ
+) : m_bricksX{ _bricksX }, m_bricksY{ _bricksY }, m_bricksZ{ _bricksZ } {
+	int largest = std::max(_bricksX, std::max(_bricksY, _bricksZ)) << BRICK_SHIFT;
+	if (_bricksX <= 0 || _bricksY <= 0 || _bricksZ <= 0 || largest > MAX_VOXELS_PER_AXIS) {
+		throw std::runtime_error("Failed to create brick map, bad dimensions");
+	}
+	m_coarse.assign(static_cast<size_t>(_bricksX) * _bricksY * _bricksZ, 0);
+}
+
+void vre::VreBrickMap::setVoxel(int _x, int _y, int _z, uint8_t _material) {
+	uint32_t &entry = m_coarse[coarseIndex(_x, _y, _z)];
+	if (entry == 0) {
+		if (_material == 0) {
+			return;
+		}
+		m_bricks.resize(m_bricks.size() + BRICK_VOXELS, 0);
+		entry = static_cast<uint32_t>(brickCount());
+	}
+	m_bricks[static_cast<size_t>(entry - 1) * BRICK_VOXELS + voxelInBrick(_x, _y, _z)] = _material;
+}
+
+uint8_t vre::VreBrickMap::voxel(int _x, int _y, int _z) const {
+	uint32_t entry = m_coarse[coarseIndex(_x, _y, _z)];
+	if (entry == 0) {
+		return 0;
+	}
+	return m_bricks[static_cast<size_t>(entry - 1) * BRICK_VOXELS + voxelInBrick(_x, _y, _z)];
+}
+
+vre::VreBrickMap vre::VreBrickMap::testScene() {
+	VreBrickMap map(32, 32, 8);
+
+	for (int y = 0; y < map.voxelsY(); y++) {
+		for (int x = 0; x < map.voxelsX(); x++) {
+			// rolling ground, grass on top of dirt
+			int ground = 6 + static_cast<int>(3.0f * std::sin(x * 0.05f) + 3.0f * std::cos(y * 0.07f));
+			for (int z = 0; z < ground; z++) {
+				map.setVoxel(x, y, z, z + 1 == ground ? 2 : 8);
+			}
+
+			// a grid of pillars, every third one joined to its neighbour by
+			// an arch
+			int cellX = x % 48;
+			int cellY = y % 48;
+			if (cellX >= 20 && cellX < 26 && cellY >= 20 && cellY < 26) {
+				for (int z = ground; z < 40; z++) {
+					map.setVoxel(x, y, z, 7);
+				}
+			}
+			if ((x / 48 + y / 48) % 3 == 0 && cellY >= 21 && cellY < 25 && (cellX >= 26 || cellX < 20)) {
+				for (int z = 34; z < 40; z++) {
+					map.setVoxel(x, y, z, 4);
+				}
+			}
+		}
+	}
+
+	// hollow ball floating over the middle
+	for (int z = 30; z < 62; z++) {
+		for (int y = 112; y < 144; y++) {
+			for (int x = 112; x < 144; x++) {
+				int dx = x - 128;
+				int dy = y - 128;
+				int dz = z - 46;
+				int distance = dx * dx + dy * dy + dz * dz;
+				if (distance < 15 * 15 && distance >= 12 * 12) {
+					map.setVoxel(x, y, z, 1);
+				}
+			}
+		}
+	}
+	return map;
+}
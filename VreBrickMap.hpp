@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace vre {
+	// sparse voxel world in two levels, a coarse grid with one entry per
+	// 8x8x8 brick and a pool of dense bricks. coarse entries are 0 for an
+	// empty brick or pool index + 1, so empty space is one uint per 512
+	// voxels and rays skip it a brick at a time. voxels are material ids,
+	// 0 is empty, z points up
+	class VreBrickMap {
+	public:
+		static constexpr int BRICK_SHIFT = 3;
+		static constexpr int BRICK_SIZE = 1 << BRICK_SHIFT;
+		static constexpr int BRICK_VOXELS = BRICK_SIZE * BRICK_SIZE * BRICK_SIZE;
+		// traversal works in 1/256 voxel fixed point on 32 bit ints
+		static constexpr int MAX_VOXELS_PER_AXIS = 512;
+
+		VreBrickMap() {}
+		// dimensions in bricks
+		VreBrickMap(int _bricksX, int _bricksY, int _bricksZ);
+
+		// the scene the cpu and compute traversals are checked against,
+		// 256x256x64 voxels of hills, pillars, arches and a floating ball
+		static VreBrickMap testScene();
+
+		// allocates the brick on the first non zero voxel. bricks are not
+		// freed when they become empty again, they only cost a lookup
+		void setVoxel(int _x, int _y, int _z, uint8_t _material);
+		uint8_t voxel(int _x, int _y, int _z) const;
+		bool inBounds(int _x, int _y, int _z) const {
+			return _x >= 0 && _y >= 0 && _z >= 0 && _x < voxelsX() && _y < voxelsY() && _z < voxelsZ();
+		}
+
+		int bricksX() const { return m_bricksX; }
+		int bricksY() const { return m_bricksY; }
+		int bricksZ() const { return m_bricksZ; }
+		int voxelsX() const { return m_bricksX << BRICK_SHIFT; }
+		int voxelsY() const { return m_bricksY << BRICK_SHIFT; }
+		int voxelsZ() const { return m_bricksZ << BRICK_SHIFT; }
+
+		// (z * bricksY + y) * bricksX + x, 0 or pool index + 1
+		const uint32_t *coarse() const { return m_coarse.data(); }
+		size_t coarseCount() const { return m_coarse.size(); }
+		// BRICK_VOXELS bytes per brick, x fastest then y then z
+		const uint8_t *bricks() const { return m_bricks.data(); }
+		size_t brickCount() const { return m_bricks.size() / BRICK_VOXELS; }
+
+		static int voxelInBrick(int _x, int _y, int _z) {
+			return (((_z & (BRICK_SIZE - 1)) << BRICK_SHIFT | (_y & (BRICK_SIZE - 1))) << BRICK_SHIFT)
+				| (_x & (BRICK_SIZE - 1));
+		}
+
+	private:
+		size_t coarseIndex(int _x, int _y, int _z) const {
+			return (static_cast<size_t>(_z >> BRICK_SHIFT) * m_bricksY + (_y >> BRICK_SHIFT)) * m_bricksX
+				+ (_x >> BRICK_SHIFT);
+		}
+
+		int m_bricksX = 0;
+		int m_bricksY = 0;
+		int m_bricksZ = 0;
+		std::vector<uint32_t> m_coarse;
+		std::vector<uint8_t> m_bricks;
+	};
+}
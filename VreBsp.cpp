@@ -0,0 +1,288 @@
+#include "VreBsp.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cfloat>
+#include <cstdlib>
+#include <fstream>
+#include <future>
+#include <thread>
+#include <utility>
+
+namespace {
+	// distances are in world units, the normal is unit length
+	constexpr float ON_LINE_EPSILON = 0.01f;
+	// splitters tried per node, spread evenly over the node's segments
+	constexpr size_t SPLITTER_CANDIDATES = 24;
+
+	constexpr uint32_t CACHE_MAGIC = 0x50534256; // "VBSP"
+	constexpr uint32_t CACHE_VERSION = 1;
+
+	struct Partition {
+		float nx;
+		float ny;
+		float d;
+
+		float side(float _x, float _y) const { return nx * _x + ny * _y - d; }
+	};
+
+	// nodes and segments of one subtree, the root is node 0
+	struct Subtree {
+		std::vector<vre::BspNode> nodes;
+		std::vector<vre::Segment> segments;
+	};
+
+	Partition partitionOf(const vre::Segment &_segment) {
+		float dx = _segment.x2 - _segment.x1;
+		float dy = _segment.y2 - _segment.y1;
+		float length = std::sqrt(dx * dx + dy * dy);
+		Partition partition;
+		partition.nx = -dy / length;
+		partition.ny = dx / length;
+		partition.d = partition.nx * _segment.x1 + partition.ny * _segment.y1;
+		return partition;
+	}
+
+	// splits, front and back counts decide the score, lower is better
+	size_t score(const std::vector<vre::Segment> &_segments, const Partition &_partition) {
+		size_t front = 0;
+		size_t back = 0;
+		size_t splits = 0;
+		for (const vre::Segment &segment : _segments) {
+			float a = _partition.side(segment.x1, segment.y1);
+			float b = _partition.side(segment.x2, segment.y2);
+			if (std::abs(a) < ON_LINE_EPSILON && std::abs(b) < ON_LINE_EPSILON) {
+				continue;
+			}
+			if (a >= -ON_LINE_EPSILON && b >= -ON_LINE_EPSILON) {
+				front++;
+			} else if (a <= ON_LINE_EPSILON && b <= ON_LINE_EPSILON) {
+				back++;
+			} else {
+				splits++;
+			}
+		}
+		size_t imbalance = front > back ? front - back : back - front;
+		return splits * 4 + imbalance;
+	}
+
+	void partitionSegments(const std::vector<vre::Segment> &_segments,
+		const Partition &_partition, std::vector<vre::Segment> &_on,
+		std::vector<vre::Segment> &_front, std::vector<vre::Segment> &_back
+	) {
+		for (const vre::Segment &segment : _segments) {
+			float a = _partition.side(segment.x1, segment.y1);
+			float b = _partition.side(segment.x2, segment.y2);
+			if (std::abs(a) < ON_LINE_EPSILON && std::abs(b) < ON_LINE_EPSILON) {
+				_on.push_back(segment);
+			} else if (a >= -ON_LINE_EPSILON && b >= -ON_LINE_EPSILON) {
+				_front.push_back(segment);
+			} else if (a <= ON_LINE_EPSILON && b <= ON_LINE_EPSILON) {
+				_back.push_back(segment);
+			} else {
+				float t = a / (a - b);
+				float x = segment.x1 + t * (segment.x2 - segment.x1);
+				float y = segment.y1 + t * (segment.y2 - segment.y1);
+				vre::Segment first = segment;
+				first.x2 = x;
+				first.y2 = y;
+				vre::Segment second = segment;
+				second.x1 = x;
+				second.y1 = y;
+				(a > 0.0f ? _front : _back).push_back(first);
+				(a > 0.0f ? _back : _front).push_back(second);
+			}
+		}
+	}
+
+	void growBounds(vre::BspNode &_node, const vre::Segment &_segment) {
+		_node.minX = std::min({ _node.minX, _segment.x1, _segment.x2 });
+		_node.minY = std::min({ _node.minY, _segment.y1, _segment.y2 });
+		_node.maxX = std::max({ _node.maxX, _segment.x1, _segment.x2 });
+		_node.maxY = std::max({ _node.maxY, _segment.y1, _segment.y2 });
+	}
+
+	// moves _child behind the nodes of _parent, returns the new index of its root
+	int32_t append(Subtree &_parent, Subtree &&_child) {
+		int32_t nodeOffset = static_cast<int32_t>(_parent.nodes.size());
+		int32_t segmentOffset = static_cast<int32_t>(_parent.segments.size());
+		for (vre::BspNode &node : _child.nodes) {
+			node.front = node.front >= 0 ? node.front + nodeOffset : -1;
+			node.back = node.back >= 0 ? node.back + nodeOffset : -1;
+			node.firstSegment += segmentOffset;
+			_parent.nodes.push_back(node);
+		}
+		_parent.segments.insert(_parent.segments.end(), _child.segments.begin(),
+			_child.segments.end());
+		return nodeOffset;
+	}
+
+	// the two children of the top _parallelDepth levels are built on
+	// separate threads
+	Subtree buildSubtree(std::vector<vre::Segment> _segments, int _parallelDepth) {
+		Subtree tree;
+		if (_segments.empty()) {
+			return tree;
+		}
+
+		size_t stride = _segments.size() > SPLITTER_CANDIDATES
+			? _segments.size() / SPLITTER_CANDIDATES : 1;
+		Partition best = partitionOf(_segments[0]);
+		size_t bestScore = SIZE_MAX;
+		for (size_t i = 0; i < _segments.size(); i += stride) {
+			Partition candidate = partitionOf(_segments[i]);
+			size_t candidateScore = score(_segments, candidate);
+			if (candidateScore < bestScore) {
+				best = candidate;
+				bestScore = candidateScore;
+			}
+		}
+
+		std::vector<vre::Segment> front;
+		std::vector<vre::Segment> back;
+		partitionSegments(_segments, best, tree.segments, front, back);
+		_segments = {};
+
+		vre::BspNode node{ best.nx, best.ny, best.d, -1, -1, 0,
+			static_cast<int32_t>(tree.segments.size()),
+			FLT_MAX, FLT_MAX, -FLT_MAX, -FLT_MAX };
+		for (const vre::Segment &segment : tree.segments) {
+			growBounds(node, segment);
+		}
+		tree.nodes.push_back(node);
+
+		Subtree frontTree;
+		Subtree backTree;
+		if (_parallelDepth > 0 && front.size() + back.size() >= vre::VreBsp::PARALLEL_MIN_SEGMENTS) {
+			auto frontFuture = std::async(std::launch::async, buildSubtree,
+				std::move(front), _parallelDepth - 1);
+			backTree = buildSubtree(std::move(back), _parallelDepth - 1);
+			frontTree = frontFuture.get();
+		} else {
+			frontTree = buildSubtree(std::move(front), 0);
+			backTree = buildSubtree(std::move(back), 0);
+		}
+
+		for (Subtree *child : { &frontTree, &backTree }) {
+			if (child->nodes.empty()) {
+				continue;
+			}
+			const vre::BspNode &root = child->nodes[0];
+			tree.nodes[0].minX = std::min(tree.nodes[0].minX, root.minX);
+			tree.nodes[0].minY = std::min(tree.nodes[0].minY, root.minY);
+			tree.nodes[0].maxX = std::max(tree.nodes[0].maxX, root.maxX);
+			tree.nodes[0].maxY = std::max(tree.nodes[0].maxY, root.maxY);
+		}
+
+		if (!frontTree.nodes.empty()) {
+			tree.nodes[0].front = append(tree, std::move(frontTree));
+		}
+		if (!backTree.nodes.empty()) {
+			tree.nodes[0].back = append(tree, std::move(backTree));
+		}
+		return tree;
+	}
+}
+
+void vre::VreBsp::build(const std::vector<Segment> &_segments, unsigned int _threads) {
+	if (_threads == 0) {
+		_threads = std::max(std::thread::hardware_concurrency(), 1u);
+	}
+	int parallelDepth = 0;
+	while ((1u << parallelDepth) < _threads) {
+		parallelDepth++;
+	}
+
+	Subtree tree = buildSubtree(_segments, parallelDepth);
+	m_nodes = std::move(tree.nodes);
+	m_segments = std::move(tree.segments);
+	m_hash = hashSegments(_segments);
+}
+
+bool vre::VreBsp::loadOrBuild(const std::vector<Segment> &_segments, const std::string &_path) {
+	uint64_t hash = hashSegments(_segments);
+	if (load(_path, hash)) {
+		return true;
+	}
+	build(_segments);
+	save(_path);
+	return false;
+}
+
+bool vre::VreBsp::save(const std::string &_path) const {
+	std::ofstream file(_path, std::ios::binary);
+	if (!file) {
+		return false;
+	}
+
+	uint32_t header[2] = { CACHE_MAGIC, CACHE_VERSION };
+	uint32_t counts[2] = { static_cast<uint32_t>(m_nodes.size()),
+		static_cast<uint32_t>(m_segments.size()) };
+	file.write(reinterpret_cast<const char *>(header), sizeof(header));
+	file.write(reinterpret_cast<const char *>(&m_hash), sizeof(m_hash));
+	file.write(reinterpret_cast<const char *>(counts), sizeof(counts));
+	file.write(reinterpret_cast<const char *>(m_nodes.data()), m_nodes.size() * sizeof(BspNode));
+	file.write(reinterpret_cast<const char *>(m_segments.data()), m_segments.size() * sizeof(Segment));
+	return static_cast<bool>(file);
+}
+
+bool vre::VreBsp::load(const std::string &_path, uint64_t _expectedHash) {
+	std::ifstream file(_path, std::ios::binary);
+	if (!file) {
+		return false;
+	}
+
+	uint32_t header[2];
+	uint64_t hash;
+	uint32_t counts[2];
+	file.read(reinterpret_cast<char *>(header), sizeof(header));
+	file.read(reinterpret_cast<char *>(&hash), sizeof(hash));
+	file.read(reinterpret_cast<char *>(counts), sizeof(counts));
+	if (!file || header[0] != CACHE_MAGIC || header[1] != CACHE_VERSION || hash != _expectedHash) {
+		return false;
+	}
+
+	std::vector<BspNode> nodes(counts[0]);
+	std::vector<Segment> segments(counts[1]);
+	file.read(reinterpret_cast<char *>(nodes.data()), nodes.size() * sizeof(BspNode));
+	file.read(reinterpret_cast<char *>(segments.data()), segments.size() * sizeof(Segment));
+	if (!file) {
+		return false;
+	}
+
+	m_nodes = std::move(nodes);
+	m_segments = std::move(segments);
+	m_hash = hash;
+	return true;
+}
+
+uint64_t vre::VreBsp::hashSegments(const std::vector<Segment> &_segments) {
+	uint64_t hash = 14695981039346656037ull;
+	const unsigned char *bytes = reinterpret_cast<const unsigned char *>(_segments.data());
+	for (size_t i = 0; i < _segments.size() * sizeof(Segment); i++) {
+		hash = (hash ^ bytes[i]) * 1099511628211ull;
+	}
+	return hash;
+}
+
+int vre::VreBsp::depth() const {
+	if (m_nodes.empty()) {
+		return 0;
+	}
+
+	int deepest = 0;
+	std::vector<std::pair<int32_t, int>> stack = { { 0, 1 } };
+	while (!stack.empty()) {
+		auto [node, level] = stack.back();
+		stack.pop_back();
+		deepest = std::max(deepest, level);
+		if (m_nodes[node].front >= 0) {
+			stack.push_back({ m_nodes[node].front, level + 1 });
+		}
+		if (m_nodes[node].back >= 0) {
+			stack.push_back({ m_nodes[node].back, level + 1 });
+		}
+	}
+	return deepest;
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <cstdint>
+
+#include "VreSegmentMap.hpp"
+
+namespace vre {
+	// partition line nx * x + ny * y = d, the front side is where the left
+	// side is bigger than d. segments lying on the line are stored with the
+	// node, so drawing near child, own segments, far child is front to back
+	struct BspNode {
+		float nx;
+		float ny;
+		float d;
+		int32_t front; // child node index, -1 if none
+		int32_t back;
+		int32_t firstSegment;
+		int32_t segmentCount;
+		// bounds of every segment in this subtree
+		float minX;
+		float minY;
+		float maxX;
+		float maxY;
+	};
+
+	class VreBsp {
+	public:
+		// split below this many segments per subtree stays on one thread
+		static constexpr size_t PARALLEL_MIN_SEGMENTS = 2048;
+
+		// _threads 0 uses every hardware thread
+		void build(const std::vector<Segment> &_segments, unsigned int _threads = 0);
+
+		// loads the tree from _path if it was built from the same segments,
+		// builds and writes it otherwise. returns true on a cache hit
+		bool loadOrBuild(const std::vector<Segment> &_segments, const std::string &_path);
+		bool save(const std::string &_path) const;
+		bool load(const std::string &_path, uint64_t _expectedHash);
+
+		// fnv-1a over the raw segment data, identifies cache files
+		static uint64_t hashSegments(const std::vector<Segment> &_segments);
+
+		const std::vector<BspNode> &nodes() const { return m_nodes; }
+		// input segments after splitting, in node order
+		const std::vector<Segment> &segments() const { return m_segments; }
+		bool empty() const { return m_nodes.empty(); }
+		int depth() const;
+
+	private:
+		std::vector<BspNode> m_nodes;
+		std::vector<Segment> m_segments;
+		uint64_t m_hash = 0;
+	};
+}
@@ -0,0 +1,242 @@
+#include "VreBspRenderer.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cfloat>
+
+namespace {
+	// segments closer than this to the camera plane are clipped, world units
+	constexpr float NEAR_PLANE = 0.01f;
+	// covered span list sentinels, far outside any screen
+	constexpr int SPAN_LIMIT = 1 << 30;
+}
+
+vre::VreBspRenderer::VreBspRenderer(const VreBsp &_bsp, int _cellSize)
+	: m_bsp(&_bsp), m_cellSize(static_cast<float>(_cellSize)) {
+}
+
+void vre::VreBspRenderer::castColumns(const RayCamera &_camera, int _firstColumn,
+	int _columnCount, int _screenWidth, RayHit *_out
+) {
+	assert(_camera.columnStep > 0.0f && "bsp columns must step left to right");
+	for (int i = 0; i < _columnCount; i++) {
+		_out[i] = {};
+		_out[i].distance = raycast::NO_HIT_DISTANCE;
+	}
+
+	Projection view;
+	view.x = _camera.x;
+	view.y = _camera.y;
+	view.forwardX = std::cos(_camera.angle);
+	view.forwardY = std::sin(_camera.angle);
+	view.rightX = -view.forwardY;
+	view.rightY = view.forwardX;
+	view.tanHalfFov = std::tan(_camera.fov * 0.5f);
+	view.screenWidth = _screenWidth;
+	view.columnStep = _camera.columnStep;
+	view.columnPhase = _camera.columnPhase;
+	view.firstColumn = _firstColumn;
+	view.lastColumn = _firstColumn + _columnCount - 1;
+	view.out = _out;
+
+	// everything outside the requested columns counts as covered already
+	m_covered.clear();
+	m_covered.push_back({ -SPAN_LIMIT, _firstColumn - 1 });
+	m_covered.push_back({ view.lastColumn + 1, SPAN_LIMIT });
+	m_nodesVisited = 0;
+	m_segmentsDrawn = 0;
+
+	if (!m_bsp->empty()) {
+		visit(0, view);
+	}
+}
+
+bool vre::VreBspRenderer::visit(int32_t _node, const Projection &_view) {
+	const BspNode &node = m_bsp->nodes()[_node];
+	m_nodesVisited++;
+	if (!boundsVisible(node, _view)) {
+		return false;
+	}
+
+	bool cameraInFront = node.nx * _view.x + node.ny * _view.y >= node.d;
+	int32_t nearChild = cameraInFront ? node.front : node.back;
+	int32_t farChild = cameraInFront ? node.back : node.front;
+
+	if (nearChild >= 0 && visit(nearChild, _view)) {
+		return true;
+	}
+
+	const Segment *segments = m_bsp->segments().data() + node.firstSegment;
+	for (int32_t i = 0; i < node.segmentCount; i++) {
+		drawSegment(segments[i], _view);
+	}
+	if (screenFull()) {
+		return true;
+	}
+
+	return farChild >= 0 && visit(farChild, _view);
+}
+
+bool vre::VreBspRenderer::boundsVisible(const BspNode &_node, const Projection &_view) const {
+	if (_view.x >= _node.minX && _view.x <= _node.maxX
+		&& _view.y >= _node.minY && _view.y <= _node.maxY) {
+		return true;
+	}
+
+	float lowest = FLT_MAX;
+	float highest = -FLT_MAX;
+	const float cornersX[4] = { _node.minX, _node.maxX, _node.minX, _node.maxX };
+	const float cornersY[4] = { _node.minY, _node.minY, _node.maxY, _node.maxY };
+	int behind = 0;
+	for (int i = 0; i < 4; i++) {
+		float x = cornersX[i] - _view.x;
+		float y = cornersY[i] - _view.y;
+		float depth = x * _view.forwardX + y * _view.forwardY;
+		if (depth < NEAR_PLANE) {
+			behind++;
+			continue;
+		}
+		float cameraX = (x * _view.rightX + y * _view.rightY) / (depth * _view.tanHalfFov);
+		lowest = std::min(lowest, cameraX);
+		highest = std::max(highest, cameraX);
+	}
+	if (behind == 4) {
+		return false;
+	}
+	if (behind > 0) {
+		// the box crosses the camera plane, its projection is unbounded
+		return true;
+	}
+
+	int first = std::max(static_cast<int>(std::ceil(castColumn(lowest, _view))),
+		_view.firstColumn);
+	int last = std::min(static_cast<int>(std::floor(castColumn(highest, _view))),
+		_view.lastColumn);
+	if (first > last) {
+		return false;
+	}
+
+	for (const ColumnSpan &span : m_covered) {
+		if (span.first <= first && span.last >= last) {
+			return false;
+		}
+		if (span.first > first) {
+			break;
+		}
+	}
+	return true;
+}
+
+void vre::VreBspRenderer::drawSegment(const Segment &_segment, const Projection &_view) {
+	// endpoints in camera space, depth along the view direction
+	float ax = _segment.x1 - _view.x;
+	float ay = _segment.y1 - _view.y;
+	float bx = _segment.x2 - _view.x;
+	float by = _segment.y2 - _view.y;
+	float depthA = ax * _view.forwardX + ay * _view.forwardY;
+	float depthB = bx * _view.forwardX + by * _view.forwardY;
+	float lateralA = ax * _view.rightX + ay * _view.rightY;
+	float lateralB = bx * _view.rightX + by * _view.rightY;
+
+	if (depthA < NEAR_PLANE && depthB < NEAR_PLANE) {
+		return;
+	}
+	if (depthA < NEAR_PLANE || depthB < NEAR_PLANE) {
+		float t = (NEAR_PLANE - depthA) / (depthB - depthA);
+		float lateral = lateralA + t * (lateralB - lateralA);
+		if (depthA < NEAR_PLANE) {
+			depthA = NEAR_PLANE;
+			lateralA = lateral;
+		} else {
+			depthB = NEAR_PLANE;
+			lateralB = lateral;
+		}
+	}
+
+	float columnA = castColumn(lateralA / (depthA * _view.tanHalfFov), _view);
+	float columnB = castColumn(lateralB / (depthB * _view.tanHalfFov), _view);
+	int first = std::max(static_cast<int>(std::ceil(std::min(columnA, columnB))), _view.firstColumn);
+	int last = std::min(static_cast<int>(std::floor(std::max(columnA, columnB))), _view.lastColumn);
+	if (first > last) {
+		return;
+	}
+
+	// fill the gaps between covered spans
+	int x = first;
+	for (const ColumnSpan &span : m_covered) {
+		if (span.last < x) {
+			continue;
+		}
+		if (span.first > last) {
+			break;
+		}
+		if (span.first > x) {
+			fillColumns(_segment, x, span.first - 1, _view);
+		}
+		x = span.last + 1;
+		if (x > last) {
+			break;
+		}
+	}
+	if (x <= last) {
+		fillColumns(_segment, x, last, _view);
+	}
+
+	// walls are full height, so the whole range is covered now
+	ColumnSpan merged{ first, last };
+	size_t begin = 0;
+	while (begin < m_covered.size() && m_covered[begin].last + 1 < first) {
+		begin++;
+	}
+	size_t end = begin;
+	while (end < m_covered.size() && m_covered[end].first <= last + 1) {
+		merged.first = std::min(merged.first, m_covered[end].first);
+		merged.last = std::max(merged.last, m_covered[end].last);
+		end++;
+	}
+	m_covered.erase(m_covered.begin() + begin, m_covered.begin() + end);
+	m_covered.insert(m_covered.begin() + begin, merged);
+}
+
+void vre::VreBspRenderer::fillColumns(const Segment &_segment, int _first, int _last,
+	const Projection &_view
+) {
+	float edgeX = _segment.x2 - _segment.x1;
+	float edgeY = _segment.y2 - _segment.y1;
+	float toStartX = _segment.x1 - _view.x;
+	float toStartY = _segment.y1 - _view.y;
+	float invCellSize = 1.0f / m_cellSize;
+	float invWidth = 2.0f / static_cast<float>(_view.screenWidth);
+	m_segmentsDrawn++;
+
+	for (int column = _first; column <= _last; column++) {
+		float screenColumn = static_cast<float>(column) * _view.columnStep + _view.columnPhase;
+		float cameraX = (screenColumn + 0.5f) * invWidth - 1.0f;
+		float dirX = _view.forwardX + _view.rightX * _view.tanHalfFov * cameraX;
+		float dirY = _view.forwardY + _view.rightY * _view.tanHalfFov * cameraX;
+
+		// camera + t * dir = start + s * edge, t is the perpendicular
+		// distance because dir has a forward component of 1
+		float denominator = dirX * edgeY - dirY * edgeX;
+		if (denominator == 0.0f) {
+			continue;
+		}
+		float t = (toStartX * edgeY - toStartY * edgeX) / denominator;
+		float s = std::clamp((toStartX * dirY - toStartY * dirX) / denominator, 0.0f, 1.0f);
+
+		raycast::finishSegmentHit(_segment, _view.x, _view.y, dirX, dirY, t, s, invCellSize,
+			_view.out[column - _view.firstColumn]);
+	}
+}
+
+float vre::VreBspRenderer::castColumn(float _cameraX, const Projection &_view) {
+	// screen column i is centred on cameraX = (i + 0.5) * 2 / width - 1, and
+	// cast column c is screen column c * columnStep + columnPhase
+	float screenColumn = (_cameraX + 1.0f) * _view.screenWidth * 0.5f - 0.5f;
+	return (screenColumn - _view.columnPhase) / _view.columnStep;
+}
+
+bool vre::VreBspRenderer::screenFull() const {
+	return m_covered.size() == 1;
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <vector>
+
+#include "VreBsp.hpp"
+#include "VreWorldRenderer.hpp"
+
+namespace vre {
+	// segment maps. walks the bsp front to back and fills every column the
+	// first time a segment covers it, a sorted list of already covered
+	// column spans clips everything behind. subtrees whose bounds are hidden
+	// are skipped, and the walk stops once the list covers the whole screen
+	class VreBspRenderer : public VreWorldRenderer {
+	public:
+		VreBspRenderer(const VreBsp &_bsp, int _cellSize);
+
+		void castColumns(const RayCamera &_camera, int _firstColumn,
+			int _columnCount, int _screenWidth, RayHit *_out) override;
+
+		const char *name() const override { return "bsp"; }
+
+		// work done by the last castColumns call
+		int nodesVisited() const { return m_nodesVisited; }
+		int segmentsDrawn() const { return m_segmentsDrawn; }
+
+	private:
+		// occluded columns, both ends inclusive
+		struct ColumnSpan {
+			int first;
+			int last;
+		};
+
+		struct Projection {
+			float x;
+			float y;
+			float forwardX;
+			float forwardY;
+			float rightX; // unit vector along the screen plane
+			float rightY;
+			float tanHalfFov;
+			int screenWidth;
+			// RayCamera's, the covered spans are in cast columns
+			float columnStep;
+			float columnPhase;
+			int firstColumn;
+			int lastColumn;
+			RayHit *out; // indexed by column - firstColumn
+		};
+
+		bool visit(int32_t _node, const Projection &_view);
+		// cast column whose ray passes through cameraX, not rounded
+		static float castColumn(float _cameraX, const Projection &_view);
+		// false if the node bounds are off screen or behind covered columns
+		bool boundsVisible(const BspNode &_node, const Projection &_view) const;
+		void drawSegment(const Segment &_segment, const Projection &_view);
+		void fillColumns(const Segment &_segment, int _first, int _last, const Projection &_view);
+		bool screenFull() const;
+
+		const VreBsp *m_bsp;
+		float m_cellSize;
+		std::vector<ColumnSpan> m_covered;
+		int m_nodesVisited = 0;
+		int m_segmentsDrawn = 0;
+	};
+}
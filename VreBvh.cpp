@@ -0,0 +1,616 @@
+#include "VreBvh.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <cfloat>
+#include <cmath>
+#include <future>
+#include <thread>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VRE_BVH_SSE 1
+#include <emmintrin.h>
+#else
+#define VRE_BVH_SSE 0
+#endif
+
+namespace {
+	// 4 floats, sse when available and plain loops otherwise
+	struct Float4 {
+#if VRE_BVH_SSE
+		__m128 v;
+
+		static Float4 load(const float *_p) { return { _mm_load_ps(_p) }; }
+		static Float4 broadcast(float _f) { return { _mm_set1_ps(_f) }; }
+		void store(float *_p) const { _mm_store_ps(_p, v); }
+
+		friend Float4 operator-(Float4 _a, Float4 _b) { return { _mm_sub_ps(_a.v, _b.v) }; }
+		friend Float4 operator*(Float4 _a, Float4 _b) { return { _mm_mul_ps(_a.v, _b.v) }; }
+		friend Float4 operator/(Float4 _a, Float4 _b) { return { _mm_div_ps(_a.v, _b.v) }; }
+		friend Float4 min(Float4 _a, Float4 _b) { return { _mm_min_ps(_a.v, _b.v) }; }
+		friend Float4 max(Float4 _a, Float4 _b) { return { _mm_max_ps(_a.v, _b.v) }; }
+		// bit i is set where _a[i] <= _b[i]
+		friend int lessEqual(Float4 _a, Float4 _b) {
+			return _mm_movemask_ps(_mm_cmple_ps(_a.v, _b.v));
+		}
+		friend int less(Float4 _a, Float4 _b) {
+			return _mm_movemask_ps(_mm_cmplt_ps(_a.v, _b.v));
+		}
+#else
+		float v[4];
+
+		static Float4 load(const float *_p) { return { { _p[0], _p[1], _p[2], _p[3] } }; }
+		static Float4 broadcast(float _f) { return { { _f, _f, _f, _f } }; }
+		void store(float *_p) const { std::copy(v, v + 4, _p); }
+
+		template<typename Op>
+		static Float4 apply(Float4 _a, Float4 _b, Op _op) {
+			return { { _op(_a.v[0], _b.v[0]), _op(_a.v[1], _b.v[1]),
+				_op(_a.v[2], _b.v[2]), _op(_a.v[3], _b.v[3]) } };
+		}
+		friend Float4 operator-(Float4 _a, Float4 _b) { return apply(_a, _b, [](float _x, float _y) { return _x - _y; }); }
+		friend Float4 operator*(Float4 _a, Float4 _b) { return apply(_a, _b, [](float _x, float _y) { return _x * _y; }); }
+		friend Float4 operator/(Float4 _a, Float4 _b) { return apply(_a, _b, [](float _x, float _y) { return _x / _y; }); }
+		friend Float4 min(Float4 _a, Float4 _b) { return apply(_a, _b, [](float _x, float _y) { return _x < _y ? _x : _y; }); }
+		friend Float4 max(Float4 _a, Float4 _b) { return apply(_a, _b, [](float _x, float _y) { return _x > _y ? _x : _y; }); }
+		friend int lessEqual(Float4 _a, Float4 _b) {
+			int mask = 0;
+			for (int i = 0; i < 4; i++) {
+				mask |= (_a.v[i] <= _b.v[i]) << i;
+			}
+			return mask;
+		}
+		friend int less(Float4 _a, Float4 _b) {
+			int mask = 0;
+			for (int i = 0; i < 4; i++) {
+				mask |= (_a.v[i] < _b.v[i]) << i;
+			}
+			return mask;
+		}
+#endif
+	};
+
+	constexpr int STACK_SIZE = 64;
+
+	// traversal stack of node indices, a local array when the tree fits
+	// in STACK_SIZE and the heap for deeper ones, so no child is dropped
+	class NodeStack {
+	public:
+		explicit NodeStack(int _capacity) : m_capacity{ _capacity } {
+			if (_capacity > STACK_SIZE) {
+				m_spill.resize(_capacity);
+				m_entries = m_spill.data();
+			}
+		}
+
+		bool empty() const { return m_top == 0; }
+		void push(int32_t _node) {
+			assert(m_top < m_capacity && "the stack size from the tree depth is too small");
+			m_entries[m_top++] = _node;
+		}
+		int32_t pop() { return m_entries[--m_top]; }
+
+	private:
+		int32_t m_local[STACK_SIZE];
+		std::vector<int32_t> m_spill;
+		int32_t *m_entries = m_local;
+		int m_capacity;
+		int m_top = 0;
+	};
+
+	struct Bounds {
+		float minX = FLT_MAX;
+		float minY = FLT_MAX;
+		float maxX = -FLT_MAX;
+		float maxY = -FLT_MAX;
+
+		void grow(float _x, float _y) {
+			minX = std::min(minX, _x);
+			minY = std::min(minY, _y);
+			maxX = std::max(maxX, _x);
+			maxY = std::max(maxY, _y);
+		}
+		void grow(const Bounds &_other) {
+			grow(_other.minX, _other.minY);
+			grow(_other.maxX, _other.maxY);
+		}
+		// the 2d surface area heuristic uses the perimeter
+		float halfPerimeter() const {
+			return minX > maxX ? 0.0f : (maxX - minX) + (maxY - minY);
+		}
+	};
+
+	struct BuildPrimitive {
+		Bounds bounds;
+		float centerX;
+		float centerY;
+		int32_t index;
+	};
+
+	// binary sah tree, collapsed into 4 wide nodes afterwards
+	struct BinaryNode {
+		Bounds bounds;
+		int32_t left;
+		int32_t right;
+		int32_t first; // into the primitive order
+		int32_t count; // > 0 for leaves
+	};
+
+	Bounds segmentBounds(const vre::Segment &_segment) {
+		Bounds bounds;
+		bounds.grow(_segment.x1, _segment.y1);
+		bounds.grow(_segment.x2, _segment.y2);
+		return bounds;
+	}
+
+	// a direction of exactly 0 would turn box plane hits into nan
+	float safeInverse(float _dir) {
+		return 1.0f / (std::abs(_dir) < 1e-20f ? 1e-20f : _dir);
+	}
+
+	bool intersectSegment(const vre::Segment &_segment, const vre::BvhRay &_ray,
+		float _tMax, float &_t, float &_s
+	) {
+		float edgeX = _segment.x2 - _segment.x1;
+		float edgeY = _segment.y2 - _segment.y1;
+		float toStartX = _segment.x1 - _ray.x;
+		float toStartY = _segment.y1 - _ray.y;
+		float denominator = _ray.dirX * edgeY - _ray.dirY * edgeX;
+		float tScaled = toStartX * edgeY - toStartY * edgeX;
+		float sScaled = toStartX * _ray.dirY - toStartY * _ray.dirX;
+		// compare before dividing, most segments in a leaf are misses
+		if (denominator < 0.0f) {
+			denominator = -denominator;
+			tScaled = -tScaled;
+			sScaled = -sScaled;
+		}
+		if (denominator == 0.0f || tScaled <= 0.0f || tScaled >= _tMax * denominator
+			|| sScaled < 0.0f || sScaled > denominator) {
+			return false;
+		}
+		float inverse = 1.0f / denominator;
+		_t = tScaled * inverse;
+		_s = sScaled * inverse;
+		return true;
+	}
+
+	std::vector<BinaryNode> buildBinary(std::vector<BuildPrimitive> &_primitives,
+		int32_t _begin, int32_t _end, int _parallelDepth);
+
+	// appends _child behind _parent's nodes, returns where its root went
+	int32_t append(std::vector<BinaryNode> &_parent, std::vector<BinaryNode> &&_child) {
+		int32_t offset = static_cast<int32_t>(_parent.size());
+		for (BinaryNode &node : _child) {
+			if (node.count == 0) {
+				node.left += offset;
+				node.right += offset;
+			}
+			_parent.push_back(node);
+		}
+		return offset;
+	}
+
+	std::vector<BinaryNode> buildBinary(std::vector<BuildPrimitive> &_primitives,
+		int32_t _begin, int32_t _end, int _parallelDepth
+	) {
+		std::vector<BinaryNode> nodes(1);
+		BinaryNode &root = nodes[0];
+		Bounds centers;
+		for (int32_t i = _begin; i < _end; i++) {
+			root.bounds.grow(_primitives[i].bounds);
+			centers.grow(_primitives[i].centerX, _primitives[i].centerY);
+		}
+		int32_t count = _end - _begin;
+
+		// bin centroids along the longer axis and sweep both ways
+		bool alongX = centers.maxX - centers.minX >= centers.maxY - centers.minY;
+		float low = alongX ? centers.minX : centers.minY;
+		float extent = (alongX ? centers.maxX : centers.maxY) - low;
+
+		int32_t middle = -1;
+		if (extent > 0.0f) {
+			constexpr int bins = vre::VreBvh::SAH_BINS;
+			float scale = bins / extent;
+			auto binOf = [&](const BuildPrimitive &_primitive) {
+				float center = alongX ? _primitive.centerX : _primitive.centerY;
+				return std::min(static_cast<int>((center - low) * scale), bins - 1);
+			};
+
+			Bounds binBounds[bins];
+			int binCounts[bins] = {};
+			for (int32_t i = _begin; i < _end; i++) {
+				int bin = binOf(_primitives[i]);
+				binBounds[bin].grow(_primitives[i].bounds);
+				binCounts[bin]++;
+			}
+
+			float rightCost[bins];
+			Bounds right;
+			int rightCount = 0;
+			for (int bin = bins - 1; bin > 0; bin--) {
+				right.grow(binBounds[bin]);
+				rightCount += binCounts[bin];
+				rightCost[bin] = right.halfPerimeter() * rightCount;
+			}
+
+			float bestCost = FLT_MAX;
+			int bestSplit = -1;
+			Bounds left;
+			int leftCount = 0;
+			for (int split = 1; split < bins; split++) {
+				left.grow(binBounds[split - 1]);
+				leftCount += binCounts[split - 1];
+				float cost = left.halfPerimeter() * leftCount + rightCost[split];
+				if (leftCount > 0 && leftCount < count && cost < bestCost) {
+					bestCost = cost;
+					bestSplit = split;
+				}
+			}
+
+			bool leafIsCheaper = bestCost >= root.bounds.halfPerimeter() * count;
+			if (bestSplit > 0 && !(count <= vre::VreBvh::MAX_LEAF_SEGMENTS && leafIsCheaper)) {
+				auto split = std::partition(_primitives.begin() + _begin, _primitives.begin() + _end,
+					[&](const BuildPrimitive &_primitive) { return binOf(_primitive) < bestSplit; });
+				middle = static_cast<int32_t>(split - _primitives.begin());
+			}
+		}
+		if (middle < 0 && count > vre::VreBvh::MAX_LEAF_SEGMENTS) {
+			// every centroid in one spot, any split is as good as another
+			middle = _begin + count / 2;
+		}
+
+		if (middle < 0) {
+			root.left = -1;
+			root.right = -1;
+			root.first = _begin;
+			root.count = count;
+			return nodes;
+		}
+
+		std::vector<BinaryNode> leftTree;
+		std::vector<BinaryNode> rightTree;
+		size_t smallerHalf = static_cast<size_t>(std::min(middle - _begin, _end - middle));
+		if (_parallelDepth > 0 && smallerHalf >= vre::VreBvh::PARALLEL_MIN_SEGMENTS) {
+			// the two halves are disjoint ranges of _primitives
+			auto leftFuture = std::async(std::launch::async, [&]() {
+				return buildBinary(_primitives, _begin, middle, _parallelDepth - 1);
+			});
+			rightTree = buildBinary(_primitives, middle, _end, _parallelDepth - 1);
+			leftTree = leftFuture.get();
+		} else {
+			leftTree = buildBinary(_primitives, _begin, middle, 0);
+			rightTree = buildBinary(_primitives, middle, _end, 0);
+		}
+
+		nodes[0].first = 0;
+		nodes[0].count = 0;
+		int32_t leftIndex = append(nodes, std::move(leftTree));
+		int32_t rightIndex = append(nodes, std::move(rightTree));
+		nodes[0].left = leftIndex;
+		nodes[0].right = rightIndex;
+		return nodes;
+	}
+
+	void setSlot(vre::BvhNode4 &_node, int _slot, const Bounds &_bounds, int32_t _child,
+		int32_t _count
+	) {
+		_node.minX[_slot] = _bounds.minX;
+		_node.minY[_slot] = _bounds.minY;
+		_node.maxX[_slot] = _bounds.maxX;
+		_node.maxY[_slot] = _bounds.maxY;
+		_node.child[_slot] = _child;
+		_node.count[_slot] = _count;
+	}
+
+	// pulls up to 4 binary descendants into one wide node, always opening
+	// the inner child with the largest perimeter. _depth ends up as the
+	// most wide levels on any path, _level counts the one being made
+	int32_t collapse(const std::vector<BinaryNode> &_binary, const BinaryNode &_root,
+		std::vector<vre::BvhNode4> &_out, int _level, int &_depth
+	) {
+		_depth = std::max(_depth, _level);
+		int32_t index = static_cast<int32_t>(_out.size());
+		_out.emplace_back();
+
+		int32_t children[4];
+		int childCount = 0;
+		if (_root.count > 0) {
+			children[childCount++] = static_cast<int32_t>(&_root - _binary.data());
+		} else {
+			children[childCount++] = _root.left;
+			children[childCount++] = _root.right;
+		}
+		while (childCount < 4) {
+			int widest = -1;
+			for (int i = 0; i < childCount; i++) {
+				const BinaryNode &child = _binary[children[i]];
+				if (child.count == 0 && (widest < 0 || child.bounds.halfPerimeter()
+					> _binary[children[widest]].bounds.halfPerimeter())) {
+					widest = i;
+				}
+			}
+			if (widest < 0) {
+				break;
+			}
+			const BinaryNode &opened = _binary[children[widest]];
+			children[widest] = opened.left;
+			children[childCount++] = opened.right;
+		}
+
+		for (int slot = 0; slot < 4; slot++) {
+			if (slot >= childCount) {
+				setSlot(_out[index], slot, Bounds(), 0, -1);
+				continue;
+			}
+			const BinaryNode &child = _binary[children[slot]];
+			if (child.count > 0) {
+				setSlot(_out[index], slot, child.bounds, child.first, child.count);
+			} else {
+				int32_t wide = collapse(_binary, child, _out, _level + 1, _depth);
+				setSlot(_out[index], slot, child.bounds, wide, 0);
+			}
+		}
+		return index;
+	}
+}
+
+void vre::VreBvh::build(const std::vector<Segment> &_segments, unsigned int _threads) {
+	m_nodes.clear();
+	m_order.clear();
+	m_segments.clear();
+	if (_segments.empty()) {
+		return;
+	}
+
+	if (_threads == 0) {
+		_threads = std::max(std::thread::hardware_concurrency(), 1u);
+	}
+	int parallelDepth = 0;
+	while ((1u << parallelDepth) < _threads) {
+		parallelDepth++;
+	}
+
+	std::vector<BuildPrimitive> primitives(_segments.size());
+	for (size_t i = 0; i < _segments.size(); i++) {
+		primitives[i].bounds = segmentBounds(_segments[i]);
+		primitives[i].centerX = (_segments[i].x1 + _segments[i].x2) * 0.5f;
+		primitives[i].centerY = (_segments[i].y1 + _segments[i].y2) * 0.5f;
+		primitives[i].index = static_cast<int32_t>(i);
+	}
+
+	std::vector<BinaryNode> binary = buildBinary(primitives, 0,
+		static_cast<int32_t>(primitives.size()), parallelDepth);
+	int depth = 0;
+	collapse(binary, binary[0], m_nodes, 1, depth);
+	// each level pops one node and pushes at most 4
+	m_stackSize = 3 * depth + 1;
+
+	m_order.resize(primitives.size());
+	m_segments.resize(primitives.size());
+	for (size_t i = 0; i < primitives.size(); i++) {
+		m_order[i] = primitives[i].index;
+		m_segments[i] = _segments[primitives[i].index];
+	}
+}
+
+void vre::VreBvh::refit(const std::vector<Segment> &_segments) {
+	for (size_t i = 0; i < m_order.size(); i++) {
+		m_segments[i] = _segments[m_order[i]];
+	}
+
+	// children always come after their parent
+	for (size_t i = m_nodes.size(); i-- > 0;) {
+		BvhNode4 &node = m_nodes[i];
+		for (int slot = 0; slot < 4; slot++) {
+			Bounds bounds;
+			if (node.count[slot] > 0) {
+				for (int32_t p = 0; p < node.count[slot]; p++) {
+					bounds.grow(segmentBounds(m_segments[node.child[slot] + p]));
+				}
+			} else if (node.count[slot] == 0) {
+				const BvhNode4 &child = m_nodes[node.child[slot]];
+				for (int c = 0; c < 4; c++) {
+					if (child.count[c] >= 0) {
+						bounds.grow(child.minX[c], child.minY[c]);
+						bounds.grow(child.maxX[c], child.maxY[c]);
+					}
+				}
+			} else {
+				continue;
+			}
+			setSlot(node, slot, bounds, node.child[slot], node.count[slot]);
+		}
+	}
+}
+
+vre::BvhHit vre::VreBvh::intersect(const BvhRay &_ray) const {
+	return traverse<false>(_ray);
+}
+
+bool vre::VreBvh::occluded(const BvhRay &_ray) const {
+	return traverse<true>(_ray).segment >= 0;
+}
+
+template<bool AnyHit>
+vre::BvhHit vre::VreBvh::traverse(const BvhRay &_ray) const {
+	BvhHit hit{ _ray.tMax, 0.0f, -1 };
+	if (m_nodes.empty()) {
+		return hit;
+	}
+
+	Float4 originX = Float4::broadcast(_ray.x);
+	Float4 originY = Float4::broadcast(_ray.y);
+	Float4 inverseX = Float4::broadcast(safeInverse(_ray.dirX));
+	Float4 inverseY = Float4::broadcast(safeInverse(_ray.dirY));
+	Float4 zero = Float4::broadcast(0.0f);
+
+	NodeStack stack(m_stackSize);
+	stack.push(0);
+	while (!stack.empty()) {
+		const BvhNode4 &node = m_nodes[stack.pop()];
+
+		Float4 x0 = (Float4::load(node.minX) - originX) * inverseX;
+		Float4 x1 = (Float4::load(node.maxX) - originX) * inverseX;
+		Float4 y0 = (Float4::load(node.minY) - originY) * inverseY;
+		Float4 y1 = (Float4::load(node.maxY) - originY) * inverseY;
+		Float4 enter = max(max(min(x0, x1), min(y0, y1)), zero);
+		Float4 exit = min(min(max(x0, x1), max(y0, y1)), Float4::broadcast(hit.t));
+		int mask = lessEqual(enter, exit);
+		if (mask == 0) {
+			continue;
+		}
+
+		alignas(16) float enterT[4];
+		enter.store(enterT);
+
+		// inner children are pushed far to near so the nearest pops first
+		int32_t inner[4];
+		float innerT[4];
+		int innerCount = 0;
+		for (int slot = 0; slot < 4; slot++) {
+			if (!(mask & (1 << slot)) || node.count[slot] < 0) {
+				continue;
+			}
+			if (node.count[slot] == 0) {
+				int i = innerCount++;
+				while (i > 0 && innerT[i - 1] < enterT[slot]) {
+					inner[i] = inner[i - 1];
+					innerT[i] = innerT[i - 1];
+					i--;
+				}
+				inner[i] = node.child[slot];
+				innerT[i] = enterT[slot];
+				continue;
+			}
+
+			for (int32_t p = node.child[slot]; p < node.child[slot] + node.count[slot]; p++) {
+				float t;
+				float s;
+				if (intersectSegment(m_segments[p], _ray, hit.t, t, s)) {
+					hit = { t, s, m_order[p] };
+					if constexpr (AnyHit) {
+						return hit;
+					}
+				}
+			}
+		}
+		for (int i = 0; i < innerCount; i++) {
+			stack.push(inner[i]);
+		}
+	}
+	return hit;
+}
+
+void vre::VreBvh::intersect4(const BvhRay *_rays, BvhHit *_hits) const {
+	alignas(16) float originX[4];
+	alignas(16) float originY[4];
+	alignas(16) float inverseX[4];
+	alignas(16) float inverseY[4];
+	alignas(16) float dirX[4];
+	alignas(16) float dirY[4];
+	alignas(16) float best[4];
+	for (int r = 0; r < 4; r++) {
+		originX[r] = _rays[r].x;
+		originY[r] = _rays[r].y;
+		dirX[r] = _rays[r].dirX;
+		dirY[r] = _rays[r].dirY;
+		inverseX[r] = safeInverse(_rays[r].dirX);
+		inverseY[r] = safeInverse(_rays[r].dirY);
+		best[r] = _rays[r].tMax;
+		_hits[r] = { _rays[r].tMax, 0.0f, -1 };
+	}
+	if (m_nodes.empty()) {
+		return;
+	}
+
+	Float4 rayX = Float4::load(originX);
+	Float4 rayY = Float4::load(originY);
+	Float4 rayInverseX = Float4::load(inverseX);
+	Float4 rayInverseY = Float4::load(inverseY);
+	Float4 rayDirX = Float4::load(dirX);
+	Float4 rayDirY = Float4::load(dirY);
+	Float4 zero = Float4::broadcast(0.0f);
+	Float4 one = Float4::broadcast(1.0f);
+
+	NodeStack stack(m_stackSize);
+	stack.push(0);
+	while (!stack.empty()) {
+		const BvhNode4 &node = m_nodes[stack.pop()];
+		Float4 bestT = Float4::load(best);
+
+		// simd across the rays here, every child box against all four
+		int32_t inner[4];
+		float innerT[4];
+		int innerCount = 0;
+		for (int slot = 0; slot < 4; slot++) {
+			if (node.count[slot] < 0) {
+				continue;
+			}
+			Float4 x0 = (Float4::broadcast(node.minX[slot]) - rayX) * rayInverseX;
+			Float4 x1 = (Float4::broadcast(node.maxX[slot]) - rayX) * rayInverseX;
+			Float4 y0 = (Float4::broadcast(node.minY[slot]) - rayY) * rayInverseY;
+			Float4 y1 = (Float4::broadcast(node.maxY[slot]) - rayY) * rayInverseY;
+			Float4 enter = max(max(min(x0, x1), min(y0, y1)), zero);
+			Float4 exit = min(min(max(x0, x1), max(y0, y1)), bestT);
+			int mask = lessEqual(enter, exit);
+			if (mask == 0) {
+				continue;
+			}
+
+			if (node.count[slot] > 0) {
+				// each segment against all four rays, one divide for the packet.
+				// a zero denominator gives inf or nan which fails every compare
+				for (int32_t p = node.child[slot]; p < node.child[slot] + node.count[slot]; p++) {
+					const Segment &segment = m_segments[p];
+					Float4 edgeX = Float4::broadcast(segment.x2 - segment.x1);
+					Float4 edgeY = Float4::broadcast(segment.y2 - segment.y1);
+					Float4 toStartX = Float4::broadcast(segment.x1) - rayX;
+					Float4 toStartY = Float4::broadcast(segment.y1) - rayY;
+					Float4 denominator = rayDirX * edgeY - rayDirY * edgeX;
+					Float4 t = (toStartX * edgeY - toStartY * edgeX) / denominator;
+					Float4 s = (toStartX * rayDirY - toStartY * rayDirX) / denominator;
+					int hitMask = mask & less(zero, t) & less(t, bestT)
+						& lessEqual(zero, s) & lessEqual(s, one);
+					if (hitMask == 0) {
+						continue;
+					}
+
+					alignas(16) float hitT[4];
+					alignas(16) float hitS[4];
+					t.store(hitT);
+					s.store(hitS);
+					for (int r = 0; r < 4; r++) {
+						if (hitMask & (1 << r)) {
+							best[r] = hitT[r];
+							_hits[r] = { hitT[r], hitS[r], m_order[p] };
+						}
+					}
+					bestT = Float4::load(best);
+				}
+				continue;
+			}
+
+			// order by the nearest entry of any ray in the packet
+			alignas(16) float enterT[4];
+			enter.store(enterT);
+			float nearest = FLT_MAX;
+			for (int r = 0; r < 4; r++) {
+				if (mask & (1 << r)) {
+					nearest = std::min(nearest, enterT[r]);
+				}
+			}
+			int i = innerCount++;
+			while (i > 0 && innerT[i - 1] < nearest) {
+				inner[i] = inner[i - 1];
+				innerT[i] = innerT[i - 1];
+				i--;
+			}
+			inner[i] = node.child[slot];
+			innerT[i] = nearest;
+		}
+		for (int i = 0; i < innerCount; i++) {
+			stack.push(inner[i]);
+		}
+	}
+}
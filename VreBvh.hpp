@@ -0,0 +1,83 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "VreSegmentMap.hpp"
+
+namespace vre {
+	// 4 wide bvh node, the bounds of all four children are stored per axis
+	// so one node is tested against a ray with a single simd pass
+	struct alignas(64) BvhNode4 {
+		float minX[4];
+		float minY[4];
+		float maxX[4];
+		float maxY[4];
+		// inner child: node index, leaf: first primitive
+		int32_t child[4];
+		// 0 for an inner child, the primitive count for a leaf, -1 for an
+		// unused slot (whose bounds are inverted so it never hits)
+		int32_t count[4];
+	};
+
+	struct BvhRay {
+		float x;
+		float y;
+		float dirX;
+		float dirY;
+		float tMax; // hits at or beyond this are ignored
+	};
+
+	struct BvhHit {
+		float t; // ray parameter, the perpendicular distance for camera rays
+		float s; // [0, 1] along the segment
+		int segment; // index into the segments given to build, -1 on a miss
+	};
+
+	// sah bvh over wall segments, 4 wide. for screen columns over a grid
+	// map it is several times slower than VreBsp: fromGrid segments are
+	// about a cell long, so a ray crosses dozens of small leaf boxes before
+	// its hit where the bsp walks front to back and stops at the first
+	// wall. it is for what the bsp does badly, rays in no particular order
+	// like line of sight queries, and segments that move, which refit
+	// follows without a rebuild
+	class VreBvh {
+	public:
+		static constexpr int MAX_LEAF_SEGMENTS = 4;
+		static constexpr int SAH_BINS = 16;
+		// a split only goes to another thread when both halves have at
+		// least this many segments, smaller builds cost less than the
+		// thread. maps under twice this build on one thread whatever
+		// _threads says
+		static constexpr size_t PARALLEL_MIN_SEGMENTS = 4096;
+
+		// _threads 0 uses every hardware thread
+		void build(const std::vector<Segment> &_segments, unsigned int _threads = 0);
+		// segments moved but kept their count and order, e.g. doors and
+		// platforms. bounds are recomputed bottom up, the topology stays
+		void refit(const std::vector<Segment> &_segments);
+
+		BvhHit intersect(const BvhRay &_ray) const;
+		// true if anything blocks the ray before tMax, for line of sight
+		bool occluded(const BvhRay &_ray) const;
+		// 4 rays at once, fastest when they are coherent like neighbouring
+		// screen columns
+		void intersect4(const BvhRay *_rays, BvhHit *_hits) const;
+
+		const std::vector<BvhNode4> &nodes() const { return m_nodes; }
+		size_t segmentCount() const { return m_segments.size(); }
+		bool empty() const { return m_nodes.empty(); }
+
+	private:
+		template<bool AnyHit>
+		BvhHit traverse(const BvhRay &_ray) const;
+
+		std::vector<BvhNode4> m_nodes; // root is node 0, children after parents
+		std::vector<int32_t> m_order; // leaf primitive -> input segment index
+		std::vector<Segment> m_segments; // input segments in leaf order
+		// traversal stack entries the tree needs, from its depth at build.
+		// refit keeps the topology and so the depth
+		int m_stackSize = 1;
+	};
+}
@@ -0,0 +1,41 @@
+#include "VreBvhRenderer.hpp"
+
+#include <algorithm>
+
+vre::VreBvhRenderer::VreBvhRenderer(const VreBvh &_bvh, const std::vector<Segment> &_segments,
+	int _cellSize
+) : m_bvh(&_bvh), m_segments(&_segments), m_cellSize(static_cast<float>(_cellSize)) {
+}
+
+void vre::VreBvhRenderer::castColumns(const RayCamera &_camera, int _firstColumn,
+	int _columnCount, int _screenWidth, RayHit *_out
+) {
+	RayFrustum frustum(_camera, _screenWidth);
+	float invCellSize = 1.0f / m_cellSize;
+
+	for (int i = 0; i < _columnCount; i += 4) {
+		int packetSize = std::min(4, _columnCount - i);
+		BvhRay rays[4];
+		BvhHit hits[4];
+		for (int r = 0; r < 4; r++) {
+			// a short last packet repeats its final column
+			int column = _firstColumn + i + std::min(r, packetSize - 1);
+			rays[r].x = _camera.x;
+			rays[r].y = _camera.y;
+			frustum.direction(column, rays[r].dirX, rays[r].dirY);
+			rays[r].tMax = raycast::NO_HIT_DISTANCE;
+		}
+		m_bvh->intersect4(rays, hits);
+
+		for (int r = 0; r < packetSize; r++) {
+			RayHit &out = _out[i + r];
+			if (hits[r].segment < 0) {
+				out = {};
+				out.distance = raycast::NO_HIT_DISTANCE;
+				continue;
+			}
+			raycast::finishSegmentHit((*m_segments)[hits[r].segment], _camera.x, _camera.y,
+				rays[r].dirX, rays[r].dirY, hits[r].t, hits[r].s, invCellSize, out);
+		}
+	}
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "VreBvh.hpp"
+#include "VreWorldRenderer.hpp"
+
+namespace vre {
+	// segment maps through the bvh, neighbouring columns are traced as
+	// packets of 4 rays
+	class VreBvhRenderer : public VreWorldRenderer {
+	public:
+		VreBvhRenderer(const VreBvh &_bvh, const std::vector<Segment> &_segments, int _cellSize);
+
+		void castColumns(const RayCamera &_camera, int _firstColumn,
+			int _columnCount, int _screenWidth, RayHit *_out) override;
+
+		const char *name() const override { return "bvh"; }
+
+	private:
+		const VreBvh *m_bvh;
+		const std::vector<Segment> *m_segments; // what the bvh was built from
+		float m_cellSize;
+	};
+}
@@ -0,0 +1,108 @@
+#include "VreColorFramebuffer.hpp"
+
+#include <stdexcept>
+
+vre::VreColorFramebuffer::VreColorFramebuffer(VreDevice &_device, uint32_t _width,
+	uint32_t _height
+) : m_vreDevice{ _device }, m_width{ _width }, m_height{ _height } {
+	createDrawImage();
+	createFrameResources();
+}
+
+vre::VreColorFramebuffer::~VreColorFramebuffer() {
+	VkDevice device = m_vreDevice.device();
+
+	for (FrameResources &frame : m_frames) {
+		vkUnmapMemory(device, frame.stagingMemory);
+		vkDestroyBuffer(device, frame.staging, nullptr);
+		vkFreeMemory(device, frame.stagingMemory, nullptr);
+	}
+
+	vkDestroyImage(device, m_drawImage, nullptr);
+	vkFreeMemory(device, m_drawImageMemory, nullptr);
+}
+
+void vre::VreColorFramebuffer::record(VkCommandBuffer _cmd, size_t _frame,
+	VkImage _target, VkExtent2D _targetExtent
+) {
+	// the whole draw image is overwritten, its old contents are not needed
+	VkImageMemoryBarrier copyBarrier{};
+	copyBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	copyBarrier.srcAccessMask = 0;
+	copyBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	copyBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	copyBarrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	copyBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	copyBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	copyBarrier.image = m_drawImage;
+	copyBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+	vkCmdPipelineBarrier(_cmd, VK_PIPELINE_STAGE_TRANSFER_BIT,
+		VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &copyBarrier);
+
+	VkBufferImageCopy copy{};
+	copy.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+	copy.imageExtent = { m_width, m_height, 1 };
+	vkCmdCopyBufferToImage(_cmd, m_frames[_frame].staging, m_drawImage,
+		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copy);
+
+	// the swapchain image waits on the acquire semaphore, which is signalled
+	// at the color attachment output stage
+	VkImageMemoryBarrier blitBarriers[2]{};
+	blitBarriers[0] = copyBarrier;
+	blitBarriers[0].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	blitBarriers[0].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+	blitBarriers[0].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	blitBarriers[0].newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+
+	blitBarriers[1] = copyBarrier;
+	blitBarriers[1].image = _target;
+
+	vkCmdPipelineBarrier(_cmd, VK_PIPELINE_STAGE_TRANSFER_BIT
+		| VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+		VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 2, blitBarriers);
+
+	VkImageBlit blit{};
+	blit.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+	blit.srcOffsets[1] = { static_cast<int32_t>(m_width), static_cast<int32_t>(m_height), 1 };
+	blit.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+	blit.dstOffsets[1] = { static_cast<int32_t>(_targetExtent.width),
+		static_cast<int32_t>(_targetExtent.height), 1 };
+
+	// the image is smooth already, filter when scaling to the window
+	vkCmdBlitImage(_cmd, m_drawImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+		_target, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+}
+
+void vre::VreColorFramebuffer::createDrawImage() {
+	VkImageCreateInfo imageInfo{};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.extent.width = m_width;
+	imageInfo.extent.height = m_height;
+	imageInfo.extent.depth = 1;
+	imageInfo.mipLevels = 1;
+	imageInfo.arrayLayers = 1;
+	imageInfo.format = VK_FORMAT_R16G16B16A16_SFLOAT;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	imageInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	m_vreDevice.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		m_drawImage, m_drawImageMemory);
+}
+
+void vre::VreColorFramebuffer::createFrameResources() {
+	for (FrameResources &frame : m_frames) {
+		// stays mapped for the lifetime of the framebuffer
+		m_vreDevice.createBuffer(frameBytes(), VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			frame.staging, frame.stagingMemory);
+		if (vkMapMemory(m_vreDevice.device(), frame.stagingMemory, 0, frameBytes(), 0,
+			&frame.mapped) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to map color staging buffer");
+		}
+	}
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include <vulkan/vulkan.h>
+
+#include "VreDevice.hpp"
+#include "VreSwapchain.hpp"
+
+namespace vre {
+	// gpu side of cpu renderers that produce full colour, like the path
+	// tracer. every frame in flight owns a mapped staging buffer in the
+	// rgba16f layout of the draw image, it is copied straight into the draw
+	// image and blitted to the swapchain image at its own resolution
+	class VreColorFramebuffer {
+	public:
+		VreColorFramebuffer(VreDevice &_device, uint32_t _width, uint32_t _height);
+		~VreColorFramebuffer();
+
+		VreColorFramebuffer(const VreColorFramebuffer &) = delete;
+		VreColorFramebuffer &operator=(const VreColorFramebuffer &) = delete;
+
+		// width() * height() * 4 halves, write the frame here directly
+		uint16_t *mapped(size_t _frame) { return static_cast<uint16_t *>(m_frames[_frame].mapped); }
+
+		// records the copy into the draw image and the scaled blit. _target
+		// ends up in TRANSFER_DST_OPTIMAL, ready for the swapchain render pass
+		void record(VkCommandBuffer _cmd, size_t _frame, VkImage _target,
+			VkExtent2D _targetExtent);
+
+		uint32_t width() const { return m_width; }
+		uint32_t height() const { return m_height; }
+		VkDeviceSize frameBytes() const { return static_cast<VkDeviceSize>(m_width) * m_height * 8; }
+
+	private:
+		struct FrameResources {
+			VkBuffer staging = VK_NULL_HANDLE;
+			VkDeviceMemory stagingMemory = VK_NULL_HANDLE;
+			void *mapped = nullptr;
+		};
+
+		void createDrawImage();
+		void createFrameResources();
+
+		VreDevice &m_vreDevice;
+		uint32_t m_width;
+		uint32_t m_height;
+
+		VkImage m_drawImage = VK_NULL_HANDLE;
+		VkDeviceMemory m_drawImageMemory = VK_NULL_HANDLE;
+
+		std::array<FrameResources, VreSwapchain::MAX_FRAMES_IN_FLIGHT> m_frames;
+	};
+}
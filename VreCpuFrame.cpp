@@ -0,0 +1,38 @@
+#include "VreCpuFrame.hpp"
+
+#include <algorithm>
+
+int vre::CpuFrame::wallLight(float _distance, float _cellSize, int _side) {
+	int light = static_cast<int>(_distance / (_cellSize * 1.5f)) + _side;
+	return std::min(light, VrePalette::SHADES - 1);
+}
+
+vre::WallColumn vre::CpuFrame::wallColumn(const RayHit &_hit, float _cellSize, float _focal) const {
+	if (_hit.cell == 0) {
+		return { 0, 0, 0 };
+	}
+
+	int half = height / 2;
+	int lineHeight = static_cast<int>(_cellSize * _focal / std::max(_hit.distance, 1.0f));
+	WallColumn column;
+	column.top = std::max(half - lineHeight / 2, 0);
+	column.bottom = std::min(half + lineHeight / 2, height);
+	column.index = palette->shade(VrePalette::index(VrePalette::wallRamp(_hit.cell),
+		VrePalette::SHADES - 1), wallLight(_hit.distance, _cellSize, _hit.side));
+	return column;
+}
+
+void vre::CpuFrame::compositeLayers(const RayLayers &_layers, float _cellSize,
+	float _focal, uint8_t *_column, size_t _rowStep, int _y0, int _y1
+) const {
+	// farthest first so nearer panes tint what is behind them
+	for (int i = _layers.count - 1; i >= 0; i--) {
+		WallColumn layer = wallColumn(_layers.hits[i], _cellSize, _focal);
+		int y1 = std::min(layer.bottom, _y1);
+		uint8_t *pixel = _column + static_cast<size_t>(std::max(layer.top, _y0)) * _rowStep;
+		for (int y = std::max(layer.top, _y0); y < y1; y++) {
+			*pixel = palette->blend(*pixel, layer.index);
+			pixel += _rowStep;
+		}
+	}
+}
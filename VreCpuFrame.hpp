@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "VreRaycaster.hpp"
+#include "VrePalette.hpp"
+
+namespace vre {
+	// vertical extent of the wall in one column, the rest of the column
+	// is ceiling above and floor below
+	struct WallColumn {
+		int top;
+		int bottom;
+		uint8_t index;
+	};
+
+	// the buffers of VreCpuRenderer that its mode renderers draw into,
+	// handed to them for one frame, and the wall shading they all share
+	struct CpuFrame {
+		const VrePalette *palette;
+		uint8_t *pixels; // row major, stride bytes per row
+		uint8_t *columnPixels; // column major, columnStride bytes per column
+		const uint8_t *background; // ceiling or floor index per row
+		int width;
+		int height;
+		int stride;
+		int columnStride;
+
+		WallColumn wallColumn(const RayHit &_hit, float _cellSize, float _focal) const;
+		// blends the layers of one column into rows [_y0, _y1), _column
+		// points at row 0 of the column and rows are _rowStep bytes apart
+		void compositeLayers(const RayLayers &_layers, float _cellSize, float _focal,
+			uint8_t *_column, size_t _rowStep, int _y0, int _y1) const;
+
+		// light level for a distance in world units, one shade per cell and
+		// a half, horizontal faces one shade darker like the old column
+		// renderers
+		static int wallLight(float _distance, float _cellSize, int _side);
+	};
+}
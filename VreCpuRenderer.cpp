@@ -0,0 +1,235 @@
+#include "VreCpuRenderer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VRE_CPU_SSE 1
+#include <emmintrin.h>
+#else
+#define VRE_CPU_SSE 0
+#endif
+
+namespace {
+#if VRE_CPU_SSE
+	// 16 columns of 16 bytes at _source, _sourceStride apart, become 16 rows
+	// at _out, _outStride apart. four rounds of interleaving leave register
+	// i holding row bitreverse(i)
+	void transposeBlock(const uint8_t *_source, int _sourceStride, uint8_t *_out, int _outStride) {
+		static constexpr int ROW_OF_REGISTER[16] = { 0, 8, 4, 12, 2, 10, 6, 14, 1, 9, 5, 13, 3, 11, 7, 15 };
+		__m128i a[16];
+		__m128i t[16];
+		for (int i = 0; i < 16; i++) {
+			a[i] = _mm_loadu_si128(reinterpret_cast<const __m128i *>(_source + static_cast<size_t>(i) * _sourceStride));
+		}
+		for (int i = 0; i < 8; i++) {
+			t[i] = _mm_unpacklo_epi8(a[2 * i], a[2 * i + 1]);
+			t[i + 8] = _mm_unpackhi_epi8(a[2 * i], a[2 * i + 1]);
+		}
+		for (int i = 0; i < 8; i++) {
+			a[i] = _mm_unpacklo_epi16(t[2 * i], t[2 * i + 1]);
+			a[i + 8] = _mm_unpackhi_epi16(t[2 * i], t[2 * i + 1]);
+		}
+		for (int i = 0; i < 8; i++) {
+			t[i] = _mm_unpacklo_epi32(a[2 * i], a[2 * i + 1]);
+			t[i + 8] = _mm_unpackhi_epi32(a[2 * i], a[2 * i + 1]);
+		}
+		for (int i = 0; i < 8; i++) {
+			a[i] = _mm_unpacklo_epi64(t[2 * i], t[2 * i + 1]);
+			a[i + 8] = _mm_unpackhi_epi64(t[2 * i], t[2 * i + 1]);
+		}
+		for (int i = 0; i < 16; i++) {
+			_mm_store_si128(reinterpret_cast<__m128i *>(_out + static_cast<size_t>(ROW_OF_REGISTER[i]) * _outStride), a[i]);
+		}
+	}
+#endif
+}
+
+void vre::VreCpuRenderer::resize(int _width, int _height) {
+	m_width = _width;
+	m_height = _height;
+	m_stride = (_width + 3) & ~3;
+	m_pixels.assign(static_cast<size_t>(m_stride) * _height, 0);
+
+	m_background.resize(_height);
+	for (int y = 0; y < _height; y++) {
+		m_background[y] = backgroundIndex(y);
+	}
+	m_tiled.resize(_width);
+	m_columnStride = (_height + 15) & ~15;
+	m_columnPixels.assign(static_cast<size_t>(m_columnStride) * _width, 0);
+}
+
+vre::CpuFrame vre::VreCpuRenderer::frame() {
+	return { &m_palette, m_pixels.data(), m_columnPixels.data(), m_background.data(),
+		m_width, m_height, m_stride, m_columnStride };
+}
+
+uint8_t vre::VreCpuRenderer::backgroundIndex(int _y) const {
+	// ceiling and floor get darker towards the horizon
+	int half = m_height / 2;
+	bool ceiling = _y < half;
+	int fromHorizon = ceiling ? half - _y : _y - half;
+	int light = VrePalette::SHADES - 1 - std::min(fromHorizon * 2 * VrePalette::SHADES
+		/ std::max(m_height, 1), VrePalette::SHADES - 1);
+	return m_palette.shade(VrePalette::index(ceiling ? VrePalette::RAMP_CEILING
+		: VrePalette::RAMP_FLOOR, VrePalette::SHADES - 1), light);
+}
+
+void vre::VreCpuRenderer::render(const RayCamera &_camera, float _cellSize,
+	const RayHit *_hits, const RayLayers *_layers
+) {
+	uint8_t identity[256];
+	for (int i = 0; i < 256; i++) {
+		identity[i] = static_cast<uint8_t>(i);
+	}
+	draw(_camera, _cellSize, _hits, identity, m_pixels.data());
+
+	if (_layers != nullptr) {
+		CpuFrame target = frame();
+		float focal = m_width * 0.5f / std::tan(_camera.fov * 0.5f);
+		for (int x = 0; x < m_width; x++) {
+			target.compositeLayers(_layers[x], _cellSize, focal, m_pixels.data() + x, m_stride, 0, m_height);
+		}
+	}
+}
+
+void vre::VreCpuRenderer::renderRgba(const RayCamera &_camera, float _cellSize,
+	const RayHit *_hits, uint32_t *_out
+) {
+	draw(_camera, _cellSize, _hits, m_palette.colors(), _out);
+}
+
+void vre::VreCpuRenderer::renderTiled(const VreRaycaster &_raycaster,
+	const RayCamera &_camera, VreThreadPool &_pool, CpuTileOptions _options
+) {
+	m_tiled.render(frame(), _raycaster, _camera, _pool, _options);
+}
+
+void vre::VreCpuRenderer::renderInterlaced(const VreRaycaster &_raycaster,
+	const RayCamera &_camera, VreThreadPool &_pool, CpuTileOptions _options,
+	CpuInterlaceOptions _interlace
+) {
+	m_tiled.renderInterlaced(frame(), _raycaster, _camera, _pool, _options, _interlace);
+}
+
+void vre::VreCpuRenderer::renderColumnMajor(const RayCamera &_camera, float _cellSize,
+	const RayHit *_hits, const RayLayers *_layers
+) {
+	CpuFrame target = frame();
+	float focal = m_width * 0.5f / std::tan(_camera.fov * 0.5f);
+	const uint8_t *background = m_background.data();
+
+	// ceiling, wall and floor are three contiguous runs per column
+	for (int x = 0; x < m_width; x++) {
+		WallColumn column = target.wallColumn(_hits[x], _cellSize, focal);
+		uint8_t *out = m_columnPixels.data() + static_cast<size_t>(x) * m_columnStride;
+		if (column.bottom <= column.top) {
+			memcpy(out, background, static_cast<size_t>(m_height));
+		} else {
+			memcpy(out, background, static_cast<size_t>(column.top));
+			memset(out + column.top, column.index, static_cast<size_t>(column.bottom - column.top));
+			memcpy(out + column.bottom, background + column.bottom,
+				static_cast<size_t>(m_height - column.bottom));
+		}
+		if (_layers != nullptr) {
+			target.compositeLayers(_layers[x], _cellSize, focal, out, 1, 0, m_height);
+		}
+	}
+}
+
+void vre::VreCpuRenderer::transposeTo(uint8_t *_out, VreThreadPool &_pool) const {
+	constexpr int BAND = 64;
+	int bands = (m_height + BAND - 1) / BAND;
+
+	// 64x64 pixel tiles, one row band per task. a tile reads whole 64 byte
+	// lines of 64 columns and writes whole lines of 64 rows, so neither
+	// side strides across the frame and the tlb only sees a few pages
+	_pool.parallelFor(bands, [&](int _band) {
+		int y0 = _band * BAND;
+		int y1 = std::min(y0 + BAND, m_height);
+		int fullRows = y0 + ((y1 - y0) & ~15); // rows covered by whole 16 row blocks
+		int x = 0;
+#if VRE_CPU_SSE
+		// 16x16 blocks are transposed in registers, four of them fill a line
+		// per row. whole lines go out together so the write combining
+		// buffers never flush half a line
+		alignas(64) uint8_t block[16][64];
+		for (; x + 64 <= m_width; x += 64) {
+			// the column jumps defeat the hardware prefetcher, ask for the
+			// next tile's lines while this one is transposed
+			for (int column = x + 64; column < std::min(x + 128, m_width); column++) {
+				const char *next = reinterpret_cast<const char *>(m_columnPixels.data())
+					+ static_cast<size_t>(column) * m_columnStride + y0;
+				_mm_prefetch(next, _MM_HINT_T0);
+				_mm_prefetch(next + BAND - 1, _MM_HINT_T0);
+			}
+			for (int y = y0; y < fullRows; y += 16) {
+				for (int part = 0; part < 4; part++) {
+					transposeBlock(m_columnPixels.data() + static_cast<size_t>(x + part * 16) * m_columnStride + y,
+						m_columnStride, &block[0][part * 16], 64);
+				}
+				for (int i = 0; i < 16; i++) {
+					uint8_t *row = _out + static_cast<size_t>(y + i) * m_stride + x;
+					const __m128i *source = reinterpret_cast<const __m128i *>(block[i]);
+					// streaming stores skip the cache, the staging memory is
+					// write combined and never read on the cpu
+					if ((reinterpret_cast<uintptr_t>(row) & 15) == 0) {
+						for (int part = 0; part < 4; part++) {
+							_mm_stream_si128(reinterpret_cast<__m128i *>(row) + part, _mm_load_si128(source + part));
+						}
+					} else {
+						memcpy(row, block[i], 64);
+					}
+				}
+			}
+		}
+		_mm_sfence();
+#else
+		fullRows = y0;
+#endif
+		// right edge of the whole blocks, then every column of the rows left
+		for (int y = y0; y < y1; y++) {
+			uint8_t *row = _out + static_cast<size_t>(y) * m_stride;
+			for (int column = y < fullRows ? x : 0; column < m_width; column++) {
+				row[column] = m_columnPixels[static_cast<size_t>(column) * m_columnStride + y];
+			}
+		}
+	});
+}
+
+void vre::VreCpuRenderer::renderStacked(const VreMap &_map, const RayCamera &_camera,
+	VreThreadPool &_pool, float _eyeHeight
+) {
+	m_stacked.render(frame(), _map, _camera, _pool, _eyeHeight);
+}
+
+void vre::VreCpuRenderer::renderTerrain(const VreTerrain &_terrain,
+	const TerrainCamera &_camera, VreThreadPool &_pool, TerrainSettings _settings
+) {
+	m_terrain.render(frame(), _terrain, _camera, _pool, _settings);
+}
+
+template<typename Pixel>
+void vre::VreCpuRenderer::draw(const RayCamera &_camera, float _cellSize,
+	const RayHit *_hits, const Pixel *_lookup, Pixel *_out
+) {
+	CpuFrame target = frame();
+	float focal = m_width * 0.5f / std::tan(_camera.fov * 0.5f);
+
+	// one fill per row for ceiling and floor
+	for (int y = 0; y < m_height; y++) {
+		std::fill_n(_out + static_cast<size_t>(y) * m_stride, m_width, _lookup[m_background[y]]);
+	}
+
+	for (int x = 0; x < m_width; x++) {
+		WallColumn column = target.wallColumn(_hits[x], _cellSize, focal);
+		Pixel color = _lookup[column.index];
+		Pixel *pixel = _out + static_cast<size_t>(column.top) * m_stride + x;
+		for (int y = column.top; y < column.bottom; y++) {
+			*pixel = color;
+			pixel += m_stride;
+		}
+	}
+}
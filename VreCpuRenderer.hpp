@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "VreRaycaster.hpp"
+#include "VrePalette.hpp"
+#include "VreCpuFrame.hpp"
+#include "VreTiledRenderer.hpp"
+#include "VreStackedRenderer.hpp"
+#include "VreTerrainRenderer.hpp"
+#include "VreThreadPool.hpp"
+
+namespace vre {
+	// software renderer for the grid, turns one RayHit per column into an
+	// 8 bit indexed frame. rows are padded to a multiple of 4 bytes so the
+	// gpu can read them as uints. owns the frame buffers, the tiled,
+	// stacked and terrain modes are drawn into them by their own renderers
+	class VreCpuRenderer {
+	public:
+		void resize(int _width, int _height);
+
+		// _hits holds width() entries, cast with the same camera. _layers is
+		// optional, also width() entries, and blends the see through walls
+		// of every column over it back to front
+		void render(const RayCamera &_camera, float _cellSize, const RayHit *_hits,
+			const RayLayers *_layers = nullptr);
+		// same frame written as rgba8 straight from the palette, this is
+		// what a 32 bit backend would have to write and upload. _out holds
+		// stride() * height() pixels
+		void renderRgba(const RayCamera &_camera, float _cellSize, const RayHit *_hits,
+			uint32_t *_out);
+
+		// casts and draws the indexed frame in column bands x row bands on
+		// _pool. every column band casts its rays once, then each tile writes
+		// its rows left to right so the framebuffer lines it touches stay in
+		// cache instead of striding a full row per pixel like render does.
+		// see through walls are cast and blended when the map has any
+		void renderTiled(const VreRaycaster &_raycaster, const RayCamera &_camera,
+			VreThreadPool &_pool, CpuTileOptions _options = {});
+
+		// renderTiled casting every other column, the other half each frame.
+		// the columns left out take the last frame's hits moved into the new
+		// pose, spans between neighbouring hits on one wall face are filled
+		// in perspective. a reprojected column is kept only where a column
+		// cast this frame next to it sees the same face at about the same
+		// distance, the rest are cast after all. the first frame, fast turns
+		// or moves and maps with see through walls cast everything, as do a
+		// few frames after one that had to cast most of its other half. it
+		// only saves the casting, so it pays where long rays make that a
+		// large part of the frame, not where filling the pixels dominates
+		void renderInterlaced(const VreRaycaster &_raycaster, const RayCamera &_camera,
+			VreThreadPool &_pool, CpuTileOptions _options = {}, CpuInterlaceOptions _interlace = {});
+		// columns the last renderTiled or renderInterlaced cast
+		int lastCastColumns() const { return m_tiled.lastCastColumns(); }
+		// columns the last frame supersampled, see CpuTileOptions::edgeSamples
+		int lastEdgeColumns() const { return m_tiled.lastEdgeColumns(); }
+
+		// draws into a column major buffer instead, every column is one
+		// contiguous run of columnStride() bytes. transposeTo then writes the
+		// row major frame, stride() * height() bytes, in 16x16 blocks with
+		// non temporal stores, meant to go straight into mapped staging
+		// memory that the cpu never reads back
+		void renderColumnMajor(const RayCamera &_camera, float _cellSize, const RayHit *_hits,
+			const RayLayers *_layers = nullptr);
+		void transposeTo(uint8_t *_out, VreThreadPool &_pool) const;
+
+		// column major frame of a map with CellHeights, transposeTo
+		// afterwards. every column walks front to back past short walls and
+		// steps, keeping the still open rows as one range that each floor,
+		// ceiling, riser and wall face narrows from the bottom or the top, so
+		// every pixel is written exactly once. the eye sits _eyeHeight cells
+		// above the floor of the camera cell. flat maps give the same frame
+		// as renderColumnMajor
+		void renderStacked(const VreMap &_map, const RayCamera &_camera, VreThreadPool &_pool,
+			float _eyeHeight = 0.5f);
+
+		// outdoor mode, voxel space terrain into the column major buffer,
+		// transposeTo afterwards. every column marches front to back with
+		// steps that grow with distance and only draws the rows above the
+		// highest point so far, so every pixel is written once
+		void renderTerrain(const VreTerrain &_terrain, const TerrainCamera &_camera,
+			VreThreadPool &_pool, TerrainSettings _settings = {});
+		const uint8_t *columnPixels() const { return m_columnPixels.data(); }
+		int columnStride() const { return m_columnStride; }
+
+		const uint8_t *pixels() const { return m_pixels.data(); }
+		size_t sizeBytes() const { return m_pixels.size(); }
+		int width() const { return m_width; }
+		int height() const { return m_height; }
+		int stride() const { return m_stride; }
+		// first wall row and the row after the wall per column, only filled
+		// by the tiled renderers
+		const int16_t *columnTops() const { return m_tiled.columnTops(); }
+		const int16_t *columnBottoms() const { return m_tiled.columnBottoms(); }
+
+		const VrePalette &palette() const { return m_palette; }
+
+	private:
+		// the buffers below, for the mode renderers and the shared shading
+		CpuFrame frame();
+		uint8_t backgroundIndex(int _y) const;
+
+		template<typename Pixel>
+		void draw(const RayCamera &_camera, float _cellSize, const RayHit *_hits,
+			const Pixel *_lookup, Pixel *_out);
+
+		VrePalette m_palette;
+		VreTiledRenderer m_tiled;
+		VreStackedRenderer m_stacked;
+		VreTerrainRenderer m_terrain;
+		std::vector<uint8_t> m_pixels;
+		std::vector<uint8_t> m_background; // ceiling or floor index per row
+		std::vector<uint8_t> m_columnPixels;
+		int m_columnStride = 0; // height rounded up to whole 16 row blocks
+		int m_width = 0;
+		int m_height = 0;
+		int m_stride = 0;
+	};
+}
@@ -1,5 +1,7 @@
 #include "VreDevice.hpp"
 
+#include <cstring>
+
 namespace vreDebug {
     // local callback functions
     static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(
@@ -359,15 +361,38 @@ void vre::VreDevice::createLogicalDevice() {
     VkPhysicalDeviceFeatures deviceFeatures = {};
     deviceFeatures.samplerAnisotropy = VK_TRUE;
 
+    // present id and wait let the swapchain time frames up to the end of
+    // their present, optional since not every driver or platform has them
+    std::vector<const char *> extensions = deviceExtensions;
+    VkPhysicalDevicePresentIdFeaturesKHR presentIdFeatures = {};
+    presentIdFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR;
+    VkPhysicalDevicePresentWaitFeaturesKHR presentWaitFeatures = {};
+    presentWaitFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR;
+    bool presentWait = false;
+    if (hasDeviceExtension(m_physicalDevice, VK_KHR_PRESENT_ID_EXTENSION_NAME)
+        && hasDeviceExtension(m_physicalDevice, VK_KHR_PRESENT_WAIT_EXTENSION_NAME)) {
+        presentIdFeatures.pNext = &presentWaitFeatures;
+        VkPhysicalDeviceFeatures2 features2 = {};
+        features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        features2.pNext = &presentIdFeatures;
+        vkGetPhysicalDeviceFeatures2(m_physicalDevice, &features2);
+        presentWait = presentIdFeatures.presentId && presentWaitFeatures.presentWait;
+    }
+
     VkDeviceCreateInfo createInfo = {};
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
 
     createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
     createInfo.pQueueCreateInfos = queueCreateInfos.data();
 
+    if (presentWait) {
+        extensions.push_back(VK_KHR_PRESENT_ID_EXTENSION_NAME);
+        extensions.push_back(VK_KHR_PRESENT_WAIT_EXTENSION_NAME);
+        createInfo.pNext = &presentIdFeatures;
+    }
     createInfo.pEnabledFeatures = &deviceFeatures;
-    createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-    createInfo.ppEnabledExtensionNames = deviceExtensions.data();
+    createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+    createInfo.ppEnabledExtensionNames = extensions.data();
 
     // might not really be necessary anymore because device specific validation layers
     // have been deprecated
@@ -384,6 +409,11 @@ void vre::VreDevice::createLogicalDevice() {
 
     vkGetDeviceQueue(m_device, indices.graphicsFamily, 0, &m_graphicsQueue);
     vkGetDeviceQueue(m_device, indices.presentFamily, 0, &m_presentQueue);
+
+    if (presentWait) {
+        m_waitForPresent = reinterpret_cast<PFN_vkWaitForPresentKHR>(
+            vkGetDeviceProcAddr(m_device, "vkWaitForPresentKHR"));
+    }
 }
 
 void vre::VreDevice::createCommandPool() {
@@ -558,6 +588,21 @@ bool vre::VreDevice::checkDeviceExtensionSupport(VkPhysicalDevice _device) {
     return requiredExtensions.empty();
 }
 
+bool vre::VreDevice::hasDeviceExtension(VkPhysicalDevice _device, const char *_name) {
+    uint32_t extensionCount;
+    vkEnumerateDeviceExtensionProperties(_device, nullptr, &extensionCount, nullptr);
+
+    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(_device, nullptr, &extensionCount, availableExtensions.data());
+
+    for (const auto &extension : availableExtensions) {
+        if (std::strcmp(extension.extensionName, _name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
 vre::SwapchainSupportDetails vre::VreDevice::querySwapchainSupport(VkPhysicalDevice _device) {
     SwapchainSupportDetails details;
     vkGetPhysicalDeviceSurfaceCapabilitiesKHR(_device, m_surface, &details.capabilities);
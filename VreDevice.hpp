@@ -45,9 +45,15 @@ namespace vre {
 
 		VkCommandPool getCommandPool() { return m_commandPool; }
 		VkDevice device() { return m_device; }
+		VkInstance instance() { return m_instance; }
+		VkPhysicalDevice physicalDevice() { return m_physicalDevice; }
 		VkSurfaceKHR surface() { return m_surface; }
 		VkQueue graphicsQueue() { return m_graphicsQueue; }
 		VkQueue presentQueue() { return m_presentQueue; }
+		// VK_KHR_present_id and VK_KHR_present_wait, enabled when the device
+		// has both. waitForPresent is null otherwise
+		bool hasPresentWait() const { return m_waitForPresent != nullptr; }
+		PFN_vkWaitForPresentKHR waitForPresent() const { return m_waitForPresent; }
 
 		SwapchainSupportDetails getSwapChainSupport() { return querySwapchainSupport(m_physicalDevice); }
 		uint32_t findMemoryType(uint32_t _typeFilter, VkMemoryPropertyFlags _properties);
@@ -95,6 +101,7 @@ namespace vre {
 
 		VkQueue m_graphicsQueue;
 		VkQueue m_presentQueue;
+		PFN_vkWaitForPresentKHR m_waitForPresent = nullptr;
 
 		// helper functions
 		bool isDeviceSuitable(VkPhysicalDevice _device);
@@ -111,6 +118,8 @@ namespace vre {
 		
 		bool checkDeviceExtensionSupport(VkPhysicalDevice _device);
 
+		bool hasDeviceExtension(VkPhysicalDevice _device, const char *_name);
+
 		SwapchainSupportDetails querySwapchainSupport(VkPhysicalDevice _device);
 	};
 }
\ No newline at end of file
@@ -0,0 +1,240 @@
+#include "VreFloorCaster.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VRE_FLOOR_SSE 1
+#include <emmintrin.h>
+#else
+#define VRE_FLOOR_SSE 0
+#endif
+
+namespace {
+	constexpr int TEXEL_MASK = vre::VreFloorCaster::SIZE - 1;
+	// texel positions along a row are stepped as 8.24 fixed point. 2^32 is
+	// a whole number of textures, so wrapping around is the texture repeating
+	constexpr int FRACTION_BITS = 32 - vre::VreFloorCaster::TEXTURE_BITS;
+
+	// _texels modulo the texture size as fixed point
+	uint32_t toFixed(double _texels) {
+		double wrapped = _texels - std::floor(_texels / vre::VreFloorCaster::SIZE) * vre::VreFloorCaster::SIZE;
+		return static_cast<uint32_t>(static_cast<uint64_t>(wrapped * (1u << FRACTION_BITS)));
+	}
+
+	// bits 0..7 of _v moved to the even bits 0..14
+	uint32_t spreadBits(uint32_t _v) {
+		_v = (_v | (_v << 4)) & 0x0F0Fu;
+		_v = (_v | (_v << 2)) & 0x3333u;
+		return (_v | (_v << 1)) & 0x5555u;
+	}
+
+	uint32_t mortonIndex(int _u, int _v) {
+		return spreadBits(static_cast<uint32_t>(_u)) | (spreadBits(static_cast<uint32_t>(_v)) << 1);
+	}
+
+#if VRE_FLOOR_SSE
+	__m128i spreadBits(__m128i _v) {
+		_v = _mm_and_si128(_mm_or_si128(_v, _mm_slli_epi32(_v, 4)), _mm_set1_epi32(0x0F0F));
+		_v = _mm_and_si128(_mm_or_si128(_v, _mm_slli_epi32(_v, 2)), _mm_set1_epi32(0x3333));
+		return _mm_and_si128(_mm_or_si128(_v, _mm_slli_epi32(_v, 1)), _mm_set1_epi32(0x5555));
+	}
+
+	// morton addresses of 4 fixed point texel positions
+	__m128i mortonIndex(__m128i _u, __m128i _v) {
+		__m128i u = _mm_srli_epi32(_u, FRACTION_BITS);
+		__m128i v = _mm_srli_epi32(_v, FRACTION_BITS);
+		return _mm_or_si128(spreadBits(u), _mm_slli_epi32(spreadBits(v), 1));
+	}
+#endif
+
+	// the walls' light for a distance, one shade per cell and a half
+	int flatLight(float _distance, float _cellSize) {
+		return std::min(static_cast<int>(_distance / (_cellSize * 1.5f)), vre::VrePalette::SHADES - 1);
+	}
+
+	uint32_t hashTexel(uint32_t _x, uint32_t _y, uint32_t _seed) {
+		uint32_t h = _x * 0x8DA6B343u ^ _y * 0xD8163841u ^ _seed * 0xCB1AB31Fu;
+		h ^= h >> 13;
+		h *= 0x85EBCA6Bu;
+		return h ^ (h >> 16);
+	}
+}
+
+vre::VreFloorCaster::VreFloorCaster() {
+	constexpr int TILE = SIZE / 4;
+	constexpr int PANEL = SIZE / 2;
+	std::vector<uint8_t> floor(SIZE * SIZE);
+	std::vector<uint8_t> ceiling(SIZE * SIZE);
+	for (int v = 0; v < SIZE; v++) {
+		for (int u = 0; u < SIZE; u++) {
+			// 4x4 stone tiles with dark grout, every tile its own shade
+			int tu = u % TILE;
+			int tv = v % TILE;
+			int shade = 0;
+			if (tu < 2 || tv < 2) {
+				shade = 6;
+			} else {
+				shade = 11 + static_cast<int>(hashTexel(u / TILE, v / TILE, 1) % 4)
+					- static_cast<int>(hashTexel(u, v, 2) % 3 == 0);
+			}
+			floor[v * SIZE + u] = VrePalette::index(VrePalette::RAMP_FLOOR, shade);
+
+			// 2x2 panels, lit from the top left edge and shadowed on the other
+			int pu = u % PANEL;
+			int pv = v % PANEL;
+			if (pu < 3 || pv < 3) {
+				shade = 15;
+			} else if (pu >= PANEL - 3 || pv >= PANEL - 3) {
+				shade = 8;
+			} else {
+				shade = 12 + static_cast<int>(hashTexel(u, v, 3) % 2);
+			}
+			ceiling[v * SIZE + u] = VrePalette::index(VrePalette::RAMP_CEILING, shade);
+		}
+	}
+	setTexture(false, floor.data());
+	setTexture(true, ceiling.data());
+}
+
+void vre::VreFloorCaster::setTexture(bool _ceiling, const uint8_t *_texels) {
+	std::vector<uint8_t> &rows = m_rowMajor[_ceiling ? 1 : 0];
+	std::vector<uint8_t> &morton = m_morton[_ceiling ? 1 : 0];
+	rows.assign(_texels, _texels + SIZE * SIZE);
+	morton.resize(SIZE * SIZE);
+	for (int v = 0; v < SIZE; v++) {
+		for (int u = 0; u < SIZE; u++) {
+			morton[mortonIndex(u, v)] = _texels[v * SIZE + u];
+		}
+	}
+}
+
+vre::FlatView vre::VreFloorCaster::view(const RayCamera &_camera, float _cellSize,
+	int _width, int _height
+) const {
+	RayFrustum frustum(_camera, _width);
+	FlatView view;
+	view.texelsPerUnit = SIZE / _cellSize;
+	view.x = _camera.x * view.texelsPerUnit;
+	view.y = _camera.y * view.texelsPerUnit;
+	view.dirX = frustum.m_dirX;
+	view.dirY = frustum.m_dirY;
+	view.planeX = frustum.m_planeX;
+	view.planeY = frustum.m_planeY;
+	view.eye = _cellSize * 0.5f * (_width * 0.5f / std::tan(_camera.fov * 0.5f));
+	view.cellSize = _cellSize;
+	view.width = _width;
+	view.half = _height / 2;
+	return view;
+}
+
+void vre::VreFloorCaster::setView(const RayCamera &_camera, float _cellSize, int _width,
+	int _height
+) {
+	m_view = view(_camera, _cellSize, _width, _height);
+}
+
+void vre::VreFloorCaster::castRow(const FlatView &_view, const VrePalette &_palette, int _y,
+	int _x0, int _x1, uint8_t *_row, const int16_t *_tops, const int16_t *_bottoms
+) const {
+	bool ceiling = _y < _view.half;
+	const uint8_t *texels = m_morton[ceiling ? 1 : 0].data();
+	float distance = _view.eye / std::abs(static_cast<float>(_y - _view.half) + 0.5f);
+	int light = flatLight(distance, _view.cellSize);
+
+	// texel position of pixel x is start + x * step, set up in double
+	// since far rows step many textures per pixel
+	double scale = static_cast<double>(distance) * _view.texelsPerUnit;
+	double invWidth = 2.0 / _view.width;
+	double cameraX = (_x0 + 0.5) * invWidth - 1.0;
+	uint32_t u0 = toFixed(_view.x + scale * (_view.dirX + _view.planeX * cameraX));
+	uint32_t v0 = toFixed(_view.y + scale * (_view.dirY + _view.planeY * cameraX));
+	uint32_t stepU = toFixed(scale * _view.planeX * invWidth);
+	uint32_t stepV = toFixed(scale * _view.planeY * invWidth);
+
+	int x = _x0;
+#if VRE_FLOOR_SSE
+	__m128i u = _mm_setr_epi32(static_cast<int>(u0), static_cast<int>(u0 + stepU),
+		static_cast<int>(u0 + 2 * stepU), static_cast<int>(u0 + 3 * stepU));
+	__m128i v = _mm_setr_epi32(static_cast<int>(v0), static_cast<int>(v0 + stepV),
+		static_cast<int>(v0 + 2 * stepV), static_cast<int>(v0 + 3 * stepV));
+	__m128i halfU = _mm_set1_epi32(static_cast<int>(4 * stepU));
+	__m128i halfV = _mm_set1_epi32(static_cast<int>(4 * stepV));
+	__m128i fullU = _mm_set1_epi32(static_cast<int>(8 * stepU));
+	__m128i fullV = _mm_set1_epi32(static_cast<int>(8 * stepV));
+	__m128i rowY = _mm_set1_epi16(static_cast<int16_t>(_y));
+	alignas(16) uint32_t address[8];
+	for (; x + 8 <= _x1; x += 8) {
+		bool hidden = false;
+		if (_tops != nullptr) {
+			__m128i wall = _mm_andnot_si128(
+				_mm_cmplt_epi16(rowY, _mm_loadu_si128(reinterpret_cast<const __m128i *>(_tops + x))),
+				_mm_cmplt_epi16(rowY, _mm_loadu_si128(reinterpret_cast<const __m128i *>(_bottoms + x))));
+			hidden = _mm_movemask_epi8(wall) == 0xFFFF;
+		}
+		if (!hidden) {
+			_mm_store_si128(reinterpret_cast<__m128i *>(address), mortonIndex(u, v));
+			_mm_store_si128(reinterpret_cast<__m128i *>(address + 4),
+				mortonIndex(_mm_add_epi32(u, halfU), _mm_add_epi32(v, halfV)));
+			// sse2 has no gather, the 8 texels are read one at a time
+			for (int i = 0; i < 8; i++) {
+				_row[x + i] = _palette.shade(texels[address[i]], light);
+			}
+		}
+		u = _mm_add_epi32(u, fullU);
+		v = _mm_add_epi32(v, fullV);
+	}
+#endif
+	for (; x < _x1; x++) {
+		uint32_t offset = static_cast<uint32_t>(x - _x0);
+		int tu = static_cast<int>((u0 + offset * stepU) >> FRACTION_BITS);
+		int tv = static_cast<int>((v0 + offset * stepV) >> FRACTION_BITS);
+		_row[x] = _palette.shade(texels[mortonIndex(tu, tv)], light);
+	}
+}
+
+void vre::VreFloorCaster::cast(const RayCamera &_camera, float _cellSize,
+	const VrePalette &_palette, int _width, int _height, uint8_t *_out, int _stride,
+	VreThreadPool &_pool, int _rowBand
+) const {
+	FlatView flat = view(_camera, _cellSize, _width, _height);
+	_pool.parallelFor((_height + _rowBand - 1) / _rowBand, [&](int _band) {
+		for (int y = _band * _rowBand; y < std::min((_band + 1) * _rowBand, _height); y++) {
+			castRow(flat, _palette, y, 0, _width, _out + static_cast<size_t>(y) * _stride);
+		}
+	});
+}
+
+void vre::VreFloorCaster::castNaive(const RayCamera &_camera, float _cellSize,
+	const VrePalette &_palette, int _width, int _height, uint8_t *_out, int _stride
+) const {
+	RayFrustum frustum(_camera, _width);
+	float eye = _cellSize * 0.5f * (_width * 0.5f / std::tan(_camera.fov * 0.5f));
+	int half = _height / 2;
+	for (int x = 0; x < _width; x++) {
+		float dirX;
+		float dirY;
+		frustum.direction(x, dirX, dirY);
+		for (int y = 0; y < _height; y++) {
+			bool ceiling = y < half;
+			float distance = eye / std::abs(static_cast<float>(y - half) + 0.5f);
+			float worldX = _camera.x + dirX * distance;
+			float worldY = _camera.y + dirY * distance;
+			int tu = static_cast<int>(std::floor(worldX / _cellSize * SIZE)) & TEXEL_MASK;
+			int tv = static_cast<int>(std::floor(worldY / _cellSize * SIZE)) & TEXEL_MASK;
+			uint8_t texel = m_rowMajor[ceiling ? 1 : 0][tv * SIZE + tu];
+			_out[static_cast<size_t>(y) * _stride + x] = _palette.shade(texel, flatLight(distance, _cellSize));
+		}
+	}
+}
+
+uint8_t vre::VreFloorCaster::sample(const FlatView &_view, const VrePalette &_palette,
+	float _screenX, int _y
+) const {
+	float distance = _view.eye / std::abs(static_cast<float>(_y - _view.half) + 0.5f);
+	float cameraX = _screenX * 2.0f / static_cast<float>(_view.width) - 1.0f;
+	float scale = distance * _view.texelsPerUnit;
+	int tu = static_cast<int>(std::floor(_view.x + scale * (_view.dirX + _view.planeX * cameraX))) & TEXEL_MASK;
+	int tv = static_cast<int>(std::floor(_view.y + scale * (_view.dirY + _view.planeY * cameraX))) & TEXEL_MASK;
+	return _palette.shade(m_morton[_y < _view.half ? 1 : 0][mortonIndex(tu, tv)], flatLight(distance, _view.cellSize));
+}
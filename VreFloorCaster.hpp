@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "VreRaycaster.hpp"
+#include "VrePalette.hpp"
+#include "VreThreadPool.hpp"
+
+namespace vre {
+	// per frame constants of a flat cast, see VreFloorCaster::view
+	struct FlatView {
+		float x; // camera position in texels
+		float y;
+		float dirX;
+		float dirY;
+		float planeX;
+		float planeY;
+		float eye; // half a cell times the focal length, in pixels
+		float cellSize;
+		float texelsPerUnit;
+		int width;
+		int half; // horizon row
+	};
+
+	// textured floor and ceiling for the software renderer. one SIZE x SIZE
+	// texture of palette indices repeats every cell. a screen row sees
+	// the floor at one distance, so its texture coordinates step by a
+	// constant per pixel and its light is the same throughout. rows are cast
+	// 8 pixels at a time from textures stored in morton order, where a row
+	// crossing the texture at any angle keeps to nearby cache lines. the
+	// eye sits half a cell up, where the walls of VreCpuRenderer put it
+	class VreFloorCaster {
+	public:
+		static constexpr int TEXTURE_BITS = 8;
+		static constexpr int SIZE = 1 << TEXTURE_BITS;
+
+		// stone tiles on the floor and panels on the ceiling
+		VreFloorCaster();
+
+		// _texels row major, SIZE * SIZE full bright palette indices
+		void setTexture(bool _ceiling, const uint8_t *_texels);
+
+		FlatView view(const RayCamera &_camera, float _cellSize, int _width, int _height) const;
+		// keeps the view of the frame being drawn for the renderer that
+		// casts its rows and samples tile by tile
+		void setView(const RayCamera &_camera, float _cellSize, int _width, int _height);
+		const FlatView &currentView() const { return m_view; }
+
+		// pixels [_x0, _x1) of row _y. with _tops and _bottoms, the wall
+		// extents per column, runs of 8 pixels hidden behind walls are
+		// skipped. the horizon row counts as floor
+		void castRow(const FlatView &_view, const VrePalette &_palette, int _y, int _x0, int _x1,
+			uint8_t *_row, const int16_t *_tops = nullptr, const int16_t *_bottoms = nullptr) const;
+		// every row of a _width x _height frame, in bands of _rowBand rows
+		// on _pool
+		void cast(const RayCamera &_camera, float _cellSize, const VrePalette &_palette,
+			int _width, int _height, uint8_t *_out, int _stride, VreThreadPool &_pool,
+			int _rowBand = 16) const;
+		// the same frame a pixel at a time down every column, each pixel
+		// with its own ray and divide, from the row major textures. the
+		// reference cast is measured against
+		void castNaive(const RayCamera &_camera, float _cellSize, const VrePalette &_palette,
+			int _width, int _height, uint8_t *_out, int _stride) const;
+
+		// one texel at a fractional screen column, for the sub column rays
+		// of edge supersampling
+		uint8_t sample(const FlatView &_view, const VrePalette &_palette, float _screenX, int _y) const;
+
+	private:
+		std::vector<uint8_t> m_rowMajor[2]; // floor, ceiling
+		std::vector<uint8_t> m_morton[2];
+		FlatView m_view{};
+	};
+}
@@ -0,0 +1,170 @@
+#include "VreFrameDelta.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+
+namespace {
+	constexpr int ROW_BAND = 32;
+	// every SAMPLE_STRIDE th band is scanned first, so the first part of
+	// the scan already sees the whole frame
+	constexpr int SAMPLE_STRIDE = 8;
+	// past this fraction of changed blocks the rectangles packed from them
+	// cover most of the frame anyway
+	constexpr float MAX_CHANGED = 0.1f;
+	// frames sent whole without a diff after one that passed MAX_CHANGED,
+	// a camera that moved tends to keep moving
+	constexpr int WHOLE_FRAMES = 8;
+}
+
+void vre::VreFrameDelta::resize(int _stride, int _height, int _slots) {
+	m_stride = _stride;
+	m_height = _height;
+	m_blocks = (_stride + BLOCK - 1) / BLOCK;
+	m_shadow.assign(static_cast<size_t>(_stride) * _height, 0);
+	m_slots.assign(_slots, std::vector<RowRange>(m_blocks));
+	m_valid = false;
+	m_wholeFrames = 0;
+
+	int bands = (_height + ROW_BAND - 1) / ROW_BAND;
+	m_bandOrder.clear();
+	for (int phase = 0; phase < SAMPLE_STRIDE; phase++) {
+		for (int band = phase; band < bands; band += SAMPLE_STRIDE) {
+			m_bandOrder.push_back(band);
+		}
+	}
+}
+
+void vre::VreFrameDelta::markAll() {
+	for (std::vector<RowRange> &slot : m_slots) {
+		std::fill(slot.begin(), slot.end(), RowRange{ 0, m_height });
+	}
+}
+
+const std::vector<vre::VreFrameDelta::Copy> &vre::VreFrameDelta::update(int _slot,
+	const uint8_t *_pixels, uint8_t *_staging, VreThreadPool &_pool
+) {
+	m_copies.clear();
+	m_lastFull = true;
+	if (m_wholeFrames > 0) {
+		// backing off after a frame that mostly changed, the shadow is left
+		// alone until the frames settle
+		m_wholeFrames--;
+	} else if (!m_valid) {
+		memcpy(m_shadow.data(), _pixels, m_shadow.size());
+		markAll();
+		m_valid = true;
+	} else {
+		// every row band notes the rows it saw change per block, then the
+		// bands are folded into the slots. once the sampled bands show more
+		// than MAX_CHANGED of their blocks changed the bands left are
+		// skipped and the frame goes out whole
+		int bands = (m_height + ROW_BAND - 1) / ROW_BAND;
+		m_bands.assign(static_cast<size_t>(bands) * m_blocks, RowRange{ m_height, 0 });
+		std::atomic<int> scannedRows{ 0 };
+		std::atomic<int> changedBlocks{ 0 };
+		std::atomic<bool> whole{ false };
+		int sampleRows = std::min(m_height, ROW_BAND * ((bands + SAMPLE_STRIDE - 1) / SAMPLE_STRIDE));
+		_pool.parallelFor(bands, [&](int _i) {
+			if (whole.load(std::memory_order_relaxed)) {
+				return;
+			}
+			int band = m_bandOrder[_i];
+			int y1 = std::min((band + 1) * ROW_BAND, m_height);
+			RowRange *ranges = &m_bands[static_cast<size_t>(band) * m_blocks];
+			int changed = 0;
+			for (int y = band * ROW_BAND; y < y1; y++) {
+				const uint8_t *row = _pixels + static_cast<size_t>(y) * m_stride;
+				uint8_t *shadow = m_shadow.data() + static_cast<size_t>(y) * m_stride;
+				if (memcmp(row, shadow, m_stride) == 0) {
+					continue;
+				}
+				for (int block = 0; block < m_blocks; block++) {
+					int x = block * BLOCK;
+					size_t size = static_cast<size_t>(std::min(BLOCK, m_stride - x));
+					if (memcmp(row + x, shadow + x, size) != 0) {
+						memcpy(shadow + x, row + x, size);
+						ranges[block].top = std::min(ranges[block].top, y);
+						ranges[block].bottom = y + 1;
+						changed++;
+					}
+				}
+			}
+			int scanned = scannedRows.fetch_add(y1 - band * ROW_BAND, std::memory_order_relaxed)
+				+ (y1 - band * ROW_BAND);
+			int total = changedBlocks.fetch_add(changed, std::memory_order_relaxed) + changed;
+			if (scanned >= sampleRows && total > MAX_CHANGED * scanned * m_blocks) {
+				whole.store(true, std::memory_order_relaxed);
+			}
+		});
+
+		if (whole.load()) {
+			// part of the shadow is this frame and part the last
+			m_valid = false;
+			m_wholeFrames = WHOLE_FRAMES;
+		} else {
+			m_lastFull = false;
+			for (int band = 0; band < bands; band++) {
+				const RowRange *ranges = &m_bands[static_cast<size_t>(band) * m_blocks];
+				for (std::vector<RowRange> &slot : m_slots) {
+					for (int block = 0; block < m_blocks; block++) {
+						if (ranges[block].top < ranges[block].bottom) {
+							slot[block].top = std::min(slot[block].top, ranges[block].top);
+							slot[block].bottom = std::max(slot[block].bottom, ranges[block].bottom);
+						}
+					}
+				}
+			}
+		}
+	}
+
+	if (!m_valid) {
+		// straight from _pixels, one copy
+		memcpy(_staging, _pixels, m_shadow.size());
+		m_copies.push_back({ 0, 0, m_shadow.size() });
+		m_lastBytes = m_shadow.size();
+		return m_copies;
+	}
+
+	// runs of neighbouring dirty blocks go out as one rectangle over the
+	// union of their rows, one copy per row, or one copy for whole rows
+	std::vector<RowRange> &slot = m_slots[_slot];
+	size_t offset = 0;
+	for (int block = 0; block < m_blocks;) {
+		if (slot[block].top >= slot[block].bottom) {
+			block++;
+			continue;
+		}
+		int top = slot[block].top;
+		int bottom = slot[block].bottom;
+		int end = block + 1;
+		while (end < m_blocks && slot[end].top < slot[end].bottom) {
+			top = std::min(top, slot[end].top);
+			bottom = std::max(bottom, slot[end].bottom);
+			end++;
+		}
+
+		size_t x0 = static_cast<size_t>(block) * BLOCK;
+		size_t x1 = std::min(static_cast<size_t>(end) * BLOCK, static_cast<size_t>(m_stride));
+		size_t first = static_cast<size_t>(top) * m_stride;
+		if (x0 == 0 && x1 == static_cast<size_t>(m_stride)) {
+			size_t size = static_cast<size_t>(bottom - top) * m_stride;
+			memcpy(_staging + offset, m_shadow.data() + first, size);
+			m_copies.push_back({ offset, first, size });
+			offset += size;
+		} else {
+			for (int y = top; y < bottom; y++) {
+				size_t frameOffset = static_cast<size_t>(y) * m_stride + x0;
+				memcpy(_staging + offset, m_shadow.data() + frameOffset, x1 - x0);
+				m_copies.push_back({ offset, frameOffset, x1 - x0 });
+				offset += x1 - x0;
+			}
+		}
+		for (int i = block; i < end; i++) {
+			slot[i] = RowRange{ m_height, 0 };
+		}
+		block = end;
+	}
+	m_lastBytes = offset;
+	return m_copies;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "VreThreadPool.hpp"
+
+namespace vre {
+	// which parts of an indexed frame changed since each frame in flight's
+	// device copy was last written. frames are compared against a shadow of
+	// the last one in BLOCK byte wide column blocks, a changed block widens
+	// its row range in every slot, and a slot's turn copies what it is
+	// missing out of the shadow into its staging memory, packed, together
+	// with the buffer copies that put it in place. a frame that mostly
+	// changed is found early in the scan and sent whole, as are the next
+	// few, before the shadow is taken up again
+	class VreFrameDelta {
+	public:
+		static constexpr int BLOCK = 64;
+
+		// one buffer copy, offsets in bytes
+		struct Copy {
+			size_t stagingOffset;
+			size_t frameOffset;
+			size_t size;
+		};
+
+		// _stride * _height byte frames, _slots device copies of them
+		void resize(int _stride, int _height, int _slots);
+		// the device copies were written some other way, the next update
+		// sends everything again
+		void invalidate() { m_valid = false; }
+
+		// diffs _pixels against the last frame on _pool and packs what slot
+		// _slot lacks into _staging, at most a whole frame. the returned
+		// copies stay valid until the next update
+		const std::vector<Copy> &update(int _slot, const uint8_t *_pixels, uint8_t *_staging,
+			VreThreadPool &_pool);
+
+		// bytes packed by the last update
+		size_t lastBytes() const { return m_lastBytes; }
+		// the last update sent the whole frame, because it was invalid or
+		// because too much of this or a recent frame changed to be worth
+		// diffing
+		bool lastFull() const { return m_lastFull; }
+		size_t frameBytes() const { return m_shadow.size(); }
+
+	private:
+		// rows [top, bottom) of one column block, empty when top >= bottom
+		struct RowRange {
+			int top;
+			int bottom;
+		};
+
+		void markAll();
+
+		int m_stride = 0;
+		int m_height = 0;
+		int m_blocks = 0;
+		bool m_valid = false;
+		std::vector<uint8_t> m_shadow;
+		std::vector<std::vector<RowRange>> m_slots; // m_blocks per slot
+		std::vector<RowRange> m_bands; // m_blocks per row band, update only
+		std::vector<int> m_bandOrder; // the order update scans the row bands in
+		std::vector<Copy> m_copies;
+		size_t m_lastBytes = 0;
+		bool m_lastFull = false;
+		int m_wholeFrames = 0; // left to send whole before diffing again
+	};
+}
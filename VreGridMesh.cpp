@@ -0,0 +1,209 @@
+#include "VreGridMesh.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+
+#include "VreSwapchain.hpp"
+
+namespace {
+	struct MeshPushConstants {
+		glm::mat4 viewProjection;
+	};
+
+	std::vector<VkVertexInputBindingDescription> meshBindings() {
+		std::vector<VkVertexInputBindingDescription> bindings(1);
+		bindings[0].binding = 0;
+		bindings[0].stride = sizeof(vre::MeshVertex);
+		bindings[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+		return bindings;
+	}
+
+	std::vector<VkVertexInputAttributeDescription> meshAttributes() {
+		std::vector<VkVertexInputAttributeDescription> attributes(2);
+		attributes[0].binding = 0;
+		attributes[0].location = 0;
+		attributes[0].format = VK_FORMAT_R32G32B32_SFLOAT;
+		attributes[0].offset = offsetof(vre::MeshVertex, x);
+
+		// palette rgba8 arrives in the shader as a normalized vec4
+		attributes[1].binding = 0;
+		attributes[1].location = 1;
+		attributes[1].format = VK_FORMAT_R8G8B8A8_UNORM;
+		attributes[1].offset = offsetof(vre::MeshVertex, color);
+		return attributes;
+	}
+}
+
+vre::VreGridMesh::VreGridMesh(VreDevice &_device, const VreMap &_map, const VrePalette &_palette
+) : m_vreDevice{ _device }, m_mesher{ _map, _palette } {
+	m_chunks.resize(m_mesher.chunkCount());
+	createPipelineLayout();
+}
+
+vre::VreGridMesh::~VreGridMesh() {
+	for (ChunkBuffers &chunk : m_chunks) {
+		destroyBuffers(chunk);
+	}
+	for (Retired &retired : m_retired) {
+		destroyBuffers(retired.buffers);
+	}
+	m_pipeline.reset();
+	vkDestroyPipelineLayout(m_vreDevice.device(), m_pipelineLayout, nullptr);
+}
+
+void vre::VreGridMesh::createPipeline(VkRenderPass _renderPass) {
+	PipelineConfigInfo pipelineConfig{};
+	VrePipeline::defaultPipelineConfigInfo(pipelineConfig);
+	pipelineConfig.bindingDescriptions = meshBindings();
+	pipelineConfig.attributeDescriptions = meshAttributes();
+	pipelineConfig.renderPass = _renderPass;
+	pipelineConfig.pipelineLayout = m_pipelineLayout;
+
+	m_pipeline.reset();
+	m_pipeline = std::make_unique<VrePipeline>(m_vreDevice.m_device, pipelineConfig,
+		"./grid_mesh.vert.spv", "./grid_mesh.frag.spv");
+}
+
+void vre::VreGridMesh::update(VreThreadPool &_pool) {
+	// the frames that could still draw a retired pair have finished by now
+	for (size_t i = 0; i < m_retired.size();) {
+		if (--m_retired[i].framesLeft > 0) {
+			i++;
+			continue;
+		}
+		destroyBuffers(m_retired[i].buffers);
+		m_retired[i] = m_retired.back();
+		m_retired.pop_back();
+	}
+
+	if (!m_mesher.hasDirty()) {
+		return;
+	}
+	auto start = std::chrono::steady_clock::now();
+	for (int chunk : m_mesher.rebuildDirty(_pool)) {
+		upload(chunk);
+	}
+	m_lastRebuildMs = std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now() - start).count();
+
+	m_triangles = 0;
+	for (const ChunkBuffers &chunk : m_chunks) {
+		m_triangles += chunk.indexCount / 3;
+	}
+}
+
+void vre::VreGridMesh::record(VkCommandBuffer _cmd, const glm::mat4 &_viewProjection) {
+	m_pipeline->bind(_cmd);
+
+	MeshPushConstants push{ _viewProjection };
+	vkCmdPushConstants(_cmd, m_pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0,
+		sizeof(MeshPushConstants), &push);
+
+	VkDeviceSize offset = 0;
+	for (const ChunkBuffers &chunk : m_chunks) {
+		if (chunk.indexCount == 0) {
+			continue;
+		}
+		vkCmdBindVertexBuffers(_cmd, 0, 1, &chunk.vertices, &offset);
+		vkCmdBindIndexBuffer(_cmd, chunk.indices, 0, VK_INDEX_TYPE_UINT32);
+		vkCmdDrawIndexed(_cmd, chunk.indexCount, 1, 0, 0, 0);
+	}
+}
+
+glm::mat4 vre::VreGridMesh::cameraMatrix(const RayCamera &_camera, float _cellSize, float _eyeHeight,
+	VkExtent2D _extent
+) {
+	constexpr float NEAR_PLANE = 0.05f;
+	constexpr float FAR_PLANE = 512.0f;
+
+	// view basis of the raycaster, columns go left to right along the plane
+	// vector (-sin, cos) and depth is the distance along the view direction
+	float eyeX = _camera.x / _cellSize;
+	float eyeY = _camera.y / _cellSize;
+	float forwardX = std::cos(_camera.angle);
+	float forwardY = std::sin(_camera.angle);
+	float rightX = -forwardY;
+	float rightY = forwardX;
+	float focalX = 1.0f / std::tan(_camera.fov * 0.5f);
+	float focalY = focalX * static_cast<float>(_extent.width) / static_cast<float>(_extent.height);
+	float depthScale = FAR_PLANE / (FAR_PLANE - NEAR_PLANE);
+	float depthOffset = -FAR_PLANE * NEAR_PLANE / (FAR_PLANE - NEAR_PLANE);
+	float eyeDepth = forwardX * eyeX + forwardY * eyeY;
+
+	// columns of clip = m * (x, y, z, 1), vulkan clip y points down
+	glm::mat4 m(0.0f);
+	m[0][0] = focalX * rightX;
+	m[1][0] = focalX * rightY;
+	m[3][0] = -focalX * (rightX * eyeX + rightY * eyeY);
+	m[2][1] = -focalY;
+	m[3][1] = focalY * _eyeHeight;
+	m[0][2] = depthScale * forwardX;
+	m[1][2] = depthScale * forwardY;
+	m[3][2] = depthOffset - depthScale * eyeDepth;
+	m[0][3] = forwardX;
+	m[1][3] = forwardY;
+	m[3][3] = -eyeDepth;
+	return m;
+}
+
+void vre::VreGridMesh::upload(int _chunk) {
+	ChunkBuffers &chunk = m_chunks[_chunk];
+	if (chunk.indexCount > 0) {
+		m_retired.push_back({ chunk, static_cast<int>(VreSwapchain::MAX_FRAMES_IN_FLIGHT) + 1 });
+	}
+	chunk = ChunkBuffers{};
+
+	const GridChunkMesh &mesh = m_mesher.chunk(_chunk);
+	if (mesh.indices.empty()) {
+		return;
+	}
+	createHostBuffer(mesh.vertices.data(), sizeof(MeshVertex) * mesh.vertices.size(),
+		VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, chunk.vertices, chunk.vertexMemory);
+	createHostBuffer(mesh.indices.data(), sizeof(uint32_t) * mesh.indices.size(),
+		VK_BUFFER_USAGE_INDEX_BUFFER_BIT, chunk.indices, chunk.indexMemory);
+	chunk.indexCount = static_cast<uint32_t>(mesh.indices.size());
+}
+
+void vre::VreGridMesh::createHostBuffer(const void *_data, VkDeviceSize _size,
+	VkBufferUsageFlags _usage, VkBuffer &_buffer, VkDeviceMemory &_memory
+) {
+	m_vreDevice.createBuffer(_size, _usage,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		_buffer, _memory);
+
+	void *data;
+	vkMapMemory(m_vreDevice.device(), _memory, 0, _size, 0, &data);
+	memcpy(data, _data, static_cast<size_t>(_size));
+	vkUnmapMemory(m_vreDevice.device(), _memory);
+}
+
+void vre::VreGridMesh::destroyBuffers(ChunkBuffers &_buffers) {
+	VkDevice device = m_vreDevice.device();
+	vkDestroyBuffer(device, _buffers.vertices, nullptr);
+	vkFreeMemory(device, _buffers.vertexMemory, nullptr);
+	vkDestroyBuffer(device, _buffers.indices, nullptr);
+	vkFreeMemory(device, _buffers.indexMemory, nullptr);
+	_buffers = ChunkBuffers{};
+}
+
+void vre::VreGridMesh::createPipelineLayout() {
+	VkPushConstantRange pushConstantRange{};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(MeshPushConstants);
+
+	VkPipelineLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	layoutInfo.setLayoutCount = 0;
+	layoutInfo.pSetLayouts = nullptr;
+	layoutInfo.pushConstantRangeCount = 1;
+	layoutInfo.pPushConstantRanges = &pushConstantRange;
+
+	if (vkCreatePipelineLayout(m_vreDevice.device(), &layoutInfo, nullptr,
+		&m_pipelineLayout) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create grid mesh pipeline layout");
+	}
+}
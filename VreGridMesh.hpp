@@ -0,0 +1,78 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE // forces depth to [0,1] instead of [-1,1]
+#include <glm/glm.hpp>
+
+#include <vulkan/vulkan.h>
+
+#include "VreDevice.hpp"
+#include "VrePipeline.hpp"
+#include "VreGridMesher.hpp"
+#include "VreRaycaster.hpp"
+
+namespace vre {
+	// gpu side of VreGridMesher, the level drawn by the rasterizer into the
+	// swapchain render pass with its depth buffer instead of cast column by
+	// column. each chunk owns a host visible vertex and index buffer like
+	// VreModel, a rebuilt chunk gets new ones and the old pair is freed once
+	// no frame in flight can still read it
+	class VreGridMesh {
+	public:
+		VreGridMesh(VreDevice &_device, const VreMap &_map, const VrePalette &_palette);
+		~VreGridMesh();
+
+		VreGridMesh(const VreGridMesh &) = delete;
+		VreGridMesh &operator=(const VreGridMesh &) = delete;
+
+		// again after every swapchain rebuild
+		void createPipeline(VkRenderPass _renderPass);
+
+		void markCell(int _x, int _y) { m_mesher.markCell(_x, _y); }
+		// rebuilds marked chunks on _pool and uploads them, once per frame
+		// before recording
+		void update(VreThreadPool &_pool);
+		// inside the render pass, viewport and scissor already set
+		void record(VkCommandBuffer _cmd, const glm::mat4 &_viewProjection);
+
+		// world units to vulkan clip space for the raycaster's camera, same
+		// horizontal fov, square pixels and the eye _eyeHeight cells up
+		static glm::mat4 cameraMatrix(const RayCamera &_camera, float _cellSize, float _eyeHeight,
+			VkExtent2D _extent);
+
+		size_t triangleCount() const { return m_triangles; }
+		double lastRebuildMs() const { return m_lastRebuildMs; }
+
+	private:
+		struct ChunkBuffers {
+			VkBuffer vertices = VK_NULL_HANDLE;
+			VkDeviceMemory vertexMemory = VK_NULL_HANDLE;
+			VkBuffer indices = VK_NULL_HANDLE;
+			VkDeviceMemory indexMemory = VK_NULL_HANDLE;
+			uint32_t indexCount = 0;
+		};
+		struct Retired {
+			ChunkBuffers buffers;
+			int framesLeft;
+		};
+
+		void upload(int _chunk);
+		void createHostBuffer(const void *_data, VkDeviceSize _size, VkBufferUsageFlags _usage,
+			VkBuffer &_buffer, VkDeviceMemory &_memory);
+		void destroyBuffers(ChunkBuffers &_buffers);
+		void createPipelineLayout();
+
+		VreDevice &m_vreDevice;
+		VreGridMesher m_mesher;
+		std::vector<ChunkBuffers> m_chunks;
+		std::vector<Retired> m_retired;
+		size_t m_triangles = 0;
+		double m_lastRebuildMs = 0.0;
+
+		VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE;
+		std::unique_ptr<VrePipeline> m_pipeline;
+	};
+}
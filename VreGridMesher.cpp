@@ -0,0 +1,230 @@
+#include "VreGridMesher.hpp"
+
+#include <algorithm>
+#include <tuple>
+
+namespace {
+	// +x, -x, +y, -y
+	constexpr int SIDES = 4;
+	constexpr int SIDE_X[SIDES] = { 1, -1, 0, 0 };
+	constexpr int SIDE_Y[SIDES] = { 0, 0, 1, -1 };
+
+	// solid from 0 to low and from ceiling to 1, low >= ceiling is solid
+	// all the way up. outside the map counts as solid
+	struct Profile {
+		float low;
+		float ceiling;
+		int cell;
+	};
+
+	Profile profile(const vre::VreMap &_map, int _x, int _y) {
+		if (!_map.inBounds(_x, _y)) {
+			return { 1.0f, 0.0f, 0 };
+		}
+		int cell = _map.at(_x, _y);
+		vre::CellHeights heights = _map.heights(_x, _y);
+		return { cell != 0 ? heights.wallTop : heights.floor, heights.ceiling, cell };
+	}
+
+	uint32_t paletteColor(const vre::VrePalette &_palette, int _ramp, int _shade) {
+		return _palette.colors()[vre::VrePalette::index(_ramp, _shade)];
+	}
+
+	int lowRamp(const Profile &_profile) {
+		return _profile.cell != 0 ? vre::VrePalette::wallRamp(_profile.cell) : vre::VrePalette::RAMP_FLOOR;
+	}
+
+	// one unit wide piece of a wall plane before merging
+	struct Face {
+		int along;
+		float z0;
+		float z1;
+		uint32_t color;
+	};
+
+	void addQuad(vre::GridChunkMesh &_out, const vre::MeshVertex (&_corners)[4]) {
+		uint32_t base = static_cast<uint32_t>(_out.vertices.size());
+		_out.vertices.insert(_out.vertices.end(), _corners, _corners + 4);
+		for (uint32_t corner : { 0u, 1u, 2u, 0u, 2u, 3u }) {
+			_out.indices.push_back(base + corner);
+		}
+	}
+}
+
+vre::VreGridMesher::VreGridMesher(const VreMap &_map, const VrePalette &_palette
+) : m_map{ &_map }, m_palette{ &_palette },
+	m_chunksX{ (_map.width() + CHUNK_SIZE - 1) / CHUNK_SIZE },
+	m_chunksY{ (_map.height() + CHUNK_SIZE - 1) / CHUNK_SIZE } {
+	m_chunks.resize(chunkCount());
+	m_marked.assign(chunkCount(), 0);
+	markAll();
+}
+
+void vre::VreGridMesher::markCell(int _x, int _y) {
+	for (int dy = -1; dy <= 1; dy++) {
+		for (int dx = -1; dx <= 1; dx++) {
+			if (dx != 0 && dy != 0) {
+				continue;
+			}
+			int x = _x + dx;
+			int y = _y + dy;
+			if (!m_map->inBounds(x, y)) {
+				continue;
+			}
+			int index = (y / CHUNK_SIZE) * m_chunksX + x / CHUNK_SIZE;
+			if (!m_marked[index]) {
+				m_marked[index] = 1;
+				m_dirty.push_back(index);
+			}
+		}
+	}
+}
+
+void vre::VreGridMesher::markAll() {
+	m_dirty.clear();
+	for (int i = 0; i < chunkCount(); i++) {
+		m_marked[i] = 1;
+		m_dirty.push_back(i);
+	}
+}
+
+std::vector<int> vre::VreGridMesher::rebuildDirty(VreThreadPool &_pool) {
+	std::vector<int> rebuilt;
+	rebuilt.swap(m_dirty);
+	_pool.parallelFor(static_cast<int>(rebuilt.size()), [&](int _i) {
+		int index = rebuilt[_i];
+		buildChunk(*m_map, *m_palette, index % m_chunksX, index / m_chunksX, m_chunks[index]);
+	});
+	for (int index : rebuilt) {
+		m_marked[index] = 0;
+	}
+	return rebuilt;
+}
+
+void vre::VreGridMesher::buildChunk(const VreMap &_map, const VrePalette &_palette, int _chunkX,
+	int _chunkY, GridChunkMesh &_out
+) {
+	_out.vertices.clear();
+	_out.indices.clear();
+	int x0 = _chunkX * CHUNK_SIZE;
+	int y0 = _chunkY * CHUNK_SIZE;
+	int width = std::min(CHUNK_SIZE, _map.width() - x0);
+	int height = std::min(CHUNK_SIZE, _map.height() - y0);
+
+	// walls, one plane per cell line and side. the exposed part of a face
+	// is the cell's solid span clipped to the neighbour's open span
+	std::vector<Face> faces;
+	for (int side = 0; side < SIDES; side++) {
+		bool facesX = SIDE_X[side] != 0;
+		int shade = VrePalette::SHADES - 1 - (facesX ? 0 : 1);
+		int lines = facesX ? width : height;
+		int length = facesX ? height : width;
+		for (int line = 0; line < lines; line++) {
+			faces.clear();
+			for (int k = 0; k < length; k++) {
+				int x = x0 + (facesX ? line : k);
+				int y = y0 + (facesX ? k : line);
+				Profile cell = profile(_map, x, y);
+				Profile next = profile(_map, x + SIDE_X[side], y + SIDE_Y[side]);
+				if (next.low >= next.ceiling) {
+					continue;
+				}
+				if (cell.low >= cell.ceiling) {
+					faces.push_back({ k, next.low, next.ceiling, paletteColor(_palette, lowRamp(cell), shade) });
+					continue;
+				}
+				float top = std::min(cell.low, next.ceiling);
+				if (top > next.low) {
+					faces.push_back({ k, next.low, top, paletteColor(_palette, lowRamp(cell), shade) });
+				}
+				float bottom = std::max(cell.ceiling, next.low);
+				if (next.ceiling > bottom) {
+					faces.push_back({ k, bottom, next.ceiling,
+						paletteColor(_palette, VrePalette::RAMP_CEILING, shade) });
+				}
+			}
+
+			// runs of neighbouring faces with the same span and color
+			std::sort(faces.begin(), faces.end(), [](const Face &_a, const Face &_b) {
+				return std::tie(_a.z0, _a.z1, _a.color, _a.along) < std::tie(_b.z0, _b.z1, _b.color, _b.along);
+			});
+			float plane = static_cast<float>((facesX ? x0 : y0) + line + (SIDE_X[side] + SIDE_Y[side] > 0 ? 1 : 0));
+			for (size_t first = 0; first < faces.size();) {
+				size_t last = first;
+				while (last + 1 < faces.size() && faces[last + 1].along == faces[last].along + 1
+					&& faces[last + 1].z0 == faces[first].z0 && faces[last + 1].z1 == faces[first].z1
+					&& faces[last + 1].color == faces[first].color) {
+					last++;
+				}
+				const Face &face = faces[first];
+				float a0 = static_cast<float>((facesX ? y0 : x0) + face.along);
+				float a1 = static_cast<float>((facesX ? y0 : x0) + faces[last].along + 1);
+				if (facesX) {
+					addQuad(_out, { { plane, a0, face.z0, face.color }, { plane, a1, face.z0, face.color },
+						{ plane, a1, face.z1, face.color }, { plane, a0, face.z1, face.color } });
+				} else {
+					addQuad(_out, { { a0, plane, face.z0, face.color }, { a1, plane, face.z0, face.color },
+						{ a1, plane, face.z1, face.color }, { a0, plane, face.z1, face.color } });
+				}
+				first = last + 1;
+			}
+		}
+	}
+
+	// floors and wall tops facing up, then ceilings facing down, grown into
+	// the largest rectangles of equal height and color
+	struct Cap {
+		float z;
+		uint32_t color;
+		bool open;
+	};
+	std::vector<Cap> caps(static_cast<size_t>(width) * height);
+	std::vector<uint8_t> used(caps.size());
+	for (int pass = 0; pass < 2; pass++) {
+		for (int y = 0; y < height; y++) {
+			for (int x = 0; x < width; x++) {
+				Profile cell = profile(_map, x0 + x, y0 + y);
+				Cap &cap = caps[static_cast<size_t>(y) * width + x];
+				cap.open = cell.low < cell.ceiling;
+				cap.z = pass == 0 ? cell.low : cell.ceiling;
+				cap.color = pass == 0 ? paletteColor(_palette, lowRamp(cell), VrePalette::SHADES - 3)
+					: paletteColor(_palette, VrePalette::RAMP_CEILING, VrePalette::SHADES - 3);
+			}
+		}
+		std::fill(used.begin(), used.end(), 0);
+		auto joins = [&](const Cap &_a, int _x, int _y) {
+			size_t i = static_cast<size_t>(_y) * width + _x;
+			return !used[i] && caps[i].open && caps[i].z == _a.z && caps[i].color == _a.color;
+		};
+
+		for (int y = 0; y < height; y++) {
+			for (int x = 0; x < width; x++) {
+				const Cap &cap = caps[static_cast<size_t>(y) * width + x];
+				if (!joins(cap, x, y)) {
+					continue;
+				}
+				int w = 1;
+				while (x + w < width && joins(cap, x + w, y)) {
+					w++;
+				}
+				int h = 1;
+				for (bool grow = true; grow && y + h < height; ) {
+					for (int i = 0; i < w && grow; i++) {
+						grow = joins(cap, x + i, y + h);
+					}
+					h += grow ? 1 : 0;
+				}
+				for (int j = 0; j < h; j++) {
+					std::fill_n(used.begin() + static_cast<size_t>(y + j) * width + x, w, 1);
+				}
+
+				float fx0 = static_cast<float>(x0 + x);
+				float fy0 = static_cast<float>(y0 + y);
+				float fx1 = fx0 + w;
+				float fy1 = fy0 + h;
+				addQuad(_out, { { fx0, fy0, cap.z, cap.color }, { fx1, fy0, cap.z, cap.color },
+					{ fx1, fy1, cap.z, cap.color }, { fx0, fy1, cap.z, cap.color } });
+			}
+		}
+	}
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "VreMap.hpp"
+#include "VrePalette.hpp"
+#include "VreThreadPool.hpp"
+
+namespace vre {
+	// position in cells, z up from the ground at 0 to the classic ceiling at
+	// 1. color is rgba8 straight from the palette, red in the lowest byte
+	struct MeshVertex {
+		float x;
+		float y;
+		float z;
+		uint32_t color;
+	};
+
+	struct GridChunkMesh {
+		std::vector<MeshVertex> vertices;
+		std::vector<uint32_t> indices; // two triangles per quad
+	};
+
+	// extrudes the grid map into triangles for the rasterizer. every cell is
+	// solid from the ground up to its wall top (walls) or floor (open cells)
+	// and from its ceiling up, faces between two solid spans are dropped and
+	// coplanar faces of the same color are merged greedily, runs along a
+	// wall line and rectangles for floors and ceilings. the map is cut into
+	// CHUNK_SIZE square chunks so an edited cell only rebuilds its chunk
+	// and the ones next to it
+	class VreGridMesher {
+	public:
+		static constexpr int CHUNK_SIZE = 16;
+
+		VreGridMesher(const VreMap &_map, const VrePalette &_palette);
+
+		int chunksX() const { return m_chunksX; }
+		int chunksY() const { return m_chunksY; }
+		int chunkCount() const { return m_chunksX * m_chunksY; }
+		const GridChunkMesh &chunk(int _index) const { return m_chunks[_index]; }
+
+		// after the map changed at (_x, _y). faces of the neighbours look at
+		// the cell too, so their chunks are marked as well
+		void markCell(int _x, int _y);
+		void markAll();
+		bool hasDirty() const { return !m_dirty.empty(); }
+
+		// rebuilds every marked chunk, one chunk per task on _pool, and
+		// returns their indices
+		std::vector<int> rebuildDirty(VreThreadPool &_pool);
+
+		// the chunk at (_chunkX, _chunkY) of _map into _out
+		static void buildChunk(const VreMap &_map, const VrePalette &_palette, int _chunkX, int _chunkY,
+			GridChunkMesh &_out);
+
+	private:
+		const VreMap *m_map;
+		const VrePalette *m_palette;
+		int m_chunksX;
+		int m_chunksY;
+		std::vector<GridChunkMesh> m_chunks;
+		std::vector<uint8_t> m_marked; // per chunk, mirrors m_dirty
+		std::vector<int> m_dirty;
+	};
+}
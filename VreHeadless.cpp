@@ -0,0 +1,78 @@
+#include "VreHeadless.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <chrono>
+#include <random>
+
+#include "Game.hpp"
+#include "VideoSettings.hpp"
+#include "VreRaycaster.hpp"
+#include "VreRayStats.hpp"
+#include "VreBatchEnv.hpp"
+#include "VreMultiCamera.hpp"
+
+bool vre::headless::run(int _frames, const std::string &_jsonPath) {
+	Game game;
+	game.initialize();
+
+	VreRaycaster raycaster;
+	raycaster.bindMap(game.m_level);
+	std::vector<RayHit> hits(WINDOW_WIDTH);
+
+	for (int frame = 0; frame < _frames; frame++) {
+		game.update();
+		// no controller here, just turn a little every frame
+		game.m_pa = frame * 0.05f;
+
+		RayCamera camera{ game.m_px, game.m_py, game.m_pa };
+		raycaster.castColumns(camera, 0, WINDOW_WIDTH, WINDOW_WIDTH, hits.data());
+		VreRayStats::endFrame();
+	}
+
+	std::ofstream file(_jsonPath);
+	if (!file) {
+		std::cout << "could not open " << _jsonPath << std::endl;
+		return false;
+	}
+	file << "{\"frames\":" << _frames
+		<< ",\"lastFrame\":" << VreRayStats::toJson(VreRayStats::lastFrame())
+		<< ",\"total\":" << VreRayStats::toJson(VreRayStats::total()) << "}" << std::endl;
+
+	std::cout << "wrote ray stats for " << _frames << " frames to " << _jsonPath << std::endl;
+	return true;
+}
+
+void vre::headless::runBatch(int _envs, int _steps) {
+	Game game;
+	game.initialize();
+
+	VreBatchEnv env({ &game.m_level }, std::vector<uint16_t>(_envs, 0));
+	VreMultiCamera observer({ &game.m_level });
+	std::vector<float> observations(observer.outputSize(_envs));
+	VreThreadPool &pool = VreThreadPool::shared();
+
+	std::mt19937 rng(1);
+	std::uniform_int_distribution<int> action(0, 15);
+	std::vector<uint8_t> actions(_envs);
+
+	double rewards = 0.0;
+	auto start = std::chrono::steady_clock::now();
+	for (int step = 0; step < _steps; step++) {
+		for (uint8_t &a : actions) {
+			a = static_cast<uint8_t>(action(rng));
+		}
+		env.step(actions.data(), pool);
+		for (int i = 0; i < _envs; i++) {
+			rewards += env.rewards()[i];
+		}
+		observer.cast({ env.x(), env.y(), env.angle(), nullptr, _envs }, observations.data(), pool);
+	}
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	std::cout << _envs << " envs x " << _steps << " steps on " << pool.threadCount() << " threads: "
+		<< env.totalSteps() / seconds / 1e6 << " M steps/s including action generation and "
+		<< observer.settings().columns << " column observations, "
+		<< rewards << " pickups collected" << std::endl;
+}
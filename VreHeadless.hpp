@@ -0,0 +1,20 @@
+#pragma once
+
+#include <string>
+
+// runs the game loop without a window or a vulkan device, run with
+// "VulkanRayEngine --headless [frames] [out.json]"
+namespace vre {
+	namespace headless {
+		// casts one screen of rays per frame while turning the player in
+		// place, then writes the ray stats of the last frame and the totals
+		// as json. returns false if the file could not be written
+		bool run(int _frames, const std::string &_jsonPath);
+
+		// "--batch [envs] [steps]", steps _envs copies of the game level as
+		// a VreBatchEnv with random actions on every core, casts a multi
+		// camera observation for every env after each step and prints the
+		// step rate
+		void runBatch(int _envs, int _steps);
+	}
+}
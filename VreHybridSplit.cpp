@@ -0,0 +1,49 @@
+#include "VreHybridSplit.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+	// weight of the newest measurement in the averages
+	constexpr double SMOOTHING = 0.25;
+	// the split moves at most this part of the width per update
+	constexpr int MAX_STEP_DIVISOR = 16;
+}
+
+void vre::VreHybridSplit::reset(int _width, int _align, int _minColumns) {
+	m_width = _width;
+	m_align = std::max(_align, 1);
+	m_minColumns = std::min(_minColumns, _width / 2);
+	m_split = (_width / 2) / m_align * m_align;
+	m_measured = false;
+}
+
+void vre::VreHybridSplit::update(int _gpuColumns, double _gpuMs, double _cpuMs) {
+	int cpuColumns = m_width - _gpuColumns;
+	if (_gpuColumns <= 0 || cpuColumns <= 0) {
+		return;
+	}
+
+	double gpuColumn = _gpuMs / _gpuColumns;
+	double cpuColumn = _cpuMs / cpuColumns;
+	if (!m_measured) {
+		m_gpuColumnMs = gpuColumn;
+		m_cpuColumnMs = cpuColumn;
+		m_measured = true;
+	} else {
+		m_gpuColumnMs += (gpuColumn - m_gpuColumnMs) * SMOOTHING;
+		m_cpuColumnMs += (cpuColumn - m_cpuColumnMs) * SMOOTHING;
+	}
+	if (m_gpuColumnMs + m_cpuColumnMs <= 0.0) {
+		return;
+	}
+
+	// gpu columns * gpu cost = cpu columns * cpu cost
+	double target = m_width * m_cpuColumnMs / (m_gpuColumnMs + m_cpuColumnMs);
+	int maxStep = std::max(m_width / MAX_STEP_DIVISOR, m_align);
+	int next = std::clamp(static_cast<int>(std::lround(target)), m_split - maxStep, m_split + maxStep);
+	next = (next + m_align / 2) / m_align * m_align;
+	int low = (m_minColumns + m_align - 1) / m_align * m_align;
+	int high = (m_width - m_minColumns) / m_align * m_align;
+	m_split = std::clamp(next, low, std::max(high, low));
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+namespace vre {
+	// divides the columns of a frame between the gpu, left of split(), and
+	// the cpu. each side's time per column is averaged over the last few
+	// measurements and the split moves to where both sides take the same
+	// time, a limited step per frame so one late frame doesn't throw it
+	// around. both sides keep a few columns, a side without any would never
+	// be measured again
+	class VreHybridSplit {
+	public:
+		// _width columns, the split stays a multiple of _align
+		void reset(int _width, int _align, int _minColumns);
+
+		// the times of a frame drawn with _gpuColumns columns on the gpu,
+		// which may be an older split than the current one
+		void update(int _gpuColumns, double _gpuMs, double _cpuMs);
+
+		int split() const { return m_split; }
+		// the last averaged costs, for the ui
+		double gpuColumnUs() const { return m_gpuColumnMs * 1000.0; }
+		double cpuColumnUs() const { return m_cpuColumnMs * 1000.0; }
+
+	private:
+		int m_width = 0;
+		int m_align = 1;
+		int m_minColumns = 0;
+		int m_split = 0;
+		double m_gpuColumnMs = 0.0;
+		double m_cpuColumnMs = 0.0;
+		bool m_measured = false;
+	};
+}
@@ -0,0 +1,424 @@
+#include "VreIndexedFramebuffer.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "VrePipeline.hpp"
+
+namespace {
+	struct ExpandPushConstants {
+		uint32_t strideWords; // row pitch of the index buffer in uints
+	};
+}
+
+vre::VreIndexedFramebuffer::VreIndexedFramebuffer(VreDevice &_device, uint32_t _width,
+	uint32_t _height, const VrePalette &_palette
+) : m_vreDevice{ _device }, m_width{ _width }, m_height{ _height },
+	m_stride{ (_width + 3) & ~3u } {
+	createPalette(_palette);
+	createFrameResources();
+	createDescriptors();
+	createPipeline();
+
+	std::array<VkImageView, VreSwapchain::MAX_FRAMES_IN_FLIGHT> drawImageViews;
+	for (size_t i = 0; i < m_frames.size(); i++) {
+		drawImageViews[i] = m_frames[i].drawImageView;
+	}
+	m_sky = std::make_unique<VreSky>(_device, drawImageViews, m_width, m_height);
+	m_delta.resize(static_cast<int>(m_stride), static_cast<int>(m_height),
+		static_cast<int>(m_frames.size()));
+}
+
+vre::VreIndexedFramebuffer::~VreIndexedFramebuffer() {
+	VkDevice device = m_vreDevice.device();
+
+	m_sky.reset();
+	vkDestroyPipeline(device, m_pipeline, nullptr);
+	vkDestroyPipelineLayout(device, m_pipelineLayout, nullptr);
+	vkDestroyDescriptorPool(device, m_descriptorPool, nullptr);
+	vkDestroyDescriptorSetLayout(device, m_setLayout, nullptr);
+
+	for (FrameResources &frame : m_frames) {
+		vkUnmapMemory(device, frame.stagingMemory);
+		vkDestroyBuffer(device, frame.staging, nullptr);
+		vkFreeMemory(device, frame.stagingMemory, nullptr);
+		vkDestroyBuffer(device, frame.indices, nullptr);
+		vkFreeMemory(device, frame.indicesMemory, nullptr);
+		vkDestroyImageView(device, frame.drawImageView, nullptr);
+		vkDestroyImage(device, frame.drawImage, nullptr);
+		vkFreeMemory(device, frame.drawImageMemory, nullptr);
+	}
+
+	vkDestroyBuffer(device, m_palette, nullptr);
+	vkFreeMemory(device, m_paletteMemory, nullptr);
+}
+
+void vre::VreIndexedFramebuffer::upload(size_t _frame, const uint8_t *_pixels) {
+	memcpy(m_frames[_frame].mapped, _pixels, static_cast<size_t>(frameBytes()));
+}
+
+void vre::VreIndexedFramebuffer::uploadChanged(size_t _frame, const uint8_t *_pixels,
+	VreThreadPool &_pool
+) {
+	FrameResources &frame = m_frames[_frame];
+	frame.deltaCopies.clear();
+	for (const VreFrameDelta::Copy &copy : m_delta.update(static_cast<int>(_frame), _pixels,
+		static_cast<uint8_t *>(frame.mapped), _pool)) {
+		frame.deltaCopies.push_back({ copy.stagingOffset, copy.frameOffset, copy.size });
+	}
+	frame.delta = true;
+}
+
+void vre::VreIndexedFramebuffer::record(VkCommandBuffer _cmd, size_t _frame,
+	VkImage _target, VkExtent2D _targetExtent
+) {
+	FrameResources &frame = m_frames[_frame];
+
+	if (frame.delta) {
+		if (!frame.deltaCopies.empty()) {
+			vkCmdCopyBuffer(_cmd, frame.staging, frame.indices,
+				static_cast<uint32_t>(frame.deltaCopies.size()), frame.deltaCopies.data());
+		}
+		m_lastUploadBytes = m_delta.lastBytes();
+		frame.delta = false;
+	} else {
+		// written through upload or mapped, the other device copies no
+		// longer match what the delta tracker remembers
+		VkBufferCopy copy{};
+		copy.size = frameBytes();
+		vkCmdCopyBuffer(_cmd, frame.staging, frame.indices, 1, &copy);
+		m_lastUploadBytes = frameBytes();
+		m_delta.invalidate();
+	}
+
+	recordExpand(_cmd, _frame, _target, _targetExtent, VK_PIPELINE_STAGE_TRANSFER_BIT,
+		VK_ACCESS_TRANSFER_WRITE_BIT);
+}
+
+void vre::VreIndexedFramebuffer::recordComputed(VkCommandBuffer _cmd, size_t _frame,
+	VkImage _target, VkExtent2D _targetExtent
+) {
+	m_lastUploadBytes = 0;
+	m_delta.invalidate();
+	recordExpand(_cmd, _frame, _target, _targetExtent, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_ACCESS_SHADER_WRITE_BIT);
+}
+
+void vre::VreIndexedFramebuffer::recordSplit(VkCommandBuffer _cmd, size_t _frame,
+	uint32_t _cpuColumn, VkImage _target, VkExtent2D _targetExtent
+) {
+	FrameResources &frame = m_frames[_frame];
+
+	frame.deltaCopies.clear();
+	if (_cpuColumn < m_stride) {
+		for (uint32_t y = 0; y < m_height; y++) {
+			VkDeviceSize offset = static_cast<VkDeviceSize>(y) * m_stride + _cpuColumn;
+			frame.deltaCopies.push_back({ offset, offset, m_stride - _cpuColumn });
+		}
+		vkCmdCopyBuffer(_cmd, frame.staging, frame.indices,
+			static_cast<uint32_t>(frame.deltaCopies.size()), frame.deltaCopies.data());
+	}
+	m_lastUploadBytes = static_cast<VkDeviceSize>(m_stride - std::min(_cpuColumn, m_stride)) * m_height;
+	frame.delta = false;
+	m_delta.invalidate();
+
+	// the copies and the trace touch different bytes, the expansion waits
+	// for both
+	recordExpand(_cmd, _frame, _target, _targetExtent,
+		VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+}
+
+void vre::VreIndexedFramebuffer::drawSky(size_t _frame, const int16_t *_tops,
+	const int16_t *_bottoms, float _angle, float _fov
+) {
+	FrameResources &frame = m_frames[_frame];
+	m_sky->update(_frame, _tops, _bottoms);
+	frame.sky = true;
+	frame.skyAngle = _angle;
+	frame.skyFov = _fov;
+}
+
+void vre::VreIndexedFramebuffer::recordExpand(VkCommandBuffer _cmd, size_t _frame,
+	VkImage _target, VkExtent2D _targetExtent, VkPipelineStageFlags _srcStage,
+	VkAccessFlags _srcAccess
+) {
+	FrameResources &frame = m_frames[_frame];
+
+	// indices visible to the shader, draw image writable. the old contents
+	// of the draw image are not needed
+	VkBufferMemoryBarrier indexBarrier{};
+	indexBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+	indexBarrier.srcAccessMask = _srcAccess;
+	indexBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+	indexBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	indexBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	indexBarrier.buffer = frame.indices;
+	indexBarrier.offset = 0;
+	indexBarrier.size = VK_WHOLE_SIZE;
+
+	VkImageMemoryBarrier drawBarrier{};
+	drawBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	drawBarrier.srcAccessMask = 0;
+	drawBarrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	drawBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	drawBarrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+	drawBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	drawBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	drawBarrier.image = frame.drawImage;
+	drawBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+	vkCmdPipelineBarrier(_cmd, _srcStage,
+		VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr,
+		1, &indexBarrier, 1, &drawBarrier);
+
+	vkCmdBindPipeline(_cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline);
+	vkCmdBindDescriptorSets(_cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout,
+		0, 1, &frame.descriptorSet, 0, nullptr);
+
+	ExpandPushConstants push{};
+	push.strideWords = m_stride / 4;
+	vkCmdPushConstants(_cmd, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT,
+		0, sizeof(ExpandPushConstants), &push);
+
+	// one invocation per 4 packed indices, 16x16 workgroups
+	vkCmdDispatch(_cmd, (push.strideWords + 15) / 16, (m_height + 15) / 16, 1);
+
+	if (frame.sky) {
+		// the sky overwrites ceiling pixels the expansion just wrote
+		VkImageMemoryBarrier skyBarrier = drawBarrier;
+		skyBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		skyBarrier.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+		skyBarrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+		vkCmdPipelineBarrier(_cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+			VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &skyBarrier);
+		m_sky->record(_cmd, _frame, frame.skyAngle, frame.skyFov);
+		frame.sky = false;
+	}
+
+	// the swapchain image waits on the acquire semaphore, which is signalled
+	// at the color attachment output stage
+	VkImageMemoryBarrier blitBarriers[2]{};
+	blitBarriers[0] = drawBarrier;
+	blitBarriers[0].srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	blitBarriers[0].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+	blitBarriers[0].oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+	blitBarriers[0].newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+
+	blitBarriers[1] = drawBarrier;
+	blitBarriers[1].srcAccessMask = 0;
+	blitBarriers[1].dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	blitBarriers[1].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	blitBarriers[1].newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	blitBarriers[1].image = _target;
+
+	vkCmdPipelineBarrier(_cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
+		| VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+		VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 2, blitBarriers);
+
+	VkImageBlit blit{};
+	blit.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+	blit.srcOffsets[1] = { static_cast<int32_t>(m_width), static_cast<int32_t>(m_height), 1 };
+	blit.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+	blit.dstOffsets[1] = { static_cast<int32_t>(_targetExtent.width),
+		static_cast<int32_t>(_targetExtent.height), 1 };
+
+	// nearest keeps the hard pixel edges if the render resolution is lower
+	vkCmdBlitImage(_cmd, frame.drawImage, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+		_target, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_NEAREST);
+}
+
+void vre::VreIndexedFramebuffer::createDrawImage(FrameResources &_frame) {
+	VkImageCreateInfo imageInfo{};
+	imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+	imageInfo.imageType = VK_IMAGE_TYPE_2D;
+	imageInfo.extent.width = m_width;
+	imageInfo.extent.height = m_height;
+	imageInfo.extent.depth = 1;
+	imageInfo.mipLevels = 1;
+	imageInfo.arrayLayers = 1;
+	imageInfo.format = VK_FORMAT_R16G16B16A16_SFLOAT;
+	imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	imageInfo.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+	m_vreDevice.createImageWithInfo(imageInfo, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		_frame.drawImage, _frame.drawImageMemory);
+
+	VkImageViewCreateInfo viewInfo{};
+	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewInfo.image = _frame.drawImage;
+	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	viewInfo.format = imageInfo.format;
+	viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+	if (vkCreateImageView(m_vreDevice.device(), &viewInfo, nullptr,
+		&_frame.drawImageView) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create draw image view");
+	}
+}
+
+void vre::VreIndexedFramebuffer::createPalette(const VrePalette &_palette) {
+	VkDeviceSize size = sizeof(uint32_t) * VrePalette::RAMPS * VrePalette::SHADES;
+
+	VkBuffer staging;
+	VkDeviceMemory stagingMemory;
+	m_vreDevice.createBuffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		staging, stagingMemory);
+
+	void *data;
+	vkMapMemory(m_vreDevice.device(), stagingMemory, 0, size, 0, &data);
+	memcpy(data, _palette.colors(), static_cast<size_t>(size));
+	vkUnmapMemory(m_vreDevice.device(), stagingMemory);
+
+	m_vreDevice.createBuffer(size,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_palette, m_paletteMemory);
+	m_vreDevice.copyBuffer(staging, m_palette, size);
+
+	vkDestroyBuffer(m_vreDevice.device(), staging, nullptr);
+	vkFreeMemory(m_vreDevice.device(), stagingMemory, nullptr);
+}
+
+void vre::VreIndexedFramebuffer::createFrameResources() {
+	for (FrameResources &frame : m_frames) {
+		// stays mapped for the lifetime of the framebuffer
+		m_vreDevice.createBuffer(frameBytes(), VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			frame.staging, frame.stagingMemory);
+		vkMapMemory(m_vreDevice.device(), frame.stagingMemory, 0, frameBytes(), 0,
+			&frame.mapped);
+
+		m_vreDevice.createBuffer(frameBytes(),
+			VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, frame.indices, frame.indicesMemory);
+
+		createDrawImage(frame);
+	}
+}
+
+void vre::VreIndexedFramebuffer::createDescriptors() {
+	// 0 draw image, 1 indices, 2 palette
+	VkDescriptorSetLayoutBinding bindings[3]{};
+	bindings[0].binding = 0;
+	bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+	bindings[0].descriptorCount = 1;
+	bindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	bindings[1].binding = 1;
+	bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	bindings[1].descriptorCount = 1;
+	bindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	bindings[2] = bindings[1];
+	bindings[2].binding = 2;
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = 3;
+	layoutInfo.pBindings = bindings;
+
+	if (vkCreateDescriptorSetLayout(m_vreDevice.device(), &layoutInfo, nullptr,
+		&m_setLayout) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create palette descriptor set layout");
+	}
+
+	uint32_t frameCount = static_cast<uint32_t>(m_frames.size());
+	VkDescriptorPoolSize poolSizes[] = {
+		{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, frameCount },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2 * frameCount }
+	};
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.maxSets = frameCount;
+	poolInfo.poolSizeCount = 2;
+	poolInfo.pPoolSizes = poolSizes;
+
+	if (vkCreateDescriptorPool(m_vreDevice.device(), &poolInfo, nullptr,
+		&m_descriptorPool) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create palette descriptor pool");
+	}
+
+	for (FrameResources &frame : m_frames) {
+		VkDescriptorSetAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocInfo.descriptorPool = m_descriptorPool;
+		allocInfo.descriptorSetCount = 1;
+		allocInfo.pSetLayouts = &m_setLayout;
+
+		if (vkAllocateDescriptorSets(m_vreDevice.device(), &allocInfo,
+			&frame.descriptorSet) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to allocate palette descriptor set");
+		}
+
+		VkDescriptorImageInfo imageInfo{};
+		imageInfo.imageView = frame.drawImageView;
+		imageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+		VkDescriptorBufferInfo indexInfo{ frame.indices, 0, VK_WHOLE_SIZE };
+		VkDescriptorBufferInfo paletteInfo{ m_palette, 0, VK_WHOLE_SIZE };
+
+		VkWriteDescriptorSet writes[3]{};
+		for (int i = 0; i < 3; i++) {
+			writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writes[i].dstSet = frame.descriptorSet;
+			writes[i].dstBinding = i;
+			writes[i].descriptorCount = 1;
+			writes[i].descriptorType = bindings[i].descriptorType;
+		}
+		writes[0].pImageInfo = &imageInfo;
+		writes[1].pBufferInfo = &indexInfo;
+		writes[2].pBufferInfo = &paletteInfo;
+
+		vkUpdateDescriptorSets(m_vreDevice.device(), 3, writes, 0, nullptr);
+	}
+}
+
+void vre::VreIndexedFramebuffer::createPipeline() {
+	VkPushConstantRange pushConstantRange{};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(ExpandPushConstants);
+
+	VkPipelineLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	layoutInfo.setLayoutCount = 1;
+	layoutInfo.pSetLayouts = &m_setLayout;
+	layoutInfo.pushConstantRangeCount = 1;
+	layoutInfo.pPushConstantRanges = &pushConstantRange;
+
+	if (vkCreatePipelineLayout(m_vreDevice.device(), &layoutInfo, nullptr,
+		&m_pipelineLayout) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create palette pipeline layout");
+	}
+
+	std::vector<char> code = VrePipeline::readFile("./palette_expand.comp.spv");
+
+	VkShaderModuleCreateInfo moduleInfo{};
+	moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	moduleInfo.codeSize = code.size();
+	moduleInfo.pCode = reinterpret_cast<const uint32_t *>(code.data());
+
+	VkShaderModule module;
+	if (vkCreateShaderModule(m_vreDevice.device(), &moduleInfo, nullptr, &module) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create palette shader module");
+	}
+
+	VkComputePipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	pipelineInfo.stage.module = module;
+	pipelineInfo.stage.pName = "main";
+	pipelineInfo.layout = m_pipelineLayout;
+
+	VkResult result = vkCreateComputePipelines(m_vreDevice.device(), VK_NULL_HANDLE, 1,
+		&pipelineInfo, nullptr, &m_pipeline);
+	vkDestroyShaderModule(m_vreDevice.device(), module, nullptr);
+
+	if (result != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create palette compute pipeline");
+	}
+}
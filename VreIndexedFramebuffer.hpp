@@ -0,0 +1,116 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include "VreDevice.hpp"
+#include "VreSwapchain.hpp"
+#include "VrePalette.hpp"
+#include "VreFrameDelta.hpp"
+#include "VreSky.hpp"
+
+namespace vre {
+	// gpu side of the cpu renderer. every frame in flight owns a mapped
+	// staging buffer for the 8 bit indices, a device local copy and an
+	// rgba16f draw image, a compute pass expands the indices through the
+	// palette into the draw image which is then blitted into the swapchain
+	// image. frames that mostly stay the same can send only their changed
+	// blocks
+	class VreIndexedFramebuffer {
+	public:
+		VreIndexedFramebuffer(VreDevice &_device, uint32_t _width, uint32_t _height,
+			const VrePalette &_palette);
+		~VreIndexedFramebuffer();
+
+		VreIndexedFramebuffer(const VreIndexedFramebuffer &) = delete;
+		VreIndexedFramebuffer &operator=(const VreIndexedFramebuffer &) = delete;
+
+		// copies a finished frame, stride() * height() bytes, into the
+		// staging buffer of _frame
+		void upload(size_t _frame, const uint8_t *_pixels);
+		// the same frame diffed against the last one, only the column blocks
+		// the device copy of _frame hasn't seen yet are staged and copied
+		void uploadChanged(size_t _frame, const uint8_t *_pixels, VreThreadPool &_pool);
+		// the same staging buffer for writing the frame in place
+		uint8_t *mapped(size_t _frame) { return static_cast<uint8_t *>(m_frames[_frame].mapped); }
+
+		// records the upload, the palette expansion and the blit. _target
+		// ends up in TRANSFER_DST_OPTIMAL, ready for the swapchain render pass
+		void record(VkCommandBuffer _cmd, size_t _frame, VkImage _target,
+			VkExtent2D _targetExtent);
+		// the same without the upload, for indices a compute pass recorded
+		// earlier in _cmd wrote straight into indexBuffer(_frame)
+		void recordComputed(VkCommandBuffer _cmd, size_t _frame, VkImage _target,
+			VkExtent2D _targetExtent);
+		// both, for a frame split at byte column _cpuColumn. a compute pass
+		// wrote the columns left of it, the staging buffer holds the rest,
+		// which are copied row by row
+		void recordSplit(VkCommandBuffer _cmd, size_t _frame, uint32_t _cpuColumn,
+			VkImage _target, VkExtent2D _targetExtent);
+		// the next record of _frame draws the sky panorama over the ceiling
+		// after the expansion, down to the wall extents per column. _angle
+		// and _fov of the camera the frame was drawn with
+		void drawSky(size_t _frame, const int16_t *_tops, const int16_t *_bottoms, float _angle,
+			float _fov);
+		// device local, stride() * height() bytes, bound as a storage buffer
+		VkBuffer indexBuffer(size_t _frame) const { return m_frames[_frame].indices; }
+
+		uint32_t width() const { return m_width; }
+		uint32_t height() const { return m_height; }
+		uint32_t stride() const { return m_stride; }
+		VkDeviceSize frameBytes() const { return static_cast<VkDeviceSize>(m_stride) * m_height; }
+		// copied to the device by the last record
+		VkDeviceSize lastUploadBytes() const { return m_lastUploadBytes; }
+
+	private:
+		struct FrameResources {
+			VkBuffer staging = VK_NULL_HANDLE;
+			VkDeviceMemory stagingMemory = VK_NULL_HANDLE;
+			void *mapped = nullptr;
+			VkBuffer indices = VK_NULL_HANDLE;
+			VkDeviceMemory indicesMemory = VK_NULL_HANDLE;
+			// a frame still blitting from its draw image is never written by
+			// the next one
+			VkImage drawImage = VK_NULL_HANDLE;
+			VkDeviceMemory drawImageMemory = VK_NULL_HANDLE;
+			VkImageView drawImageView = VK_NULL_HANDLE;
+			VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+			// regions staged by uploadChanged, a whole frame is copied otherwise
+			std::vector<VkBufferCopy> deltaCopies;
+			bool delta = false;
+			bool sky = false;
+			float skyAngle = 0.0f;
+			float skyFov = 0.0f;
+		};
+
+		void recordExpand(VkCommandBuffer _cmd, size_t _frame, VkImage _target,
+			VkExtent2D _targetExtent, VkPipelineStageFlags _srcStage, VkAccessFlags _srcAccess);
+		void createDrawImage(FrameResources &_frame);
+		void createPalette(const VrePalette &_palette);
+		void createFrameResources();
+		void createDescriptors();
+		void createPipeline();
+
+		VreDevice &m_vreDevice;
+		uint32_t m_width;
+		uint32_t m_height;
+		uint32_t m_stride; // bytes per row, a multiple of 4
+
+		VkBuffer m_palette = VK_NULL_HANDLE;
+		VkDeviceMemory m_paletteMemory = VK_NULL_HANDLE;
+
+		std::array<FrameResources, VreSwapchain::MAX_FRAMES_IN_FLIGHT> m_frames;
+		VreFrameDelta m_delta;
+		std::unique_ptr<VreSky> m_sky;
+		VkDeviceSize m_lastUploadBytes = 0;
+
+		VkDescriptorPool m_descriptorPool = VK_NULL_HANDLE;
+		VkDescriptorSetLayout m_setLayout = VK_NULL_HANDLE;
+		VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE;
+		VkPipeline m_pipeline = VK_NULL_HANDLE;
+	};
+}
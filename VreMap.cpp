@@ -0,0 +1,98 @@
+#include "VreMap.hpp"
+
+#include <stdexcept>
+
+vre::VreMap::VreMap(int _width, int _height, int _cellSize, const int *_cells
+) : m_width(_width), m_height(_height), m_cellSize(_cellSize),
+	m_cells(_cells, _cells + _width * _height) {
+	if (_width <= 0 || _height <= 0 || _cellSize <= 0) {
+		throw std::runtime_error("Invalid map dimensions");
+	}
+	rebuildDerived();
+}
+
+vre::VreMap::VreMap(int _width, int _height, int _cellSize, const std::vector<int> &_cells
+) : VreMap(_width, _height, _cellSize, _cells.data()) {
+	if (_cells.size() != static_cast<size_t>(_width) * _height) {
+		throw std::runtime_error("Map cell count does not match its dimensions");
+	}
+}
+
+void vre::VreMap::setCell(int _x, int _y, int _value) {
+	m_cells[_y * m_width + _x] = _value;
+	// only ever turned on here, a stale true just means the layered path
+	m_hasTransparentCells |= isTransparent(_value);
+
+	// interior edits that still fit a byte are the common case (doors etc),
+	// anything else is rare enough to just rebuild the derived data
+	bool onBorder = _x == 0 || _y == 0 || _x == m_width - 1 || _y == m_height - 1;
+	if (!onBorder && hasCompactCells() && _value >= 0 && _value <= 0xFF) {
+		m_compactCells[_y * m_width + _x] = static_cast<uint8_t>(_value);
+		return;
+	}
+	rebuildDerived();
+}
+
+void vre::VreMap::setTransparent(int _wallId, bool _transparent) {
+	if (_wallId <= 0) {
+		throw std::runtime_error("Only wall ids can be transparent");
+	}
+	if (_wallId >= static_cast<int>(m_transparent.size())) {
+		m_transparent.resize(_wallId + 1, 0);
+	}
+	m_transparent[_wallId] = _transparent ? 1 : 0;
+
+	m_hasTransparentCells = false;
+	for (int cell : m_cells) {
+		if (isTransparent(cell)) {
+			m_hasTransparentCells = true;
+			break;
+		}
+	}
+}
+
+void vre::VreMap::setHeights(int _x, int _y, const CellHeights &_heights) {
+	if (_heights.ceiling < _heights.floor) {
+		throw std::runtime_error("Cell ceiling below its floor");
+	}
+	if (m_heights.empty()) {
+		m_heights.assign(m_cells.size(), CellHeights{});
+	}
+	m_heights[_y * m_width + _x] = _heights;
+}
+
+bool vre::VreMap::containsWorldPoint(float _x, float _y) const {
+	return _x >= 0.0f && _y >= 0.0f
+		&& _x < static_cast<float>(m_width * m_cellSize)
+		&& _y < static_cast<float>(m_height * m_cellSize);
+}
+
+int vre::VreMap::log2Exact(int _value) {
+	if (_value <= 0 || (_value & (_value - 1)) != 0) {
+		return -1;
+	}
+
+	int shift = 0;
+	while ((1 << shift) != _value) {
+		shift++;
+	}
+	return shift;
+}
+
+void vre::VreMap::rebuildDerived() {
+	m_solidBorder = true;
+	for (int x = 0; x < m_width && m_solidBorder; x++) {
+		m_solidBorder = at(x, 0) != 0 && at(x, m_height - 1) != 0;
+	}
+	for (int y = 0; y < m_height && m_solidBorder; y++) {
+		m_solidBorder = at(0, y) != 0 && at(m_width - 1, y) != 0;
+	}
+
+	m_compactCells.clear();
+	for (int cell : m_cells) {
+		if (cell < 0 || cell > 0xFF) {
+			return;
+		}
+	}
+	m_compactCells.assign(m_cells.begin(), m_cells.end());
+}
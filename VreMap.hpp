@@ -0,0 +1,82 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+namespace vre {
+	// vertical extent of a cell in cells, 0 is the ground and 1 the classic
+	// wall height. empty cells are open from floor to ceiling, wall cells
+	// are solid from floor to wallTop and open above it up to the ceiling
+	struct CellHeights {
+		float floor = 0.0f;
+		float ceiling = 1.0f;
+		float wallTop = 1.0f;
+	};
+
+	// grid level the raycaster walks. cells are stored row major, 0 is empty
+	// and any other value is a wall id. positions are in world units where
+	// one cell is m_cellSize units wide
+	class VreMap {
+	public:
+		VreMap() {}
+		VreMap(int _width, int _height, int _cellSize, const int *_cells);
+		VreMap(int _width, int _height, int _cellSize, const std::vector<int> &_cells);
+
+		int width() const { return m_width; }
+		int height() const { return m_height; }
+		int cellSize() const { return m_cellSize; }
+		bool empty() const { return m_cells.empty(); }
+
+		int at(int _x, int _y) const { return m_cells[_y * m_width + _x]; }
+		bool inBounds(int _x, int _y) const {
+			return _x >= 0 && _y >= 0 && _x < m_width && _y < m_height;
+		}
+		void setCell(int _x, int _y, int _value);
+
+		const int *data() const { return m_cells.data(); }
+
+		// one byte per cell copy of the map, only available when every wall id
+		// fits in a byte. it is 4x smaller so more of the map stays in cache
+		bool hasCompactCells() const { return !m_compactCells.empty(); }
+		const uint8_t *compactData() const { return m_compactCells.data(); }
+
+		// with a solid outer ring a ray started inside the map always hits a
+		// wall before it can leave, so traversal doesnt need bounds checks
+		bool hasSolidBorder() const { return m_solidBorder; }
+		bool containsWorldPoint(float _x, float _y) const;
+
+		// transparent wall ids (glass, grates) let rays through to the walls
+		// behind them. ids are per map, hasTransparentCells is true once any
+		// cell uses one so the opaque only case can skip the layered casts
+		void setTransparent(int _wallId, bool _transparent);
+		bool isTransparent(int _cell) const {
+			return _cell > 0 && _cell < static_cast<int>(m_transparent.size()) && m_transparent[_cell];
+		}
+		bool hasTransparentCells() const { return m_hasTransparentCells; }
+
+		// per cell heights, every cell is the default CellHeights until the
+		// first setHeights. maps that never call it stay flat and skip the
+		// stacked renderer
+		void setHeights(int _x, int _y, const CellHeights &_heights);
+		bool hasHeights() const { return !m_heights.empty(); }
+		CellHeights heights(int _x, int _y) const {
+			return m_heights.empty() ? CellHeights{} : m_heights[_y * m_width + _x];
+		}
+
+		// number of bits to shift by when a value is a power of two, -1 otherwise
+		static int log2Exact(int _value);
+
+	private:
+		void rebuildDerived();
+
+		int m_width = 0;
+		int m_height = 0;
+		int m_cellSize = 64;
+		std::vector<int> m_cells;
+		std::vector<uint8_t> m_compactCells;
+		std::vector<uint8_t> m_transparent; // indexed by wall id
+		std::vector<CellHeights> m_heights;
+		bool m_solidBorder = false;
+		bool m_hasTransparentCells = false;
+	};
+}
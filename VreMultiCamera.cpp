@@ -0,0 +1,67 @@
+#include "VreMultiCamera.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include "VrePalette.hpp"
+
+namespace {
+	// same light falloff as the cpu renderer, as a fraction
+	float shade(float _distanceCells, int _side) {
+		int light = static_cast<int>(_distanceCells / 1.5f) + _side;
+		light = std::min(light, vre::VrePalette::SHADES - 1);
+		return 1.0f - static_cast<float>(light) / static_cast<float>(vre::VrePalette::SHADES - 1);
+	}
+}
+
+vre::VreMultiCamera::VreMultiCamera(std::vector<const VreMap *> _maps,
+	MultiCameraSettings _settings
+) : m_settings{ _settings } {
+	if (_maps.empty()) {
+		throw std::runtime_error("Failed to create multi camera caster without a map");
+	}
+	if (m_settings.columns <= 0) {
+		throw std::runtime_error("Failed to create multi camera caster without columns");
+	}
+	m_raycasters.resize(_maps.size());
+	for (size_t i = 0; i < _maps.size(); i++) {
+		m_raycasters[i].bindMap(*_maps[i]);
+	}
+}
+
+void vre::VreMultiCamera::cast(const MultiCameraPoses &_poses, float *_out,
+	VreThreadPool &_pool
+) const {
+	int columns = m_settings.columns;
+	int camerasPerTask = std::max(m_settings.camerasPerTask, 1);
+	int tasks = (_poses.count + camerasPerTask - 1) / camerasPerTask;
+
+	_pool.parallelFor(tasks, [&](int _task) {
+		std::vector<RayHit> hits(columns);
+		int last = std::min((_task + 1) * camerasPerTask, _poses.count);
+		for (int camera = _task * camerasPerTask; camera < last; camera++) {
+			const VreRaycaster &raycaster = m_raycasters[_poses.mapIndex ? _poses.mapIndex[camera] : 0];
+			RayCamera pose{ _poses.x[camera], _poses.y[camera], _poses.angle[camera], m_settings.fov };
+			raycaster.castColumns(pose, 0, columns, columns, hits.data());
+
+			float invCellSize = 1.0f / static_cast<float>(raycaster.map()->cellSize());
+			float *depth = _out + (static_cast<size_t>(camera) * OBSERVATION_CHANNELS + OBSERVATION_DEPTH) * columns;
+			float *wall = _out + (static_cast<size_t>(camera) * OBSERVATION_CHANNELS + OBSERVATION_WALL) * columns;
+			float *light = _out + (static_cast<size_t>(camera) * OBSERVATION_CHANNELS + OBSERVATION_SHADE) * columns;
+			for (int column = 0; column < columns; column++) {
+				const RayHit &hit = hits[column];
+				if (hit.cell == 0) {
+					depth[column] = 0.0f;
+					wall[column] = 0.0f;
+					light[column] = 0.0f;
+					continue;
+				}
+				float distance = hit.distance * invCellSize;
+				depth[column] = distance;
+				wall[column] = static_cast<float>(hit.cell);
+				light[column] = shade(distance, hit.side);
+			}
+		}
+	});
+}
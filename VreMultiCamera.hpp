@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "VreMap.hpp"
+#include "VreRaycaster.hpp"
+#include "VreThreadPool.hpp"
+
+namespace vre {
+	// channels of one camera in the observation buffer
+	enum ObservationChannel {
+		OBSERVATION_DEPTH = 0, // perpendicular distance in cells, 0 if nothing was hit
+		OBSERVATION_WALL = 1, // wall id as a float, 0 for no wall
+		OBSERVATION_SHADE = 2, // [0, 1] light the cpu renderer would use
+		OBSERVATION_CHANNELS = 3,
+	};
+
+	// poses of all cameras, one array per field. _mapIndex picks the map
+	// per camera and may be null when every camera uses map 0
+	struct MultiCameraPoses {
+		const float *x;
+		const float *y;
+		const float *angle;
+		const uint16_t *mapIndex = nullptr;
+		int count;
+	};
+
+	struct MultiCameraSettings {
+		int columns = 64; // rays per camera
+		float fov = 1.0471976f; // 60 degrees, like RayCamera
+		int camerasPerTask = 64;
+	};
+
+	// many small viewpoints per tick for agents or split screen, no window
+	// or swapchain involved. every camera writes columns floats for each
+	// channel into one buffer laid out [camera][channel][column]. each
+	// camera is one castColumns of its map's raycaster, the cameras are
+	// split into pool tasks
+	class VreMultiCamera {
+	public:
+		VreMultiCamera(std::vector<const VreMap *> _maps, MultiCameraSettings _settings = {});
+
+		// _out holds outputSize(_poses.count) floats
+		void cast(const MultiCameraPoses &_poses, float *_out, VreThreadPool &_pool) const;
+
+		size_t outputSize(int _cameras) const {
+			return static_cast<size_t>(_cameras) * OBSERVATION_CHANNELS * m_settings.columns;
+		}
+		const MultiCameraSettings &settings() const { return m_settings; }
+
+	private:
+		std::vector<VreRaycaster> m_raycasters; // one per map
+		MultiCameraSettings m_settings;
+	};
+}
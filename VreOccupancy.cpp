@@ -0,0 +1,195 @@
+#include "VreOccupancy.hpp"
+#include "VreRaycaster.hpp"
+
+#include <bit>
+#include <algorithm>
+
+namespace {
+	// walks one ray line by line. in row mode (Transposed = false) a line is a
+	// map row and we scan along x, in column mode a line is a map column and
+	// we scan along y. "major" faces are the ones crossed while scanning
+	template<bool Transposed>
+	void castSpans(const vre::VreOccupancyGrid &_grid, const vre::VreMap &_map,
+		const vre::RayCamera &_camera, float _dirX, float _dirY, vre::RayHit &_out,
+		[[maybe_unused]] vre::RayStatsCounters &_stats
+	) {
+		const float cellSize = static_cast<float>(_map.cellSize());
+		const float invCellSize = 1.0f / cellSize;
+
+		const float posA = Transposed ? _camera.y : _camera.x;
+		const float posB = Transposed ? _camera.x : _camera.y;
+		const float dirA = Transposed ? _dirY : _dirX;
+		const float dirB = Transposed ? _dirX : _dirY;
+		const int sizeA = Transposed ? _map.height() : _map.width();
+		const int sizeB = Transposed ? _map.width() : _map.height();
+		const int stepA = dirA < 0.0f ? -1 : 1;
+		const int stepB = dirB < 0.0f ? -1 : 1;
+
+		int line = static_cast<int>(std::floor(posB * invCellSize));
+		int entry = static_cast<int>(std::floor(posA * invCellSize));
+		// the camera cell itself never counts as a hit
+		int from = entry + stepA;
+		bool firstLine = true;
+
+		// the ray's position along a moves by slope per unit of b. the exit of
+		// every line is computed from the camera in double, summing a per
+		// line step or rounding to float puts exits near a corner on the
+		// wrong cell once the map is a few thousand cells wide
+		double slope = dirB != 0.0f ? static_cast<double>(dirA) / dirB : 0.0;
+		const double cellsPerUnit = 1.0 / cellSize;
+
+		int hit = -1;
+		bool majorFace = true;
+		VRE_RAY_STATS(int steps = 0;)
+		VRE_RAY_STATS(int words = 0;)
+		while (line >= 0 && line < sizeB) {
+			VRE_RAY_STATS(steps++;)
+			int exit = stepA > 0 ? sizeA : -1;
+			if (dirB != 0.0f) {
+				double boundary = static_cast<double>(stepB > 0 ? line + 1 : line) * cellSize;
+				exit = static_cast<int>(std::floor((posA + (boundary - posB) * slope) * cellsPerUnit));
+			}
+
+			bool leavesMap = exit < 0 || exit >= sizeA;
+			exit = std::clamp(exit, 0, sizeA - 1);
+			// rounding at a corner can put the exit a cell behind the entry
+			if ((exit - entry) * stepA < 0) {
+				exit = entry;
+			}
+
+			if (from >= 0 && from < sizeA && (exit - from) * stepA >= 0) {
+				hit = Transposed ? _grid.findInColumn(line, from, exit)
+					: _grid.findInRow(line, from, exit);
+				// each 64 bit word scanned counts as one tile
+				VRE_RAY_STATS(words += std::abs((exit >> 6) - (from >> 6)) + 1;)
+			}
+
+			if (hit >= 0) {
+				// a hit on the entry cell means the ray came in through the
+				// line boundary, not through a face along the scan
+				majorFace = firstLine || hit != entry;
+				break;
+			}
+			if (leavesMap) {
+				break;
+			}
+
+			line += stepB;
+			entry = exit;
+			from = exit;
+			firstLine = false;
+		}
+
+		if (hit < 0) {
+			_out = {};
+			_out.distance = vre::raycast::NO_HIT_DISTANCE;
+			VRE_RAY_STATS(_stats.addRay(steps, words, false, 0.0f);)
+			return;
+		}
+
+		float distance;
+		if (majorFace) {
+			float boundary = static_cast<float>(stepA > 0 ? hit : hit + 1) * cellSize;
+			distance = (boundary - posA) / dirA;
+		} else {
+			float boundary = static_cast<float>(stepB > 0 ? line : line + 1) * cellSize;
+			distance = (boundary - posB) / dirB;
+		}
+
+		int mapX = Transposed ? line : hit;
+		int mapY = Transposed ? hit : line;
+		int side = majorFace != Transposed ? 0 : 1;
+		vre::raycast::finishHit(_camera, _dirX, _dirY, distance, invCellSize,
+			mapX, mapY, _map.at(mapX, mapY), side, _out);
+		VRE_RAY_STATS(_stats.addRay(steps, words, true, distance * invCellSize);)
+	}
+}
+
+void vre::VreOccupancyGrid::build(const VreMap &_map) {
+	m_width = _map.width();
+	m_height = _map.height();
+	m_rowWords = (m_width + 63) / 64;
+	m_columnWords = (m_height + 63) / 64;
+	m_rows.assign(static_cast<size_t>(m_rowWords) * m_height, 0);
+	m_columns.assign(static_cast<size_t>(m_columnWords) * m_width, 0);
+
+	for (int y = 0; y < m_height; y++) {
+		for (int x = 0; x < m_width; x++) {
+			if (_map.at(x, y) != 0) {
+				m_rows[y * m_rowWords + (x >> 6)] |= uint64_t(1) << (x & 63);
+				m_columns[x * m_columnWords + (y >> 6)] |= uint64_t(1) << (y & 63);
+			}
+		}
+	}
+}
+
+void vre::VreOccupancyGrid::setCell(int _x, int _y, bool _solid) {
+	uint64_t &row = m_rows[_y * m_rowWords + (_x >> 6)];
+	uint64_t &column = m_columns[_x * m_columnWords + (_y >> 6)];
+	uint64_t rowBit = uint64_t(1) << (_x & 63);
+	uint64_t columnBit = uint64_t(1) << (_y & 63);
+
+	if (_solid) {
+		row |= rowBit;
+		column |= columnBit;
+	} else {
+		row &= ~rowBit;
+		column &= ~columnBit;
+	}
+}
+
+int vre::VreOccupancyGrid::findInLine(const uint64_t *_line, int _from, int _to) {
+	int word = _from >> 6;
+	int lastWord = _to >> 6;
+
+	if (_from <= _to) {
+		uint64_t bits = _line[word] & (~uint64_t(0) << (_from & 63));
+		while (true) {
+			if (word == lastWord) {
+				bits &= ~uint64_t(0) >> (63 - (_to & 63));
+			}
+			if (bits != 0) {
+				return (word << 6) + std::countr_zero(bits);
+			}
+			if (word == lastWord) {
+				return -1;
+			}
+			bits = _line[++word];
+		}
+	}
+
+	uint64_t bits = _line[word] & (~uint64_t(0) >> (63 - (_from & 63)));
+	while (true) {
+		if (word == lastWord) {
+			bits &= ~uint64_t(0) << (_to & 63);
+		}
+		if (bits != 0) {
+			return (word << 6) + 63 - std::countl_zero(bits);
+		}
+		if (word == lastWord) {
+			return -1;
+		}
+		bits = _line[--word];
+	}
+}
+
+void vre::raycast::castOccupancy(const VreOccupancyGrid &_grid, const VreMap &_map,
+	const RayCamera &_camera, int _firstColumn, int _columnCount,
+	int _screenWidth, RayHit *_out
+) {
+	RayFrustum frustum(_camera, _screenWidth);
+	// stays empty when stats are compiled out
+	RayStatsCounters stats;
+	for (int i = 0; i < _columnCount; i++) {
+		float dirX;
+		float dirY;
+		frustum.direction(_firstColumn + i, dirX, dirY);
+
+		if (std::abs(dirX) >= std::abs(dirY)) {
+			castSpans<false>(_grid, _map, _camera, dirX, dirY, _out[i], stats);
+		} else {
+			castSpans<true>(_grid, _map, _camera, dirX, dirY, _out[i], stats);
+		}
+	}
+	VRE_RAY_STATS(VreRayStats::local().merge(stats);)
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+#include "VreMap.hpp"
+
+namespace vre {
+	struct RayCamera;
+	struct RayHit;
+
+	// 1 bit per cell solid/empty layer of a VreMap. rows are stored as 64 bit
+	// words, and a transposed copy stores the columns so vertical scans are
+	// word sized too. a 16k x 16k map is 32 MB per copy instead of 1 GB of ints
+	class VreOccupancyGrid {
+	public:
+		void build(const VreMap &_map);
+		void setCell(int _x, int _y, bool _solid);
+
+		bool solid(int _x, int _y) const {
+			return (m_rows[_y * m_rowWords + (_x >> 6)] >> (_x & 63)) & 1;
+		}
+
+		// first solid cell walking from _from to _to (both inclusive, either
+		// direction), -1 if the whole range is empty
+		int findInRow(int _y, int _from, int _to) const {
+			return findInLine(&m_rows[_y * m_rowWords], _from, _to);
+		}
+		int findInColumn(int _x, int _from, int _to) const {
+			return findInLine(&m_columns[_x * m_columnWords], _from, _to);
+		}
+
+		int width() const { return m_width; }
+		int height() const { return m_height; }
+		size_t memoryBytes() const {
+			return (m_rows.size() + m_columns.size()) * sizeof(uint64_t);
+		}
+
+	private:
+		static int findInLine(const uint64_t *_line, int _from, int _to);
+
+		int m_width = 0;
+		int m_height = 0;
+		int m_rowWords = 0;
+		int m_columnWords = 0;
+		std::vector<uint64_t> m_rows;
+		std::vector<uint64_t> m_columns;
+	};
+
+	namespace raycast {
+		// rays within this slope of an axis cross many cells per row or column
+		// and are scanned a word at a time. that only pays on sparse maps,
+		// "bench occupancy" has near axis rays about 2.8x faster at 4096^2 with
+		// 0.05% walls and no faster than the dda at 1024^2 with 2%
+		constexpr float NEAR_AXIS_SLOPE = 0.25f;
+
+		inline bool isNearAxis(float _dirX, float _dirY) {
+			float ax = _dirX < 0.0f ? -_dirX : _dirX;
+			float ay = _dirY < 0.0f ? -_dirY : _dirY;
+			return ay <= ax * NEAR_AXIS_SLOPE || ax <= ay * NEAR_AXIS_SLOPE;
+		}
+
+		// walks the ray one row (or column, for mostly vertical rays) at a
+		// time and finds the first solid cell of each span with a bit scan
+		void castOccupancy(const VreOccupancyGrid &_grid, const VreMap &_map,
+			const RayCamera &_camera, int _firstColumn, int _columnCount,
+			int _screenWidth, RayHit *_out);
+	}
+}
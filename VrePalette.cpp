@@ -0,0 +1,71 @@
+#include "VrePalette.hpp"
+
+vre::VrePalette::VrePalette() {
+	fillRamp(RAMP_CEILING, 40, 90, 160);
+	fillRamp(1, 200, 60, 50);
+	fillRamp(2, 60, 170, 70);
+	fillRamp(3, 70, 90, 200);
+	fillRamp(4, 210, 190, 80);
+	fillRamp(5, 170, 80, 180);
+	fillRamp(6, 80, 180, 180);
+	fillRamp(7, 200, 200, 200);
+	fillRamp(8, 150, 100, 60);
+	fillRamp(RAMP_FLOOR, 100, 100, 110);
+	for (int ramp = RAMP_SPRITE; ramp < RAMPS; ramp++) {
+		fillRamp(ramp, 255, 255, 255);
+	}
+
+	// shades are linear, so darkening only moves down the same ramp
+	for (int light = 0; light < SHADES; light++) {
+		for (int i = 0; i < RAMPS * SHADES; i++) {
+			int shade = (i & 15) - light;
+			m_colormaps[light][i] = index(i >> 4, shade < 0 ? 0 : shade);
+		}
+	}
+	buildBlendTable();
+}
+
+void vre::VrePalette::setRamp(int _ramp, uint8_t _r, uint8_t _g, uint8_t _b) {
+	fillRamp(_ramp, _r, _g, _b);
+	buildBlendTable();
+}
+
+void vre::VrePalette::fillRamp(int _ramp, uint8_t _r, uint8_t _g, uint8_t _b) {
+	for (int shade = 0; shade < SHADES; shade++) {
+		uint32_t r = _r * shade / (SHADES - 1);
+		uint32_t g = _g * shade / (SHADES - 1);
+		uint32_t b = _b * shade / (SHADES - 1);
+		m_colors[index(_ramp, shade)] = r | (g << 8) | (b << 16) | (0xffu << 24);
+	}
+}
+
+void vre::VrePalette::buildBlendTable() {
+	constexpr int COLORS = RAMPS * SHADES;
+	for (int over = 0; over < COLORS; over++) {
+		for (int under = 0; under <= over; under++) {
+			uint32_t a = m_colors[over];
+			uint32_t b = m_colors[under];
+			uint8_t mixed = nearest(static_cast<int>((a & 0xff) + (b & 0xff)) / 2,
+				static_cast<int>(((a >> 8) & 0xff) + ((b >> 8) & 0xff)) / 2,
+				static_cast<int>(((a >> 16) & 0xff) + ((b >> 16) & 0xff)) / 2);
+			m_blend[over][under] = mixed;
+			m_blend[under][over] = mixed;
+		}
+	}
+}
+
+uint8_t vre::VrePalette::nearest(int _r, int _g, int _b) const {
+	int best = 0;
+	int bestDistance = 1 << 30;
+	for (int i = 0; i < RAMPS * SHADES; i++) {
+		int dr = static_cast<int>(m_colors[i] & 0xff) - _r;
+		int dg = static_cast<int>((m_colors[i] >> 8) & 0xff) - _g;
+		int db = static_cast<int>((m_colors[i] >> 16) & 0xff) - _b;
+		int distance = dr * dr + dg * dg + db * db;
+		if (distance < bestDistance) {
+			best = i;
+			bestDistance = distance;
+		}
+	}
+	return static_cast<uint8_t>(best);
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+
+namespace vre {
+	// 256 colour palette laid out as 16 ramps of 16 shades, shade 15 is the
+	// full colour and shade 0 is black. the cpu renderer only writes these
+	// indices, the gpu expands them to colours
+	class VrePalette {
+	public:
+		static constexpr int RAMPS = 16;
+		static constexpr int SHADES = 16;
+
+		static constexpr int RAMP_CEILING = 0;
+		static constexpr int RAMP_FLOOR = 9;
+		static constexpr int RAMP_SPRITE = 10; // 10..15 are free for sprites
+
+		// ramp 0 ceiling, ramps 1..8 wall ids, ramp 9 floor
+		VrePalette();
+
+		static uint8_t index(int _ramp, int _shade) {
+			return static_cast<uint8_t>((_ramp << 4) | _shade);
+		}
+
+		// darkens an index by _light shades, the classic colormap lookup
+		uint8_t shade(uint8_t _index, int _light) const {
+			return m_colormaps[_light][_index];
+		}
+
+		// index closest to an even mix of two indices, the translucency table
+		// see through walls are composited with. symmetric
+		uint8_t blend(uint8_t _under, uint8_t _over) const {
+			return m_blend[_over][_under];
+		}
+
+		// wall ids beyond the palette wrap around the wall ramps
+		static int wallRamp(int _cell) { return 1 + (_cell - 1) % 8; }
+
+		// changing a ramp rebuilds the blend table
+		void setRamp(int _ramp, uint8_t _r, uint8_t _g, uint8_t _b);
+
+		// rgba8, red in the lowest byte, the layout unpackUnorm4x8 expects
+		const uint32_t *colors() const { return m_colors; }
+
+	private:
+		void fillRamp(int _ramp, uint8_t _r, uint8_t _g, uint8_t _b);
+		void buildBlendTable();
+		uint8_t nearest(int _r, int _g, int _b) const;
+
+		uint32_t m_colors[RAMPS * SHADES];
+		uint8_t m_colormaps[SHADES][RAMPS * SHADES];
+		uint8_t m_blend[RAMPS * SHADES][RAMPS * SHADES];
+	};
+}
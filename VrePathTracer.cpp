@@ -0,0 +1,431 @@
+#include "VrePathTracer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "VrePalette.hpp"
+
+namespace {
+	constexpr float PI = 3.14159265f;
+	// light panel radiance, bright enough that a few panels light a room
+	constexpr float LIGHT_RADIANCE = 30.0f;
+	// share of light samples that go to the near list, the rest are spread
+	// over every light so the estimate stays unbiased
+	constexpr float NEAR_LIGHT_PROBABILITY = 0.9f;
+
+	uint32_t hash(uint32_t _value) {
+		// pcg output permutation
+		uint32_t state = _value * 747796405u + 2891336453u;
+		uint32_t word = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+		return (word >> 22u) ^ word;
+	}
+
+	float random(uint32_t &_rng) {
+		_rng = hash(_rng);
+		return static_cast<float>(_rng >> 8) * (1.0f / 16777216.0f);
+	}
+
+	float linearChannel(uint32_t _color, int _shift) {
+		return std::pow(static_cast<float>((_color >> _shift) & 0xff) / 255.0f, 2.2f);
+	}
+
+	// round to nearest, values here are finite and never negative
+	uint16_t floatToHalf(float _value) {
+		uint32_t bits;
+		memcpy(&bits, &_value, sizeof(bits));
+		int exponent = static_cast<int>((bits >> 23) & 0xff) - 127 + 15;
+		uint32_t mantissa = bits & 0x7fffff;
+		if (exponent <= 0) {
+			return 0;
+		}
+		if (exponent >= 31) {
+			return 0x7bff;
+		}
+		uint32_t half = (static_cast<uint32_t>(exponent) << 10) | (mantissa >> 13);
+		half += (mantissa >> 12) & 1;
+		return static_cast<uint16_t>(half);
+	}
+
+	float displayValue(float _sum, float _scale) {
+		return std::pow(std::min(_sum * _scale, 1.0f), 1.0f / 2.2f);
+	}
+}
+
+void vre::VrePathTracer::bindMap(const VreMap &_map, PathTracerSettings _settings) {
+	m_map = &_map;
+	m_settings = _settings;
+	m_cellSize = static_cast<float>(_map.cellSize());
+	m_invCellSize = 1.0f / m_cellSize;
+
+	// surfaces take their colour from the same palette as the cpu renderer
+	VrePalette palette;
+	auto albedo = [&](int _ramp) {
+		uint32_t color = palette.colors()[VrePalette::index(_ramp, VrePalette::SHADES - 1)];
+		return Vec3{ linearChannel(color, 0), linearChannel(color, 8), linearChannel(color, 16) };
+	};
+	for (int i = 0; i < 8; i++) {
+		m_wallAlbedo[i] = albedo(VrePalette::wallRamp(i + 1));
+	}
+	m_floorAlbedo = albedo(VrePalette::RAMP_FLOOR);
+	m_ceilingAlbedo = albedo(VrePalette::RAMP_CEILING);
+
+	placeLights();
+}
+
+void vre::VrePathTracer::placeLights() {
+	std::vector<PathTracerLight> lights;
+	int spacing = m_settings.lightSpacing;
+	for (int y = 0; spacing > 0 && y < m_map->height(); y++) {
+		for (int x = 0; x < m_map->width(); x++) {
+			if (x % spacing != spacing / 2 || y % spacing != spacing / 2 || m_map->at(x, y) != 0) {
+				continue;
+			}
+			lights.push_back({ (x + 0.5f) * m_cellSize, (y + 0.5f) * m_cellSize,
+				m_cellSize * 0.3f, LIGHT_RADIANCE, LIGHT_RADIANCE * 0.9f, LIGHT_RADIANCE * 0.75f });
+		}
+	}
+	setLights(std::move(lights));
+}
+
+void vre::VrePathTracer::setLights(std::vector<PathTracerLight> _lights) {
+	m_lights = std::move(_lights);
+	m_lightCells.assign(static_cast<size_t>(m_map->width()) * m_map->height(), -1);
+	for (size_t i = 0; i < m_lights.size(); i++) {
+		int x = static_cast<int>(std::floor(m_lights[i].x * m_invCellSize));
+		int y = static_cast<int>(std::floor(m_lights[i].y * m_invCellSize));
+		if (m_map->inBounds(x, y)) {
+			m_lightCells[static_cast<size_t>(y) * m_map->width() + x] = static_cast<int>(i);
+		}
+	}
+
+	int radius = m_settings.nearLightRadius;
+	m_nearLightStart.clear();
+	m_nearLights.clear();
+	for (int y = 0; y < m_map->height(); y++) {
+		for (int x = 0; x < m_map->width(); x++) {
+			m_nearLightStart.push_back(static_cast<int>(m_nearLights.size()));
+			for (size_t i = 0; i < m_lights.size(); i++) {
+				int lightX = static_cast<int>(std::floor(m_lights[i].x * m_invCellSize));
+				int lightY = static_cast<int>(std::floor(m_lights[i].y * m_invCellSize));
+				if (std::abs(lightX - x) <= radius && std::abs(lightY - y) <= radius) {
+					m_nearLights.push_back(static_cast<int>(i));
+				}
+			}
+		}
+	}
+	m_nearLightStart.push_back(static_cast<int>(m_nearLights.size()));
+	reset();
+}
+
+int vre::VrePathTracer::pickLight(const Vec3 &_point, uint32_t &_rng, float &_pdf) const {
+	int count = static_cast<int>(m_lights.size());
+	int mapX = std::clamp(static_cast<int>(std::floor(_point.x * m_invCellSize)), 0, m_map->width() - 1);
+	int mapY = std::clamp(static_cast<int>(std::floor(_point.y * m_invCellSize)), 0, m_map->height() - 1);
+	size_t cell = static_cast<size_t>(mapY) * m_map->width() + mapX;
+	int first = m_nearLightStart[cell];
+	int nearCount = m_nearLightStart[cell + 1] - first;
+
+	int light;
+	if (nearCount > 0 && random(_rng) < NEAR_LIGHT_PROBABILITY) {
+		light = m_nearLights[first + std::min(static_cast<int>(random(_rng) * nearCount), nearCount - 1)];
+	} else {
+		light = std::min(static_cast<int>(random(_rng) * count), count - 1);
+	}
+
+	// either branch could have produced it
+	_pdf = (nearCount > 0 ? 1.0f - NEAR_LIGHT_PROBABILITY : 1.0f) / count;
+	if (nearCount > 0) {
+		const int *nearLights = &m_nearLights[first];
+		if (std::find(nearLights, nearLights + nearCount, light) != nearLights + nearCount) {
+			_pdf += NEAR_LIGHT_PROBABILITY / nearCount;
+		}
+	}
+	return light;
+}
+
+void vre::VrePathTracer::resize(int _width, int _height) {
+	m_width = _width;
+	m_height = _height;
+	m_accumulation.assign(static_cast<size_t>(_width) * _height * 4, 0.0f);
+	m_samples = 0;
+}
+
+void vre::VrePathTracer::reset() {
+	std::fill(m_accumulation.begin(), m_accumulation.end(), 0.0f);
+	m_samples = 0;
+}
+
+void vre::VrePathTracer::renderSample(const RayCamera &_camera, VreThreadPool &_pool) {
+	if (_camera.x != m_lastCamera.x || _camera.y != m_lastCamera.y
+		|| _camera.angle != m_lastCamera.angle || _camera.fov != m_lastCamera.fov) {
+		reset();
+		m_lastCamera = _camera;
+	}
+
+	int tilesX = (m_width + m_settings.tileSize - 1) / m_settings.tileSize;
+	int tilesY = (m_height + m_settings.tileSize - 1) / m_settings.tileSize;
+	_pool.parallelFor(tilesX * tilesY, [&](int _tile) {
+		renderTile(_camera, _tile);
+	});
+	m_samples++;
+}
+
+void vre::VrePathTracer::renderTile(const RayCamera &_camera, int _tile) {
+	int tileSize = m_settings.tileSize;
+	int tilesX = (m_width + tileSize - 1) / tileSize;
+	int x0 = (_tile % tilesX) * tileSize;
+	int y0 = (_tile / tilesX) * tileSize;
+	int x1 = std::min(x0 + tileSize, m_width);
+	int y1 = std::min(y0 + tileSize, m_height);
+
+	// same horizontal frustum as the raycaster, square pixels vertically
+	float forwardX = std::cos(_camera.angle);
+	float forwardY = std::sin(_camera.angle);
+	float planeScale = std::tan(_camera.fov * 0.5f);
+	float planeX = -forwardY * planeScale;
+	float planeY = forwardX * planeScale;
+	float upScale = planeScale * static_cast<float>(m_height) / static_cast<float>(m_width);
+	Vec3 eye{ _camera.x, _camera.y, m_settings.eyeHeight * m_cellSize };
+
+	for (int y = y0; y < y1; y++) {
+		for (int x = x0; x < x1; x++) {
+			uint32_t rng = hash(static_cast<uint32_t>(y * m_width + x) ^ hash(static_cast<uint32_t>(m_samples)));
+			float cameraX = (x + random(rng)) * 2.0f / m_width - 1.0f;
+			float cameraY = 1.0f - (y + random(rng)) * 2.0f / m_height;
+
+			Vec3 dir{ forwardX + planeX * cameraX, forwardY + planeY * cameraX, upScale * cameraY };
+			float invLength = 1.0f / std::sqrt(dir.x * dir.x + dir.y * dir.y + dir.z * dir.z);
+			dir = { dir.x * invLength, dir.y * invLength, dir.z * invLength };
+
+			Vec3 radiance = trace(eye, dir, rng);
+			float *pixel = &m_accumulation[(static_cast<size_t>(y) * m_width + x) * 4];
+			pixel[0] += radiance.x;
+			pixel[1] += radiance.y;
+			pixel[2] += radiance.z;
+			pixel[3] += 1.0f;
+		}
+	}
+}
+
+vre::VrePathTracer::Vec3 vre::VrePathTracer::trace(Vec3 _origin, Vec3 _dir, uint32_t &_rng) const {
+	const float epsilon = m_cellSize * 1e-3f;
+	const float ceiling = m_cellSize;
+	Vec3 radiance{ 0.0f, 0.0f, 0.0f };
+	Vec3 throughput{ 1.0f, 1.0f, 1.0f };
+
+	for (int bounce = 0; bounce <= m_settings.maxBounces; bounce++) {
+		SurfaceHit hit;
+		if (!intersect(_origin, _dir, hit)) {
+			break;
+		}
+		Vec3 point{ _origin.x + _dir.x * hit.t, _origin.y + _dir.y * hit.t, _origin.z + _dir.z * hit.t };
+		Vec3 normal = hit.normal;
+
+		// emitters only count when seen directly, every later bounce gets
+		// their light through the explicit light sample below
+		if (bounce == 0 && hit.light >= 0) {
+			const PathTracerLight &light = m_lights[hit.light];
+			radiance = { light.r, light.g, light.b };
+		}
+
+		Vec3 offsetPoint{ point.x + normal.x * epsilon, point.y + normal.y * epsilon,
+			point.z + normal.z * epsilon };
+
+		if (!m_lights.empty()) {
+			float pickPdf;
+			const PathTracerLight &light = m_lights[pickLight(point, _rng, pickPdf)];
+			Vec3 target{ light.x + (random(_rng) * 2.0f - 1.0f) * light.halfSize,
+				light.y + (random(_rng) * 2.0f - 1.0f) * light.halfSize, ceiling };
+			Vec3 toLight{ target.x - point.x, target.y - point.y, target.z - point.z };
+			float distanceSquared = toLight.x * toLight.x + toLight.y * toLight.y + toLight.z * toLight.z;
+			float invDistance = 1.0f / std::sqrt(distanceSquared);
+			float cosSurface = (toLight.x * normal.x + toLight.y * normal.y + toLight.z * normal.z) * invDistance;
+			// panels face straight down
+			float cosLight = toLight.z * invDistance;
+
+			if (cosSurface > 0.0f && cosLight > 0.0f && !occluded(offsetPoint, target)) {
+				float area = 4.0f * light.halfSize * light.halfSize;
+				float weight = cosSurface * cosLight * area / (PI * distanceSquared * pickPdf);
+				radiance.x += throughput.x * hit.albedo.x * light.r * weight;
+				radiance.y += throughput.y * hit.albedo.y * light.g * weight;
+				radiance.z += throughput.z * hit.albedo.z * light.b * weight;
+			}
+		}
+
+		throughput = { throughput.x * hit.albedo.x, throughput.y * hit.albedo.y,
+			throughput.z * hit.albedo.z };
+
+		// russian roulette once the path has lost most of its energy
+		if (bounce >= 2) {
+			float survive = std::clamp(std::max({ throughput.x, throughput.y, throughput.z }), 0.05f, 1.0f);
+			if (random(_rng) >= survive) {
+				break;
+			}
+			throughput = { throughput.x / survive, throughput.y / survive, throughput.z / survive };
+		}
+
+		// cosine weighted direction, normals are always axis aligned so the
+		// local frame is a swizzle
+		float u = random(_rng);
+		float phi = 2.0f * PI * random(_rng);
+		float radius = std::sqrt(u);
+		float a = radius * std::cos(phi);
+		float b = radius * std::sin(phi);
+		float up = std::sqrt(std::max(1.0f - u, 0.0f));
+		if (normal.z != 0.0f) {
+			_dir = { a, b, up * normal.z };
+		} else if (normal.x != 0.0f) {
+			_dir = { up * normal.x, a, b };
+		} else {
+			_dir = { a, up * normal.y, b };
+		}
+		_origin = offsetPoint;
+	}
+	return radiance;
+}
+
+bool vre::VrePathTracer::intersect(const Vec3 &_origin, const Vec3 &_dir, SurfaceHit &_hit) const {
+	float tPlane = raycast::NO_HIT_DISTANCE;
+	if (_dir.z > 0.0f) {
+		tPlane = (m_cellSize - _origin.z) / _dir.z;
+	} else if (_dir.z < 0.0f) {
+		tPlane = -_origin.z / _dir.z;
+	}
+
+	int mapX = static_cast<int>(std::floor(_origin.x * m_invCellSize));
+	int mapY = static_cast<int>(std::floor(_origin.y * m_invCellSize));
+	float deltaX = raycast::deltaDistance(m_cellSize, _dir.x);
+	float deltaY = raycast::deltaDistance(m_cellSize, _dir.y);
+	float sideX = raycast::firstSideDistance(m_cellSize, _origin.x - mapX * m_cellSize, _dir.x);
+	float sideY = raycast::firstSideDistance(m_cellSize, _origin.y - mapY * m_cellSize, _dir.y);
+	int stepX = _dir.x < 0.0f ? -1 : 1;
+	int stepY = _dir.y < 0.0f ? -1 : 1;
+
+	while (true) {
+		float t;
+		int side;
+		if (sideX < sideY) {
+			t = sideX;
+			side = 0;
+		} else {
+			t = sideY;
+			side = 1;
+		}
+
+		// the floor or ceiling comes before the next grid line
+		if (t >= tPlane) {
+			if (tPlane == raycast::NO_HIT_DISTANCE) {
+				return false;
+			}
+			_hit.t = tPlane;
+			if (_dir.z < 0.0f) {
+				_hit.normal = { 0.0f, 0.0f, 1.0f };
+				_hit.albedo = m_floorAlbedo;
+				_hit.light = -1;
+			} else {
+				_hit.normal = { 0.0f, 0.0f, -1.0f };
+				_hit.albedo = m_ceilingAlbedo;
+				_hit.light = lightAt(_origin.x + _dir.x * tPlane, _origin.y + _dir.y * tPlane);
+			}
+			return true;
+		}
+
+		if (side == 0) {
+			sideX += deltaX;
+			mapX += stepX;
+		} else {
+			sideY += deltaY;
+			mapY += stepY;
+		}
+		if (!m_map->inBounds(mapX, mapY)) {
+			return false;
+		}
+
+		int cell = m_map->at(mapX, mapY);
+		if (cell != 0) {
+			_hit.t = t;
+			_hit.normal = side == 0 ? Vec3{ static_cast<float>(-stepX), 0.0f, 0.0f }
+				: Vec3{ 0.0f, static_cast<float>(-stepY), 0.0f };
+			_hit.albedo = m_wallAlbedo[VrePalette::wallRamp(cell) - 1];
+			_hit.light = -1;
+			return true;
+		}
+	}
+}
+
+bool vre::VrePathTracer::occluded(const Vec3 &_from, const Vec3 &_to) const {
+	// unnormalized direction, the target sits at t = 1
+	Vec3 dir{ _to.x - _from.x, _to.y - _from.y, _to.z - _from.z };
+	int mapX = static_cast<int>(std::floor(_from.x * m_invCellSize));
+	int mapY = static_cast<int>(std::floor(_from.y * m_invCellSize));
+	int endX = static_cast<int>(std::floor(_to.x * m_invCellSize));
+	int endY = static_cast<int>(std::floor(_to.y * m_invCellSize));
+	float deltaX = raycast::deltaDistance(m_cellSize, dir.x);
+	float deltaY = raycast::deltaDistance(m_cellSize, dir.y);
+	float sideX = raycast::firstSideDistance(m_cellSize, _from.x - mapX * m_cellSize, dir.x);
+	float sideY = raycast::firstSideDistance(m_cellSize, _from.y - mapY * m_cellSize, dir.y);
+	int stepX = dir.x < 0.0f ? -1 : 1;
+	int stepY = dir.y < 0.0f ? -1 : 1;
+
+	while (mapX != endX || mapY != endY) {
+		if (sideX < sideY) {
+			if (sideX >= 1.0f) {
+				return false;
+			}
+			sideX += deltaX;
+			mapX += stepX;
+		} else {
+			if (sideY >= 1.0f) {
+				return false;
+			}
+			sideY += deltaY;
+			mapY += stepY;
+		}
+		if (!m_map->inBounds(mapX, mapY) || m_map->at(mapX, mapY) != 0) {
+			return true;
+		}
+	}
+	return false;
+}
+
+int vre::VrePathTracer::lightAt(float _x, float _y) const {
+	int mapX = static_cast<int>(std::floor(_x * m_invCellSize));
+	int mapY = static_cast<int>(std::floor(_y * m_invCellSize));
+	if (!m_map->inBounds(mapX, mapY)) {
+		return -1;
+	}
+	int index = m_lightCells[static_cast<size_t>(mapY) * m_map->width() + mapX];
+	if (index < 0) {
+		return -1;
+	}
+	const PathTracerLight &light = m_lights[index];
+	bool inside = std::abs(_x - light.x) <= light.halfSize && std::abs(_y - light.y) <= light.halfSize;
+	return inside ? index : -1;
+}
+
+void vre::VrePathTracer::resolve(uint16_t *_out, VreThreadPool &_pool) const {
+	float scale = m_settings.exposure / static_cast<float>(std::max(m_samples, 1));
+	_pool.parallelFor(m_height, [&](int _row) {
+		const float *sums = &m_accumulation[static_cast<size_t>(_row) * m_width * 4];
+		uint16_t *out = _out + static_cast<size_t>(_row) * m_width * 4;
+		for (int x = 0; x < m_width; x++) {
+			for (int c = 0; c < 3; c++) {
+				out[x * 4 + c] = floatToHalf(displayValue(sums[x * 4 + c], scale));
+			}
+			out[x * 4 + 3] = 0x3c00; // 1.0
+		}
+	});
+}
+
+void vre::VrePathTracer::resolveRgba8(uint32_t *_out) const {
+	float scale = m_settings.exposure / static_cast<float>(std::max(m_samples, 1));
+	for (size_t i = 0; i < static_cast<size_t>(m_width) * m_height; i++) {
+		const float *sums = &m_accumulation[i * 4];
+		uint32_t color = 0xffu << 24;
+		for (int c = 0; c < 3; c++) {
+			color |= static_cast<uint32_t>(displayValue(sums[c], scale) * 255.0f + 0.5f) << (c * 8);
+		}
+		_out[i] = color;
+	}
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "VreMap.hpp"
+#include "VreRaycaster.hpp"
+#include "VreThreadPool.hpp"
+
+namespace vre {
+	// square emitter set into the ceiling, centered on a world position. it
+	// has to fit inside the cell its center is in
+	struct PathTracerLight {
+		float x;
+		float y;
+		float halfSize;
+		float r;
+		float g;
+		float b;
+	};
+
+	struct PathTracerSettings {
+		int maxBounces = 4;
+		int tileSize = 32;
+		float eyeHeight = 0.5f; // in cells above the floor
+		float exposure = 1.0f;
+		// one ceiling light in every empty cell on this grid, 0 for none
+		int lightSpacing = 4;
+		// radius in cells of the lights that are sampled preferably
+		int nearLightRadius = 6;
+	};
+
+	// reference renderer for the 3d extrusion of the grid: walls one cell
+	// high, a flat floor and ceiling and square ceiling lights, all diffuse.
+	// rays walk the grid with the same dda as the raycaster, the floor and
+	// ceiling planes bound every ray so no other acceleration is needed.
+	// each renderSample adds one path per pixel to the accumulation buffer,
+	// seeded from the pixel and sample number so the image does not depend
+	// on how tiles land on threads
+	class VrePathTracer {
+	public:
+		void bindMap(const VreMap &_map, PathTracerSettings _settings = {});
+		void setLights(std::vector<PathTracerLight> _lights);
+		void resize(int _width, int _height);
+
+		// drops the accumulated samples, renderSample does this by itself
+		// when the camera moved
+		void reset();
+		void renderSample(const RayCamera &_camera, VreThreadPool &_pool);
+
+		// averaged radiance times exposure with a 2.2 gamma as rgba16f, the
+		// layout of the draw image. _out holds width() * height() * 4 halves
+		void resolve(uint16_t *_out, VreThreadPool &_pool) const;
+		// same as 8 bit rgba, red in the lowest byte, for image tests
+		void resolveRgba8(uint32_t *_out) const;
+
+		int width() const { return m_width; }
+		int height() const { return m_height; }
+		int sampleCount() const { return m_samples; }
+		// rgba float sums, divide by sampleCount for the estimate
+		const float *accumulation() const { return m_accumulation.data(); }
+		const std::vector<PathTracerLight> &lights() const { return m_lights; }
+
+	private:
+		struct Vec3 {
+			float x;
+			float y;
+			float z;
+		};
+
+		struct SurfaceHit {
+			float t;
+			Vec3 normal;
+			Vec3 albedo;
+			int light; // index of the ceiling light that was hit, -1 otherwise
+		};
+
+		bool intersect(const Vec3 &_origin, const Vec3 &_dir, SurfaceHit &_hit) const;
+		// walls between a point and a ceiling point, the planes cant block it
+		bool occluded(const Vec3 &_from, const Vec3 &_to) const;
+		Vec3 trace(Vec3 _origin, Vec3 _dir, uint32_t &_rng) const;
+		void renderTile(const RayCamera &_camera, int _tile);
+		int lightAt(float _x, float _y) const;
+		// picks a light for a shading point, _pdf is its selection probability
+		int pickLight(const Vec3 &_point, uint32_t &_rng, float &_pdf) const;
+		void placeLights();
+
+		const VreMap *m_map = nullptr;
+		PathTracerSettings m_settings;
+		std::vector<PathTracerLight> m_lights;
+		std::vector<int> m_lightCells; // light index per map cell, -1 for none
+		// lights near each cell, most light samples pick from these so far
+		// away panels behind walls dont eat the samples. m_nearLightStart
+		// has one entry per cell plus an end marker
+		std::vector<int> m_nearLightStart;
+		std::vector<int> m_nearLights;
+		Vec3 m_wallAlbedo[8];
+		Vec3 m_floorAlbedo;
+		Vec3 m_ceilingAlbedo;
+		float m_cellSize = 64.0f;
+		float m_invCellSize = 1.0f / 64.0f;
+
+		int m_width = 0;
+		int m_height = 0;
+		int m_samples = 0;
+		RayCamera m_lastCamera{ -1e30f, -1e30f, 0.0f };
+		std::vector<float> m_accumulation;
+	};
+}
@@ -112,6 +112,9 @@ void vre::VrePipeline::defaultPipelineConfigInfo(PipelineConfigInfo &_configInfo
     _configInfo.depthStencilInfo.front = {}; // optional
     _configInfo.depthStencilInfo.back = {}; // optional
 
+    _configInfo.bindingDescriptions = vre::VreModel::Vertex::getBindingDescriptions();
+    _configInfo.attributeDescriptions = vre::VreModel::Vertex::getAttributeDescriptions();
+
     _configInfo.dynamicStateEnables = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
     _configInfo.dynamicStateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
     _configInfo.dynamicStateInfo.pDynamicStates = _configInfo.dynamicStateEnables.data();
@@ -157,8 +160,8 @@ void vre::VrePipeline::createGraphicsPipeline(
     shaderStages[1].pSpecializationInfo = nullptr;
 
     // how we interpret the vertex data
-    auto bindingDescriptions = vre::VreModel::Vertex::getBindingDescriptions();
-    auto attributeDescriptions = vre::VreModel::Vertex::getAttributeDescriptions();
+    const auto &bindingDescriptions = _info.bindingDescriptions;
+    const auto &attributeDescriptions = _info.attributeDescriptions;
     VkPipelineVertexInputStateCreateInfo vertexInfo{};
     vertexInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
     vertexInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
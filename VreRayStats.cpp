@@ -0,0 +1,107 @@
+#include "VreRayStats.hpp"
+
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <bit>
+
+namespace {
+	// cache line aligned so two threads never share a line while counting
+	struct alignas(64) ThreadCounters {
+		vre::RayStatsCounters counters;
+	};
+
+	std::mutex g_registryMutex;
+	std::vector<std::unique_ptr<ThreadCounters>> g_registry;
+	vre::RayStatsFrame g_lastFrame;
+	vre::RayStatsCounters g_total;
+	uint64_t g_frameNumber = 0;
+
+	void writeHistogram(std::ostringstream &_out, const char *_name, const uint64_t *_buckets) {
+		_out << "\"" << _name << "\":[";
+		for (int i = 0; i < vre::RAY_STATS_BUCKETS; i++) {
+			_out << (i ? "," : "") << _buckets[i];
+		}
+		_out << "]";
+	}
+}
+
+int vre::RayStatsCounters::bucket(uint64_t _value) {
+	int b = static_cast<int>(std::bit_width(_value));
+	return b < RAY_STATS_BUCKETS ? b : RAY_STATS_BUCKETS - 1;
+}
+
+void vre::RayStatsCounters::addRay(int _steps, int _tileCrossings, bool _hit,
+	float _distanceCells
+) {
+	rays++;
+	steps += _steps;
+	tileCrossings += _tileCrossings;
+	stepHistogram[bucket(static_cast<uint64_t>(_steps))]++;
+	if (_hit) {
+		distanceHistogram[bucket(static_cast<uint64_t>(_distanceCells))]++;
+	} else {
+		earlyOuts++;
+	}
+}
+
+void vre::RayStatsCounters::merge(const RayStatsCounters &_other) {
+	rays += _other.rays;
+	steps += _other.steps;
+	tileCrossings += _other.tileCrossings;
+	earlyOuts += _other.earlyOuts;
+	for (int i = 0; i < RAY_STATS_BUCKETS; i++) {
+		stepHistogram[i] += _other.stepHistogram[i];
+		distanceHistogram[i] += _other.distanceHistogram[i];
+	}
+}
+
+vre::RayStatsCounters &vre::VreRayStats::local() {
+	thread_local ThreadCounters *counters = nullptr;
+	if (counters == nullptr) {
+		std::lock_guard<std::mutex> lock(g_registryMutex);
+		g_registry.push_back(std::make_unique<ThreadCounters>());
+		counters = g_registry.back().get();
+	}
+	return counters->counters;
+}
+
+void vre::VreRayStats::endFrame() {
+	std::lock_guard<std::mutex> lock(g_registryMutex);
+
+	g_lastFrame.frame = g_frameNumber++;
+	g_lastFrame.counters.clear();
+	for (auto &thread : g_registry) {
+		g_lastFrame.counters.merge(thread->counters);
+		thread->counters.clear();
+	}
+	g_total.merge(g_lastFrame.counters);
+}
+
+const vre::RayStatsFrame &vre::VreRayStats::lastFrame() {
+	return g_lastFrame;
+}
+
+const vre::RayStatsCounters &vre::VreRayStats::total() {
+	return g_total;
+}
+
+std::string vre::VreRayStats::toJson(const RayStatsFrame &_frame) {
+	std::ostringstream out;
+	out << "{\"frame\":" << _frame.frame << ",\"counters\":" << toJson(_frame.counters) << "}";
+	return out.str();
+}
+
+std::string vre::VreRayStats::toJson(const RayStatsCounters &_counters) {
+	std::ostringstream out;
+	out << "{\"rays\":" << _counters.rays
+		<< ",\"steps\":" << _counters.steps
+		<< ",\"tileCrossings\":" << _counters.tileCrossings
+		<< ",\"earlyOuts\":" << _counters.earlyOuts << ",";
+	writeHistogram(out, "stepHistogram", _counters.stepHistogram);
+	out << ",";
+	writeHistogram(out, "distanceHistogram", _counters.distanceHistogram);
+	out << "}";
+	return out.str();
+}
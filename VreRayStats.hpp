@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+
+// ray traversal counters. build with VRE_ENABLE_RAY_STATS=0 to compile every
+// counter out of the kernels
+#ifndef VRE_ENABLE_RAY_STATS
+#define VRE_ENABLE_RAY_STATS 1
+#endif
+
+#if VRE_ENABLE_RAY_STATS
+#define VRE_RAY_STATS(x) x
+#else
+#define VRE_RAY_STATS(x)
+#endif
+
+namespace vre {
+	// log2 buckets, bucket i holds values in [2^(i-1), 2^i), bucket 0 holds 0
+	constexpr int RAY_STATS_BUCKETS = 16;
+	// the map is split into 8x8 cell tiles for the tile crossing counter
+	constexpr int RAY_STATS_TILE_SHIFT = 3;
+
+	struct RayStatsCounters {
+		uint64_t rays = 0;
+		uint64_t steps = 0;
+		uint64_t tileCrossings = 0;
+		uint64_t earlyOuts = 0; // rays that ended without hitting a wall
+		uint64_t stepHistogram[RAY_STATS_BUCKETS] = {};
+		uint64_t distanceHistogram[RAY_STATS_BUCKETS] = {}; // in cells
+
+		void addRay(int _steps, int _tileCrossings, bool _hit, float _distanceCells);
+		// a grid ray only ever moves one way per axis, so steps and tile
+		// crossings follow from the start and end cell and the dda loop
+		// itself stays untouched
+		void addGridRay(int _startX, int _startY, int _endX, int _endY, bool _hit,
+			float _distanceCells
+		) {
+			int steps = std::abs(_endX - _startX) + std::abs(_endY - _startY);
+			int tiles = std::abs((_endX >> RAY_STATS_TILE_SHIFT) - (_startX >> RAY_STATS_TILE_SHIFT))
+				+ std::abs((_endY >> RAY_STATS_TILE_SHIFT) - (_startY >> RAY_STATS_TILE_SHIFT));
+			addRay(steps, tiles, _hit, _distanceCells);
+		}
+		void merge(const RayStatsCounters &_other);
+		void clear() { *this = RayStatsCounters(); }
+
+		static int bucket(uint64_t _value);
+	};
+
+	struct RayStatsFrame {
+		uint64_t frame = 0;
+		RayStatsCounters counters;
+	};
+
+	// every thread that casts rays gets its own counters, kernels add to a
+	// local copy and flush it once per call. endFrame merges all threads, it
+	// must be called while no rays are being cast
+	class VreRayStats {
+	public:
+		static RayStatsCounters &local();
+		static void endFrame();
+
+		static const RayStatsFrame &lastFrame();
+		// sum of every frame since startup
+		static const RayStatsCounters &total();
+
+		static std::string toJson(const RayStatsFrame &_frame);
+		static std::string toJson(const RayStatsCounters &_counters);
+	};
+}
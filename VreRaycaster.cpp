@@ -0,0 +1,299 @@
+#include "VreRaycaster.hpp"
+
+#include <stdexcept>
+
+namespace {
+	// range of specialized instantiations, anything outside falls back to the
+	// generic kernel. cells of 16 to 128 units, maps 8 to 4096 cells wide
+	constexpr int MIN_CELL_SHIFT = 4;
+	constexpr int MAX_CELL_SHIFT = 7;
+	constexpr int MIN_WIDTH_SHIFT = 3;
+	constexpr int MAX_WIDTH_SHIFT = 12;
+
+	template<typename Cell, int CellShift, int WidthShift = MIN_WIDTH_SHIFT>
+	vre::VreRaycaster::Kernel findWidthKernel(int _widthShift) {
+		if constexpr (WidthShift > MAX_WIDTH_SHIFT) {
+			return nullptr;
+		} else {
+			if (_widthShift == WidthShift) {
+				return &vre::raycast::castGridSpecialized<CellShift, WidthShift, Cell>;
+			}
+			return findWidthKernel<Cell, CellShift, WidthShift + 1>(_widthShift);
+		}
+	}
+
+	template<typename Cell, int CellShift = MIN_CELL_SHIFT>
+	vre::VreRaycaster::Kernel findKernel(int _cellShift, int _widthShift) {
+		if constexpr (CellShift > MAX_CELL_SHIFT) {
+			return nullptr;
+		} else {
+			if (_cellShift == CellShift) {
+				return findWidthKernel<Cell, CellShift>(_widthShift);
+			}
+			return findKernel<Cell, CellShift + 1>(_cellShift, _widthShift);
+		}
+	}
+}
+
+void vre::raycast::castGridGeneric(const VreMap &_map, const RayCamera &_camera,
+	int _firstColumn, int _columnCount, int _screenWidth, RayHit *_out
+) {
+	const float cellSize = static_cast<float>(_map.cellSize());
+	const float invCellSize = 1.0f / cellSize;
+	const int maxSteps = _map.width() + _map.height() + 2;
+	const int *cells = _map.data();
+	RayFrustum frustum(_camera, _screenWidth);
+
+	int startX = static_cast<int>(std::floor(_camera.x * invCellSize));
+	int startY = static_cast<int>(std::floor(_camera.y * invCellSize));
+	float offsetX = _camera.x - startX * cellSize;
+	float offsetY = _camera.y - startY * cellSize;
+	VRE_RAY_STATS(RayStatsCounters stats;)
+
+	for (int i = 0; i < _columnCount; i++) {
+		float dirX;
+		float dirY;
+		frustum.direction(_firstColumn + i, dirX, dirY);
+
+		float deltaX = deltaDistance(cellSize, dirX);
+		float deltaY = deltaDistance(cellSize, dirY);
+		float sideX = firstSideDistance(cellSize, offsetX, dirX);
+		float sideY = firstSideDistance(cellSize, offsetY, dirY);
+		int stepX = dirX < 0.0f ? -1 : 1;
+		int stepY = dirY < 0.0f ? -1 : 1;
+
+		int mapX = startX;
+		int mapY = startY;
+		int side = 0;
+		int cell = 0;
+		for (int step = 0; step < maxSteps; step++) {
+			if (sideX < sideY) {
+				sideX += deltaX;
+				mapX += stepX;
+				side = 0;
+			} else {
+				sideY += deltaY;
+				mapY += stepY;
+				side = 1;
+			}
+
+			if (!_map.inBounds(mapX, mapY)) {
+				// outside a map without a border, only stop once we are
+				// moving away from it for good
+				bool leaving = (mapX < 0 && stepX < 0) || (mapX >= _map.width() && stepX > 0)
+					|| (mapY < 0 && stepY < 0) || (mapY >= _map.height() && stepY > 0);
+				if (leaving) {
+					break;
+				}
+				continue;
+			}
+
+			cell = cells[mapY * _map.width() + mapX];
+			if (cell != 0) {
+				break;
+			}
+		}
+
+		float distance = side == 0 ? sideX - deltaX : sideY - deltaY;
+		finishHit(_camera, dirX, dirY, distance, invCellSize, mapX, mapY,
+			cell, side, _out[i]);
+		VRE_RAY_STATS(stats.addGridRay(startX, startY, mapX, mapY, cell != 0, distance * invCellSize);)
+	}
+	VRE_RAY_STATS(VreRayStats::local().merge(stats);)
+}
+
+void vre::raycast::castGridLayered(const VreMap &_map, const RayCamera &_camera,
+	int _firstColumn, int _columnCount, int _screenWidth, RayHit *_out,
+	RayLayers *_layers
+) {
+	const float cellSize = static_cast<float>(_map.cellSize());
+	const float invCellSize = 1.0f / cellSize;
+	const int maxSteps = _map.width() + _map.height() + 2;
+	const int *cells = _map.data();
+	RayFrustum frustum(_camera, _screenWidth);
+
+	int startX = static_cast<int>(std::floor(_camera.x * invCellSize));
+	int startY = static_cast<int>(std::floor(_camera.y * invCellSize));
+	float offsetX = _camera.x - startX * cellSize;
+	float offsetY = _camera.y - startY * cellSize;
+	// standing inside glass should not draw that glass over everything
+	int startCell = _map.inBounds(startX, startY) ? _map.at(startX, startY) : 0;
+	VRE_RAY_STATS(RayStatsCounters stats;)
+
+	for (int i = 0; i < _columnCount; i++) {
+		float dirX;
+		float dirY;
+		frustum.direction(_firstColumn + i, dirX, dirY);
+
+		float deltaX = deltaDistance(cellSize, dirX);
+		float deltaY = deltaDistance(cellSize, dirY);
+		float sideX = firstSideDistance(cellSize, offsetX, dirX);
+		float sideY = firstSideDistance(cellSize, offsetY, dirY);
+		int stepX = dirX < 0.0f ? -1 : 1;
+		int stepY = dirY < 0.0f ? -1 : 1;
+
+		int mapX = startX;
+		int mapY = startY;
+		int side = 0;
+		int cell = 0;
+		int previous = startCell;
+		RayLayers &layers = _layers[i];
+		layers.count = 0;
+		for (int step = 0; step < maxSteps; step++) {
+			if (sideX < sideY) {
+				sideX += deltaX;
+				mapX += stepX;
+				side = 0;
+			} else {
+				sideY += deltaY;
+				mapY += stepY;
+				side = 1;
+			}
+
+			if (!_map.inBounds(mapX, mapY)) {
+				bool leaving = (mapX < 0 && stepX < 0) || (mapX >= _map.width() && stepX > 0)
+					|| (mapY < 0 && stepY < 0) || (mapY >= _map.height() && stepY > 0);
+				if (leaving) {
+					break;
+				}
+				previous = 0;
+				continue;
+			}
+
+			cell = cells[mapY * _map.width() + mapX];
+			if (cell == 0 || !_map.isTransparent(cell)) {
+				previous = cell;
+				if (cell != 0) {
+					break;
+				}
+				continue;
+			}
+
+			// a pane several cells thick is one layer, its front face
+			if (cell != previous && layers.count < RayLayers::MAX_LAYERS) {
+				float distance = side == 0 ? sideX - deltaX : sideY - deltaY;
+				finishHit(_camera, dirX, dirY, distance, invCellSize, mapX, mapY,
+					cell, side, layers.hits[layers.count++]);
+			}
+			previous = cell;
+			cell = 0;
+		}
+
+		float distance = side == 0 ? sideX - deltaX : sideY - deltaY;
+		finishHit(_camera, dirX, dirY, distance, invCellSize, mapX, mapY,
+			cell, side, _out[i]);
+		VRE_RAY_STATS(stats.addGridRay(startX, startY, mapX, mapY, cell != 0, distance * invCellSize);)
+	}
+	VRE_RAY_STATS(VreRayStats::local().merge(stats);)
+}
+
+void vre::VreRaycaster::bindMap(const VreMap &_map, RaycasterOptions _options) {
+	if (_map.empty()) {
+		throw std::runtime_error("Cannot bind an empty map to the raycaster");
+	}
+
+	m_map = &_map;
+	m_options = _options;
+	if (m_options.occupancy) {
+		m_occupancy.build(_map);
+	}
+	chooseKernel();
+}
+
+void vre::VreRaycaster::updateCell(int _x, int _y) {
+	if (m_options.occupancy) {
+		m_occupancy.setCell(_x, _y, m_map->at(_x, _y) != 0);
+	}
+	// the edit may have cost the map its border or its byte sized cells
+	chooseKernel();
+}
+
+void vre::VreRaycaster::castColumns(const RayCamera &_camera, int _firstColumn,
+	int _columnCount, int _screenWidth, RayHit *_out
+) const {
+	if (!m_options.occupancy || !m_map->containsWorldPoint(_camera.x, _camera.y)) {
+		castGrid(_camera, _firstColumn, _columnCount, _screenWidth, _out);
+		return;
+	}
+
+	// directions change monotonically across the screen, so this splits
+	// into at most a handful of runs, each handed to one kernel
+	RayFrustum frustum(_camera, _screenWidth);
+	int runStart = 0;
+	bool runNearAxis = false;
+	for (int i = 0; i <= _columnCount; i++) {
+		bool nearAxis = false;
+		if (i < _columnCount) {
+			float dirX;
+			float dirY;
+			frustum.direction(_firstColumn + i, dirX, dirY);
+			nearAxis = raycast::isNearAxis(dirX, dirY);
+			if (i == 0) {
+				runNearAxis = nearAxis;
+			}
+		}
+
+		if (i == _columnCount || nearAxis != runNearAxis) {
+			int count = i - runStart;
+			if (runNearAxis) {
+				raycast::castOccupancy(m_occupancy, *m_map, _camera,
+					_firstColumn + runStart, count, _screenWidth, _out + runStart);
+			} else {
+				castGrid(_camera, _firstColumn + runStart, count, _screenWidth,
+					_out + runStart);
+			}
+			runStart = i;
+			runNearAxis = nearAxis;
+		}
+	}
+}
+
+void vre::VreRaycaster::castColumnsLayered(const RayCamera &_camera, int _firstColumn,
+	int _columnCount, int _screenWidth, RayHit *_out, RayLayers *_layers
+) const {
+	// the specialized and occupancy kernels stop at any non zero cell, so
+	// they only serve maps that have nothing to see through
+	if (!m_map->hasTransparentCells()) {
+		castColumns(_camera, _firstColumn, _columnCount, _screenWidth, _out);
+		for (int i = 0; i < _columnCount; i++) {
+			_layers[i].count = 0;
+		}
+		return;
+	}
+	raycast::castGridLayered(*m_map, _camera, _firstColumn, _columnCount, _screenWidth,
+		_out, _layers);
+}
+
+void vre::VreRaycaster::castGrid(const RayCamera &_camera, int _firstColumn,
+	int _columnCount, int _screenWidth, RayHit *_out
+) const {
+	if (m_specialized != nullptr && cameraInsideBorder(_camera)) {
+		m_specialized(*m_map, _camera, _firstColumn, _columnCount, _screenWidth, _out);
+	} else {
+		raycast::castGridGeneric(*m_map, _camera, _firstColumn, _columnCount,
+			_screenWidth, _out);
+	}
+}
+
+void vre::VreRaycaster::chooseKernel() {
+	m_specialized = nullptr;
+
+	int cellShift = VreMap::log2Exact(m_map->cellSize());
+	int widthShift = VreMap::log2Exact(m_map->width());
+	if (!m_options.specialized || !m_map->hasSolidBorder() || cellShift < 0 || widthShift < 0) {
+		return;
+	}
+
+	if (m_map->hasCompactCells()) {
+		m_specialized = findKernel<uint8_t>(cellShift, widthShift);
+	} else {
+		m_specialized = findKernel<int>(cellShift, widthShift);
+	}
+}
+
+bool vre::VreRaycaster::cameraInsideBorder(const RayCamera &_camera) const {
+	float cellSize = static_cast<float>(m_map->cellSize());
+	return _camera.x >= cellSize && _camera.y >= cellSize
+		&& _camera.x < (m_map->width() - 1) * cellSize
+		&& _camera.y < (m_map->height() - 1) * cellSize;
+}
@@ -0,0 +1,222 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <type_traits>
+
+#include "VreMap.hpp"
+#include "VreOccupancy.hpp"
+#include "VreRayStats.hpp"
+
+namespace vre {
+	struct RayCamera {
+		float x;
+		float y;
+		float angle;
+		float fov = 1.0471976f; // 60 degrees
+		// column i of a cast is screen column i * columnStep + columnPhase,
+		// so every other column or the sub column rays of one column can be
+		// cast in one run. honoured wherever directions come from
+		// RayFrustum and by the bsp's projection
+		float columnStep = 1.0f;
+		float columnPhase = 0.0f;
+	};
+
+	struct RayHit {
+		float distance; // perpendicular distance to the wall, no fisheye
+		float wallU; // [0, 1) along the wall face, used as texture coordinate
+		int mapX;
+		int mapY;
+		int cell; // wall id, 0 if the ray left the map without hitting anything
+		int side; // 0 if a vertical grid line was crossed, 1 if horizontal
+	};
+
+	// transparent walls a column looks through before its opaque RayHit,
+	// nearest first. fixed size so casting never allocates, layers past
+	// MAX_LAYERS are dropped, the farthest ones first
+	struct RayLayers {
+		static constexpr int MAX_LAYERS = 3;
+
+		RayHit hits[MAX_LAYERS];
+		int count;
+	};
+
+	// turns a screen column into a ray direction. the direction is
+	// forward + plane * cameraX so the ray parameter at a hit is already the
+	// perpendicular distance
+	struct RayFrustum {
+		RayFrustum(const RayCamera &_camera, int _screenWidth) {
+			m_dirX = std::cos(_camera.angle);
+			m_dirY = std::sin(_camera.angle);
+			float planeScale = std::tan(_camera.fov * 0.5f);
+			m_planeX = -m_dirY * planeScale;
+			m_planeY = m_dirX * planeScale;
+			m_invWidth = 2.0f / static_cast<float>(_screenWidth);
+			m_columnStep = _camera.columnStep;
+			m_columnOffset = _camera.columnPhase + 0.5f;
+		}
+
+		void direction(int _column, float &_dirX, float &_dirY) const {
+			float cameraX = (static_cast<float>(_column) * m_columnStep + m_columnOffset) * m_invWidth - 1.0f;
+			_dirX = m_dirX + m_planeX * cameraX;
+			_dirY = m_dirY + m_planeY * cameraX;
+		}
+
+		float m_dirX;
+		float m_dirY;
+		float m_planeX;
+		float m_planeY;
+		float m_invWidth;
+		float m_columnStep;
+		float m_columnOffset;
+	};
+
+	namespace raycast {
+		constexpr float NO_HIT_DISTANCE = 1e30f;
+
+		inline float deltaDistance(float _cellSize, float _dir) {
+			return _dir == 0.0f ? NO_HIT_DISTANCE : std::abs(_cellSize / _dir);
+		}
+
+		// distance along the ray to the first grid line, _offset is the
+		// position inside the start cell in world units
+		inline float firstSideDistance(float _cellSize, float _offset, float _dir) {
+			if (_dir == 0.0f) {
+				return NO_HIT_DISTANCE;
+			}
+			return _dir < 0.0f ? _offset / -_dir : (_cellSize - _offset) / _dir;
+		}
+
+		inline void finishHit(const RayCamera &_camera, float _dirX, float _dirY,
+			float _distance, float _invCellSize, int _mapX, int _mapY, int _cell,
+			int _side, RayHit &_out
+		) {
+			float along = _side == 0 ? _camera.y + _distance * _dirY
+				: _camera.x + _distance * _dirX;
+			along *= _invCellSize;
+
+			_out.distance = _distance;
+			_out.wallU = along - std::floor(along);
+			_out.mapX = _mapX;
+			_out.mapY = _mapY;
+			_out.cell = _cell;
+			_out.side = _side;
+		}
+
+		template<typename Cell>
+		const Cell *mapCells(const VreMap &_map) {
+			if constexpr (std::is_same_v<Cell, uint8_t>) {
+				return _map.compactData();
+			} else {
+				return _map.data();
+			}
+		}
+
+		// map dimensions are compile time constants here, so cell lookups are
+		// shifts and masks. needs a power of two width and cell size, a solid
+		// border and a camera inside the border, which the dispatcher checks
+		// once per call instead of once per step
+		template<int CellShift, int WidthShift, typename Cell>
+		void castGridSpecialized(const VreMap &_map, const RayCamera &_camera,
+			int _firstColumn, int _columnCount, int _screenWidth, RayHit *_out
+		) {
+			constexpr float cellSize = static_cast<float>(1 << CellShift);
+			constexpr float invCellSize = 1.0f / cellSize;
+			constexpr int widthMask = (1 << WidthShift) - 1;
+
+			const Cell *cells = mapCells<Cell>(_map);
+			RayFrustum frustum(_camera, _screenWidth);
+
+			int startX = static_cast<int>(_camera.x) >> CellShift;
+			int startY = static_cast<int>(_camera.y) >> CellShift;
+			float offsetX = _camera.x - static_cast<float>(startX << CellShift);
+			float offsetY = _camera.y - static_cast<float>(startY << CellShift);
+			VRE_RAY_STATS(RayStatsCounters stats;)
+
+			for (int i = 0; i < _columnCount; i++) {
+				float dirX;
+				float dirY;
+				frustum.direction(_firstColumn + i, dirX, dirY);
+
+				float deltaX = deltaDistance(cellSize, dirX);
+				float deltaY = deltaDistance(cellSize, dirY);
+				float sideX = firstSideDistance(cellSize, offsetX, dirX);
+				float sideY = firstSideDistance(cellSize, offsetY, dirY);
+				int stepX = dirX < 0.0f ? -1 : 1;
+				int stepY = dirY < 0.0f ? -1 : 1;
+
+				int mapX = startX;
+				int mapY = startY;
+				int side;
+				Cell cell;
+				do {
+					if (sideX < sideY) {
+						sideX += deltaX;
+						mapX += stepX;
+						side = 0;
+					} else {
+						sideY += deltaY;
+						mapY += stepY;
+						side = 1;
+					}
+					cell = cells[(mapY << WidthShift) | (mapX & widthMask)];
+				} while (cell == 0);
+
+				float distance = side == 0 ? sideX - deltaX : sideY - deltaY;
+				finishHit(_camera, dirX, dirY, distance, invCellSize, mapX, mapY,
+					static_cast<int>(cell), side, _out[i]);
+				VRE_RAY_STATS(stats.addGridRay(startX, startY, mapX, mapY, true, distance * invCellSize);)
+			}
+			VRE_RAY_STATS(VreRayStats::local().merge(stats);)
+		}
+
+		// works for any map and camera position, at the cost of a divide per
+		// column and a bounds check per step
+		void castGridGeneric(const VreMap &_map, const RayCamera &_camera,
+			int _firstColumn, int _columnCount, int _screenWidth, RayHit *_out);
+
+		// generic kernel that steps through transparent cells, one layer per
+		// run of the same transparent id, until an opaque wall. _out gets the
+		// opaque hit like castGridGeneric, _layers what was in front of it
+		void castGridLayered(const VreMap &_map, const RayCamera &_camera,
+			int _firstColumn, int _columnCount, int _screenWidth, RayHit *_out,
+			RayLayers *_layers);
+	}
+
+	struct RaycasterOptions {
+		bool specialized = true; // false forces the generic grid kernel
+		bool occupancy = true; // word stepping for near axis rays
+	};
+
+	class VreRaycaster {
+	public:
+		using Kernel = void (*)(const VreMap &, const RayCamera &, int, int, int, RayHit *);
+
+		// picks the kernels for the map and builds the occupancy bits. call
+		// again if the map is replaced, use updateCell for single cell edits
+		void bindMap(const VreMap &_map, RaycasterOptions _options = {});
+		void updateCell(int _x, int _y);
+
+		void castColumns(const RayCamera &_camera, int _firstColumn,
+			int _columnCount, int _screenWidth, RayHit *_out) const;
+		// same with see through walls. maps without transparent cells go
+		// through castColumns untouched and get zero layers everywhere
+		void castColumnsLayered(const RayCamera &_camera, int _firstColumn,
+			int _columnCount, int _screenWidth, RayHit *_out, RayLayers *_layers) const;
+
+		const VreMap *map() const { return m_map; }
+		const VreOccupancyGrid &occupancy() const { return m_occupancy; }
+		bool isSpecialized() const { return m_specialized != nullptr; }
+
+	private:
+		void castGrid(const RayCamera &_camera, int _firstColumn,
+			int _columnCount, int _screenWidth, RayHit *_out) const;
+		bool cameraInsideBorder(const RayCamera &_camera) const;
+		void chooseKernel();
+
+		const VreMap *m_map = nullptr;
+		RaycasterOptions m_options;
+		Kernel m_specialized = nullptr;
+		VreOccupancyGrid m_occupancy;
+	};
+}
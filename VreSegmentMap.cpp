@@ -0,0 +1,63 @@
+#include "VreSegmentMap.hpp"
+
+#include <utility>
+
+vre::VreSegmentMap::VreSegmentMap(std::vector<Segment> _segments, int _cellSize)
+	: m_segments(std::move(_segments)), m_cellSize(_cellSize) {
+}
+
+vre::VreSegmentMap vre::VreSegmentMap::fromGrid(const VreMap &_map) {
+	std::vector<Segment> segments;
+	float cell = static_cast<float>(_map.cellSize());
+
+	auto solid = [&](int _x, int _y) {
+		return _map.inBounds(_x, _y) && _map.at(_x, _y) != 0;
+	};
+
+	// horizontal faces, one pass per grid line y. a face belongs to the
+	// solid cell on one side when the other side is empty
+	for (int y = 0; y <= _map.height(); y++) {
+		for (int facing = 0; facing < 2; facing++) {
+			int solidY = facing == 0 ? y - 1 : y;
+			int emptyY = facing == 0 ? y : y - 1;
+			int runStart = -1;
+			int runWall = 0;
+			for (int x = 0; x <= _map.width(); x++) {
+				int wall = x < _map.width() && solid(x, solidY) && _map.inBounds(x, emptyY)
+					&& !solid(x, emptyY) ? _map.at(x, solidY) : 0;
+				if (runStart >= 0 && wall != runWall) {
+					segments.push_back({ runStart * cell, y * cell, x * cell, y * cell, runWall });
+					runStart = -1;
+				}
+				if (runStart < 0 && wall != 0) {
+					runStart = x;
+					runWall = wall;
+				}
+			}
+		}
+	}
+
+	// vertical faces, the same with x and y swapped
+	for (int x = 0; x <= _map.width(); x++) {
+		for (int facing = 0; facing < 2; facing++) {
+			int solidX = facing == 0 ? x - 1 : x;
+			int emptyX = facing == 0 ? x : x - 1;
+			int runStart = -1;
+			int runWall = 0;
+			for (int y = 0; y <= _map.height(); y++) {
+				int wall = y < _map.height() && solid(solidX, y) && _map.inBounds(emptyX, y)
+					&& !solid(emptyX, y) ? _map.at(solidX, y) : 0;
+				if (runStart >= 0 && wall != runWall) {
+					segments.push_back({ x * cell, runStart * cell, x * cell, y * cell, runWall });
+					runStart = -1;
+				}
+				if (runStart < 0 && wall != 0) {
+					runStart = y;
+					runWall = wall;
+				}
+			}
+		}
+	}
+
+	return VreSegmentMap(std::move(segments), _map.cellSize());
+}
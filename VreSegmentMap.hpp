@@ -0,0 +1,37 @@
+#pragma once
+
+#include <vector>
+
+#include "VreMap.hpp"
+
+namespace vre {
+	// wall between two points in world units, seen from both sides
+	struct Segment {
+		float x1;
+		float y1;
+		float x2;
+		float y2;
+		int wall; // wall id like a grid cell, never 0
+	};
+
+	// level made of free standing line segments instead of grid cells.
+	// m_cellSize is only the texture scale, one texture repeat per cellSize
+	// units of wall
+	class VreSegmentMap {
+	public:
+		VreSegmentMap() {}
+		VreSegmentMap(std::vector<Segment> _segments, int _cellSize);
+
+		// every face between a solid and an empty cell, with collinear faces
+		// of the same wall id merged into one segment
+		static VreSegmentMap fromGrid(const VreMap &_map);
+
+		const std::vector<Segment> &segments() const { return m_segments; }
+		int cellSize() const { return m_cellSize; }
+		bool empty() const { return m_segments.empty(); }
+
+	private:
+		std::vector<Segment> m_segments;
+		int m_cellSize = 64;
+	};
+}
@@ -0,0 +1,288 @@
+#include "VreSky.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#include "VrePipeline.hpp"
+
+namespace {
+	struct SkyPushConstants {
+		int32_t panoramaWidth;
+		int32_t panoramaHeight;
+		int32_t horizon; // rows above it can be sky
+		// panorama column of screen column 0 and the step per screen
+		// column, 16.16 fixed point
+		uint32_t offset;
+		uint32_t step;
+	};
+
+	constexpr float TWO_PI = 6.2831853f;
+
+	uint32_t packColor(float _r, float _g, float _b) {
+		auto channel = [](float _v) {
+			return static_cast<uint32_t>(std::clamp(_v, 0.0f, 1.0f) * 255.0f + 0.5f);
+		};
+		return channel(_r) | (channel(_g) << 8) | (channel(_b) << 16) | (255u << 24);
+	}
+
+	// sums of whole periods around the circle, so the seam at u = 0 is
+	// invisible
+	float ridge(float _angle) {
+		return 0.5f * std::sin(3.0f * _angle) + 0.3f * std::sin(7.0f * _angle + 1.3f)
+			+ 0.2f * std::sin(17.0f * _angle + 0.4f);
+	}
+
+	float clouds(float _angle, float _height) {
+		float band = std::sin(5.0f * _angle + 4.0f * _height) * std::sin(11.0f * _angle - 7.0f * _height + 2.0f)
+			+ 0.5f * std::sin(23.0f * _angle + 13.0f * _height);
+		return std::clamp(band - 0.4f, 0.0f, 1.0f);
+	}
+}
+
+vre::VreSky::VreSky(VreDevice &_device,
+	const std::array<VkImageView, VreSwapchain::MAX_FRAMES_IN_FLIGHT> &_drawImages,
+	uint32_t _width, uint32_t _height
+) : m_vreDevice{ _device }, m_width{ _width }, m_height{ _height } {
+	createPanorama();
+	createFrameResources();
+	createDescriptors(_drawImages);
+	createPipeline();
+}
+
+vre::VreSky::~VreSky() {
+	VkDevice device = m_vreDevice.device();
+
+	vkDestroyPipeline(device, m_pipeline, nullptr);
+	vkDestroyPipelineLayout(device, m_pipelineLayout, nullptr);
+	vkDestroyDescriptorPool(device, m_descriptorPool, nullptr);
+	vkDestroyDescriptorSetLayout(device, m_setLayout, nullptr);
+
+	for (FrameResources &frame : m_frames) {
+		vkUnmapMemory(device, frame.topsMemory);
+		vkDestroyBuffer(device, frame.tops, nullptr);
+		vkFreeMemory(device, frame.topsMemory, nullptr);
+	}
+
+	vkDestroyBuffer(device, m_panorama, nullptr);
+	vkFreeMemory(device, m_panoramaMemory, nullptr);
+}
+
+void vre::VreSky::update(size_t _frame, const int16_t *_tops, const int16_t *_bottoms) {
+	int32_t *tops = m_frames[_frame].mapped;
+	for (uint32_t x = 0; x < m_width; x++) {
+		tops[x] = _tops[x] < _bottoms[x] ? _tops[x] : static_cast<int32_t>(m_height);
+	}
+}
+
+void vre::VreSky::record(VkCommandBuffer _cmd, size_t _frame, float _angle, float _fov) {
+	// the panorama goes once around, the screen spans _fov of it
+	float columns = static_cast<float>(PANORAMA_WIDTH);
+	float left = (_angle - _fov * 0.5f) / TWO_PI;
+	left -= std::floor(left);
+
+	SkyPushConstants push{};
+	push.panoramaWidth = PANORAMA_WIDTH;
+	push.panoramaHeight = PANORAMA_HEIGHT;
+	push.horizon = static_cast<int32_t>(m_height / 2);
+	push.offset = static_cast<uint32_t>(left * columns * 65536.0f);
+	push.step = static_cast<uint32_t>(_fov / TWO_PI * columns / m_width * 65536.0f);
+
+	vkCmdBindPipeline(_cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline);
+	vkCmdBindDescriptorSets(_cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout,
+		0, 1, &m_frames[_frame].descriptorSet, 0, nullptr);
+	vkCmdPushConstants(_cmd, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT,
+		0, sizeof(SkyPushConstants), &push);
+
+	// the upper half only, 16x16 workgroups
+	vkCmdDispatch(_cmd, (m_width + 15) / 16, (static_cast<uint32_t>(push.horizon) + 15) / 16, 1);
+}
+
+void vre::VreSky::createPanorama() {
+	// deep blue overhead fading to haze, clouds, then a far mountain ridge
+	// standing on the horizon row
+	std::vector<uint32_t> texels(static_cast<size_t>(PANORAMA_WIDTH) * PANORAMA_HEIGHT);
+	for (int u = 0; u < PANORAMA_WIDTH; u++) {
+		float angle = u * TWO_PI / PANORAMA_WIDTH;
+		float ridgeTop = 0.82f - 0.08f * ridge(angle);
+		for (int v = 0; v < PANORAMA_HEIGHT; v++) {
+			float height = static_cast<float>(v) / PANORAMA_HEIGHT;
+			float r = 0.10f + 0.55f * height;
+			float g = 0.22f + 0.50f * height;
+			float b = 0.55f + 0.35f * height;
+			float cloud = clouds(angle, height) * (1.0f - height);
+			r += (0.95f - r) * cloud;
+			g += (0.95f - g) * cloud;
+			b += (0.97f - b) * cloud;
+			if (height > ridgeTop) {
+				r = 0.20f;
+				g = 0.24f;
+				b = 0.30f;
+			}
+			texels[static_cast<size_t>(v) * PANORAMA_WIDTH + u] = packColor(r, g, b);
+		}
+	}
+
+	VkDeviceSize size = sizeof(uint32_t) * texels.size();
+	VkBuffer staging;
+	VkDeviceMemory stagingMemory;
+	m_vreDevice.createBuffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		staging, stagingMemory);
+
+	void *data;
+	vkMapMemory(m_vreDevice.device(), stagingMemory, 0, size, 0, &data);
+	memcpy(data, texels.data(), static_cast<size_t>(size));
+	vkUnmapMemory(m_vreDevice.device(), stagingMemory);
+
+	m_vreDevice.createBuffer(size,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_panorama, m_panoramaMemory);
+	m_vreDevice.copyBuffer(staging, m_panorama, size);
+
+	vkDestroyBuffer(m_vreDevice.device(), staging, nullptr);
+	vkFreeMemory(m_vreDevice.device(), stagingMemory, nullptr);
+}
+
+void vre::VreSky::createFrameResources() {
+	VkDeviceSize size = sizeof(int32_t) * m_width;
+	for (FrameResources &frame : m_frames) {
+		// stays mapped, rewritten every frame the sky is drawn
+		m_vreDevice.createBuffer(size, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+			VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+			frame.tops, frame.topsMemory);
+		void *mapped;
+		vkMapMemory(m_vreDevice.device(), frame.topsMemory, 0, size, 0, &mapped);
+		frame.mapped = static_cast<int32_t *>(mapped);
+		for (uint32_t x = 0; x < m_width; x++) {
+			frame.mapped[x] = static_cast<int32_t>(m_height);
+		}
+	}
+}
+
+void vre::VreSky::createDescriptors(
+	const std::array<VkImageView, VreSwapchain::MAX_FRAMES_IN_FLIGHT> &_drawImages
+) {
+	// 0 draw image, 1 wall tops, 2 panorama
+	VkDescriptorSetLayoutBinding bindings[3]{};
+	bindings[0].binding = 0;
+	bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+	bindings[0].descriptorCount = 1;
+	bindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	bindings[1].binding = 1;
+	bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	bindings[1].descriptorCount = 1;
+	bindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	bindings[2] = bindings[1];
+	bindings[2].binding = 2;
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = 3;
+	layoutInfo.pBindings = bindings;
+
+	if (vkCreateDescriptorSetLayout(m_vreDevice.device(), &layoutInfo, nullptr,
+		&m_setLayout) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create sky descriptor set layout");
+	}
+
+	uint32_t frameCount = static_cast<uint32_t>(m_frames.size());
+	VkDescriptorPoolSize poolSizes[] = {
+		{ VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, frameCount },
+		{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2 * frameCount }
+	};
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.maxSets = frameCount;
+	poolInfo.poolSizeCount = 2;
+	poolInfo.pPoolSizes = poolSizes;
+
+	if (vkCreateDescriptorPool(m_vreDevice.device(), &poolInfo, nullptr,
+		&m_descriptorPool) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create sky descriptor pool");
+	}
+
+	for (size_t i = 0; i < m_frames.size(); i++) {
+		FrameResources &frame = m_frames[i];
+		VkDescriptorSetAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocInfo.descriptorPool = m_descriptorPool;
+		allocInfo.descriptorSetCount = 1;
+		allocInfo.pSetLayouts = &m_setLayout;
+
+		if (vkAllocateDescriptorSets(m_vreDevice.device(), &allocInfo,
+			&frame.descriptorSet) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to allocate sky descriptor set");
+		}
+
+		VkDescriptorImageInfo imageInfo{};
+		imageInfo.imageView = _drawImages[i];
+		imageInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+		VkDescriptorBufferInfo topsInfo{ frame.tops, 0, VK_WHOLE_SIZE };
+		VkDescriptorBufferInfo panoramaInfo{ m_panorama, 0, VK_WHOLE_SIZE };
+
+		VkWriteDescriptorSet writes[3]{};
+		for (int i = 0; i < 3; i++) {
+			writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writes[i].dstSet = frame.descriptorSet;
+			writes[i].dstBinding = i;
+			writes[i].descriptorCount = 1;
+			writes[i].descriptorType = bindings[i].descriptorType;
+		}
+		writes[0].pImageInfo = &imageInfo;
+		writes[1].pBufferInfo = &topsInfo;
+		writes[2].pBufferInfo = &panoramaInfo;
+
+		vkUpdateDescriptorSets(m_vreDevice.device(), 3, writes, 0, nullptr);
+	}
+}
+
+void vre::VreSky::createPipeline() {
+	VkPushConstantRange pushConstantRange{};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(SkyPushConstants);
+
+	VkPipelineLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	layoutInfo.setLayoutCount = 1;
+	layoutInfo.pSetLayouts = &m_setLayout;
+	layoutInfo.pushConstantRangeCount = 1;
+	layoutInfo.pPushConstantRanges = &pushConstantRange;
+
+	if (vkCreatePipelineLayout(m_vreDevice.device(), &layoutInfo, nullptr,
+		&m_pipelineLayout) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create sky pipeline layout");
+	}
+
+	std::vector<char> code = VrePipeline::readFile("./sky.comp.spv");
+
+	VkShaderModuleCreateInfo moduleInfo{};
+	moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	moduleInfo.codeSize = code.size();
+	moduleInfo.pCode = reinterpret_cast<const uint32_t *>(code.data());
+
+	VkShaderModule module;
+	if (vkCreateShaderModule(m_vreDevice.device(), &moduleInfo, nullptr, &module) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create sky shader module");
+	}
+
+	VkComputePipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	pipelineInfo.stage.module = module;
+	pipelineInfo.stage.pName = "main";
+	pipelineInfo.layout = m_pipelineLayout;
+
+	VkResult result = vkCreateComputePipelines(m_vreDevice.device(), VK_NULL_HANDLE, 1,
+		&pipelineInfo, nullptr, &m_pipeline);
+	vkDestroyShaderModule(m_vreDevice.device(), module, nullptr);
+
+	if (result != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create sky compute pipeline");
+	}
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include <vulkan/vulkan.h>
+
+#include "VreDevice.hpp"
+#include "VreSwapchain.hpp"
+
+namespace vre {
+	// cylindrical panorama over the ceiling of the indexed framebuffer's
+	// draw image. the panorama wraps once around the player, the view angle
+	// picks the column the left edge of the screen starts at and every
+	// screen column steps the same amount further, so sky.comp does one
+	// fetch per pixel. only rows above the horizon and above the first wall
+	// row of their column are written
+	class VreSky {
+	public:
+		static constexpr int PANORAMA_WIDTH = 2048;
+		static constexpr int PANORAMA_HEIGHT = 256;
+
+		// _drawImages per frame in flight, each frame writes its own
+		VreSky(VreDevice &_device,
+			const std::array<VkImageView, VreSwapchain::MAX_FRAMES_IN_FLIGHT> &_drawImages,
+			uint32_t _width, uint32_t _height);
+		~VreSky();
+
+		VreSky(const VreSky &) = delete;
+		VreSky &operator=(const VreSky &) = delete;
+
+		// wall extents per column of the frame, columns with top >= bottom
+		// have no wall and show sky down to the horizon
+		void update(size_t _frame, const int16_t *_tops, const int16_t *_bottoms);
+		// the draw image of _frame in GENERAL layout after the expansion
+		// wrote it
+		void record(VkCommandBuffer _cmd, size_t _frame, float _angle, float _fov);
+
+	private:
+		struct FrameResources {
+			VkBuffer tops = VK_NULL_HANDLE;
+			VkDeviceMemory topsMemory = VK_NULL_HANDLE;
+			int32_t *mapped = nullptr;
+			VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+		};
+
+		void createPanorama();
+		void createFrameResources();
+		void createDescriptors(
+			const std::array<VkImageView, VreSwapchain::MAX_FRAMES_IN_FLIGHT> &_drawImages);
+		void createPipeline();
+
+		VreDevice &m_vreDevice;
+		uint32_t m_width;
+		uint32_t m_height;
+
+		VkBuffer m_panorama = VK_NULL_HANDLE;
+		VkDeviceMemory m_panoramaMemory = VK_NULL_HANDLE;
+		std::array<FrameResources, VreSwapchain::MAX_FRAMES_IN_FLIGHT> m_frames;
+
+		VkDescriptorPool m_descriptorPool = VK_NULL_HANDLE;
+		VkDescriptorSetLayout m_setLayout = VK_NULL_HANDLE;
+		VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE;
+		VkPipeline m_pipeline = VK_NULL_HANDLE;
+	};
+}
@@ -0,0 +1,136 @@
+#include "VreStackedRenderer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+void vre::VreStackedRenderer::render(const CpuFrame &_frame, const VreMap &_map,
+	const RayCamera &_camera, VreThreadPool &_pool, float _eyeHeight
+) const {
+	constexpr int BAND = 64;
+	float focal = _frame.width * 0.5f / std::tan(_camera.fov * 0.5f);
+	RayFrustum frustum(_camera, _frame.width);
+
+	float invCellSize = 1.0f / static_cast<float>(_map.cellSize());
+	int cameraX = static_cast<int>(std::floor(_camera.x * invCellSize));
+	int cameraY = static_cast<int>(std::floor(_camera.y * invCellSize));
+	float eye = _eyeHeight;
+	if (_map.inBounds(cameraX, cameraY)) {
+		CellHeights heights = _map.heights(cameraX, cameraY);
+		eye = std::min(heights.floor + _eyeHeight, heights.ceiling);
+	}
+
+	_pool.parallelFor((_frame.width + BAND - 1) / BAND, [&](int _band) {
+		for (int x = _band * BAND; x < std::min((_band + 1) * BAND, _frame.width); x++) {
+			drawColumn(_frame, _map, _camera, frustum, x, focal, eye);
+		}
+	});
+}
+
+void vre::VreStackedRenderer::drawColumn(const CpuFrame &_frame, const VreMap &_map,
+	const RayCamera &_camera, const RayFrustum &_frustum, int _x, float _focal, float _eye
+) const {
+	const float cellSize = static_cast<float>(_map.cellSize());
+	const float invCellSize = 1.0f / cellSize;
+	const int maxSteps = _map.width() + _map.height() + 2;
+	const int half = _frame.height / 2;
+	const uint8_t *background = _frame.background;
+	uint8_t *out = _frame.columnPixels + static_cast<size_t>(_x) * _frame.columnStride;
+
+	float dirX;
+	float dirY;
+	_frustum.direction(_x, dirX, dirY);
+	float deltaX = raycast::deltaDistance(cellSize, dirX);
+	float deltaY = raycast::deltaDistance(cellSize, dirY);
+	int mapX = static_cast<int>(std::floor(_camera.x * invCellSize));
+	int mapY = static_cast<int>(std::floor(_camera.y * invCellSize));
+	float sideX = raycast::firstSideDistance(cellSize, _camera.x - mapX * cellSize, dirX);
+	float sideY = raycast::firstSideDistance(cellSize, _camera.y - mapY * cellSize, dirY);
+	int stepX = dirX < 0.0f ? -1 : 1;
+	int stepY = dirY < 0.0f ? -1 : 1;
+
+	// rows [top, bottom) are still open, everything outside is final
+	int top = 0;
+	int bottom = _frame.height;
+	CellHeights current = _map.inBounds(mapX, mapY) ? _map.heights(mapX, mapY) : CellHeights{};
+	float surface = current.floor;
+
+	// floor and ceiling keep the per row shading of the flat renderer
+	auto fillBackground = [&](int _from, int _to) {
+		if (_to > _from) {
+			memcpy(out + _from, background + _from, static_cast<size_t>(_to - _from));
+		}
+	};
+
+	for (int step = 0; step < maxSteps && top < bottom; step++) {
+		int side;
+		if (sideX < sideY) {
+			sideX += deltaX;
+			mapX += stepX;
+			side = 0;
+		} else {
+			sideY += deltaY;
+			mapY += stepY;
+			side = 1;
+		}
+		if (!_map.inBounds(mapX, mapY)) {
+			bool leaving = (mapX < 0 && stepX < 0) || (mapX >= _map.width() && stepX > 0)
+				|| (mapY < 0 && stepY < 0) || (mapY >= _map.height() && stepY > 0);
+			if (leaving) {
+				break;
+			}
+			continue;
+		}
+
+		int cell = _map.at(mapX, mapY);
+		CellHeights next = _map.heights(mapX, mapY);
+		// floor and ceiling rows only depend on the row, so a run of cells at
+		// the same heights can close them all at the far end
+		if (cell == 0 && next.floor == surface && next.ceiling == current.ceiling) {
+			continue;
+		}
+
+		// same rounding as wallColumn, so flat maps match it pixel for pixel
+		float distance = side == 0 ? sideX - deltaX : sideY - deltaY;
+		float lineHeight = static_cast<float>(static_cast<int>(cellSize * _focal
+			/ std::max(distance, 1.0f)));
+		auto row = [&](float _height) {
+			return std::clamp(half - static_cast<int>((_height - _eye) * lineHeight), top, bottom);
+		};
+
+		// the cell being left ends here, its floor and ceiling are final
+		int floorRow = row(surface);
+		fillBackground(floorRow, bottom);
+		bottom = floorRow;
+		int ceilingRow = row(current.ceiling);
+		fillBackground(top, ceilingRow);
+		top = ceilingRow;
+
+		float nextSurface = cell != 0 ? next.wallTop : next.floor;
+		int light = CpuFrame::wallLight(distance, cellSize, side);
+
+		// a wall is a step up to its top, in the wall's colour
+		if (nextSurface > surface) {
+			int ramp = cell != 0 ? VrePalette::wallRamp(cell) : VrePalette::RAMP_FLOOR;
+			int riserRow = row(nextSurface);
+			memset(out + riserRow, _frame.palette->shade(VrePalette::index(ramp, VrePalette::SHADES - 1), light),
+				static_cast<size_t>(bottom - riserRow));
+			bottom = riserRow;
+		}
+		if (next.ceiling < current.ceiling) {
+			int lipRow = row(next.ceiling);
+			memset(out + top, _frame.palette->shade(VrePalette::index(VrePalette::RAMP_CEILING,
+				VrePalette::SHADES - 1), light), static_cast<size_t>(lipRow - top));
+			top = lipRow;
+		}
+
+		if (nextSurface >= next.ceiling) {
+			break;
+		}
+		current = next;
+		surface = nextSurface;
+	}
+
+	// rows nothing closed off, the ray left the map
+	fillBackground(top, bottom);
+}
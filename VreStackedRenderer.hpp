@@ -0,0 +1,20 @@
+#pragma once
+
+#include "VreCpuFrame.hpp"
+#include "VreMap.hpp"
+#include "VreRaycaster.hpp"
+#include "VreThreadPool.hpp"
+
+namespace vre {
+	// maps with CellHeights, see VreCpuRenderer::renderStacked. draws into
+	// the column major buffer, a column band per task
+	class VreStackedRenderer {
+	public:
+		void render(const CpuFrame &_frame, const VreMap &_map, const RayCamera &_camera,
+			VreThreadPool &_pool, float _eyeHeight) const;
+
+	private:
+		void drawColumn(const CpuFrame &_frame, const VreMap &_map, const RayCamera &_camera,
+			const RayFrustum &_frustum, int _x, float _focal, float _eye) const;
+	};
+}
@@ -0,0 +1,39 @@
+#include "VreStatsPanel.hpp"
+
+#include "imgui.h"
+
+namespace {
+	void histogram(const char *_label, const uint64_t *_buckets) {
+		float values[vre::RAY_STATS_BUCKETS];
+		float largest = 0.0f;
+		for (int i = 0; i < vre::RAY_STATS_BUCKETS; i++) {
+			values[i] = static_cast<float>(_buckets[i]);
+			largest = values[i] > largest ? values[i] : largest;
+		}
+		ImGui::PlotHistogram(_label, values, vre::RAY_STATS_BUCKETS, 0, nullptr,
+			0.0f, largest, ImVec2(0.0f, 60.0f));
+	}
+}
+
+void vre::ui::rayStatsPanel(const RayStatsFrame &_frame) {
+	ImGui::Begin("Ray stats");
+#if VRE_ENABLE_RAY_STATS
+	const RayStatsCounters &counters = _frame.counters;
+	double rays = counters.rays > 0 ? static_cast<double>(counters.rays) : 1.0;
+	ImGui::Text("frame %llu", static_cast<unsigned long long>(_frame.frame));
+	ImGui::Text("rays %llu", static_cast<unsigned long long>(counters.rays));
+	ImGui::Text("dda steps %llu (%.1f per ray)",
+		static_cast<unsigned long long>(counters.steps), counters.steps / rays);
+	ImGui::Text("tile crossings %llu (%.2f per ray)",
+		static_cast<unsigned long long>(counters.tileCrossings), counters.tileCrossings / rays);
+	ImGui::Text("early outs %llu", static_cast<unsigned long long>(counters.earlyOuts));
+
+	// bucket i covers [2^(i-1), 2^i)
+	histogram("steps (log2)", counters.stepHistogram);
+	histogram("distance (log2 cells)", counters.distanceHistogram);
+#else
+	(void)_frame;
+	ImGui::Text("built with VRE_ENABLE_RAY_STATS=0");
+#endif
+	ImGui::End();
+}
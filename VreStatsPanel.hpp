@@ -0,0 +1,11 @@
+#pragma once
+
+#include "VreRayStats.hpp"
+
+namespace vre {
+	namespace ui {
+		// imgui window with the ray counters of the last finished frame.
+		// call between ImGui::NewFrame and ImGui::Render
+		void rayStatsPanel(const RayStatsFrame &_frame);
+	}
+}
@@ -1,13 +1,21 @@
 #include "VreSwapchain.hpp"
 
-vre::VreSwapchain::VreSwapchain(VreDevice &_device, VkExtent2D _extent
-) : m_vreDevice(_device), m_windowExtent(_extent) {
+#include <algorithm>
+
+namespace {
+	// weight of the newest frame in the present done average
+	constexpr double PRESENT_SMOOTHING = 0.1;
+}
+
+vre::VreSwapchain::VreSwapchain(VreDevice &_device, VkExtent2D _extent,
+	SwapchainSettings _settings
+) : m_vreDevice(_device), m_windowExtent(_extent), m_settings(_settings) {
 	init();
 }
 
 vre::VreSwapchain::VreSwapchain(VreDevice &_device, VkExtent2D _extent,
-	std::shared_ptr<VreSwapchain> _previous
-) : m_vreDevice(_device), m_windowExtent(_extent), m_oldSwapchain(_previous) {
+	std::shared_ptr<VreSwapchain> _previous, SwapchainSettings _settings
+) : m_vreDevice(_device), m_windowExtent(_extent), m_settings(_settings), m_oldSwapchain(_previous) {
 	init();
 
 	// clean up old swapchain since its no longer needed
@@ -38,7 +46,7 @@ vre::VreSwapchain::~VreSwapchain() {
 	vkDestroyRenderPass(m_vreDevice.device(), m_renderPass, nullptr);
 
 	// cleanup sync objs
-	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+	for (size_t i = 0; i < m_inFlightFences.size(); i++) {
 		vkDestroySemaphore(m_vreDevice.device(), m_renderFinishedSemaphores[i], nullptr);
 		vkDestroySemaphore(m_vreDevice.device(), m_imageAvailableSemaphores[i], nullptr);
 		vkDestroyFence(m_vreDevice.device(), m_inFlightFences[i], nullptr);
@@ -54,12 +62,30 @@ VkFormat vre::VreSwapchain::findDepthFormat() {
 		);
 }
 
+const char *vre::VreSwapchain::presentModeName(VkPresentModeKHR _mode) {
+	switch (_mode) {
+	case VK_PRESENT_MODE_FIFO_KHR:
+		return "fifo";
+	case VK_PRESENT_MODE_MAILBOX_KHR:
+		return "mailbox";
+	case VK_PRESENT_MODE_IMMEDIATE_KHR:
+		return "immediate";
+	default:
+		return "other";
+	}
+}
+
 VkResult vre::VreSwapchain::acquireNextImage(uint32_t *_imageIndex) {
+	pollPresents();
 	vkWaitForFences(m_vreDevice.device(), 1, &m_inFlightFences[m_currentFrame],
 		VK_TRUE, std::numeric_limits<uint64_t>::max());
 	VkResult result = vkAcquireNextImageKHR(m_vreDevice.device(), m_swapchain,
 		std::numeric_limits<uint64_t>::max(), m_imageAvailableSemaphores[m_currentFrame],
 		VK_NULL_HANDLE, _imageIndex);
+	// an image handed back has left the display, its present is long done
+	if (result == VK_SUCCESS || result == VK_SUBOPTIMAL_KHR) {
+		completePresent(*_imageIndex);
+	}
 	return result;
 }
 
@@ -91,6 +117,7 @@ VkResult vre::VreSwapchain::submitCommandBuffers(
 	submitInfo.pSignalSemaphores = signalSemaphores;
 
 	vkResetFences(m_vreDevice.device(), 1, &m_inFlightFences[m_currentFrame]);
+	m_submitTimes[*_imageIndex] = std::chrono::steady_clock::now();
 	if (vkQueueSubmit(m_vreDevice.graphicsQueue(), 1, &submitInfo,
 		m_inFlightFences[m_currentFrame]) != VK_SUCCESS) {
 		throw std::runtime_error("Failed to submit draw commandbuffer");
@@ -106,14 +133,55 @@ VkResult vre::VreSwapchain::submitCommandBuffers(
 	presentInfo.pSwapchains = swapchains;
 	presentInfo.pImageIndices = _imageIndex;
 
+	VkPresentIdKHR presentId{};
+	if (m_vreDevice.hasPresentWait()) {
+		m_presentIds[*_imageIndex] = ++m_lastPresentId;
+		presentId.sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR;
+		presentId.swapchainCount = 1;
+		presentId.pPresentIds = &m_presentIds[*_imageIndex];
+		presentInfo.pNext = &presentId;
+	}
+
 	auto result = vkQueuePresentKHR(m_vreDevice.presentQueue(), &presentInfo);
+	if (result == VK_SUCCESS || result == VK_SUBOPTIMAL_KHR) {
+		m_pending[*_imageIndex] = 1;
+	}
 
-	m_currentFrame = (m_currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+	m_currentFrame = (m_currentFrame + 1) % m_inFlightFences.size();
 
 	return result;
 }
 
+void vre::VreSwapchain::pollPresents() {
+	if (!m_vreDevice.hasPresentWait()) {
+		return;
+	}
+	for (uint32_t i = 0; i < m_pending.size(); i++) {
+		if (m_pending[i] && m_vreDevice.waitForPresent()(m_vreDevice.device(), m_swapchain,
+			m_presentIds[i], 0) == VK_SUCCESS) {
+			completePresent(i);
+		}
+	}
+}
+
+void vre::VreSwapchain::completePresent(uint32_t _image) {
+	if (!m_pending[_image]) {
+		return;
+	}
+	m_pending[_image] = 0;
+
+	double ms = std::chrono::duration<double, std::milli>(
+		std::chrono::steady_clock::now() - m_submitTimes[_image]).count();
+	if (!m_presentMeasured) {
+		m_presentDoneMs = ms;
+		m_presentMeasured = true;
+	} else {
+		m_presentDoneMs += (ms - m_presentDoneMs) * PRESENT_SMOOTHING;
+	}
+}
+
 void vre::VreSwapchain::init() {
+	m_settings.framesInFlight = std::clamp(m_settings.framesInFlight, 1, MAX_FRAMES_IN_FLIGHT);
 	createSwapchain();
 	createImageViews();
 	createRenderpass();
@@ -127,6 +195,7 @@ void vre::VreSwapchain::createSwapchain() {
 
 	VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapchainSupport.formats);
 	VkPresentModeKHR presentMode = chooseSwapPresentMode(swapchainSupport.presentModes);
+	m_presentMode = presentMode;
 	VkExtent2D extent = chooseSwapExtent(swapchainSupport.capabilities);
 
 	uint32_t imageCount = swapchainSupport.capabilities.minImageCount + 1;
@@ -144,7 +213,10 @@ void vre::VreSwapchain::createSwapchain() {
 	createInfo.imageColorSpace = surfaceFormat.colorSpace;
 	createInfo.imageExtent = extent;
 	createInfo.imageArrayLayers = 1;
-	createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+	// transfer dst so the cpu renderer can blit into it and the plain
+	// path can clear it before the render pass loads it
+	createInfo.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT
+		| VK_IMAGE_USAGE_TRANSFER_DST_BIT;
 
 	QueueFamilyIndices indices = m_vreDevice.findPhysicalQueueFamilies();
 	uint32_t queueFamilyIndices[] = { indices.graphicsFamily, indices.presentFamily };
@@ -270,11 +342,13 @@ void vre::VreSwapchain::createRenderpass() {
 	VkAttachmentDescription colorAttachment{};
 	colorAttachment.format = getSwapchainImageFormat();
 	colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
-	colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+	// the image is already filled by a transfer (blit or clear) when the
+	// render pass starts, everything in here draws on top of it
+	colorAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
 	colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
 	colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
 	colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-	colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+	colorAttachment.initialLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
 	colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
 	VkAttachmentReference colorAttachmentRef{};
@@ -289,13 +363,14 @@ void vre::VreSwapchain::createRenderpass() {
 
 	VkSubpassDependency dependency{};
 	dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-	dependency.srcAccessMask = 0;
+	dependency.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
 	dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT
-		| VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+		| VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT;
 	dependency.dstSubpass = 0;
 	dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT
 		| VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-	dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT
+	dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT
+		| VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT
 		| VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
 
 	std::array<VkAttachmentDescription, 2> attachments = { colorAttachment, depthAttachment };
@@ -337,10 +412,14 @@ void vre::VreSwapchain::createFramebuffers() {
 }
 
 void vre::VreSwapchain::createSyncObjects() {
-	m_imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-	m_renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-	m_inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
+	size_t frames = static_cast<size_t>(m_settings.framesInFlight);
+	m_imageAvailableSemaphores.resize(frames);
+	m_renderFinishedSemaphores.resize(frames);
+	m_inFlightFences.resize(frames);
 	m_imagesInFlight.resize(imageCount(), VK_NULL_HANDLE);
+	m_submitTimes.resize(imageCount());
+	m_presentIds.resize(imageCount(), 0);
+	m_pending.resize(imageCount(), 0);
 
 	VkSemaphoreCreateInfo semaphoreInfo{};
 	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
@@ -349,7 +428,7 @@ void vre::VreSwapchain::createSyncObjects() {
 	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
 	fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
-	for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+	for (size_t i = 0; i < frames; i++) {
 		if (vkCreateSemaphore(m_vreDevice.device(), &semaphoreInfo, nullptr, &m_imageAvailableSemaphores[i]) != VK_SUCCESS
 			|| vkCreateSemaphore(m_vreDevice.device(), &semaphoreInfo, nullptr, &m_renderFinishedSemaphores[i]) != VK_SUCCESS
 			|| vkCreateFence(m_vreDevice.device(), &fenceInfo, nullptr, &m_inFlightFences[i]) != VK_SUCCESS) {
@@ -372,21 +451,14 @@ VkSurfaceFormatKHR vre::VreSwapchain::chooseSwapSurfaceFormat(
 
 VkPresentModeKHR vre::VreSwapchain::chooseSwapPresentMode(const std::vector<VkPresentModeKHR> &_availablePresentModes) {
 	for (const auto &availablePresentMode : _availablePresentModes) {
-		if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
-			std::cout << "Present mode: Mailbox" << std::endl;
+		if (availablePresentMode == m_settings.presentMode) {
+			std::cout << "Present mode: " << presentModeName(availablePresentMode) << std::endl;
 			return availablePresentMode;
 		}
 	}
 
-	for (const auto &availablePresentMode : _availablePresentModes) {
-		if (availablePresentMode == VK_PRESENT_MODE_IMMEDIATE_KHR) {
-			std::cout << "Present Mode: immediate available, but not selected" << std::endl;
-			// return availablePresentMode;
-			break;
-		}
-	}
-
-	std::cout << "Present mode: V-Sync" << std::endl;
+	std::cout << "Present mode: " << presentModeName(m_settings.presentMode)
+		<< " not available, V-Sync" << std::endl;
 	return VK_PRESENT_MODE_FIFO_KHR;
 }
 
@@ -3,25 +3,52 @@
 #include <iostream>
 #include <vector>
 #include <memory>
+#include <chrono>
 
 #include <vulkan/vulkan.h>
 
 #include "VreDevice.hpp"
+#include "VideoSettings.hpp"
 
 namespace vre {
+	// chosen at runtime, a change takes a new swapchain
+	struct SwapchainSettings {
+		// 1 to VreSwapchain::MAX_FRAMES_IN_FLIGHT
+		int framesInFlight = 2;
+		// fifo when the surface doesn't offer it, fifo is always there
+		VkPresentModeKHR presentMode = VYSNC ? VK_PRESENT_MODE_FIFO_KHR : VK_PRESENT_MODE_MAILBOX_KHR;
+	};
+
 	class VreSwapchain {
 	public:
-		static constexpr int MAX_FRAMES_IN_FLIGHT = 2;
+		// per frame resources elsewhere are sized for this many slots, the
+		// settings choose how many of them are used
+		static constexpr int MAX_FRAMES_IN_FLIGHT = 3;
 
-		VreSwapchain(VreDevice &_device, VkExtent2D _extent);
+		VreSwapchain(VreDevice &_device, VkExtent2D _extent, SwapchainSettings _settings = {});
 		VreSwapchain(VreDevice &_device, VkExtent2D _extent, 
-			std::shared_ptr<VreSwapchain> _previous);
+			std::shared_ptr<VreSwapchain> _previous, SwapchainSettings _settings = {});
 		~VreSwapchain();
 
+		static const char *presentModeName(VkPresentModeKHR _mode);
+
 		VkFramebuffer getFramebuffer(int _index) { return m_swapchainFramebuffers[_index]; }
 		VkRenderPass getRenderPass() { return m_renderPass; }
 		VkImageView getImageView(int _index) { return m_swapchainImageViews[_index]; }
 		size_t imageCount() { return m_swapchainImages.size(); }
+		VkImage getImage(int _index) { return m_swapchainImages[_index]; }
+		// frame in flight slot the next submit uses, per frame resources index with this
+		size_t currentFrame() { return m_currentFrame; }
+		int framesInFlight() const { return m_settings.framesInFlight; }
+		// the mode in use, which is the requested one if the surface has it
+		VkPresentModeKHR presentMode() const { return m_presentMode; }
+		// cpu submit until the frame's present was done, averaged over the
+		// last frames. with VK_KHR_present_wait that is the image reaching
+		// the display, polled once a frame so up to a frame late. without it
+		// the end is when the image is acquired again, after the display
+		// moved on to a later one, so it runs long by about a refresh
+		double presentDoneMs() const { return m_presentDoneMs; }
+		bool presentWaitTimed() const { return m_vreDevice.hasPresentWait(); }
 		VkFormat getSwapchainImageFormat() { return m_swapchainImageFormat; }
 		VkExtent2D getSwapchainExtent() { return m_swapchainExtent; }
 		uint32_t width() { return m_swapchainExtent.width; }
@@ -42,6 +69,9 @@ namespace vre {
 		void createRenderpass();
 		void createFramebuffers();
 		void createSyncObjects();
+		// times the presented images whose present wait has finished
+		void pollPresents();
+		void completePresent(uint32_t _image);
 
 		// helpers
 		VkSurfaceFormatKHR chooseSwapSurfaceFormat(
@@ -53,6 +83,8 @@ namespace vre {
 
 		VreDevice &m_vreDevice;
 		VkExtent2D m_windowExtent;
+		SwapchainSettings m_settings;
+		VkPresentModeKHR m_presentMode = VK_PRESENT_MODE_FIFO_KHR;
 
 		VkSwapchainKHR m_swapchain;
 		std::shared_ptr<VreSwapchain> m_oldSwapchain;
@@ -74,5 +106,13 @@ namespace vre {
 		std::vector<VkFence> m_inFlightFences;
 		std::vector<VkFence> m_imagesInFlight;
 		size_t m_currentFrame = 0;
+
+		// per swapchain image, for the present it is waiting on
+		std::vector<std::chrono::steady_clock::time_point> m_submitTimes;
+		std::vector<uint64_t> m_presentIds;
+		std::vector<uint8_t> m_pending;
+		uint64_t m_lastPresentId = 0;
+		double m_presentDoneMs = 0.0;
+		bool m_presentMeasured = false;
 	};
 }
\ No newline at end of file
@@ -0,0 +1,112 @@
+#include "VreTerrain.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include "VrePalette.hpp"
+
+namespace {
+	constexpr float WATER_LEVEL = 0.35f;
+
+	uint32_t nextRandom(uint32_t &_state) {
+		_state ^= _state << 13;
+		_state ^= _state >> 17;
+		_state ^= _state << 5;
+		return _state;
+	}
+
+	// palette ramp by height, bands are fractions of the full range
+	int terrainRamp(float _height) {
+		if (_height <= WATER_LEVEL) {
+			return 3;
+		}
+		if (_height < 0.4f) {
+			return 4;
+		}
+		if (_height < 0.65f) {
+			return 2;
+		}
+		return _height < 0.8f ? 8 : 7;
+	}
+}
+
+vre::VreTerrain::VreTerrain(int _sizeShift, const std::vector<uint8_t> &_heights,
+	const std::vector<uint8_t> &_colors
+) : m_sizeShift{ _sizeShift }, m_mask{ (1 << _sizeShift) - 1 } {
+	size_t texels = _sizeShift >= 1 && _sizeShift <= 14 ? static_cast<size_t>(1) << (2 * _sizeShift) : 0;
+	if (texels == 0 || _heights.size() != texels || _colors.size() != texels) {
+		throw std::runtime_error("Failed to create terrain, maps must be square powers of two");
+	}
+	m_texels.resize(texels);
+	for (size_t i = 0; i < texels; i++) {
+		m_texels[i] = static_cast<uint16_t>(_heights[i] | (_colors[i] << 8));
+	}
+}
+
+vre::VreTerrain vre::VreTerrain::generate(int _sizeShift, uint32_t _seed) {
+	int size = 1 << _sizeShift;
+	std::vector<float> field(static_cast<size_t>(size) * size, 0.0f);
+	uint32_t rng = _seed * 2654435761u | 1u;
+
+	// octaves of smoothed value noise on wrapping lattices, so the result
+	// tiles like the renderer expects
+	float amplitude = 1.0f;
+	for (int cells = 4; cells <= size && cells <= 512; cells *= 2) {
+		std::vector<float> lattice(static_cast<size_t>(cells) * cells);
+		for (float &value : lattice) {
+			value = static_cast<float>(nextRandom(rng) >> 8) / 16777216.0f;
+		}
+		float scale = static_cast<float>(cells) / static_cast<float>(size);
+		for (int y = 0; y < size; y++) {
+			float fy = y * scale;
+			int y0 = static_cast<int>(fy);
+			float ty = fy - y0;
+			ty = ty * ty * (3.0f - 2.0f * ty);
+			const float *row0 = &lattice[static_cast<size_t>(y0 % cells) * cells];
+			const float *row1 = &lattice[static_cast<size_t>((y0 + 1) % cells) * cells];
+			for (int x = 0; x < size; x++) {
+				float fx = x * scale;
+				int x0 = static_cast<int>(fx);
+				float tx = fx - x0;
+				tx = tx * tx * (3.0f - 2.0f * tx);
+				int x1 = (x0 + 1) % cells;
+				x0 %= cells;
+				float top = row0[x0] + (row0[x1] - row0[x0]) * tx;
+				float bottom = row1[x0] + (row1[x1] - row1[x0]) * tx;
+				field[static_cast<size_t>(y) * size + x] += amplitude * (top + (bottom - top) * ty);
+			}
+		}
+		amplitude *= 0.5f;
+	}
+
+	auto [low, high] = std::minmax_element(field.begin(), field.end());
+	float minimum = *low;
+	float range = std::max(*high - minimum, 1e-6f);
+	for (float &value : field) {
+		value = std::max((value - minimum) / range, WATER_LEVEL);
+	}
+
+	std::vector<uint8_t> heights(field.size());
+	std::vector<uint8_t> colors(field.size());
+	for (int y = 0; y < size; y++) {
+		for (int x = 0; x < size; x++) {
+			size_t i = static_cast<size_t>(y) * size + x;
+			float height = field[i];
+			heights[i] = static_cast<uint8_t>(height * 255.0f);
+
+			// sun from the west, slopes facing it are lit and the rest fall
+			// off, water stays flat
+			float west = field[static_cast<size_t>(y) * size + ((x + size - 1) & (size - 1))];
+			float east = field[static_cast<size_t>(y) * size + ((x + 1) & (size - 1))];
+			int shade = 12 + static_cast<int>((west - east) * 400.0f);
+			shade = height <= WATER_LEVEL ? 12 : std::clamp(shade, 4, VrePalette::SHADES - 1);
+			colors[i] = VrePalette::index(terrainRamp(height), shade);
+		}
+	}
+	return VreTerrain(_sizeShift, heights, colors);
+}
+
+float vre::VreTerrain::heightAt(float _x, float _y) const {
+	return m_texels[texel(static_cast<int>(std::floor(_x)), static_cast<int>(std::floor(_y)))] & 0xff;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace vre {
+	// eye over the terrain, position and height in texels. horizon is the screen row of the horizon as a
+	// fraction of the frame height, moving it up or down looks down or up
+	struct TerrainCamera {
+		float x;
+		float y;
+		float angle;
+		float height;
+		float fov = 1.0471976f; // 60 degrees, like RayCamera
+		float horizon = 0.4f;
+	};
+
+	struct TerrainSettings {
+		float maxDistance = 1500.0f; // texels along the view direction
+		float verticalScale = 0.6f; // texels of rise per heightmap step
+		// march step at distance d is 1 + d * lodGrowth texels, far away
+		// one sample covers many texels and the cost per column stays low
+		float lodGrowth = 0.006f;
+		float fogStart = 400.0f; // one palette shade darker every fogStep
+		float fogStep = 120.0f;
+	};
+
+	// heightmap and colormap pair for the voxel space renderer, the
+	// colormap holds palette indices with the lighting already baked in.
+	// both wrap around, the size is a power of two so wrapping is a mask
+	class VreTerrain {
+	public:
+		// fractal noise hills with water, sand, grass, rock and snow
+		static VreTerrain generate(int _sizeShift, uint32_t _seed);
+
+		VreTerrain() {}
+		VreTerrain(int _sizeShift, const std::vector<uint8_t> &_heights,
+			const std::vector<uint8_t> &_colors);
+
+		int size() const { return 1 << m_sizeShift; }
+		int sizeShift() const { return m_sizeShift; }
+		bool empty() const { return m_texels.empty(); }
+
+		// index of the texel containing (_x, _y), wrapped
+		uint32_t texel(int _x, int _y) const {
+			return (static_cast<uint32_t>(_y & m_mask) << m_sizeShift) | static_cast<uint32_t>(_x & m_mask);
+		}
+		// height in the low byte and color in the high byte, one load per
+		// sample touches a single cache line
+		const uint16_t *texels() const { return m_texels.data(); }
+		// raw heightmap step under a position, times verticalScale for texels
+		float heightAt(float _x, float _y) const;
+
+	private:
+		int m_sizeShift = 0;
+		int m_mask = 0;
+		std::vector<uint16_t> m_texels;
+	};
+}
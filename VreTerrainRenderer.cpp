@@ -0,0 +1,72 @@
+#include "VreTerrainRenderer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+void vre::VreTerrainRenderer::render(const CpuFrame &_frame, const VreTerrain &_terrain,
+	const TerrainCamera &_camera, VreThreadPool &_pool, TerrainSettings _settings
+) {
+	constexpr int BAND = 64;
+	float focal = _frame.width * 0.5f / std::tan(_camera.fov * 0.5f);
+	RayFrustum frustum(RayCamera{ _camera.x, _camera.y, _camera.angle, _camera.fov }, _frame.width);
+
+	// sky brightens towards the horizon, which moves with the camera
+	int horizon = static_cast<int>(_camera.horizon * _frame.height);
+	m_sky.resize(_frame.height);
+	for (int y = 0; y < _frame.height; y++) {
+		int light = std::clamp((horizon - y) * 2 * VrePalette::SHADES / std::max(_frame.height, 1), 0,
+			VrePalette::SHADES - 1);
+		m_sky[y] = _frame.palette->shade(VrePalette::index(VrePalette::RAMP_CEILING,
+			VrePalette::SHADES - 1), light / 2);
+	}
+
+	_pool.parallelFor((_frame.width + BAND - 1) / BAND, [&](int _band) {
+		for (int x = _band * BAND; x < std::min((_band + 1) * BAND, _frame.width); x++) {
+			drawColumn(_frame, _terrain, _camera, _settings, frustum, x, focal);
+		}
+	});
+}
+
+void vre::VreTerrainRenderer::drawColumn(const CpuFrame &_frame, const VreTerrain &_terrain,
+	const TerrainCamera &_camera, const TerrainSettings &_settings, const RayFrustum &_frustum,
+	int _x, float _focal
+) const {
+	const uint16_t *texels = _terrain.texels();
+	const float horizon = static_cast<float>(static_cast<int>(_camera.horizon * _frame.height));
+	const float verticalScale = _settings.verticalScale;
+	uint8_t *out = _frame.columnPixels + static_cast<size_t>(_x) * _frame.columnStride;
+
+	float dirX;
+	float dirY;
+	_frustum.direction(_x, dirX, dirY);
+
+	// the direction is forward + plane * cameraX, so t is the depth along
+	// the view axis and the projection needs no fisheye correction
+	int yBuffer = _frame.height;
+	float t = 1.0f;
+	while (t < _settings.maxDistance && yBuffer > 0) {
+		float sampleX = _camera.x + dirX * t;
+		float sampleY = _camera.y + dirY * t;
+		int texelX = static_cast<int>(sampleX);
+		int texelY = static_cast<int>(sampleY);
+		texelX -= sampleX < static_cast<float>(texelX);
+		texelY -= sampleY < static_cast<float>(texelY);
+		uint16_t texel = texels[_terrain.texel(texelX, texelY)];
+
+		float rise = _camera.height - static_cast<float>(texel & 0xff) * verticalScale;
+		int y = static_cast<int>(horizon + rise * _focal / t);
+		if (y < yBuffer) {
+			y = std::max(y, 0);
+			int fog = t < _settings.fogStart ? 0 : std::min(static_cast<int>((t - _settings.fogStart)
+				/ _settings.fogStep), VrePalette::SHADES - 1);
+			memset(out + y, _frame.palette->shade(static_cast<uint8_t>(texel >> 8), fog), static_cast<size_t>(yBuffer - y));
+			yBuffer = y;
+		}
+		t += 1.0f + t * _settings.lodGrowth;
+	}
+
+	if (yBuffer > 0) {
+		memcpy(out, m_sky.data(), static_cast<size_t>(yBuffer));
+	}
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "VreCpuFrame.hpp"
+#include "VreRaycaster.hpp"
+#include "VreTerrain.hpp"
+#include "VreThreadPool.hpp"
+
+namespace vre {
+	// outdoor mode, see VreCpuRenderer::renderTerrain. draws into the
+	// column major buffer, a column band per task
+	class VreTerrainRenderer {
+	public:
+		void render(const CpuFrame &_frame, const VreTerrain &_terrain, const TerrainCamera &_camera,
+			VreThreadPool &_pool, TerrainSettings _settings);
+
+	private:
+		void drawColumn(const CpuFrame &_frame, const VreTerrain &_terrain,
+			const TerrainCamera &_camera, const TerrainSettings &_settings, const RayFrustum &_frustum,
+			int _x, float _focal) const;
+
+		std::vector<uint8_t> m_sky; // per row above the horizon
+	};
+}
@@ -0,0 +1,95 @@
+#include "VreThreadPool.hpp"
+
+#include <algorithm>
+
+namespace {
+	// set on pool threads and while the caller is running tasks
+	thread_local bool t_insideTask = false;
+}
+
+vre::VreThreadPool::VreThreadPool(unsigned _threads) {
+	if (_threads == 0) {
+		_threads = std::max(std::thread::hardware_concurrency(), 1u);
+	}
+	// the thread calling parallelFor is one of the _threads
+	for (unsigned i = 1; i < _threads; i++) {
+		m_workers.emplace_back(&VreThreadPool::workerLoop, this);
+	}
+}
+
+vre::VreThreadPool::~VreThreadPool() {
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_stop = true;
+	}
+	m_wake.notify_all();
+	for (std::thread &worker : m_workers) {
+		worker.join();
+	}
+}
+
+vre::VreThreadPool &vre::VreThreadPool::shared() {
+	static VreThreadPool pool;
+	return pool;
+}
+
+void vre::VreThreadPool::parallelFor(int _count, const std::function<void(int)> &_task) {
+	if (_count <= 0) {
+		return;
+	}
+	if (t_insideTask || m_workers.empty() || _count == 1) {
+		for (int i = 0; i < _count; i++) {
+			_task(i);
+		}
+		return;
+	}
+
+	std::lock_guard<std::mutex> submit(m_submitMutex);
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_task = &_task;
+		m_count = _count;
+		m_next.store(0, std::memory_order_relaxed);
+		m_busyWorkers = static_cast<int>(m_workers.size());
+		m_generation++;
+	}
+	m_wake.notify_all();
+
+	t_insideTask = true;
+	runTasks();
+	t_insideTask = false;
+
+	// _task has to outlive every worker that might still touch it
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_finished.wait(lock, [this] { return m_busyWorkers == 0; });
+	m_task = nullptr;
+}
+
+void vre::VreThreadPool::workerLoop() {
+	t_insideTask = true;
+	uint64_t seen = 0;
+	while (true) {
+		{
+			std::unique_lock<std::mutex> lock(m_mutex);
+			m_wake.wait(lock, [&] { return m_stop || m_generation != seen; });
+			if (m_stop) {
+				return;
+			}
+			seen = m_generation;
+		}
+
+		runTasks();
+
+		std::lock_guard<std::mutex> lock(m_mutex);
+		if (--m_busyWorkers == 0) {
+			m_finished.notify_one();
+		}
+	}
+}
+
+void vre::VreThreadPool::runTasks() {
+	int i;
+	while ((i = m_next.fetch_add(1, std::memory_order_relaxed)) < m_count) {
+		(*m_task)(i);
+	}
+}
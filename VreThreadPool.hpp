@@ -0,0 +1,52 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace vre {
+	// fixed set of worker threads for splitting one frame of cpu work into
+	// tiles or bands. parallelFor hands out indices from a shared counter,
+	// so uneven tiles balance themselves, and the calling thread works too
+	class VreThreadPool {
+	public:
+		// 0 uses every hardware thread
+		explicit VreThreadPool(unsigned _threads = 0);
+		~VreThreadPool();
+
+		VreThreadPool(const VreThreadPool &) = delete;
+		VreThreadPool &operator=(const VreThreadPool &) = delete;
+
+		// runs _task(i) for every i in [0, _count) and returns once all of
+		// them finished. one job at a time, a call from inside a task runs
+		// the nested loop inline instead of deadlocking
+		void parallelFor(int _count, const std::function<void(int)> &_task);
+
+		// workers plus the calling thread
+		unsigned threadCount() const { return static_cast<unsigned>(m_workers.size()) + 1; }
+
+		// pool sized to the machine, created on first use
+		static VreThreadPool &shared();
+
+	private:
+		void workerLoop();
+		void runTasks();
+
+		std::vector<std::thread> m_workers;
+		std::mutex m_submitMutex; // serializes parallelFor callers
+
+		std::mutex m_mutex;
+		std::condition_variable m_wake;
+		std::condition_variable m_finished;
+		uint64_t m_generation = 0;
+		bool m_stop = false;
+
+		const std::function<void(int)> *m_task = nullptr;
+		int m_count = 0;
+		std::atomic<int> m_next{ 0 };
+		int m_busyWorkers = 0;
+	};
+}
@@ -0,0 +1,400 @@
+#include "VreTiledRenderer.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VRE_TILED_SSE 1
+#include <emmintrin.h>
+#else
+#define VRE_TILED_SSE 0
+#endif
+
+void vre::VreTiledRenderer::resize(int _width) {
+	m_hits.resize(_width);
+	m_layers.resize(_width);
+	m_history.resize(_width);
+	m_reprojected.resize(_width);
+	m_hasHistory = false;
+	m_fullFrames = 0;
+	m_columnTop.resize(_width);
+	m_columnBottom.resize(_width);
+	m_columnIndex.resize(_width);
+}
+
+void vre::VreTiledRenderer::render(const CpuFrame &_frame, const VreRaycaster &_raycaster,
+	const RayCamera &_camera, VreThreadPool &_pool, CpuTileOptions _options
+) {
+	m_frame = _frame;
+	int columnBands = (m_frame.width + _options.columnBand - 1) / _options.columnBand;
+	m_layered = _raycaster.map()->hasTransparentCells();
+	m_cellSize = static_cast<float>(_raycaster.map()->cellSize());
+	m_focal = m_frame.width * 0.5f / std::tan(_camera.fov * 0.5f);
+
+	_pool.parallelFor(columnBands, [&](int _band) {
+		int x0 = _band * _options.columnBand;
+		int count = std::min(_options.columnBand, m_frame.width - x0);
+		if (m_layered) {
+			_raycaster.castColumnsLayered(_camera, x0, count, m_frame.width, &m_hits[x0], &m_layers[x0]);
+		} else {
+			_raycaster.castColumns(_camera, x0, count, m_frame.width, &m_hits[x0]);
+		}
+		shadeColumns(x0, x0 + count);
+	});
+
+	drawTiles(_camera, _pool, _options);
+	supersampleEdges(_raycaster, _camera, _pool, _options);
+
+	// layers aren't reprojected, an interlaced frame after this one casts
+	// everything again
+	m_history = m_hits;
+	m_historyCamera = _camera;
+	m_hasHistory = !m_layered;
+	m_castColumns = m_frame.width;
+}
+
+void vre::VreTiledRenderer::renderInterlaced(const CpuFrame &_frame,
+	const VreRaycaster &_raycaster, const RayCamera &_camera, VreThreadPool &_pool,
+	CpuTileOptions _options, CpuInterlaceOptions _interlace
+) {
+	m_frame = _frame;
+	float cellSize = static_cast<float>(_raycaster.map()->cellSize());
+	float turn = std::remainder(_camera.angle - m_historyCamera.angle, 6.2831853f);
+	float move = std::hypot(_camera.x - m_historyCamera.x, _camera.y - m_historyCamera.y);
+	if (m_fullFrames > 0) {
+		m_fullFrames--;
+		render(_frame, _raycaster, _camera, _pool, _options);
+		return;
+	}
+	if (!m_hasHistory || _raycaster.map()->hasTransparentCells() || _camera.fov != m_historyCamera.fov
+		|| std::abs(turn) > _interlace.maxTurn || move > _interlace.maxMove * cellSize) {
+		render(_frame, _raycaster, _camera, _pool, _options);
+		return;
+	}
+
+	int columnBands = (m_frame.width + _options.columnBand - 1) / _options.columnBand;
+	m_parity ^= 1;
+	m_layered = false;
+	m_cellSize = cellSize;
+	m_focal = m_frame.width * 0.5f / std::tan(_camera.fov * 0.5f);
+
+	// this frame's half, cast as half as many columns and spread out
+	RayCamera half = _camera;
+	half.columnStep = 2.0f;
+	half.columnPhase = static_cast<float>(m_parity);
+	int halfWidth = (m_frame.width + 1 - m_parity) / 2;
+	int halfBand = _options.columnBand / 2;
+	m_halfHits.resize(halfWidth);
+	_pool.parallelFor((halfWidth + halfBand - 1) / halfBand, [&](int _band) {
+		int x0 = _band * halfBand;
+		int count = std::min(halfBand, halfWidth - x0);
+		_raycaster.castColumns(half, x0, count, m_frame.width, &m_halfHits[x0]);
+		for (int i = x0; i < x0 + count; i++) {
+			m_hits[2 * i + m_parity] = m_halfHits[i];
+		}
+	});
+
+	reproject(_camera);
+
+	// the other half from the last frame where a cast neighbour agrees
+	auto sameFace = [](const RayHit &_a, const RayHit &_b) {
+		return _a.cell != 0 && _a.cell == _b.cell && _a.side == _b.side
+			&& (_a.side == 0 ? _a.mapX == _b.mapX : _a.mapY == _b.mapY);
+	};
+	m_recast.clear();
+	for (int x = 1 - m_parity; x < m_frame.width; x += 2) {
+		const RayHit &candidate = m_reprojected[x];
+		float nearest = raycast::NO_HIT_DISTANCE;
+		float farthest = 0.0f;
+		for (int neighbour : { x - 1, x + 1 }) {
+			if (neighbour >= 0 && neighbour < m_frame.width && sameFace(m_hits[neighbour], candidate)) {
+				nearest = std::min(nearest, m_hits[neighbour].distance);
+				farthest = std::max(farthest, m_hits[neighbour].distance);
+			}
+		}
+		if (farthest > 0.0f && candidate.distance >= nearest * (1.0f - _interlace.depthTolerance)
+			&& candidate.distance <= farthest * (1.0f + _interlace.depthTolerance)) {
+			m_hits[x] = candidate;
+		} else {
+			m_recast.push_back(x);
+		}
+	}
+
+	// runs of neighbouring recasts go out as one cast of the other half
+	RayCamera other = _camera;
+	other.columnStep = 2.0f;
+	other.columnPhase = static_cast<float>(1 - m_parity);
+	constexpr int RECAST_BATCH = 64;
+	int batches = (static_cast<int>(m_recast.size()) + RECAST_BATCH - 1) / RECAST_BATCH;
+	m_recastHits.resize(m_recast.size());
+	_pool.parallelFor(batches, [&](int _batch) {
+		size_t end = std::min(m_recast.size(), static_cast<size_t>(_batch + 1) * RECAST_BATCH);
+		for (size_t i = static_cast<size_t>(_batch) * RECAST_BATCH; i < end;) {
+			size_t run = i + 1;
+			while (run < end && m_recast[run] == m_recast[run - 1] + 2) {
+				run++;
+			}
+			_raycaster.castColumns(other, m_recast[i] / 2, static_cast<int>(run - i), m_frame.width,
+				&m_recastHits[i]);
+			for (; i < run; i++) {
+				m_hits[m_recast[i]] = m_recastHits[i];
+			}
+		}
+	});
+
+	_pool.parallelFor(columnBands, [&](int _band) {
+		int x0 = _band * _options.columnBand;
+		shadeColumns(x0, std::min(x0 + _options.columnBand, m_frame.width));
+	});
+	drawTiles(_camera, _pool, _options);
+	supersampleEdges(_raycaster, _camera, _pool, _options);
+
+	m_history = m_hits;
+	m_historyCamera = _camera;
+	m_castColumns = halfWidth + static_cast<int>(m_recast.size());
+	if (m_recast.size() > _interlace.maxRecast * (m_frame.width - halfWidth)) {
+		m_fullFrames = _interlace.fullFrames;
+	}
+}
+
+void vre::VreTiledRenderer::shadeColumns(int _x0, int _x1) {
+	for (int x = _x0; x < _x1; x++) {
+		WallColumn column = m_frame.wallColumn(m_hits[x], m_cellSize, m_focal);
+		m_columnTop[x] = static_cast<int16_t>(column.top);
+		m_columnBottom[x] = static_cast<int16_t>(column.bottom);
+		m_columnIndex[x] = column.index;
+	}
+}
+
+void vre::VreTiledRenderer::reproject(const RayCamera &_camera) {
+	constexpr float NEAR_DISTANCE = 1.0f;
+	RayFrustum previous(m_historyCamera, m_frame.width);
+	float forwardX = std::cos(_camera.angle);
+	float forwardY = std::sin(_camera.angle);
+	float planeScale = std::tan(_camera.fov * 0.5f);
+
+	// only the columns this frame doesn't cast are written. screen column
+	// and new distance of the last frame's hit in column _x, false behind
+	// the near plane
+	auto project = [&](int _x, float &_column, float &_distance) {
+		const RayHit &hit = m_history[_x];
+		if (hit.cell == 0) {
+			return false;
+		}
+		float dirX;
+		float dirY;
+		previous.direction(_x, dirX, dirY);
+		float relX = m_historyCamera.x + dirX * hit.distance - _camera.x;
+		float relY = m_historyCamera.y + dirY * hit.distance - _camera.y;
+		_distance = relX * forwardX + relY * forwardY;
+		if (_distance < NEAR_DISTANCE) {
+			return false;
+		}
+		float cameraX = (relY * forwardX - relX * forwardY) / (_distance * planeScale);
+		_column = (cameraX + 1.0f) * 0.5f * m_frame.width - 0.5f;
+		return true;
+	};
+	auto splat = [&](int _column, const RayHit &_hit, float _distance, float _wallU) {
+		if (_column < 0 || _column >= m_frame.width || (_column & 1) == m_parity) {
+			return;
+		}
+		RayHit &out = m_reprojected[_column];
+		if (out.cell == 0 || _distance < out.distance) {
+			out = _hit;
+			out.distance = _distance;
+			out.wallU = _wallU;
+		}
+	};
+
+	for (RayHit &hit : m_reprojected) {
+		hit.cell = 0;
+	}
+	float column = 0.0f;
+	float distance = 0.0f;
+	bool valid = project(0, column, distance);
+	for (int x = 0; x < m_frame.width; x++) {
+		const RayHit &hit = m_history[x];
+		if (!valid) {
+			if (x + 1 < m_frame.width) {
+				valid = project(x + 1, column, distance);
+			}
+			continue;
+		}
+		splat(static_cast<int>(std::floor(column + 0.5f)), hit, distance, hit.wallU);
+
+		// the span to the next hit on the same face, 1 / distance and
+		// u / distance are linear across the screen
+		float nextColumn = 0.0f;
+		float nextDistance = 0.0f;
+		bool nextValid = x + 1 < m_frame.width && project(x + 1, nextColumn, nextDistance);
+		const RayHit &next = m_history[std::min(x + 1, m_frame.width - 1)];
+		bool sameFace = nextValid && next.cell == hit.cell && next.side == hit.side
+			&& (hit.side == 0 ? next.mapX == hit.mapX : next.mapY == hit.mapY);
+		if (sameFace) {
+			int first = std::max(static_cast<int>(std::ceil(std::min(column, nextColumn))), 0);
+			int last = std::min(static_cast<int>(std::floor(std::max(column, nextColumn))), m_frame.width - 1);
+			float span = nextColumn - column;
+			first += (first & 1) == m_parity ? 1 : 0;
+			for (int c = first; c <= last && span != 0.0f; c += 2) {
+				float t = (static_cast<float>(c) - column) / span;
+				float inverse = (1.0f - t) / distance + t / nextDistance;
+				float u = ((1.0f - t) * hit.wallU / distance + t * next.wallU / nextDistance) / inverse;
+				splat(c, hit, 1.0f / inverse, u);
+			}
+		}
+		column = nextColumn;
+		distance = nextDistance;
+		valid = nextValid;
+	}
+}
+
+void vre::VreTiledRenderer::supersampleEdges(const VreRaycaster &_raycaster,
+	const RayCamera &_camera, VreThreadPool &_pool, CpuTileOptions _options
+) {
+	m_edges.clear();
+	int samples = _options.edgeSamples >= 4 ? 4 : _options.edgeSamples >= 2 ? 2 : 0;
+	if (samples == 0 || m_layered) {
+		return;
+	}
+
+	auto differs = [&](const RayHit &_a, const RayHit &_b) {
+		if (_a.cell != _b.cell || _a.side != _b.side) {
+			return true;
+		}
+		float nearer = std::min(_a.distance, _b.distance);
+		return _a.cell != 0 && std::abs(_a.distance - _b.distance) > nearer * _options.edgeDepthJump;
+	};
+	for (int x = 0; x < m_frame.width; x++) {
+		if ((x > 0 && differs(m_hits[x], m_hits[x - 1]))
+			|| (x + 1 < m_frame.width && differs(m_hits[x], m_hits[x + 1]))) {
+			m_edges.push_back(x);
+		}
+	}
+
+	constexpr int EDGE_BATCH = 32;
+	m_edgeHits.resize(m_edges.size() * samples);
+	int batches = (static_cast<int>(m_edges.size()) + EDGE_BATCH - 1) / EDGE_BATCH;
+	_pool.parallelFor(batches, [&](int _batch) {
+		size_t end = std::min(m_edges.size(), static_cast<size_t>(_batch + 1) * EDGE_BATCH);
+		for (size_t e = static_cast<size_t>(_batch) * EDGE_BATCH; e < end; e++) {
+			// samples at the centres of equal slices of the column
+			RayCamera sub = _camera;
+			sub.columnStep = 1.0f / samples;
+			sub.columnPhase = static_cast<float>(m_edges[e]) + 0.5f / samples - 0.5f;
+			RayHit *hits = &m_edgeHits[e * samples];
+			_raycaster.castColumns(sub, 0, samples, m_frame.width, hits);
+
+			// rows where the centre ray or any sample drew a wall
+			WallColumn walls[4];
+			int top = m_columnTop[m_edges[e]];
+			int bottom = m_columnBottom[m_edges[e]];
+			if (bottom <= top) {
+				top = m_frame.height;
+				bottom = 0;
+			}
+			for (int i = 0; i < samples; i++) {
+				walls[i] = m_frame.wallColumn(hits[i], m_cellSize, m_focal);
+				if (walls[i].bottom > walls[i].top) {
+					top = std::min(top, walls[i].top);
+					bottom = std::max(bottom, walls[i].bottom);
+				}
+			}
+			// neither the centre nor a sample drew a wall, and top at the
+			// frame height would point the pixel past the image
+			if (bottom <= top) {
+				continue;
+			}
+
+			// pairs first, then the pairs' mixes, an even mix for 2 and 4
+			uint8_t *pixel = m_frame.pixels + static_cast<size_t>(top) * m_frame.stride + m_edges[e];
+			for (int y = top; y < bottom; y++) {
+				uint8_t mixed[4];
+				for (int i = 0; i < samples; i++) {
+					if (y >= walls[i].top && y < walls[i].bottom) {
+						mixed[i] = walls[i].index;
+					} else if (m_texturedFlats) {
+						mixed[i] = m_flats.sample(m_flats.currentView(), *m_frame.palette,
+							m_edges[e] + (i + 0.5f) / samples, y);
+					} else {
+						mixed[i] = m_frame.background[y];
+					}
+				}
+				for (int count = samples; count > 1; count /= 2) {
+					for (int i = 0; i < count / 2; i++) {
+						mixed[i] = m_frame.palette->blend(mixed[2 * i], mixed[2 * i + 1]);
+					}
+				}
+				*pixel = mixed[0];
+				pixel += m_frame.stride;
+			}
+		}
+	});
+}
+
+void vre::VreTiledRenderer::drawTiles(const RayCamera &_camera, VreThreadPool &_pool,
+	CpuTileOptions _options
+) {
+	m_texturedFlats = _options.texturedFlats;
+	if (m_texturedFlats) {
+		m_flats.setView(_camera, m_cellSize, m_frame.width, m_frame.height);
+	}
+	int columnBands = (m_frame.width + _options.columnBand - 1) / _options.columnBand;
+	int rowBands = (m_frame.height + _options.rowBand - 1) / _options.rowBand;
+
+	// row bands of one column band are neighbours in the index, so a
+	// thread that picks up consecutive tiles reuses the same columns
+	_pool.parallelFor(columnBands * rowBands, [&](int _tile) {
+		int x0 = (_tile / rowBands) * _options.columnBand;
+		int y0 = (_tile % rowBands) * _options.rowBand;
+		drawTile(x0, std::min(x0 + _options.columnBand, m_frame.width),
+			y0, std::min(y0 + _options.rowBand, m_frame.height));
+	});
+}
+
+void vre::VreTiledRenderer::drawTile(int _x0, int _x1, int _y0, int _y1) {
+	const int16_t *tops = m_columnTop.data();
+	const int16_t *bottoms = m_columnBottom.data();
+	const uint8_t *indices = m_columnIndex.data();
+
+	// every pixel is written once, wall or background picked per pixel.
+	// textured flats are cast into the row first, except where walls
+	// cover whole runs, and the walls go over them
+	for (int y = _y0; y < _y1; y++) {
+		uint8_t *row = m_frame.pixels + static_cast<size_t>(y) * m_frame.stride;
+		uint8_t background = m_frame.background[y];
+		if (m_texturedFlats) {
+			m_flats.castRow(m_flats.currentView(), *m_frame.palette, y, _x0, _x1, row, tops, bottoms);
+		}
+		int x = _x0;
+#if VRE_TILED_SSE
+		__m128i rowY = _mm_set1_epi16(static_cast<int16_t>(y));
+		__m128i fill = _mm_set1_epi8(static_cast<char>(background));
+		for (; x + 16 <= _x1; x += 16) {
+			if (m_texturedFlats) {
+				fill = _mm_loadu_si128(reinterpret_cast<const __m128i *>(row + x));
+			}
+			// y >= top and y < bottom, 8 columns per compare
+			__m128i low = _mm_andnot_si128(
+				_mm_cmplt_epi16(rowY, _mm_loadu_si128(reinterpret_cast<const __m128i *>(tops + x))),
+				_mm_cmplt_epi16(rowY, _mm_loadu_si128(reinterpret_cast<const __m128i *>(bottoms + x))));
+			__m128i high = _mm_andnot_si128(
+				_mm_cmplt_epi16(rowY, _mm_loadu_si128(reinterpret_cast<const __m128i *>(tops + x + 8))),
+				_mm_cmplt_epi16(rowY, _mm_loadu_si128(reinterpret_cast<const __m128i *>(bottoms + x + 8))));
+			__m128i wall = _mm_packs_epi16(low, high);
+			__m128i wallIndex = _mm_loadu_si128(reinterpret_cast<const __m128i *>(indices + x));
+			__m128i pixels = _mm_or_si128(_mm_and_si128(wall, wallIndex), _mm_andnot_si128(wall, fill));
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(row + x), pixels);
+		}
+#endif
+		for (; x < _x1; x++) {
+			row[x] = y >= tops[x] && y < bottoms[x] ? indices[x] : m_texturedFlats ? row[x] : background;
+		}
+	}
+
+	if (m_layered) {
+		for (int x = _x0; x < _x1; x++) {
+			m_frame.compositeLayers(m_layers[x], m_cellSize, m_focal, m_frame.pixels + x,
+				m_frame.stride, _y0, _y1);
+		}
+	}
+}
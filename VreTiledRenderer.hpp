@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "VreCpuFrame.hpp"
+#include "VreFloorCaster.hpp"
+#include "VreRaycaster.hpp"
+#include "VreThreadPool.hpp"
+
+namespace vre {
+	// tile sizes for renderTiled, in pixels. column bands should stay a
+	// multiple of 16, the tile loop writes 16 pixels at a time
+	struct CpuTileOptions {
+		int columnBand = 128;
+		int rowBand = 64;
+		// sub column rays per edge column, 2 or 4. 0 casts none
+		int edgeSamples = 0;
+		// neighbouring hits this far apart in distance, relative to the
+		// nearer one, make an edge like a change of cell or side does
+		float edgeDepthJump = 0.1f;
+		// textured floor and ceiling from VreFloorCaster instead of one
+		// shade per row, cast per tile ahead of its walls
+		bool texturedFlats = false;
+	};
+
+	// limits for renderInterlaced, past them a frame is cast in full
+	struct CpuInterlaceOptions {
+		float maxTurn = 0.05f; // radians per frame
+		float maxMove = 0.5f; // cells per frame
+		// a reprojected column has to stay this close, relative, to the
+		// distance of the cast neighbours on the same wall face
+		float depthTolerance = 0.05f;
+		// a frame that cast more than this fraction of the columns it meant
+		// to reproject cost more than a full one, the next fullFrames are
+		// cast in full before reprojecting is tried again
+		float maxRecast = 0.25f;
+		int fullFrames = 8;
+	};
+
+	// the tiled and interlaced modes of VreCpuRenderer, which documents
+	// them. casts its own hits band by band and keeps the last frame's for
+	// reprojection, along with the wall extents per column
+	class VreTiledRenderer {
+	public:
+		void resize(int _width);
+
+		void render(const CpuFrame &_frame, const VreRaycaster &_raycaster,
+			const RayCamera &_camera, VreThreadPool &_pool, CpuTileOptions _options);
+		void renderInterlaced(const CpuFrame &_frame, const VreRaycaster &_raycaster,
+			const RayCamera &_camera, VreThreadPool &_pool, CpuTileOptions _options,
+			CpuInterlaceOptions _interlace);
+
+		int lastCastColumns() const { return m_castColumns; }
+		int lastEdgeColumns() const { return static_cast<int>(m_edges.size()); }
+		const int16_t *columnTops() const { return m_columnTop.data(); }
+		const int16_t *columnBottoms() const { return m_columnBottom.data(); }
+
+	private:
+		// wall extent and shade of columns [_x0, _x1) from m_hits
+		void shadeColumns(int _x0, int _x1);
+		void drawTile(int _x0, int _x1, int _y0, int _y1);
+		void drawTiles(const RayCamera &_camera, VreThreadPool &_pool, CpuTileOptions _options);
+		// after drawTiles. columns whose hit differs from a neighbour's are
+		// cast again with edgeSamples sub column rays and their rows between
+		// the highest and lowest wall edge redrawn as the blend of the
+		// samples, so the cost follows the number of edges. skipped when
+		// see through walls were composited
+		void supersampleEdges(const VreRaycaster &_raycaster, const RayCamera &_camera,
+			VreThreadPool &_pool, CpuTileOptions _options);
+		// m_history moved into _camera's pose, into m_reprojected
+		void reproject(const RayCamera &_camera);
+
+		CpuFrame m_frame{}; // the frame being drawn
+		VreFloorCaster m_flats;
+		bool m_texturedFlats = false; // the last drawTiles cast the flats
+		std::vector<RayHit> m_hits;
+		std::vector<RayLayers> m_layers;
+		bool m_layered = false; // the last frame cast layers
+		float m_cellSize = 0.0f;
+		float m_focal = 0.0f;
+		// renderInterlaced: the hits and camera of the last frame
+		std::vector<RayHit> m_history;
+		std::vector<RayHit> m_reprojected;
+		std::vector<RayHit> m_halfHits;
+		std::vector<int> m_recast;
+		std::vector<RayHit> m_recastHits; // per m_recast entry
+		std::vector<int> m_edges;
+		std::vector<RayHit> m_edgeHits; // edgeSamples per edge column
+		RayCamera m_historyCamera{};
+		bool m_hasHistory = false;
+		int m_fullFrames = 0; // left to cast in full after too many recasts
+		int m_parity = 0;
+		int m_castColumns = 0;
+		std::vector<int16_t> m_columnTop;
+		std::vector<int16_t> m_columnBottom;
+		std::vector<uint8_t> m_columnIndex;
+	};
+}
@@ -0,0 +1,326 @@
+#include "VreVoxelChunks.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+	struct VoxelPushConstants {
+		glm::mat4 viewProjection;
+		glm::ivec4 origin; // first voxel of the chunk
+	};
+
+	// a chunk can't have more faces than a checkerboard
+	constexpr uint32_t MAX_QUADS = vre::VreVoxelMesher::CHUNK_SIZE * vre::VreVoxelMesher::CHUNK_SIZE
+		* vre::VreVoxelMesher::CHUNK_SIZE * 3;
+	constexpr VkDeviceSize QUAD_BYTES = 4 * sizeof(vre::PackedVoxelVertex);
+	constexpr VkDeviceSize MIN_CHUNK_BYTES = 4096;
+
+	std::vector<VkVertexInputBindingDescription> voxelBindings() {
+		std::vector<VkVertexInputBindingDescription> bindings(1);
+		bindings[0].binding = 0;
+		bindings[0].stride = sizeof(vre::PackedVoxelVertex);
+		bindings[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+		return bindings;
+	}
+
+	std::vector<VkVertexInputAttributeDescription> voxelAttributes() {
+		std::vector<VkVertexInputAttributeDescription> attributes(2);
+		attributes[0].binding = 0;
+		attributes[0].location = 0;
+		attributes[0].format = VK_FORMAT_R32_UINT;
+		attributes[0].offset = offsetof(vre::PackedVoxelVertex, position);
+
+		attributes[1].binding = 0;
+		attributes[1].location = 1;
+		attributes[1].format = VK_FORMAT_R8G8B8A8_UNORM;
+		attributes[1].offset = offsetof(vre::PackedVoxelVertex, color);
+		return attributes;
+	}
+}
+
+vre::VreVoxelChunks::VreVoxelChunks(VreDevice &_device, VreBrickMap &_map, const VrePalette &_palette
+) : m_vreDevice{ _device }, m_map{ _map }, m_mesher{ _map, _palette } {
+	m_chunks.resize(m_mesher.chunkCount());
+	m_isWaiting.assign(m_mesher.chunkCount(), 0);
+
+	m_vreDevice.createBuffer(RING_BYTES, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		m_ring, m_ringMemory);
+	void *data;
+	vkMapMemory(m_vreDevice.device(), m_ringMemory, 0, RING_BYTES, 0, &data);
+	m_ringMapped = static_cast<uint8_t *>(data);
+
+	createIndexBuffer();
+	createPipelineLayout();
+	m_mesher.markAll();
+}
+
+vre::VreVoxelChunks::~VreVoxelChunks() {
+	VkDevice device = m_vreDevice.device();
+	for (ChunkBuffer &chunk : m_chunks) {
+		vkDestroyBuffer(device, chunk.buffer, nullptr);
+		vkFreeMemory(device, chunk.memory, nullptr);
+	}
+	for (Retired &retired : m_retired) {
+		vkDestroyBuffer(device, retired.buffer.buffer, nullptr);
+		vkFreeMemory(device, retired.buffer.memory, nullptr);
+	}
+	vkUnmapMemory(device, m_ringMemory);
+	vkDestroyBuffer(device, m_ring, nullptr);
+	vkFreeMemory(device, m_ringMemory, nullptr);
+	vkDestroyBuffer(device, m_indices, nullptr);
+	vkFreeMemory(device, m_indexMemory, nullptr);
+	m_pipeline.reset();
+	vkDestroyPipelineLayout(device, m_pipelineLayout, nullptr);
+}
+
+void vre::VreVoxelChunks::createPipeline(VkRenderPass _renderPass) {
+	PipelineConfigInfo pipelineConfig{};
+	VrePipeline::defaultPipelineConfigInfo(pipelineConfig);
+	pipelineConfig.bindingDescriptions = voxelBindings();
+	pipelineConfig.attributeDescriptions = voxelAttributes();
+	pipelineConfig.renderPass = _renderPass;
+	pipelineConfig.pipelineLayout = m_pipelineLayout;
+
+	m_pipeline.reset();
+	m_pipeline = std::make_unique<VrePipeline>(m_vreDevice.m_device, pipelineConfig,
+		"./voxel_mesh.vert.spv", "./grid_mesh.frag.spv");
+}
+
+void vre::VreVoxelChunks::setVoxel(int _x, int _y, int _z, uint8_t _material) {
+	if (!m_map.inBounds(_x, _y, _z) || m_map.voxel(_x, _y, _z) == _material) {
+		return;
+	}
+	uint8_t before = m_map.voxel(_x, _y, _z);
+	m_map.setVoxel(_x, _y, _z, _material);
+	m_mesher.markVoxel(_x, _y, _z, before);
+}
+
+void vre::VreVoxelChunks::update(size_t _frame, VreThreadPool &_pool) {
+	// the copies this slot recorded last time have run, so has every draw
+	// of a buffer retired before them
+	m_ringUsed -= m_frameBytes[_frame];
+	m_frameBytes[_frame] = 0;
+	for (size_t i = 0; i < m_retired.size();) {
+		if (--m_retired[i].framesLeft > 0) {
+			i++;
+			continue;
+		}
+		vkDestroyBuffer(m_vreDevice.device(), m_retired[i].buffer.buffer, nullptr);
+		vkFreeMemory(m_vreDevice.device(), m_retired[i].buffer.memory, nullptr);
+		m_retired[i] = m_retired.back();
+		m_retired.pop_back();
+	}
+
+	if (m_mesher.hasDirty()) {
+		auto start = std::chrono::steady_clock::now();
+		for (int chunk : m_mesher.rebuildDirty(_pool)) {
+			if (!m_isWaiting[chunk]) {
+				m_isWaiting[chunk] = 1;
+				m_waiting.push_back(chunk);
+			}
+		}
+		m_lastRemeshMs = std::chrono::duration<double, std::milli>(
+			std::chrono::steady_clock::now() - start).count();
+	}
+
+	// oldest first, whatever doesn't fit stays in order for the next frame
+	size_t staged = 0;
+	while (staged < m_waiting.size() && stage(m_waiting[staged], _frame)) {
+		m_isWaiting[m_waiting[staged]] = 0;
+		staged++;
+	}
+	m_waiting.erase(m_waiting.begin(), m_waiting.begin() + staged);
+	m_stagedBytes = m_frameBytes[_frame];
+
+	if (staged > 0) {
+		m_quads = 0;
+		for (const ChunkBuffer &chunk : m_chunks) {
+			m_quads += chunk.quads;
+		}
+	}
+}
+
+void vre::VreVoxelChunks::releaseFrames() {
+	for (VkDeviceSize &bytes : m_frameBytes) {
+		m_ringUsed -= bytes;
+		bytes = 0;
+	}
+}
+
+bool vre::VreVoxelChunks::stage(int _chunk, size_t _frame) {
+	const VoxelChunkMesh &mesh = m_mesher.chunk(_chunk);
+	ChunkBuffer &chunk = m_chunks[_chunk];
+	VkDeviceSize size = mesh.quadCount() * QUAD_BYTES;
+	if (size == 0) {
+		chunk.quads = 0;
+		return true;
+	}
+
+	// wrapping skips the ring's tail, those bytes belong to this frame too
+	VkDeviceSize skip = m_ringHead + size > RING_BYTES ? RING_BYTES - m_ringHead : 0;
+	if (m_ringUsed + skip + size > RING_BYTES) {
+		return false;
+	}
+	VkDeviceSize offset = skip > 0 ? 0 : m_ringHead;
+	m_ringHead = offset + size;
+	m_ringUsed += skip + size;
+	m_frameBytes[_frame] += skip + size;
+	memcpy(m_ringMapped + offset, mesh.vertices.data(), static_cast<size_t>(size));
+
+	// grown buffers go up in powers of two, the old one is kept until no
+	// frame in flight can still draw it
+	if (size > chunk.capacity) {
+		if (chunk.buffer != VK_NULL_HANDLE) {
+			m_retired.push_back({ chunk, static_cast<int>(VreSwapchain::MAX_FRAMES_IN_FLIGHT) + 1 });
+		}
+		VkDeviceSize capacity = MIN_CHUNK_BYTES;
+		while (capacity < size) {
+			capacity *= 2;
+		}
+		chunk = ChunkBuffer{};
+		m_vreDevice.createBuffer(capacity,
+			VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+			VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, chunk.buffer, chunk.memory);
+		chunk.capacity = capacity;
+	}
+	chunk.quads = static_cast<uint32_t>(mesh.quadCount());
+	m_copies.push_back({ chunk.buffer, offset, size });
+	return true;
+}
+
+void vre::VreVoxelChunks::recordUploads(VkCommandBuffer _cmd) {
+	if (m_copies.empty()) {
+		return;
+	}
+
+	// earlier frames may still be drawing from the buffers being rewritten
+	VkMemoryBarrier barrier{};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = 0;
+	barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	vkCmdPipelineBarrier(_cmd, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+		0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+	for (const PendingCopy &copy : m_copies) {
+		VkBufferCopy region{};
+		region.srcOffset = copy.ringOffset;
+		region.dstOffset = 0;
+		region.size = copy.size;
+		vkCmdCopyBuffer(_cmd, m_ring, copy.target, 1, &region);
+	}
+	m_copies.clear();
+
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+	vkCmdPipelineBarrier(_cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT,
+		0, 1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+void vre::VreVoxelChunks::record(VkCommandBuffer _cmd, const glm::mat4 &_viewProjection) {
+	m_pipeline->bind(_cmd);
+	vkCmdBindIndexBuffer(_cmd, m_indices, 0, VK_INDEX_TYPE_UINT32);
+
+	VoxelPushConstants push{ _viewProjection, glm::ivec4(0) };
+	VkDeviceSize offset = 0;
+	for (int i = 0; i < m_mesher.chunkCount(); i++) {
+		const ChunkBuffer &chunk = m_chunks[i];
+		if (chunk.quads == 0) {
+			continue;
+		}
+		m_mesher.chunkOrigin(i, push.origin.x, push.origin.y, push.origin.z);
+		vkCmdPushConstants(_cmd, m_pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT, 0,
+			sizeof(VoxelPushConstants), &push);
+		vkCmdBindVertexBuffers(_cmd, 0, 1, &chunk.buffer, &offset);
+		vkCmdDrawIndexed(_cmd, chunk.quads * 6, 1, 0, 0, 0);
+	}
+}
+
+glm::mat4 vre::VreVoxelChunks::cameraMatrix(const VoxelCamera &_camera, VkExtent2D _extent) {
+	constexpr float NEAR_PLANE = 0.05f;
+	constexpr float FAR_PLANE = 1024.0f;
+
+	// the tracer's basis, VoxelFrame::make
+	float cosPitch = std::cos(_camera.pitch);
+	glm::vec3 eye(_camera.x, _camera.y, _camera.z);
+	glm::vec3 forward(std::cos(_camera.yaw) * cosPitch, std::sin(_camera.yaw) * cosPitch,
+		std::sin(_camera.pitch));
+	glm::vec3 right(-std::sin(_camera.yaw), std::cos(_camera.yaw), 0.0f);
+	glm::vec3 up = glm::cross(forward, right);
+	float focalX = 1.0f / std::tan(_camera.fov * 0.5f);
+	float focalY = focalX * static_cast<float>(_extent.width) / static_cast<float>(_extent.height);
+	float depthScale = FAR_PLANE / (FAR_PLANE - NEAR_PLANE);
+	float depthOffset = -FAR_PLANE * NEAR_PLANE / (FAR_PLANE - NEAR_PLANE);
+
+	// rows of clip = m * (p, 1), vulkan clip y points down
+	glm::vec3 rows[3] = { focalX * right, -focalY * up, depthScale * forward };
+	glm::mat4 m(0.0f);
+	for (int a = 0; a < 3; a++) {
+		m[a][0] = rows[0][a];
+		m[a][1] = rows[1][a];
+		m[a][2] = rows[2][a];
+		m[a][3] = forward[a];
+	}
+	m[3][0] = -glm::dot(rows[0], eye);
+	m[3][1] = -glm::dot(rows[1], eye);
+	m[3][2] = depthOffset - glm::dot(rows[2], eye);
+	m[3][3] = -glm::dot(forward, eye);
+	return m;
+}
+
+void vre::VreVoxelChunks::createIndexBuffer() {
+	// 0 1 2, 0 2 3 for every quad
+	std::vector<uint32_t> indices(static_cast<size_t>(MAX_QUADS) * 6);
+	for (uint32_t quad = 0; quad < MAX_QUADS; quad++) {
+		uint32_t first = quad * 4;
+		uint32_t *out = indices.data() + static_cast<size_t>(quad) * 6;
+		out[0] = first;
+		out[1] = first + 1;
+		out[2] = first + 2;
+		out[3] = first;
+		out[4] = first + 2;
+		out[5] = first + 3;
+	}
+	VkDeviceSize size = sizeof(uint32_t) * indices.size();
+
+	VkBuffer staging;
+	VkDeviceMemory stagingMemory;
+	m_vreDevice.createBuffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		staging, stagingMemory);
+
+	void *data;
+	vkMapMemory(m_vreDevice.device(), stagingMemory, 0, size, 0, &data);
+	memcpy(data, indices.data(), static_cast<size_t>(size));
+	vkUnmapMemory(m_vreDevice.device(), stagingMemory);
+
+	m_vreDevice.createBuffer(size, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_indices, m_indexMemory);
+	m_vreDevice.copyBuffer(staging, m_indices, size);
+
+	vkDestroyBuffer(m_vreDevice.device(), staging, nullptr);
+	vkFreeMemory(m_vreDevice.device(), stagingMemory, nullptr);
+}
+
+void vre::VreVoxelChunks::createPipelineLayout() {
+	VkPushConstantRange pushConstantRange{};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(VoxelPushConstants);
+
+	VkPipelineLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	layoutInfo.setLayoutCount = 0;
+	layoutInfo.pSetLayouts = nullptr;
+	layoutInfo.pushConstantRangeCount = 1;
+	layoutInfo.pPushConstantRanges = &pushConstantRange;
+
+	if (vkCreatePipelineLayout(m_vreDevice.device(), &layoutInfo, nullptr,
+		&m_pipelineLayout) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create voxel mesh pipeline layout");
+	}
+}
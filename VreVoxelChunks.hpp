@@ -0,0 +1,109 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE // forces depth to [0,1] instead of [-1,1]
+#include <glm/glm.hpp>
+
+#include <vulkan/vulkan.h>
+
+#include "VreDevice.hpp"
+#include "VrePipeline.hpp"
+#include "VreSwapchain.hpp"
+#include "VreVoxelMesher.hpp"
+#include "VreVoxelTracer.hpp"
+
+namespace vre {
+	// gpu side of VreVoxelMesher. every chunk owns a device local vertex
+	// buffer, remeshed chunks are written into a persistently mapped staging
+	// ring and copied over at the start of the frame's command buffer, so
+	// an edit costs the remesh plus a memcpy and no allocation as long as
+	// the chunk still fits its buffer. the ring space a frame used comes back
+	// when that frame slot is used again. quads share one index buffer
+	class VreVoxelChunks {
+	public:
+		static constexpr VkDeviceSize RING_BYTES = 8 << 20;
+
+		VreVoxelChunks(VreDevice &_device, VreBrickMap &_map, const VrePalette &_palette);
+		~VreVoxelChunks();
+
+		VreVoxelChunks(const VreVoxelChunks &) = delete;
+		VreVoxelChunks &operator=(const VreVoxelChunks &) = delete;
+
+		// again after every swapchain rebuild
+		void createPipeline(VkRenderPass _renderPass);
+
+		// edits the map and marks the chunks that see the voxel
+		void setVoxel(int _x, int _y, int _z, uint8_t _material);
+
+		// once per frame before recording, after the frame's fence. remeshes
+		// marked chunks on _pool and stages them, chunks that don't fit in
+		// the ring this frame wait for the next
+		void update(size_t _frame, VreThreadPool &_pool);
+		// with the device idle, e.g. on a swapchain rebuild that may change
+		// the number of frame slots, the ring space of every slot is free
+		void releaseFrames();
+		// the staged copies, outside the render pass
+		void recordUploads(VkCommandBuffer _cmd);
+		// inside the render pass, viewport and scissor already set
+		void record(VkCommandBuffer _cmd, const glm::mat4 &_viewProjection);
+
+		// voxels to vulkan clip space for the voxel tracer's camera
+		static glm::mat4 cameraMatrix(const VoxelCamera &_camera, VkExtent2D _extent);
+
+		size_t quadCount() const { return m_quads; }
+		double lastRemeshMs() const { return m_lastRemeshMs; }
+		// staged by the last update
+		VkDeviceSize stagedBytes() const { return m_stagedBytes; }
+
+	private:
+		struct ChunkBuffer {
+			VkBuffer buffer = VK_NULL_HANDLE;
+			VkDeviceMemory memory = VK_NULL_HANDLE;
+			VkDeviceSize capacity = 0;
+			uint32_t quads = 0;
+		};
+		struct Retired {
+			ChunkBuffer buffer;
+			int framesLeft;
+		};
+		struct PendingCopy {
+			VkBuffer target;
+			VkDeviceSize ringOffset;
+			VkDeviceSize size;
+		};
+
+		// false when the ring is too full this frame
+		bool stage(int _chunk, size_t _frame);
+		void createIndexBuffer();
+		void createPipelineLayout();
+
+		VreDevice &m_vreDevice;
+		VreBrickMap &m_map;
+		VreVoxelMesher m_mesher;
+		std::vector<ChunkBuffer> m_chunks;
+		std::vector<Retired> m_retired;
+		std::vector<int> m_waiting;
+		std::vector<uint8_t> m_isWaiting;
+		std::vector<PendingCopy> m_copies;
+
+		VkBuffer m_ring = VK_NULL_HANDLE;
+		VkDeviceMemory m_ringMemory = VK_NULL_HANDLE;
+		uint8_t *m_ringMapped = nullptr;
+		VkDeviceSize m_ringHead = 0;
+		VkDeviceSize m_ringUsed = 0;
+		VkDeviceSize m_frameBytes[VreSwapchain::MAX_FRAMES_IN_FLIGHT] = {};
+
+		VkBuffer m_indices = VK_NULL_HANDLE;
+		VkDeviceMemory m_indexMemory = VK_NULL_HANDLE;
+
+		size_t m_quads = 0;
+		double m_lastRemeshMs = 0.0;
+		VkDeviceSize m_stagedBytes = 0;
+
+		VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE;
+		std::unique_ptr<VrePipeline> m_pipeline;
+	};
+}
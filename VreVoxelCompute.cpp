@@ -0,0 +1,247 @@
+#include "VreVoxelCompute.hpp"
+
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+#include "VrePipeline.hpp"
+
+vre::VreVoxelCompute::VreVoxelCompute(VreDevice &_device, const VreBrickMap &_map,
+	VreIndexedFramebuffer &_framebuffer
+) : m_vreDevice{ _device }, m_framebuffer{ _framebuffer } {
+	// an empty pool still needs a buffer to bind
+	m_coarseBytes = sizeof(uint32_t) * _map.coarseCount();
+	m_brickBytes = static_cast<VkDeviceSize>(_map.brickCount()) * VreBrickMap::BRICK_VOXELS;
+	uint32_t noBricks = 0;
+	uploadStorage(_map.coarse(), m_coarseBytes, m_coarse, m_coarseMemory);
+	uploadStorage(m_brickBytes > 0 ? static_cast<const void *>(_map.bricks()) : &noBricks,
+		m_brickBytes > 0 ? m_brickBytes : sizeof(noBricks), m_bricks, m_bricksMemory);
+
+	createDescriptors();
+	createPipeline();
+	createQueryPool();
+}
+
+vre::VreVoxelCompute::~VreVoxelCompute() {
+	VkDevice device = m_vreDevice.device();
+
+	vkDestroyQueryPool(device, m_queryPool, nullptr);
+	vkDestroyPipeline(device, m_pipeline, nullptr);
+	vkDestroyPipelineLayout(device, m_pipelineLayout, nullptr);
+	vkDestroyDescriptorPool(device, m_descriptorPool, nullptr);
+	vkDestroyDescriptorSetLayout(device, m_setLayout, nullptr);
+
+	vkDestroyBuffer(device, m_bricks, nullptr);
+	vkFreeMemory(device, m_bricksMemory, nullptr);
+	vkDestroyBuffer(device, m_coarse, nullptr);
+	vkFreeMemory(device, m_coarseMemory, nullptr);
+}
+
+void vre::VreVoxelCompute::record(VkCommandBuffer _cmd, size_t _frame,
+	const VoxelFrame &_voxelFrame, VkImage _target, VkExtent2D _targetExtent
+) {
+	vkCmdBindPipeline(_cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline);
+	vkCmdBindDescriptorSets(_cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout,
+		0, 1, &m_descriptorSets[_frame], 0, nullptr);
+	vkCmdPushConstants(_cmd, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT,
+		0, sizeof(VoxelFrame), &_voxelFrame);
+
+	uint32_t query = static_cast<uint32_t>(_frame) * 2;
+	if (m_queryPool != VK_NULL_HANDLE) {
+		vkCmdResetQueryPool(_cmd, m_queryPool, query, 2);
+		vkCmdWriteTimestamp(_cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_queryPool, query);
+	}
+
+	// one invocation per 4 pixels of a row, 16x16 workgroups
+	uint32_t words = static_cast<uint32_t>(_voxelFrame.endWord - _voxelFrame.firstWord);
+	if (words > 0) {
+		vkCmdDispatch(_cmd, (words + 15) / 16, (static_cast<uint32_t>(_voxelFrame.height) + 15) / 16, 1);
+	}
+
+	if (m_queryPool != VK_NULL_HANDLE) {
+		vkCmdWriteTimestamp(_cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_queryPool, query + 1);
+		m_timed[_frame] = true;
+	}
+
+	if (_voxelFrame.endWord < _voxelFrame.strideWords) {
+		m_framebuffer.recordSplit(_cmd, _frame, static_cast<uint32_t>(_voxelFrame.endWord) * 4,
+			_target, _targetExtent);
+	} else {
+		m_framebuffer.recordComputed(_cmd, _frame, _target, _targetExtent);
+	}
+}
+
+bool vre::VreVoxelCompute::readTraceMs(size_t _frame, double &_ms) {
+	if (m_queryPool == VK_NULL_HANDLE || !m_timed[_frame]) {
+		return false;
+	}
+	m_timed[_frame] = false;
+
+	uint64_t ticks[2];
+	if (vkGetQueryPoolResults(m_vreDevice.device(), m_queryPool, static_cast<uint32_t>(_frame) * 2, 2,
+		sizeof(ticks), ticks, sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS) {
+		return false;
+	}
+	_ms = static_cast<double>((ticks[1] - ticks[0]) & m_timestampMask) * m_timestampPeriod / 1e6;
+	return true;
+}
+
+void vre::VreVoxelCompute::uploadStorage(const void *_data, VkDeviceSize _size,
+	VkBuffer &_buffer, VkDeviceMemory &_memory
+) {
+	VkBuffer staging;
+	VkDeviceMemory stagingMemory;
+	m_vreDevice.createBuffer(_size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+		VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+		staging, stagingMemory);
+
+	void *data;
+	vkMapMemory(m_vreDevice.device(), stagingMemory, 0, _size, 0, &data);
+	memcpy(data, _data, static_cast<size_t>(_size));
+	vkUnmapMemory(m_vreDevice.device(), stagingMemory);
+
+	m_vreDevice.createBuffer(_size,
+		VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+		VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, _buffer, _memory);
+	m_vreDevice.copyBuffer(staging, _buffer, _size);
+
+	vkDestroyBuffer(m_vreDevice.device(), staging, nullptr);
+	vkFreeMemory(m_vreDevice.device(), stagingMemory, nullptr);
+}
+
+void vre::VreVoxelCompute::createDescriptors() {
+	// 0 coarse grid, 1 brick pool, 2 indices of the frame
+	VkDescriptorSetLayoutBinding bindings[3]{};
+	for (uint32_t i = 0; i < 3; i++) {
+		bindings[i].binding = i;
+		bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+		bindings[i].descriptorCount = 1;
+		bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	}
+
+	VkDescriptorSetLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+	layoutInfo.bindingCount = 3;
+	layoutInfo.pBindings = bindings;
+
+	if (vkCreateDescriptorSetLayout(m_vreDevice.device(), &layoutInfo, nullptr,
+		&m_setLayout) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create voxel descriptor set layout");
+	}
+
+	uint32_t frameCount = static_cast<uint32_t>(m_descriptorSets.size());
+	VkDescriptorPoolSize poolSize{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3 * frameCount };
+
+	VkDescriptorPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+	poolInfo.maxSets = frameCount;
+	poolInfo.poolSizeCount = 1;
+	poolInfo.pPoolSizes = &poolSize;
+
+	if (vkCreateDescriptorPool(m_vreDevice.device(), &poolInfo, nullptr,
+		&m_descriptorPool) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create voxel descriptor pool");
+	}
+
+	for (size_t frame = 0; frame < m_descriptorSets.size(); frame++) {
+		VkDescriptorSetAllocateInfo allocInfo{};
+		allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+		allocInfo.descriptorPool = m_descriptorPool;
+		allocInfo.descriptorSetCount = 1;
+		allocInfo.pSetLayouts = &m_setLayout;
+
+		if (vkAllocateDescriptorSets(m_vreDevice.device(), &allocInfo,
+			&m_descriptorSets[frame]) != VK_SUCCESS) {
+			throw std::runtime_error("Failed to allocate voxel descriptor set");
+		}
+
+		VkDescriptorBufferInfo bufferInfos[3] = {
+			{ m_coarse, 0, VK_WHOLE_SIZE },
+			{ m_bricks, 0, VK_WHOLE_SIZE },
+			{ m_framebuffer.indexBuffer(frame), 0, VK_WHOLE_SIZE }
+		};
+
+		VkWriteDescriptorSet writes[3]{};
+		for (int i = 0; i < 3; i++) {
+			writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+			writes[i].dstSet = m_descriptorSets[frame];
+			writes[i].dstBinding = i;
+			writes[i].descriptorCount = 1;
+			writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+			writes[i].pBufferInfo = &bufferInfos[i];
+		}
+
+		vkUpdateDescriptorSets(m_vreDevice.device(), 3, writes, 0, nullptr);
+	}
+}
+
+void vre::VreVoxelCompute::createPipeline() {
+	VkPushConstantRange pushConstantRange{};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = sizeof(VoxelFrame);
+
+	VkPipelineLayoutCreateInfo layoutInfo{};
+	layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	layoutInfo.setLayoutCount = 1;
+	layoutInfo.pSetLayouts = &m_setLayout;
+	layoutInfo.pushConstantRangeCount = 1;
+	layoutInfo.pPushConstantRanges = &pushConstantRange;
+
+	if (vkCreatePipelineLayout(m_vreDevice.device(), &layoutInfo, nullptr,
+		&m_pipelineLayout) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create voxel pipeline layout");
+	}
+
+	std::vector<char> code = VrePipeline::readFile("./voxel_dda.comp.spv");
+
+	VkShaderModuleCreateInfo moduleInfo{};
+	moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+	moduleInfo.codeSize = code.size();
+	moduleInfo.pCode = reinterpret_cast<const uint32_t *>(code.data());
+
+	VkShaderModule module;
+	if (vkCreateShaderModule(m_vreDevice.device(), &moduleInfo, nullptr, &module) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create voxel shader module");
+	}
+
+	VkComputePipelineCreateInfo pipelineInfo{};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+	pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+	pipelineInfo.stage.module = module;
+	pipelineInfo.stage.pName = "main";
+	pipelineInfo.layout = m_pipelineLayout;
+
+	VkResult result = vkCreateComputePipelines(m_vreDevice.device(), VK_NULL_HANDLE, 1,
+		&pipelineInfo, nullptr, &m_pipeline);
+	vkDestroyShaderModule(m_vreDevice.device(), module, nullptr);
+
+	if (result != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create voxel compute pipeline");
+	}
+}
+
+void vre::VreVoxelCompute::createQueryPool() {
+	// without timestamps on the graphics queue the trace just goes untimed
+	uint32_t familyCount = 0;
+	vkGetPhysicalDeviceQueueFamilyProperties(m_vreDevice.physicalDevice(), &familyCount, nullptr);
+	std::vector<VkQueueFamilyProperties> families(familyCount);
+	vkGetPhysicalDeviceQueueFamilyProperties(m_vreDevice.physicalDevice(), &familyCount, families.data());
+	uint32_t graphics = m_vreDevice.findPhysicalQueueFamilies().graphicsFamily;
+	uint32_t validBits = graphics < familyCount ? families[graphics].timestampValidBits : 0;
+	if (validBits == 0 || m_vreDevice.m_physDeviceProps.limits.timestampPeriod <= 0.0f) {
+		return;
+	}
+	m_timestampPeriod = m_vreDevice.m_physDeviceProps.limits.timestampPeriod;
+	m_timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+
+	VkQueryPoolCreateInfo poolInfo{};
+	poolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+	poolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+	poolInfo.queryCount = static_cast<uint32_t>(m_timed.size()) * 2;
+
+	if (vkCreateQueryPool(m_vreDevice.device(), &poolInfo, nullptr, &m_queryPool) != VK_SUCCESS) {
+		throw std::runtime_error("Failed to create voxel timestamp query pool");
+	}
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+#include <vulkan/vulkan.h>
+
+#include "VreDevice.hpp"
+#include "VreSwapchain.hpp"
+#include "VreBrickMap.hpp"
+#include "VreIndexedFramebuffer.hpp"
+#include "VreVoxelTracer.hpp"
+
+namespace vre {
+	// gpu twin of VreVoxelTracer. the coarse grid and the brick pool live in
+	// device local storage buffers, voxel_dda.comp traces 4 pixels per
+	// invocation and writes the packed indices straight into the indexed
+	// framebuffer, which expands and blits them with recordComputed. the
+	// descriptor sets point at the framebuffer's buffers, so this is rebuilt
+	// whenever the framebuffer is. the trace is timed with timestamp
+	// queries where the queue supports them
+	class VreVoxelCompute {
+	public:
+		VreVoxelCompute(VreDevice &_device, const VreBrickMap &_map,
+			VreIndexedFramebuffer &_framebuffer);
+		~VreVoxelCompute();
+
+		VreVoxelCompute(const VreVoxelCompute &) = delete;
+		VreVoxelCompute &operator=(const VreVoxelCompute &) = delete;
+
+		// the trace of words [firstWord, endWord) of _voxelFrame, then the
+		// expansion of the framebuffer. columns past endWord * 4 are copied
+		// from the frame's staging buffer, where the cpu traced them
+		void record(VkCommandBuffer _cmd, size_t _frame, const VoxelFrame &_voxelFrame,
+			VkImage _target, VkExtent2D _targetExtent);
+
+		// gpu time of the trace recorded for _frame last time around, read
+		// once that frame's fence has been waited for. false without
+		// timestamps or when no trace was recorded since the last read
+		bool readTraceMs(size_t _frame, double &_ms);
+		bool hasTimestamps() const { return m_queryPool != VK_NULL_HANDLE; }
+
+		VkDeviceSize sceneBytes() const { return m_coarseBytes + m_brickBytes; }
+
+	private:
+		void uploadStorage(const void *_data, VkDeviceSize _size, VkBuffer &_buffer,
+			VkDeviceMemory &_memory);
+		void createDescriptors();
+		void createPipeline();
+		void createQueryPool();
+
+		VreDevice &m_vreDevice;
+		VreIndexedFramebuffer &m_framebuffer;
+
+		VkBuffer m_coarse = VK_NULL_HANDLE;
+		VkDeviceMemory m_coarseMemory = VK_NULL_HANDLE;
+		VkDeviceSize m_coarseBytes = 0;
+		VkBuffer m_bricks = VK_NULL_HANDLE;
+		VkDeviceMemory m_bricksMemory = VK_NULL_HANDLE;
+		VkDeviceSize m_brickBytes = 0;
+
+		std::array<VkDescriptorSet, VreSwapchain::MAX_FRAMES_IN_FLIGHT> m_descriptorSets{};
+
+		// two timestamps per frame in flight, around the dispatch
+		VkQueryPool m_queryPool = VK_NULL_HANDLE;
+		std::array<bool, VreSwapchain::MAX_FRAMES_IN_FLIGHT> m_timed{};
+		double m_timestampPeriod = 1.0; // nanoseconds per tick
+		uint64_t m_timestampMask = ~0ull;
+
+		VkDescriptorPool m_descriptorPool = VK_NULL_HANDLE;
+		VkDescriptorSetLayout m_setLayout = VK_NULL_HANDLE;
+		VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE;
+		VkPipeline m_pipeline = VK_NULL_HANDLE;
+	};
+}
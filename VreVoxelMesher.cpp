@@ -0,0 +1,240 @@
+#include "VreVoxelMesher.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+namespace {
+	constexpr int CHUNK = vre::VreVoxelMesher::CHUNK_SIZE;
+	constexpr int PADDED = CHUNK + 2;
+
+	// +x, -x, +y, -y, +z, -z. tops brightest, undersides darkest
+	constexpr int FACE_SHADES[6] = { 13, 13, 11, 11, 15, 9 };
+
+	// the buffers of buildChunk, one set per thread so a remesh allocates
+	// nothing. every build leaves the masks empty again
+	struct ChunkScratch {
+		std::vector<uint8_t> padded = std::vector<uint8_t>(PADDED * PADDED * PADDED);
+		std::vector<uint64_t> solid = std::vector<uint64_t>(PADDED * PADDED);
+		std::vector<uint8_t> masks = std::vector<uint8_t>(CHUNK * CHUNK * CHUNK, 0);
+	};
+	thread_local ChunkScratch t_scratch;
+
+	// copies the chunk and a one voxel border out of the brick map, x
+	// fastest. rows inside the map are copied a brick row at a time
+	void fillPadded(const vre::VreBrickMap &_map, int _x0, int _y0, int _z0, uint8_t *_padded) {
+		constexpr int BRICK = vre::VreBrickMap::BRICK_SIZE;
+		const uint32_t *coarse = _map.coarse();
+		const uint8_t *bricks = _map.bricks();
+		int x1 = std::min(_x0 + CHUNK, _map.voxelsX());
+		for (int z = -1; z <= CHUNK; z++) {
+			for (int y = -1; y <= CHUNK; y++) {
+				uint8_t *row = _padded + ((z + 1) * PADDED + (y + 1)) * PADDED;
+				int wy = _y0 + y;
+				int wz = _z0 + z;
+				if (wy < 0 || wz < 0 || wy >= _map.voxelsY() || wz >= _map.voxelsZ()) {
+					memset(row, 0, PADDED);
+					continue;
+				}
+				row[0] = _x0 > 0 ? _map.voxel(_x0 - 1, wy, wz) : 0;
+				row[PADDED - 1] = _x0 + CHUNK < _map.voxelsX() ? _map.voxel(_x0 + CHUNK, wy, wz) : 0;
+
+				size_t coarseRow = (static_cast<size_t>(wz >> vre::VreBrickMap::BRICK_SHIFT) * _map.bricksY()
+					+ (wy >> vre::VreBrickMap::BRICK_SHIFT)) * _map.bricksX();
+				int inBrick = vre::VreBrickMap::voxelInBrick(0, wy, wz);
+				memset(row + 1, 0, CHUNK);
+				for (int x = _x0; x < x1; x += BRICK) {
+					uint32_t entry = coarse[coarseRow + (x >> vre::VreBrickMap::BRICK_SHIFT)];
+					if (entry != 0) {
+						memcpy(row + 1 + (x - _x0), bricks + static_cast<size_t>(entry - 1)
+							* vre::VreBrickMap::BRICK_VOXELS + inBrick, BRICK);
+					}
+				}
+			}
+		}
+	}
+}
+
+vre::VreVoxelMesher::VreVoxelMesher(const VreBrickMap &_map, const VrePalette &_palette
+) : m_map{ &_map }, m_palette{ &_palette },
+	m_chunksX{ (_map.voxelsX() + CHUNK_SIZE - 1) >> CHUNK_SHIFT },
+	m_chunksY{ (_map.voxelsY() + CHUNK_SIZE - 1) >> CHUNK_SHIFT },
+	m_chunksZ{ (_map.voxelsZ() + CHUNK_SIZE - 1) >> CHUNK_SHIFT } {
+	m_chunks.resize(chunkCount());
+	m_marked.assign(chunkCount(), 0);
+	markAll();
+}
+
+void vre::VreVoxelMesher::chunkOrigin(int _index, int &_x, int &_y, int &_z) const {
+	_x = (_index % m_chunksX) << CHUNK_SHIFT;
+	_y = ((_index / m_chunksX) % m_chunksY) << CHUNK_SHIFT;
+	_z = (_index / (m_chunksX * m_chunksY)) << CHUNK_SHIFT;
+}
+
+void vre::VreVoxelMesher::markVoxel(int _x, int _y, int _z, uint8_t _before) {
+	int cx = _x >> CHUNK_SHIFT;
+	int cy = _y >> CHUNK_SHIFT;
+	int cz = _z >> CHUNK_SHIFT;
+	mark(cx, cy, cz);
+
+	// faces only test for solid neighbours, a new material is this chunk's
+	if ((_before != 0) == (m_map->voxel(_x, _y, _z) != 0)) {
+		return;
+	}
+	int local[3] = { _x & (CHUNK_SIZE - 1), _y & (CHUNK_SIZE - 1), _z & (CHUNK_SIZE - 1) };
+	for (int axis = 0; axis < 3; axis++) {
+		int offset = local[axis] == 0 ? -1 : local[axis] == CHUNK_SIZE - 1 ? 1 : 0;
+		if (offset == 0) {
+			continue;
+		}
+		int nx = _x + (axis == 0 ? offset : 0);
+		int ny = _y + (axis == 1 ? offset : 0);
+		int nz = _z + (axis == 2 ? offset : 0);
+		if (m_map->inBounds(nx, ny, nz) && m_map->voxel(nx, ny, nz) != 0) {
+			mark(nx >> CHUNK_SHIFT, ny >> CHUNK_SHIFT, nz >> CHUNK_SHIFT);
+		}
+	}
+}
+
+void vre::VreVoxelMesher::markAll() {
+	m_dirty.clear();
+	for (int i = 0; i < chunkCount(); i++) {
+		m_marked[i] = 1;
+		m_dirty.push_back(i);
+	}
+}
+
+void vre::VreVoxelMesher::mark(int _chunkX, int _chunkY, int _chunkZ) {
+	if (_chunkX < 0 || _chunkY < 0 || _chunkZ < 0 || _chunkX >= m_chunksX || _chunkY >= m_chunksY
+		|| _chunkZ >= m_chunksZ) {
+		return;
+	}
+	int index = (_chunkZ * m_chunksY + _chunkY) * m_chunksX + _chunkX;
+	if (!m_marked[index]) {
+		m_marked[index] = 1;
+		m_dirty.push_back(index);
+	}
+}
+
+std::vector<int> vre::VreVoxelMesher::rebuildDirty(VreThreadPool &_pool) {
+	std::vector<int> rebuilt;
+	rebuilt.swap(m_dirty);
+	_pool.parallelFor(static_cast<int>(rebuilt.size()), [&](int _i) {
+		int index = rebuilt[_i];
+		int x;
+		int y;
+		int z;
+		chunkOrigin(index, x, y, z);
+		buildChunk(*m_map, *m_palette, x >> CHUNK_SHIFT, y >> CHUNK_SHIFT, z >> CHUNK_SHIFT, m_chunks[index]);
+	});
+	for (int index : rebuilt) {
+		m_marked[index] = 0;
+	}
+	return rebuilt;
+}
+
+void vre::VreVoxelMesher::buildChunk(const VreBrickMap &_map, const VrePalette &_palette, int _chunkX,
+	int _chunkY, int _chunkZ, VoxelChunkMesh &_out
+) {
+	std::vector<uint8_t> &padded = t_scratch.padded;
+	fillPadded(_map, _chunkX * CHUNK, _chunkY * CHUNK, _chunkZ * CHUNK, padded.data());
+	_out.vertices.clear();
+
+	// one bit per voxel along x, bit 0 is the border voxel before the chunk
+	std::vector<uint64_t> &solid = t_scratch.solid;
+	for (size_t row = 0; row < solid.size(); row++) {
+		const uint8_t *voxels = padded.data() + row * PADDED;
+		uint64_t bits = 0;
+		for (int x = 0; x < PADDED; x++) {
+			bits |= static_cast<uint64_t>(voxels[x] != 0) << x;
+		}
+		solid[row] = bits;
+	}
+
+	// per face direction the open faces are scattered into one mask per
+	// slice, materials plus a bit per cell so the rectangle growing below
+	// only visits cells that have a face. growing clears what it takes, so
+	// the masks are empty again for the next direction
+	std::vector<uint8_t> &masks = t_scratch.masks;
+	uint32_t rowBits[CHUNK][CHUNK] = {};
+	constexpr uint64_t INSIDE = ((uint64_t(1) << CHUNK) - 1) << 1;
+
+	for (int face = 0; face < 6; face++) {
+		int axis = face >> 1;
+		bool positive = (face & 1) == 0;
+		int uAxis = (axis + 1) % 3;
+		int vAxis = (axis + 2) % 3;
+		uint32_t slices = 0;
+
+		for (int z = 0; z < CHUNK; z++) {
+			for (int y = 0; y < CHUNK; y++) {
+				size_t row = static_cast<size_t>(z + 1) * PADDED + (y + 1);
+				uint64_t bits = solid[row];
+				uint64_t open;
+				if (axis == 0) {
+					open = positive ? ~(bits >> 1) : ~(bits << 1);
+				} else if (axis == 1) {
+					open = ~solid[positive ? row + 1 : row - 1];
+				} else {
+					open = ~solid[positive ? row + PADDED : row - PADDED];
+				}
+				uint64_t faces = bits & open & INSIDE;
+				while (faces != 0) {
+					int x = static_cast<int>(std::countr_zero(faces)) - 1;
+					faces &= faces - 1;
+					int position[3] = { x, y, z };
+					int slice = position[axis];
+					int u = position[uAxis];
+					int v = position[vAxis];
+					masks[(slice * CHUNK + v) * CHUNK + u] = padded[row * PADDED + x + 1];
+					rowBits[slice][v] |= 1u << u;
+					slices |= 1u << slice;
+				}
+			}
+		}
+
+		while (slices != 0) {
+			int slice = static_cast<int>(std::countr_zero(slices));
+			slices &= slices - 1;
+			uint8_t *mask = masks.data() + slice * CHUNK * CHUNK;
+			uint32_t *bits = rowBits[slice];
+			int plane = slice + (positive ? 1 : 0);
+
+			for (int v = 0; v < CHUNK; v++) {
+				while (bits[v] != 0) {
+					int u = static_cast<int>(std::countr_zero(bits[v]));
+					uint8_t material = mask[v * CHUNK + u];
+					int w = 1;
+					while (u + w < CHUNK && mask[v * CHUNK + u + w] == material) {
+						w++;
+					}
+					int h = 1;
+					for (bool grow = true; grow && v + h < CHUNK; ) {
+						const uint8_t *row = mask + (v + h) * CHUNK + u;
+						for (int i = 0; i < w && grow; i++) {
+							grow = row[i] == material;
+						}
+						h += grow ? 1 : 0;
+					}
+					uint32_t span = (w == 32 ? ~0u : ((1u << w) - 1)) << u;
+					for (int j = 0; j < h; j++) {
+						memset(mask + (v + j) * CHUNK + u, 0, w);
+						bits[v + j] &= ~span;
+					}
+
+					uint32_t color = _palette.colors()[VrePalette::index(VrePalette::wallRamp(material),
+						FACE_SHADES[face])];
+					int corners[4][2] = { { u, v }, { u + w, v }, { u + w, v + h }, { u, v + h } };
+					for (const auto &corner : corners) {
+						int position[3];
+						position[axis] = plane;
+						position[uAxis] = corner[0];
+						position[vAxis] = corner[1];
+						_out.vertices.push_back(PackedVoxelVertex::make(position[0], position[1], position[2],
+							face, color));
+					}
+				}
+			}
+		}
+	}
+}
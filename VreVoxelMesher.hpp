@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "VreBrickMap.hpp"
+#include "VrePalette.hpp"
+#include "VreThreadPool.hpp"
+
+namespace vre {
+	// 8 bytes per vertex. position packs x, y and z inside the chunk, 0..32
+	// in 6 bits each, and the face direction above them. color is rgba8 from
+	// the palette with the face shade already applied
+	struct PackedVoxelVertex {
+		uint32_t position;
+		uint32_t color;
+
+		static PackedVoxelVertex make(int _x, int _y, int _z, int _face, uint32_t _color) {
+			return { static_cast<uint32_t>(_x | (_y << 6) | (_z << 12) | (_face << 18)), _color };
+		}
+	};
+
+	// 4 vertices per quad, drawn with a shared quad index buffer
+	struct VoxelChunkMesh {
+		std::vector<PackedVoxelVertex> vertices;
+		size_t quadCount() const { return vertices.size() / 4; }
+	};
+
+	// cuts a brick map into CHUNK_SIZE cubed chunks and meshes each one into
+	// greedy quads. a chunk is first copied brick row by brick row into a
+	// dense block with a one voxel border, so the face tests never go
+	// through the coarse grid. open faces come out of one bit row per x line
+	// of the block, and every slice of each of the 6 face directions that
+	// has any is grown into rectangles of one material
+	class VreVoxelMesher {
+	public:
+		static constexpr int CHUNK_SHIFT = 5;
+		static constexpr int CHUNK_SIZE = 1 << CHUNK_SHIFT;
+
+		VreVoxelMesher(const VreBrickMap &_map, const VrePalette &_palette);
+
+		int chunksX() const { return m_chunksX; }
+		int chunksY() const { return m_chunksY; }
+		int chunksZ() const { return m_chunksZ; }
+		int chunkCount() const { return m_chunksX * m_chunksY * m_chunksZ; }
+		const VoxelChunkMesh &chunk(int _index) const { return m_chunks[_index]; }
+		// first voxel of the chunk
+		void chunkOrigin(int _index, int &_x, int &_y, int &_z) const;
+
+		// after the voxel at (_x, _y, _z) changed from material _before. a
+		// voxel on a chunk face also marks the chunk across it, but only
+		// when it turned solid or empty and the voxel across is solid, the
+		// only case where a face over there appears or goes
+		void markVoxel(int _x, int _y, int _z, uint8_t _before);
+		void markAll();
+		bool hasDirty() const { return !m_dirty.empty(); }
+
+		// remeshes every marked chunk, one chunk per task on _pool, and
+		// returns their indices
+		std::vector<int> rebuildDirty(VreThreadPool &_pool);
+
+		static void buildChunk(const VreBrickMap &_map, const VrePalette &_palette, int _chunkX,
+			int _chunkY, int _chunkZ, VoxelChunkMesh &_out);
+
+	private:
+		void mark(int _chunkX, int _chunkY, int _chunkZ);
+
+		const VreBrickMap *m_map;
+		const VrePalette *m_palette;
+		int m_chunksX;
+		int m_chunksY;
+		int m_chunksZ;
+		std::vector<VoxelChunkMesh> m_chunks;
+		std::vector<uint8_t> m_marked;
+		std::vector<int> m_dirty;
+	};
+}
@@ -0,0 +1,234 @@
+#include "VreVoxelTracer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+#include "VrePalette.hpp"
+
+// every line of tracePixel has a twin in voxel_dda.comp, change both
+
+namespace {
+	constexpr int VOXEL = 256; // one voxel in fixed point
+	constexpr int BRICK = VOXEL << vre::VreBrickMap::BRICK_SHIFT;
+	constexpr int BRICK_FIXED_SHIFT = 8 + vre::VreBrickMap::BRICK_SHIFT;
+
+	// distance to the first boundary of a _cell sized grid along one axis,
+	// as the numerator over |d|. axes the ray never moves along get 1 and
+	// |d| = 0, which never compares as nearer
+	int firstBoundary(int _origin, int _dir, int _cell, int _cellSize) {
+		if (_dir == 0) {
+			return 1;
+		}
+		return _dir > 0 ? (_cell + 1) * _cellSize - _origin : _origin - _cell * _cellSize;
+	}
+
+	// n[a] / d[a] < n[b] / d[b] without dividing
+	bool nearer(const int *_n, const int *_absDir, int _a, int _b) {
+		return _n[_a] * _absDir[_b] < _n[_b] * _absDir[_a];
+	}
+
+	int nearestAxis(const int *_n, const int *_absDir) {
+		int axis = 0;
+		if (nearer(_n, _absDir, 1, axis)) {
+			axis = 1;
+		}
+		if (nearer(_n, _absDir, 2, axis)) {
+			axis = 2;
+		}
+		return axis;
+	}
+
+	// tops brightest, x faces and y faces darker, then a shade per 24
+	// voxels of depth. the same integer formula as the palette colormaps
+	uint8_t shadeHit(int _material, int _axis, int _n, const int *_absDir, int _centerLength) {
+		int depth = _axis < 0 ? 0 : (_n * _centerLength) / (_absDir[_axis] * VOXEL);
+		int light = (_axis == 0 ? 2 : _axis == 1 ? 4 : 0) + std::min(depth / 24, 9);
+		int ramp = vre::VrePalette::wallRamp(_material);
+		return vre::VrePalette::index(ramp, std::max(vre::VrePalette::SHADES - 1 - light, 0));
+	}
+
+	uint8_t sky(int _y, int _height) {
+		return vre::VrePalette::index(vre::VrePalette::RAMP_CEILING, 7 + (_y * 8) / _height);
+	}
+}
+
+vre::VoxelFrame vre::VoxelFrame::make(const VreBrickMap &_map, const VoxelCamera &_camera,
+	int _width, int _height, int _stride
+) {
+	VoxelFrame frame{};
+	float position[3] = { _camera.x, _camera.y, _camera.z };
+	int voxels[3] = { _map.voxelsX(), _map.voxelsY(), _map.voxelsZ() };
+	for (int a = 0; a < 3; a++) {
+		frame.origin[a] = std::clamp(static_cast<int32_t>(std::lround(position[a] * VOXEL)), 0,
+			voxels[a] * VOXEL - 1);
+	}
+
+	float cosPitch = std::cos(_camera.pitch);
+	float forward[3] = { std::cos(_camera.yaw) * cosPitch, std::sin(_camera.yaw) * cosPitch,
+		std::sin(_camera.pitch) };
+	float right[3] = { -std::sin(_camera.yaw), std::cos(_camera.yaw), 0.0f };
+	float up[3] = { forward[1] * right[2] - forward[2] * right[1],
+		forward[2] * right[0] - forward[0] * right[2], forward[0] * right[1] - forward[1] * right[0] };
+	float scale = std::tan(_camera.fov * 0.5f) * 4096.0f;
+	for (int a = 0; a < 3; a++) {
+		frame.forward[a] = static_cast<int32_t>(std::lround(forward[a] * 4096.0f));
+		frame.right[a] = static_cast<int32_t>(std::lround(right[a] * scale));
+		frame.up[a] = static_cast<int32_t>(std::lround(up[a] * scale));
+	}
+
+	frame.bricks[0] = _map.bricksX();
+	frame.bricks[1] = _map.bricksY();
+	frame.bricks[2] = _map.bricksZ();
+	frame.width = _width;
+	frame.height = _height;
+	frame.strideWords = _stride / 4;
+
+	// directions are forward * width + right * sx + up * sy, brought down
+	// to under 2^13 so distance times direction stays inside 31 bits
+	int shift = 1;
+	while ((_width >> shift) > 1) {
+		shift++;
+	}
+	frame.shift = shift + 1;
+	frame.centerLength = (4096 * _width) >> frame.shift;
+	frame.firstWord = 0;
+	frame.endWord = frame.strideWords;
+	return frame;
+}
+
+void vre::VreVoxelTracer::render(const VoxelFrame &_frame, uint8_t *_out,
+	VreThreadPool &_pool
+) const {
+	renderColumns(_frame, 0, _frame.width, _out, _pool);
+}
+
+void vre::VreVoxelTracer::renderColumns(const VoxelFrame &_frame, int _x0, int _x1,
+	uint8_t *_out, VreThreadPool &_pool
+) const {
+	constexpr int BAND = 8;
+	int stride = _frame.strideWords * 4;
+	_pool.parallelFor((_frame.height + BAND - 1) / BAND, [&](int _band) {
+		for (int y = _band * BAND; y < std::min((_band + 1) * BAND, _frame.height); y++) {
+			uint8_t *row = _out + static_cast<size_t>(y) * stride;
+			for (int x = _x0; x < _x1; x++) {
+				row[x] = tracePixel(_frame, x, y);
+			}
+		}
+	});
+}
+
+uint8_t vre::VreVoxelTracer::tracePixel(const VoxelFrame &_frame, int _x, int _y) const {
+	const uint32_t *coarse = m_map->coarse();
+	const uint8_t *bricks = m_map->bricks();
+	const int *origin = _frame.origin;
+	const int *bricksDim = _frame.bricks;
+
+	int sx = 2 * _x + 1 - _frame.width;
+	int sy = _frame.height - 2 * _y - 1;
+	int dir[3];
+	int absDir[3];
+	int step[3];
+	int brick[3];
+	int brickNext[3];
+	for (int a = 0; a < 3; a++) {
+		dir[a] = (_frame.forward[a] * _frame.width + _frame.right[a] * sx + _frame.up[a] * sy) >> _frame.shift;
+		absDir[a] = std::abs(dir[a]);
+		step[a] = dir[a] < 0 ? -1 : 1;
+		brick[a] = origin[a] >> BRICK_FIXED_SHIFT;
+		brickNext[a] = firstBoundary(origin[a], dir[a], brick[a], BRICK);
+	}
+
+	// axis and distance of the last boundary crossed, -1 while still in
+	// the camera's brick
+	int axis = -1;
+	int crossed = 0;
+	int maxBricks = bricksDim[0] + bricksDim[1] + bricksDim[2] + 3;
+	for (int i = 0; i < maxBricks; i++) {
+		uint32_t entry = coarse[(brick[2] * bricksDim[1] + brick[1]) * bricksDim[0] + brick[0]];
+		if (entry != 0) {
+			// voxel the ray enters the brick in and its next boundaries. off
+			// the crossing axis that is the number of voxel boundaries a walk
+			// over every voxel would have crossed by now, ties going to the
+			// lower axis like nearestAxis, so both walks see the same voxels
+			int voxel[3];
+			int voxelNext[3];
+			for (int b = 0; b < 3; b++) {
+				voxel[b] = origin[b] >> 8;
+				if (axis == b) {
+					voxel[b] = step[b] > 0 ? brick[b] << VreBrickMap::BRICK_SHIFT
+						: (brick[b] << VreBrickMap::BRICK_SHIFT) + VreBrickMap::BRICK_SIZE - 1;
+				}
+				voxelNext[b] = firstBoundary(origin[b], dir[b], voxel[b], VOXEL);
+				if (axis >= 0 && axis != b && dir[b] != 0) {
+					int reached = absDir[b] * crossed + (b < axis ? 1 : 0);
+					int first = voxelNext[b] * absDir[axis];
+					int span = VOXEL * absDir[axis];
+					int count = reached > first ? (reached - first + span - 1) / span : 0;
+					voxel[b] += step[b] * count;
+					voxelNext[b] += VOXEL * count;
+				}
+			}
+
+			const uint8_t *cells = bricks + static_cast<size_t>(entry - 1) * VreBrickMap::BRICK_VOXELS;
+			int hitAxis = axis;
+			int hitDistance = crossed;
+			for (;;) {
+				int material = cells[VreBrickMap::voxelInBrick(voxel[0], voxel[1], voxel[2])];
+				if (material != 0) {
+					return shadeHit(material, hitAxis, hitDistance, absDir, _frame.centerLength);
+				}
+				int a = nearestAxis(voxelNext, absDir);
+				hitAxis = a;
+				hitDistance = voxelNext[a];
+				voxel[a] += step[a];
+				voxelNext[a] += VOXEL;
+				if ((voxel[a] >> VreBrickMap::BRICK_SHIFT) != brick[a]) {
+					break;
+				}
+			}
+		}
+
+		int a = nearestAxis(brickNext, absDir);
+		axis = a;
+		crossed = brickNext[a];
+		brick[a] += step[a];
+		brickNext[a] += BRICK;
+		if (brick[a] < 0 || brick[a] >= bricksDim[a]) {
+			break;
+		}
+	}
+	return sky(_y, _frame.height);
+}
+
+uint8_t vre::VreVoxelTracer::traceDense(const VoxelFrame &_frame, int _x, int _y) const {
+	int sx = 2 * _x + 1 - _frame.width;
+	int sy = _frame.height - 2 * _y - 1;
+	int dir[3];
+	int absDir[3];
+	int step[3];
+	int voxel[3];
+	int voxelNext[3];
+	for (int a = 0; a < 3; a++) {
+		dir[a] = (_frame.forward[a] * _frame.width + _frame.right[a] * sx + _frame.up[a] * sy) >> _frame.shift;
+		absDir[a] = std::abs(dir[a]);
+		step[a] = dir[a] < 0 ? -1 : 1;
+		voxel[a] = _frame.origin[a] >> 8;
+		voxelNext[a] = firstBoundary(_frame.origin[a], dir[a], voxel[a], VOXEL);
+	}
+
+	int hitAxis = -1;
+	int hitDistance = 0;
+	while (m_map->inBounds(voxel[0], voxel[1], voxel[2])) {
+		int material = m_map->voxel(voxel[0], voxel[1], voxel[2]);
+		if (material != 0) {
+			return shadeHit(material, hitAxis, hitDistance, absDir, _frame.centerLength);
+		}
+		int a = nearestAxis(voxelNext, absDir);
+		hitAxis = a;
+		hitDistance = voxelNext[a];
+		voxel[a] += step[a];
+		voxelNext[a] += VOXEL;
+	}
+	return sky(_y, _frame.height);
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+
+#include "VreBrickMap.hpp"
+#include "VreThreadPool.hpp"
+
+namespace vre {
+	// eye in the voxel world, position in voxels, z up. yaw 0 looks along +x
+	struct VoxelCamera {
+		float x;
+		float y;
+		float z;
+		float yaw;
+		float pitch;
+		float fov = 1.0471976f; // horizontal, 60 degrees
+	};
+
+	// one frame of voxel rays in the fixed point the cpu tracer and
+	// voxel_dda.comp share. made once per frame on the cpu and pushed to the
+	// shader unchanged, after that both sides only do integer math, so they
+	// agree on every pixel. the layout matches the shader's push constants
+	struct VoxelFrame {
+		int32_t origin[4]; // camera in 1/256 voxels
+		int32_t forward[4]; // camera basis in 1/4096, right and up already
+		int32_t right[4]; // scaled by tan(fov / 2)
+		int32_t up[4];
+		int32_t bricks[4]; // brick grid dimensions
+		int32_t width;
+		int32_t height;
+		int32_t strideWords; // output row pitch in uints
+		int32_t shift; // pixel directions are shifted down by this
+		int32_t centerLength; // length of the centre ray's direction
+		// uints of every row the shader writes, [firstWord, endWord). a
+		// hybrid frame leaves the columns past endWord * 4 to the cpu
+		int32_t firstWord;
+		int32_t endWord;
+
+		// _stride is the output row pitch in bytes, a multiple of 4. the
+		// camera is clamped into the map
+		static VoxelFrame make(const VreBrickMap &_map, const VoxelCamera &_camera,
+			int _width, int _height, int _stride);
+	};
+
+	// amanatides and woo over the brick map, on the cpu. the outer walk
+	// steps brick by brick and only descends into bricks that exist, where
+	// an inner walk steps voxel by voxel. all ray distances are kept as
+	// fractions n / |d| and compared by cross multiplying, so a step has no
+	// division and nothing depends on float rounding. writes 8 bit palette
+	// indices like the cpu renderer
+	class VreVoxelTracer {
+	public:
+		void bindMap(const VreBrickMap &_map) { m_map = &_map; }
+
+		// stride * height bytes into _out, row bands on _pool
+		void render(const VoxelFrame &_frame, uint8_t *_out, VreThreadPool &_pool) const;
+		// only columns [_x0, _x1) of every row, the rest of _out is untouched
+		void renderColumns(const VoxelFrame &_frame, int _x0, int _x1, uint8_t *_out,
+			VreThreadPool &_pool) const;
+		uint8_t tracePixel(const VoxelFrame &_frame, int _x, int _y) const;
+		// the same ray stepped through every voxel on one level, the
+		// reference the brick walk has to match exactly
+		uint8_t traceDense(const VoxelFrame &_frame, int _x, int _y) const;
+
+		const VreBrickMap *map() const { return m_map; }
+
+	private:
+		const VreBrickMap *m_map = nullptr;
+	};
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "VreRaycaster.hpp"
+#include "VreSegmentMap.hpp"
+
+namespace vre {
+	// anything that can turn a camera into one RayHit per screen column.
+	// the column renderers only see this, not the map type behind it
+	class VreWorldRenderer {
+	public:
+		virtual ~VreWorldRenderer() {}
+
+		// fills _out[0, _columnCount) for the columns starting at
+		// _firstColumn, columns with nothing in them get cell 0
+		virtual void castColumns(const RayCamera &_camera, int _firstColumn,
+			int _columnCount, int _screenWidth, RayHit *_out) = 0;
+
+		virtual const char *name() const = 0;
+	};
+
+	namespace raycast {
+		// RayHit for a ray that met _segment at ray parameter _t and segment
+		// parameter _s. wallU runs along the segment, mapX/mapY is the cell
+		// just behind the wall like the grid kernels report
+		inline void finishSegmentHit(const Segment &_segment, float _x, float _y,
+			float _dirX, float _dirY, float _t, float _s, float _invCellSize, RayHit &_out
+		) {
+			float edgeX = _segment.x2 - _segment.x1;
+			float edgeY = _segment.y2 - _segment.y1;
+			float along = _s * std::sqrt(edgeX * edgeX + edgeY * edgeY) * _invCellSize;
+
+			_out.distance = _t;
+			_out.wallU = along - std::floor(along);
+			_out.mapX = static_cast<int>(std::floor((_x + _dirX * (_t + 0.01f)) * _invCellSize));
+			_out.mapY = static_cast<int>(std::floor((_y + _dirY * (_t + 0.01f)) * _invCellSize));
+			_out.cell = _segment.wall;
+			_out.side = std::abs(edgeX) >= std::abs(edgeY) ? 1 : 0;
+		}
+	}
+
+	// grid maps, walks cells through VreRaycaster
+	class VreGridRenderer : public VreWorldRenderer {
+	public:
+		explicit VreGridRenderer(const VreRaycaster &_raycaster) : m_raycaster(&_raycaster) {}
+
+		void castColumns(const RayCamera &_camera, int _firstColumn,
+			int _columnCount, int _screenWidth, RayHit *_out
+		) override {
+			m_raycaster->castColumns(_camera, _firstColumn, _columnCount, _screenWidth, _out);
+		}
+
+		const char *name() const override { return "grid"; }
+
+	private:
+		const VreRaycaster *m_raycaster;
+	};
+}
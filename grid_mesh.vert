@@ -0,0 +1,16 @@
+#version 450
+
+layout (location = 0) in vec3 in_position;
+layout (location = 1) in vec4 in_color;
+
+layout (location = 0) out vec4 fragColor;
+
+// cells to clip space, see VreGridMesh::cameraMatrix
+layout(push_constant) uniform Push {
+	mat4 viewProjection;
+} push;
+
+void main() {
+	gl_Position = push.viewProjection * vec4(in_position, 1.0);
+	fragColor = in_color;
+}
@@ -13,6 +13,8 @@
 #include "Game.hpp"
 #include "View.hpp"
 #include "Controller.hpp"
+#include "VreBenchmark.hpp"
+#include "VreHeadless.hpp"
 
 
 std::chrono::steady_clock::time_point frameStart, frameEnd;
@@ -37,6 +39,19 @@ static void calculateFPS(View *_view) {
 
 
 int main(int argc, char *argv[]) {
+	if (argc > 1 && std::string(argv[1]) == "--bench") {
+		return vre::bench::run(argc > 2 ? argv[2] : "all") ? 0 : 1;
+	}
+	if (argc > 1 && std::string(argv[1]) == "--headless") {
+		int frames = argc > 2 ? std::stoi(argv[2]) : 600;
+		return vre::headless::run(frames, argc > 3 ? argv[3] : "ray_stats.json") ? 0 : 1;
+	}
+	if (argc > 1 && std::string(argv[1]) == "--batch") {
+		int envs = argc > 2 ? std::stoi(argv[2]) : 4096;
+		vre::headless::runBatch(envs, argc > 3 ? std::stoi(argv[3]) : 1000);
+		return 0;
+	}
+
 	// Init MVC
 	Game game;
 
@@ -1,5 +1,17 @@
 glslc.exe -c ../triangle.vert -o ../triangle.vert.spv
 glslc.exe -c ../triangle.frag -o ../triangle.frag.spv
+glslc.exe -c ../palette_expand.comp -o ../palette_expand.comp.spv
+glslc.exe -c ../voxel_dda.comp -o ../voxel_dda.comp.spv
+glslc.exe -c ../grid_mesh.vert -o ../grid_mesh.vert.spv
+glslc.exe -c ../grid_mesh.frag -o ../grid_mesh.frag.spv
+glslc.exe -c ../voxel_mesh.vert -o ../voxel_mesh.vert.spv
+glslc.exe -c ../sky.comp -o ../sky.comp.spv
 echo "done"
 spirv-val.exe ../triangle.frag.spv
+spirv-val.exe --target-env vulkan1.0 ../palette_expand.comp.spv
+spirv-val.exe --target-env vulkan1.0 ../voxel_dda.comp.spv
+spirv-val.exe --target-env vulkan1.0 ../grid_mesh.vert.spv
+spirv-val.exe --target-env vulkan1.0 ../grid_mesh.frag.spv
+spirv-val.exe --target-env vulkan1.0 ../voxel_mesh.vert.spv
+spirv-val.exe --target-env vulkan1.0 ../sky.comp.spv
 pause
\ No newline at end of file
@@ -0,0 +1,21 @@
+#version 450
+
+// PackedVoxelVertex, see VreVoxelMesher.hpp
+layout (location = 0) in uint in_position;
+layout (location = 1) in vec4 in_color;
+
+layout (location = 0) out vec4 fragColor;
+
+// voxels to clip space, see VreVoxelChunks::cameraMatrix
+layout(push_constant) uniform Push {
+	mat4 viewProjection;
+	ivec4 origin;
+} push;
+
+void main() {
+	// the face bits above z are left out, the color already carries the shade
+	uvec3 local = uvec3(in_position, in_position >> 6, in_position >> 12) & 63u;
+	vec3 position = vec3(push.origin.xyz + ivec3(local));
+	gl_Position = push.viewProjection * vec4(position, 1.0);
+	fragColor = in_color;
+}